@@ -0,0 +1,361 @@
+#include "bindiff.h"
+
+#include <QHash>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const qint64 SMALL_GAP_LIMIT = 4096;    // Gaps up to this size are refined with Myers
+const int MYERS_MAX_EDITS = 256;
+const quint32 HASH_BASE = 0x01000193;
+const int MAX_ANCHOR_TRIES = 8;         // Blocks with the same hash checked byte by byte per position
+const qint64 MATCH_PROBE = 4096;        // How far an anchor candidate is followed to rank it
+const qint64 SHIFT_COST = 16;           // Bytes moved off the alignment that cost one matched byte
+
+// A hashed block of A
+struct Anchor {
+    quint32 hash;
+    qint64 pos;
+
+    bool operator<(const Anchor &other) const {
+        return hash != other.hash ? hash < other.hash : pos < other.pos;
+    }
+};
+
+void appendRange(QVector<DiffRange> &out, qint64 aStart, qint64 aLength, qint64 bStart, qint64 bLength) {
+    if (aLength == 0 && bLength == 0) return;
+    if (!out.isEmpty()) {
+        DiffRange &last = out.last();
+        if (last.aStart + last.aLength == aStart && last.bStart + last.bLength == bStart) {
+            last.aLength += aLength;
+            last.bLength += bLength;
+            return;
+        }
+    }
+    DiffRange r;
+    r.aStart = aStart;
+    r.aLength = aLength;
+    r.bStart = bStart;
+    r.bLength = bLength;
+    out.append(r);
+}
+
+quint32 hashWindow(const uchar *p, qint64 k) {
+    quint32 h = 0;
+    for (qint64 i = 0; i < k; ++i) {
+        h = h * HASH_BASE + p[i];
+    }
+    return h;
+}
+
+void refineGap(const uchar *a, qint64 a0, qint64 a1, const uchar *b, qint64 b0, qint64 b1, QVector<DiffRange> &out) {
+    qint64 aLen = a1 - a0;
+    qint64 bLen = b1 - b0;
+    if (aLen == 0 && bLen == 0) return;
+
+    if (aLen > 0 && bLen > 0 && aLen <= SMALL_GAP_LIMIT && bLen <= SMALL_GAP_LIMIT) {
+        QVector<DiffRange> fine;
+        if (BinDiff::myers(a + a0, (int)aLen, b + b0, (int)bLen, MYERS_MAX_EDITS, a0, b0, fine)) {
+            for (const DiffRange &r : fine) {
+                appendRange(out, r.aStart, r.aLength, r.bStart, r.bLength);
+            }
+            return;
+        }
+    }
+    appendRange(out, a0, aLen, b0, bLen);
+}
+
+}
+
+namespace BinDiff {
+
+qint64 firstDifference(const uchar *a, const uchar *b, qint64 length) {
+    qint64 i = 0;
+#if defined(__SSE2__)
+    // 64 bytes per iteration; only locate the exact byte once a block differs
+    for (; i + 64 <= length; i += 64) {
+        __m128i e0 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i)));
+        __m128i e1 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i + 16)), _mm_loadu_si128((const __m128i *)(b + i + 16)));
+        __m128i e2 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i + 32)), _mm_loadu_si128((const __m128i *)(b + i + 32)));
+        __m128i e3 = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i + 48)), _mm_loadu_si128((const __m128i *)(b + i + 48)));
+        __m128i all = _mm_and_si128(_mm_and_si128(e0, e1), _mm_and_si128(e2, e3));
+        if (_mm_movemask_epi8(all) != 0xFFFF) {
+            break;
+        }
+    }
+    for (; i + 16 <= length; i += 16) {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i)));
+        quint32 mask = (quint32)_mm_movemask_epi8(eq) ^ 0xFFFFu;
+        if (mask != 0) {
+            return i + qCountTrailingZeroBits(mask);
+        }
+    }
+#else
+    for (; i + 8 <= length; i += 8) {
+        quint64 wa, wb;
+        memcpy(&wa, a + i, 8);
+        memcpy(&wb, b + i, 8);
+        if (wa != wb) break;
+    }
+#endif
+    for (; i < length; ++i) {
+        if (a[i] != b[i]) return i;
+    }
+    return length;
+}
+
+qint64 commonSuffix(const uchar *aEnd, const uchar *bEnd, qint64 limit) {
+    qint64 n = 0;
+    while (n + 8 <= limit) {
+        quint64 wa, wb;
+        memcpy(&wa, aEnd - n - 8, 8);
+        memcpy(&wb, bEnd - n - 8, 8);
+        if (wa != wb) break;
+        n += 8;
+    }
+    while (n < limit && aEnd[-n - 1] == bEnd[-n - 1]) {
+        ++n;
+    }
+    return n;
+}
+
+QVector<DiffRange> compareBlock(const uchar *a, const uchar *b, qint64 from, qint64 to, qint64 mergeGap) {
+    QVector<DiffRange> out;
+    qint64 pos = from;
+    while (pos < to) {
+        qint64 start = pos + firstDifference(a + pos, b + pos, to - pos);
+        if (start >= to) break;
+
+        qint64 end = start + 1;
+        for (;;) {
+            while (end < to && a[end] != b[end]) {
+                ++end;
+            }
+            qint64 next = end + firstDifference(a + end, b + end, to - end);
+            if (next < to && next - end < mergeGap) {
+                end = next + 1;
+                continue;
+            }
+            break;
+        }
+
+        appendRange(out, start, end - start, start, end - start);
+        pos = end;
+    }
+    return out;
+}
+
+bool myers(const uchar *a, int aSize, const uchar *b, int bSize, int maxD,
+           qint64 aBase, qint64 bBase, QVector<DiffRange> &out) {
+    maxD = std::min(maxD, aSize + bSize);
+    const int offset = maxD + 1;
+    std::vector<int> v(2 * maxD + 3, 0);
+    std::vector<std::vector<int> > trace;
+
+    int found = -1;
+    for (int d = 0; d <= maxD && found == -1; ++d) {
+        trace.push_back(v);
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1])) {
+                x = v[offset + k + 1];
+            } else {
+                x = v[offset + k - 1] + 1;
+            }
+            int y = x - k;
+            while (x < aSize && y < bSize && a[x] == b[y]) {
+                ++x;
+                ++y;
+            }
+            v[offset + k] = x;
+            if (x >= aSize && y >= bSize) {
+                found = d;
+                break;
+            }
+        }
+    }
+    if (found == -1) return false;
+
+    // Walk the trace backwards collecting single-byte edits (aPos, bPos, isInsert)
+    struct Edit { int aPos; int bPos; bool insert; };
+    std::vector<Edit> edits;
+    edits.reserve(found);
+    int x = aSize;
+    int y = bSize;
+    for (int d = found; d > 0; --d) {
+        const std::vector<int> &prev = trace[d];
+        int k = x - y;
+        int prevK;
+        if (k == -d || (k != d && prev[offset + k - 1] < prev[offset + k + 1])) {
+            prevK = k + 1;
+        } else {
+            prevK = k - 1;
+        }
+        int prevX = prev[offset + prevK];
+        int prevY = prevX - prevK;
+        Edit e;
+        e.aPos = prevX;
+        e.bPos = prevY;
+        e.insert = (prevK == k + 1);
+        edits.push_back(e);
+        x = prevX;
+        y = prevY;
+    }
+
+    for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+        if (it->insert) {
+            appendRange(out, aBase + it->aPos, 0, bBase + it->bPos, 1);
+        } else {
+            appendRange(out, aBase + it->aPos, 1, bBase + it->bPos, 0);
+        }
+    }
+    return true;
+}
+
+void alignedDiff(const uchar *a, qint64 aSize, const uchar *b, qint64 bSize, const RangeSink &sink) {
+    qint64 prefix = firstDifference(a, b, std::min(aSize, bSize));
+    qint64 suffix = commonSuffix(a + aSize, b + bSize, std::min(aSize, bSize) - prefix);
+    const qint64 aStart = prefix;
+    const qint64 aEnd = aSize - suffix;
+    const qint64 bStart = prefix;
+    const qint64 bEnd = bSize - suffix;
+
+    QVector<DiffRange> batch;
+    if (aEnd - aStart <= SMALL_GAP_LIMIT || bEnd - bStart <= SMALL_GAP_LIMIT) {
+        refineGap(a, aStart, aEnd, b, bStart, bEnd, batch);
+        sink(batch, bSize);
+        return;
+    }
+
+    // Anchor blocks: one hashed block of A every 'k' bytes keeps the index around 1M entries.
+    // All of them are kept, sorted by hash and position, so data that repeats still finds the
+    // copy after the cursor and not only the first one; the hash maps to where each run starts.
+    const qint64 k = std::max((qint64)32, (aEnd - aStart) >> 20);
+    std::vector<Anchor> index;
+    index.reserve((size_t)((aEnd - aStart) / k + 1));
+    for (qint64 p = aStart; p + k <= aEnd; p += k) {
+        index.push_back(Anchor{hashWindow(a + p, k), p});
+    }
+    std::sort(index.begin(), index.end());
+    QHash<quint32, int> runStart;
+    runStart.reserve((int)index.size());
+    for (int r = (int)index.size() - 1; r >= 0; --r) {
+        runStart.insert(index[r].hash, r);
+    }
+
+    quint32 power = 1;
+    for (qint64 i = 1; i < k; ++i) {
+        power *= HASH_BASE;
+    }
+
+    qint64 aCursor = aStart;
+    qint64 bCursor = bStart;
+    qint64 i = bStart;
+    quint32 h = (i + k <= bEnd) ? hashWindow(b + i, k) : 0;
+
+    // Block of A equal to B's window at 'pos'. Data that repeats matches further copies too, so
+    // they are ranked by how far they keep matching, less a share of how far they move off the
+    // alignment so far: a copy far ahead has to match much longer to be worth skipping to.
+    struct Anchored {
+        qint64 pos = -1;
+        qint64 length = 0;
+        qint64 shift = 0;
+
+        bool betterThan(const Anchored &other) const {
+            if (pos < 0) return false;
+            if (other.pos < 0) return true;
+            const qint64 score = length - shift / SHIFT_COST;
+            const qint64 otherScore = other.length - other.shift / SHIFT_COST;
+            return score != otherScore ? score > otherScore : shift < other.shift;
+        }
+    };
+    auto findAnchor = [&](qint64 pos, quint32 hash) {
+        Anchored best;
+        const int run = runStart.value(hash, -1);
+        if (run < 0) return best;
+        const qint64 diagonal = aCursor + (pos - bCursor);
+        auto consider = [&](qint64 candidate) {
+            if (memcmp(a + candidate, b + pos, k) != 0) return;
+            Anchored match;
+            match.pos = candidate;
+            match.length = firstDifference(a + candidate, b + pos,
+                                           std::min(MATCH_PROBE, std::min(aEnd - candidate, bEnd - pos)));
+            match.shift = std::abs(candidate - diagonal);
+            if (match.betterThan(best)) best = match;
+        };
+        if (diagonal + k <= aEnd) consider(diagonal);
+        auto it = std::lower_bound(index.begin() + run, index.end(), Anchor{hash, aCursor});
+        for (int tries = 0; it != index.end() && it->hash == hash && tries < MAX_ANCHOR_TRIES; ++it, ++tries) {
+            if (it->pos != diagonal) consider(it->pos);
+        }
+        return best;
+    };
+    auto roll = [&](quint32 hash, qint64 pos) {
+        return (hash - b[pos] * power) * HASH_BASE + b[pos + k];
+    };
+
+    while (i + k <= bEnd) {
+        Anchored anchor = findAnchor(i, h);
+        if (anchor.pos >= 0 && (anchor.shift > 0 || anchor.length < MATCH_PROBE)) {
+            // Every copy in A has a block within the next k positions, so a better one shows up there
+            const qint64 first = i;
+            quint32 ahead = h;
+            for (qint64 j = first + 1; j < first + k && j + k <= bEnd; ++j) {
+                ahead = roll(ahead, j - 1);
+                const Anchored other = findAnchor(j, ahead);
+                // Lengths from a later start are shorter by the distance moved
+                Anchored moved = other;
+                moved.length += j - first;
+                if (moved.betterThan(anchor)) {
+                    anchor = moved;
+                    i = j;
+                    h = ahead;
+                }
+            }
+        }
+        const qint64 candidate = anchor.pos;
+        if (candidate >= 0) {
+            qint64 ma = candidate;
+            qint64 mb = i;
+            while (ma > aCursor && mb > bCursor && a[ma - 1] == b[mb - 1]) {
+                --ma;
+                --mb;
+            }
+            qint64 limit = std::min(aEnd - candidate, bEnd - i);
+            qint64 matched = firstDifference(a + candidate, b + i, limit);
+
+            refineGap(a, aCursor, ma, b, bCursor, mb, batch);
+            aCursor = candidate + matched;
+            bCursor = i + matched;
+
+            if (!batch.isEmpty()) {
+                if (!sink(batch, bCursor)) return;
+                batch.clear();
+            }
+
+            i = bCursor;
+            if (i + k <= bEnd) {
+                h = hashWindow(b + i, k);
+            }
+            continue;
+        }
+
+        if (i + k < bEnd) {
+            h = roll(h, i);
+        }
+        ++i;
+    }
+
+    refineGap(a, aCursor, aEnd, b, bCursor, bEnd, batch);
+    sink(batch, bSize);
+}
+
+}
@@ -0,0 +1,41 @@
+#ifndef BINDIFF_H
+#define BINDIFF_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <functional>
+
+// Tramo distinto: [aStart, aStart + aLength) en A frente a [bStart, bStart + bLength) en B
+struct DiffRange {
+    qint64 aStart = 0;
+    qint64 aLength = 0;
+    qint64 bStart = 0;
+    qint64 bLength = 0;
+};
+
+namespace BinDiff {
+
+// Receives ranges in ascending order plus how far B has been processed. Return false to cancel.
+typedef std::function<bool(const QVector<DiffRange> &ranges, qint64 bProcessed)> RangeSink;
+
+// Index of the first differing byte, or 'length' if both buffers are equal.
+qint64 firstDifference(const uchar *a, const uchar *b, qint64 length);
+
+// Number of equal bytes at the end of both buffers, at most 'limit'.
+qint64 commonSuffix(const uchar *aEnd, const uchar *bEnd, qint64 limit);
+
+// Same-size fast path: differing ranges inside [from, to). Differences separated by
+// fewer than 'mergeGap' equal bytes are reported as one range.
+QVector<DiffRange> compareBlock(const uchar *a, const uchar *b, qint64 from, qint64 to, qint64 mergeGap = 8);
+
+// Myers O(ND) diff of two small buffers. Returns false if more than 'maxD' edits are needed.
+bool myers(const uchar *a, int aSize, const uchar *b, int bSize, int maxD,
+           qint64 aBase, qint64 bBase, QVector<DiffRange> &out);
+
+// Alignment for buffers with inserted or deleted regions: rolling-hash anchors between
+// A and B, with Myers refining the small gaps between anchors.
+void alignedDiff(const uchar *a, qint64 aSize, const uchar *b, qint64 bSize, const RangeSink &sink);
+
+}
+
+#endif // BINDIFF_H
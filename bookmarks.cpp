@@ -0,0 +1,567 @@
+#include "bookmarks.h"
+#include "hexeditorarea.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QListWidget>
+#include <QListWidgetItem>
+#include <QLineEdit>
+#include <QLabel>
+#include <QPushButton>
+#include <QPlainTextEdit>
+#include <QComboBox>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPixmap>
+#include <QIcon>
+#include <QFont>
+#include <algorithm>
+
+const int SIDECAR_VERSION = 1;
+const QColor DEFAULT_COLOR(255, 170, 0, 80);
+const int MAX_LISTED_BOOKMARKS = 5000;
+const int REFRESH_DELAY_MS = 200;
+
+// Un marcador; shift está pendiente de sumar a todo el subárbol (nodo incluido), que no se copia
+// hasta que una edición tiene que bajar por él
+struct BookmarkIndex::Node {
+    NodePtr left;
+    NodePtr right;
+    qint64 start = 0;
+    qint64 end = 0;
+    qint64 maxEnd = 0;      // Largest end in the subtree, before adding 'shift'
+    qint64 shift = 0;
+    int count = 0;
+    quint32 priority = 0;
+    QString name;
+    QString note;
+    QColor color;
+};
+
+namespace {
+
+quint32 nextPriority() {
+    // xorshift, como en PieceTable: solo tiene que parecer aleatorio
+    static quint32 state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+}
+
+int BookmarkIndex::count(const NodePtr &node) {
+    return node ? node->count : 0;
+}
+
+BookmarkIndex::NodePtr BookmarkIndex::makeNode(const NodePtr &left, const NodePtr &right, const Node &fields) {
+    QSharedPointer<Node> node = QSharedPointer<Node>::create();
+    node->left = left;
+    node->right = right;
+    node->start = fields.start;
+    node->end = fields.end;
+    node->shift = fields.shift;
+    node->priority = fields.priority;
+    node->name = fields.name;
+    node->note = fields.note;
+    node->color = fields.color;
+    // Los hijos están en el marco de este nodo: su propio shift sí cuenta, el de aquí no
+    node->maxEnd = fields.end;
+    if (left) node->maxEnd = std::max(node->maxEnd, left->maxEnd + left->shift);
+    if (right) node->maxEnd = std::max(node->maxEnd, right->maxEnd + right->shift);
+    node->count = count(left) + 1 + count(right);
+    return node;
+}
+
+BookmarkIndex::NodePtr BookmarkIndex::makeLeaf(const Bookmark &bookmark) {
+    Node fields;
+    fields.start = bookmark.start;
+    fields.end = bookmark.end;
+    fields.name = bookmark.name;
+    fields.note = bookmark.note;
+    fields.color = bookmark.color;
+    fields.priority = nextPriority();
+    return makeNode(NodePtr(), NodePtr(), fields);
+}
+
+BookmarkIndex::NodePtr BookmarkIndex::shifted(const NodePtr &node, qint64 delta) {
+    if (!node || delta == 0) return node;
+    Node fields = *node;
+    fields.shift += delta;
+    return makeNode(node->left, node->right, fields);
+}
+
+BookmarkIndex::NodePtr BookmarkIndex::pushed(const NodePtr &node) {
+    // Baja el shift a los hijos para poder comparar y reconstruir este nodo en el marco del padre
+    if (!node || node->shift == 0) return node;
+    Node fields = *node;
+    fields.start += node->shift;
+    fields.end += node->shift;
+    fields.shift = 0;
+    return makeNode(shifted(node->left, node->shift), shifted(node->right, node->shift), fields);
+}
+
+BookmarkIndex::Split BookmarkIndex::split(const NodePtr &node, qint64 pos, bool takeEqual) {
+    Split result;
+    if (!node) return result;
+    const NodePtr current = pushed(node);
+    const bool goesLeft = takeEqual ? current->start <= pos : current->start < pos;
+    if (goesLeft) {
+        Split sub = split(current->right, pos, takeEqual);
+        result.left = makeNode(current->left, sub.left, *current);
+        result.right = sub.right;
+    } else {
+        Split sub = split(current->left, pos, takeEqual);
+        result.left = sub.left;
+        result.right = makeNode(sub.right, current->right, *current);
+    }
+    return result;
+}
+
+BookmarkIndex::NodePtr BookmarkIndex::merge(const NodePtr &a, const NodePtr &b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (a->priority > b->priority) {
+        const NodePtr top = pushed(a);
+        return makeNode(top->left, merge(top->right, b), *top);
+    }
+    const NodePtr top = pushed(b);
+    return makeNode(merge(a, top->left), top->right, *top);
+}
+
+BookmarkIndex::NodePtr BookmarkIndex::eraseAt(const NodePtr &node, int index) {
+    const NodePtr current = pushed(node);
+    const int leftCount = count(current->left);
+    if (index < leftCount) return makeNode(eraseAt(current->left, index), current->right, *current);
+    if (index > leftCount) return makeNode(current->left, eraseAt(current->right, index - leftCount - 1), *current);
+    return merge(current->left, current->right);
+}
+
+BookmarkIndex::NodePtr BookmarkIndex::relabel(const NodePtr &node, int index, const Bookmark &bookmark) {
+    // El rango no cambia: los shifts se quedan donde estaban
+    const int leftCount = count(node->left);
+    if (index < leftCount) return makeNode(relabel(node->left, index, bookmark), node->right, *node);
+    if (index > leftCount) return makeNode(node->left, relabel(node->right, index - leftCount - 1, bookmark), *node);
+    Node fields = *node;
+    fields.name = bookmark.name;
+    fields.note = bookmark.note;
+    fields.color = bookmark.color;
+    return makeNode(node->left, node->right, fields);
+}
+
+BookmarkIndex::NodePtr BookmarkIndex::moveEnds(const NodePtr &node, qint64 pos, qint64 removedEnd, qint64 delta) {
+    // Solo se baja por subárboles con algún final pasado 'pos': el resto se comparte tal cual
+    if (!node || node->maxEnd + node->shift <= pos) return node;
+    const NodePtr current = pushed(node);
+    Node fields = *current;
+    if (fields.end > pos) fields.end = fields.end >= removedEnd ? fields.end + delta : pos;
+    return makeNode(moveEnds(current->left, pos, removedEnd, delta),
+                    moveEnds(current->right, pos, removedEnd, delta), fields);
+}
+
+void BookmarkIndex::collect(const NodePtr &node, qint64 frame, QVector<Bookmark> &out) {
+    if (!node) return;
+    frame += node->shift;
+    collect(node->left, frame, out);
+    Bookmark bookmark;
+    bookmark.start = node->start + frame;
+    bookmark.end = node->end + frame;
+    bookmark.name = node->name;
+    bookmark.note = node->note;
+    bookmark.color = node->color;
+    out.append(bookmark);
+    collect(node->right, frame, out);
+}
+
+Bookmark BookmarkIndex::at(int index) const {
+    Bookmark bookmark;
+    const Node *node = m_root.data();
+    qint64 frame = 0;
+    while (node) {
+        frame += node->shift;
+        const int leftCount = count(node->left);
+        if (index < leftCount) {
+            node = node->left.data();
+        } else if (index > leftCount) {
+            index -= leftCount + 1;
+            node = node->right.data();
+        } else {
+            bookmark.start = node->start + frame;
+            bookmark.end = node->end + frame;
+            bookmark.name = node->name;
+            bookmark.note = node->note;
+            bookmark.color = node->color;
+            break;
+        }
+    }
+    return bookmark;
+}
+
+QVector<Bookmark> BookmarkIndex::bookmarks() const {
+    QVector<Bookmark> result;
+    result.reserve(size());
+    collect(m_root, 0, result);
+    return result;
+}
+
+int BookmarkIndex::add(const Bookmark &bookmark) {
+    if (bookmark.end <= bookmark.start) return -1;
+    // Detrás de los que empiezan en el mismo byte
+    Split parts = split(m_root, bookmark.start, true);
+    const int index = count(parts.left);
+    m_root = merge(merge(parts.left, makeLeaf(bookmark)), parts.right);
+    return index;
+}
+
+void BookmarkIndex::removeAt(int index) {
+    if (index < 0 || index >= size()) return;
+    m_root = eraseAt(m_root, index);
+}
+
+void BookmarkIndex::setLabel(int index, const Bookmark &bookmark) {
+    if (index < 0 || index >= size()) return;
+    m_root = relabel(m_root, index, bookmark);
+}
+
+void BookmarkIndex::setBookmarks(const QVector<Bookmark> &bookmarks) {
+    QVector<Bookmark> sorted;
+    sorted.reserve(bookmarks.size());
+    for (const Bookmark &bookmark : bookmarks) {
+        if (bookmark.end > bookmark.start) sorted.append(bookmark);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const Bookmark &a, const Bookmark &b) { return a.start < b.start; });
+
+    m_root.clear();
+    for (const Bookmark &bookmark : qAsConst(sorted)) m_root = merge(m_root, makeLeaf(bookmark));
+}
+
+template <typename Visit>
+void BookmarkIndex::visit(const NodePtr &node, qint64 frame, int base, qint64 start, qint64 end, Visit &fn) {
+    // Un subárbol que acaba antes de 'start' se salta entero; a la derecha de 'end' no hay nada más
+    if (!node) return;
+    frame += node->shift;
+    if (node->maxEnd + frame <= start) return;
+    visit(node->left, frame, base, start, end, fn);
+    if (node->start + frame >= end) return;
+    const int index = base + count(node->left);
+    if (node->end + frame > start) fn(index, *node, frame);
+    visit(node->right, frame, index + 1, start, end, fn);
+}
+
+QVector<int> BookmarkIndex::indexesIn(qint64 start, qint64 end) const {
+    QVector<int> result;
+    auto append = [&result](int index, const Node &, qint64) { result.append(index); };
+    visit(m_root, 0, 0, start, end, append);
+    return result;
+}
+
+int BookmarkIndex::indexAt(qint64 offset) const {
+    const QVector<int> containing = indexesIn(offset, offset + 1);
+    return containing.isEmpty() ? -1 : containing.last();
+}
+
+void BookmarkIndex::query(qint64 start, qint64 end, QVector<HexHighlight> &out) const {
+    auto emitHighlight = [&out](int, const Node &node, qint64 frame) {
+        HexHighlight highlight;
+        highlight.start = node.start + frame;
+        highlight.end = node.end + frame;
+        highlight.color = node.color.isValid() ? node.color : DEFAULT_COLOR;
+        out.append(highlight);
+    };
+    visit(m_root, 0, 0, start, end, emitHighlight);
+}
+
+bool BookmarkIndex::insertBytes(qint64 pos, qint64 count) {
+    if (count <= 0 || !m_root) return false;
+    // Los que empiezan después se mueven con un solo shift; de los de antes solo crecen los que cruzan 'pos'
+    Split parts = split(m_root, pos, false);
+    const bool straddles = parts.left && parts.left->maxEnd + parts.left->shift > pos;
+    if (!straddles && !parts.right) return false;
+    m_root = merge(moveEnds(parts.left, pos, pos, count), shifted(parts.right, count));
+    return true;
+}
+
+bool BookmarkIndex::removeBytes(qint64 pos, qint64 count) {
+    if (count <= 0 || !m_root) return false;
+    const qint64 removedEnd = pos + count;
+    Split head = split(m_root, pos, false);
+    Split tail = split(head.right, removedEnd, false);
+    const bool straddles = head.left && head.left->maxEnd + head.left->shift > pos;
+    if (!straddles && !head.right) return false;
+
+    // Lo que empieza dentro del hueco se pega a 'pos' (y desaparece si se queda vacío); el orden
+    // por inicio se mantiene. Son los únicos nodos que se rehacen uno a uno.
+    NodePtr inside;
+    if (tail.left) {
+        QVector<Bookmark> removed;
+        removed.reserve(tail.left->count);
+        collect(tail.left, 0, removed);
+        for (Bookmark &bookmark : removed) {
+            bookmark.start = pos;
+            bookmark.end = bookmark.end >= removedEnd ? bookmark.end - count : pos;
+            if (bookmark.end > bookmark.start) inside = merge(inside, makeLeaf(bookmark));
+        }
+    }
+    m_root = merge(merge(moveEnds(head.left, pos, removedEnd, -count), inside), shifted(tail.right, -count));
+    return true;
+}
+
+bool BookmarkIndex::isSameVersion(const BookmarkIndex &other) const {
+    return m_root == other.m_root;
+}
+
+QString BookmarkIndex::sidecarPath(const QString &filePath) {
+    return filePath + ".bookmarks";
+}
+
+bool BookmarkIndex::save(const QString &path, QString *error) const {
+    if (isEmpty()) {
+        // Sin marcadores no se deja un fichero vacío al lado del documento
+        if (QFile::exists(path) && !QFile::remove(path)) {
+            if (error) *error = QFile(path).errorString();
+            return false;
+        }
+        return true;
+    }
+
+    QJsonArray list;
+    for (const Bookmark &bookmark : bookmarks()) {
+        QJsonObject entry;
+        entry["start"] = double(bookmark.start);
+        entry["length"] = double(bookmark.end - bookmark.start);
+        entry["name"] = bookmark.name;
+        if (!bookmark.note.isEmpty()) entry["note"] = bookmark.note;
+        if (bookmark.color.isValid()) entry["color"] = bookmark.color.name(QColor::HexArgb);
+        list.append(entry);
+    }
+    QJsonObject root;
+    root["version"] = SIDECAR_VERSION;
+    root["bookmarks"] = list;
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(QJsonDocument(root).toJson(QJsonDocument::Indented)) == -1) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool BookmarkIndex::load(const QString &path, QString *error) {
+    setBookmarks(QVector<Bookmark>());
+    QFile file(path);
+    if (!file.exists()) return true;
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        if (error) *error = parseError.errorString();
+        return false;
+    }
+    const QJsonObject root = document.object();
+    if (root.value("version").toInt() > SIDECAR_VERSION) {
+        if (error) *error = QObject::tr("Unsupported bookmark file version %1").arg(root.value("version").toInt());
+        return false;
+    }
+
+    const QJsonArray list = root.value("bookmarks").toArray();
+    QVector<Bookmark> bookmarks;
+    bookmarks.reserve(list.size());
+    for (const QJsonValue &value : list) {
+        const QJsonObject entry = value.toObject();
+        Bookmark bookmark;
+        bookmark.start = qint64(entry.value("start").toDouble());
+        bookmark.end = bookmark.start + qint64(entry.value("length").toDouble());
+        bookmark.name = entry.value("name").toString();
+        bookmark.note = entry.value("note").toString();
+        bookmark.color = QColor(entry.value("color").toString());
+        bookmarks.append(bookmark);
+    }
+    setBookmarks(bookmarks);
+    return true;
+}
+
+BookmarksDock::BookmarksDock(QWidget *parent)
+    : QDockWidget(tr("Bookmarks"), parent)
+{
+    setObjectName("bookmarksDock");
+    setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetClosable);
+
+    QWidget *content = new QWidget(this);
+    m_filterEdit = new QLineEdit(content);
+    m_filterEdit->setPlaceholderText(tr("Filter by name or note"));
+    m_filterEdit->setClearButtonEnabled(true);
+    QPushButton *editButton = new QPushButton(tr("Edit..."), content);
+    QPushButton *removeButton = new QPushButton(tr("Remove"), content);
+
+    m_list = new QListWidget(content);
+    m_list->setUniformItemSizes(true);
+    m_list->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    QFont mono("Monospace");
+    mono.setStyleHint(QFont::Monospace);
+    m_list->setFont(mono);
+    m_statusLabel = new QLabel(content);
+
+    QHBoxLayout *optionsLayout = new QHBoxLayout;
+    optionsLayout->addWidget(m_filterEdit, 1);
+    optionsLayout->addWidget(editButton);
+    optionsLayout->addWidget(removeButton);
+
+    QVBoxLayout *layout = new QVBoxLayout(content);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(optionsLayout);
+    layout->addWidget(m_list);
+    layout->addWidget(m_statusLabel);
+    setWidget(content);
+
+    // Insertar en modo inserción mueve marcadores en cada tecla: la lista se rehace una vez por ráfaga
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(REFRESH_DELAY_MS);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &BookmarksDock::fillList);
+    connect(m_filterEdit, &QLineEdit::textChanged, this, &BookmarksDock::scheduleRefresh);
+    connect(editButton, &QPushButton::clicked, this, &BookmarksDock::editBookmark);
+    connect(removeButton, &QPushButton::clicked, this, &BookmarksDock::removeBookmarks);
+    connect(m_list, &QListWidget::itemActivated, this, &BookmarksDock::handleItemActivated);
+    connect(m_list, &QListWidget::itemClicked, this, &BookmarksDock::handleItemActivated);
+    connect(this, &QDockWidget::visibilityChanged, this, &BookmarksDock::scheduleRefresh);
+}
+
+void BookmarksDock::setEditor(HexEditorArea *editor) {
+    if (m_editor == editor) return;
+    if (m_editor) disconnect(m_editor, &HexEditorArea::bookmarksChanged, this, &BookmarksDock::scheduleRefresh);
+    m_editor = editor;
+    if (editor) connect(editor, &HexEditorArea::bookmarksChanged, this, &BookmarksDock::scheduleRefresh);
+    fillList();
+}
+
+void BookmarksDock::scheduleRefresh() {
+    if (isVisible()) m_refreshTimer.start();
+}
+
+void BookmarksDock::fillList() {
+    m_list->clear();
+    if (!m_editor || !isVisible()) {
+        m_statusLabel->clear();
+        return;
+    }
+
+    const BookmarkIndex &bookmarks = m_editor->bookmarks();
+    const QString filter = m_filterEdit->text();
+    int matches = 0;
+    m_list->setUpdatesEnabled(false);
+    for (int i = 0; i < bookmarks.size(); ++i) {
+        const Bookmark bookmark = bookmarks.at(i);
+        if (!filter.isEmpty() && !bookmark.name.contains(filter, Qt::CaseInsensitive)
+            && !bookmark.note.contains(filter, Qt::CaseInsensitive)) {
+            continue;
+        }
+        if (++matches > MAX_LISTED_BOOKMARKS) continue;
+
+        QString text = QString("%1  %2  ").arg(bookmark.start, 8, 16, QChar('0')).toUpper().arg(bookmark.end - bookmark.start, 6);
+        QListWidgetItem *item = new QListWidgetItem(text + bookmark.name, m_list);
+        if (!bookmark.note.isEmpty()) item->setToolTip(bookmark.note);
+        item->setData(Qt::UserRole, i);
+        item->setData(Qt::UserRole + 1, bookmark.start);
+        item->setData(Qt::UserRole + 2, bookmark.end);
+    }
+    m_list->setUpdatesEnabled(true);
+
+    QString status = tr("%n bookmark(s)", "", matches);
+    if (matches > m_list->count()) {
+        status += tr(" (first %1 listed)").arg(m_list->count());
+    }
+    m_statusLabel->setText(status);
+}
+
+int BookmarksDock::indexOf(const QListWidgetItem *item) const {
+    if (!item || !m_editor) return -1;
+    const int index = item->data(Qt::UserRole).toInt();
+    const BookmarkIndex &bookmarks = m_editor->bookmarks();
+    if (index < 0 || index >= bookmarks.size()) return -1;
+    const Bookmark bookmark = bookmarks.at(index);
+    if (bookmark.start != item->data(Qt::UserRole + 1).toLongLong() || bookmark.end != item->data(Qt::UserRole + 2).toLongLong()) {
+        return -1;
+    }
+    return index;
+}
+
+void BookmarksDock::handleItemActivated(QListWidgetItem *item) {
+    if (!item || !m_editor) return;
+    const qint64 start = item->data(Qt::UserRole + 1).toLongLong();
+    emit bookmarkActivated(m_editor, start, item->data(Qt::UserRole + 2).toLongLong() - start);
+}
+
+bool BookmarksDock::editLabel(QWidget *parent, const QString &title, Bookmark *bookmark) {
+    QDialog dialog(parent);
+    dialog.setWindowTitle(title);
+    QLineEdit *nameEdit = new QLineEdit(bookmark->name, &dialog);
+    QPlainTextEdit *noteEdit = new QPlainTextEdit(bookmark->note, &dialog);
+    QComboBox *colorCombo = new QComboBox(&dialog);
+    const QList<QPair<QString, QColor>> colors = {
+        {tr("Orange"), QColor(255, 170, 0, 80)}, {tr("Blue"), QColor(70, 140, 230, 80)},
+        {tr("Green"), QColor(80, 200, 80, 80)}, {tr("Pink"), QColor(230, 90, 200, 80)},
+        {tr("Gray"), QColor(128, 128, 128, 80)}
+    };
+    for (const auto &color : colors) {
+        QPixmap swatch(12, 12);
+        swatch.fill(QColor(color.second.rgb()));
+        colorCombo->addItem(QIcon(swatch), color.first, color.second);
+        if (color.second == bookmark->color) colorCombo->setCurrentIndex(colorCombo->count() - 1);
+    }
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QFormLayout *layout = new QFormLayout(&dialog);
+    layout->addRow(tr("Name:"), nameEdit);
+    layout->addRow(tr("Color:"), colorCombo);
+    layout->addRow(tr("Note:"), noteEdit);
+    layout->addRow(buttons);
+    if (dialog.exec() != QDialog::Accepted) return false;
+
+    bookmark->name = nameEdit->text().trimmed();
+    bookmark->note = noteEdit->toPlainText();
+    bookmark->color = colorCombo->currentData().value<QColor>();
+    return true;
+}
+
+void BookmarksDock::editBookmark() {
+    const int index = indexOf(m_list->currentItem());
+    if (index < 0) return;
+    Bookmark bookmark = m_editor->bookmarks().at(index);
+    if (!editLabel(this, tr("Edit Bookmark"), &bookmark)) return;
+
+    BookmarkIndex bookmarks = m_editor->bookmarks();
+    bookmarks.setLabel(index, bookmark);
+    m_editor->setBookmarks(bookmarks);
+    emit bookmarksEdited(m_editor);
+}
+
+void BookmarksDock::removeBookmarks() {
+    QVector<int> indexes;
+    for (const QListWidgetItem *item : m_list->selectedItems()) {
+        const int index = indexOf(item);
+        if (index >= 0) indexes.append(index);
+    }
+    if (indexes.isEmpty()) return;
+
+    // De atrás hacia delante para que los índices que quedan sigan valiendo
+    std::sort(indexes.begin(), indexes.end());
+    BookmarkIndex bookmarks = m_editor->bookmarks();
+    for (int i = indexes.size() - 1; i >= 0; --i) {
+        bookmarks.removeAt(indexes.at(i));
+    }
+    m_editor->setBookmarks(bookmarks);
+    emit bookmarksEdited(m_editor);
+}
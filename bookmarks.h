@@ -0,0 +1,130 @@
+#ifndef BOOKMARKS_H
+#define BOOKMARKS_H
+
+#include <QDockWidget>
+#include <QString>
+#include <QVector>
+#include <QColor>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QTimer>
+
+#include "hexoverlay.h"
+
+class QListWidget;
+class QListWidgetItem;
+class QLineEdit;
+class QLabel;
+class HexEditorArea;
+
+// Rango con nombre: "banco de diálogos 3", "tabla de la fuente"...
+struct Bookmark {
+    qint64 start = 0;
+    qint64 end = 0;
+    QString name;
+    QString note;
+    QColor color;
+};
+
+// Bookmarks sorted by start in a treap that keeps the size and largest end of every subtree: a
+// range query is O(log n + k). An edit of the buffer moves everything after it with one pending
+// shift on a subtree, so following a keystroke is O(log n) plus the bookmarks it stretches.
+// Nodes are never modified once built, as in PieceTable: copies are O(1) and share all the
+// untouched subtrees, so undo keeps one per step.
+class BookmarkIndex : public HexOverlay
+{
+public:
+    int size() const { return count(m_root); }
+    bool isEmpty() const { return !m_root; }
+    Bookmark at(int index) const;
+
+    // Returns the index the bookmark got
+    int add(const Bookmark &bookmark);
+    void removeAt(int index);
+    // Same range, new name, note or color
+    void setLabel(int index, const Bookmark &bookmark);
+    // Replaces everything; sorts once instead of once per bookmark
+    void setBookmarks(const QVector<Bookmark> &bookmarks);
+    QVector<Bookmark> bookmarks() const;
+
+    // Indexes of the bookmarks intersecting [start, end), by start
+    QVector<int> indexesIn(qint64 start, qint64 end) const;
+    // Innermost (latest starting) bookmark containing 'offset', or -1
+    int indexAt(qint64 offset) const;
+
+    // Follow an edit of the buffer. Bookmarks after 'pos' move; one straddling it grows or shrinks,
+    // and one left empty by a removal is dropped. Return false when nothing changed.
+    bool insertBytes(qint64 pos, qint64 count);
+    bool removeBytes(qint64 pos, qint64 count);
+
+    bool isSameVersion(const BookmarkIndex &other) const;
+
+    void query(qint64 start, qint64 end, QVector<HexHighlight> &out) const override;
+
+    // Sidecar kept next to the file: "<file>.bookmarks", JSON
+    static QString sidecarPath(const QString &filePath);
+    bool save(const QString &path, QString *error = nullptr) const;
+    // A missing sidecar is not an error and leaves the index empty
+    bool load(const QString &path, QString *error = nullptr);
+
+private:
+    struct Node;
+    typedef QSharedPointer<const Node> NodePtr;
+    struct Split {
+        NodePtr left;
+        NodePtr right;
+    };
+
+    static int count(const NodePtr &node);
+    static NodePtr makeNode(const NodePtr &left, const NodePtr &right, const Node &fields);
+    static NodePtr makeLeaf(const Bookmark &bookmark);
+    static NodePtr shifted(const NodePtr &node, qint64 delta);
+    static NodePtr pushed(const NodePtr &node);
+    static Split split(const NodePtr &node, qint64 pos, bool takeEqual);
+    static NodePtr merge(const NodePtr &a, const NodePtr &b);
+    static NodePtr eraseAt(const NodePtr &node, int index);
+    static NodePtr relabel(const NodePtr &node, int index, const Bookmark &bookmark);
+    static NodePtr moveEnds(const NodePtr &node, qint64 pos, qint64 removedEnd, qint64 delta);
+    static void collect(const NodePtr &node, qint64 frame, QVector<Bookmark> &out);
+    template <typename Visit>
+    static void visit(const NodePtr &node, qint64 frame, int base, qint64 start, qint64 end, Visit &fn);
+
+    NodePtr m_root;
+};
+
+// Lista de marcadores del documento activo, con filtro por nombre o nota
+class BookmarksDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit BookmarksDock(QWidget *parent = nullptr);
+
+    void setEditor(HexEditorArea *editor);
+
+    // Name, note and color of 'bookmark'; false when cancelled
+    static bool editLabel(QWidget *parent, const QString &title, Bookmark *bookmark);
+
+signals:
+    void bookmarkActivated(HexEditorArea *editor, qint64 offset, qint64 length);
+    // The user renamed or removed bookmarks of 'editor' from the list
+    void bookmarksEdited(HexEditorArea *editor);
+
+private slots:
+    void scheduleRefresh();
+    void fillList();
+    void handleItemActivated(QListWidgetItem *item);
+    void editBookmark();
+    void removeBookmarks();
+
+private:
+    // Index of the bookmark an item was made from; -1 when it has moved or is gone
+    int indexOf(const QListWidgetItem *item) const;
+
+    QPointer<HexEditorArea> m_editor;
+    QLineEdit *m_filterEdit = nullptr;
+    QListWidget *m_list = nullptr;
+    QLabel *m_statusLabel = nullptr;
+    QTimer m_refreshTimer;
+};
+
+#endif // BOOKMARKS_H
@@ -0,0 +1,179 @@
+#include "byteops.h"
+#include "patchengine.h"
+#include "piecetable.h"
+#include "perftrace.h"
+
+#include <QCryptographicHash>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BYTE_OPS_SSE2
+#endif
+
+const qint64 CHUNK_BYTES = 1 << 20;     // Work between two looks at the cancel flag
+const int MIN_KEY_BLOCK = 4096;
+
+namespace {
+
+int gcd(int a, int b) {
+    while (b) {
+        const int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// La clave repetida hasta un múltiplo de 16 de al menos 4 KB: el bucle interno va siempre
+// por vectores enteros y recorre el bloque de principio a fin
+QByteArray keyBlock(const QByteArray &key) {
+    const int period = key.size() * 16 / gcd(key.size(), 16);
+    const int copies = (std::max(period, MIN_KEY_BLOCK) + period - 1) / period * period / key.size();
+    return key.repeated(copies);
+}
+
+void combine(uchar *data, qint64 size, const uchar *key, ByteOps::Transform op) {
+    qint64 i = 0;
+#ifdef BYTE_OPS_SSE2
+    for (; i + 16 <= size; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + i));
+        __m128i r;
+        switch (op) {
+        case ByteOps::Add: r = _mm_add_epi8(v, k); break;
+        case ByteOps::Subtract: r = _mm_sub_epi8(v, k); break;
+        default: r = _mm_xor_si128(v, k); break;
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), r);
+    }
+#endif
+    for (; i < size; ++i) {
+        switch (op) {
+        case ByteOps::Add: data[i] = uchar(data[i] + key[i]); break;
+        case ByteOps::Subtract: data[i] = uchar(data[i] - key[i]); break;
+        default: data[i] ^= key[i]; break;
+        }
+    }
+}
+
+// Recorre 'data' con el bloque empezando en la posición 'phase' del bloque
+void applyBlock(uchar *data, qint64 size, const QByteArray &block, qint64 phase, ByteOps::Transform op) {
+    const uchar *key = reinterpret_cast<const uchar *>(block.constData());
+    qint64 pos = phase;
+    for (qint64 i = 0; i < size;) {
+        const qint64 n = std::min(size - i, block.size() - pos);
+        if (op == ByteOps::Fill) {
+            memcpy(data + i, key + pos, n);
+        } else {
+            combine(data + i, n, key + pos, op);
+        }
+        i += n;
+        pos = 0;
+    }
+}
+
+void rotateLeft(uchar *data, qint64 size, int bits) {
+    qint64 i = 0;
+#ifdef BYTE_OPS_SSE2
+    // No hay desplazamientos de 8 bits: se desplaza de 16 en 16 y se quita lo que pasa al byte vecino
+    const __m128i highMask = _mm_set1_epi8((char)(0xFF << bits));
+    const __m128i lowMask = _mm_set1_epi8((char)(0xFF >> (8 - bits)));
+    for (; i + 16 <= size; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i r = _mm_or_si128(_mm_and_si128(_mm_slli_epi16(v, bits), highMask),
+                                       _mm_and_si128(_mm_srli_epi16(v, 8 - bits), lowMask));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), r);
+    }
+#endif
+    for (; i < size; ++i) {
+        data[i] = uchar(data[i] << bits | data[i] >> (8 - bits));
+    }
+}
+
+void swapWords(uchar *data, qint64 size, int width) {
+    qint64 i = 0;
+#ifdef BYTE_OPS_SSE2
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        if (width == 4) {
+            // Después de invertir cada mitad, se intercambian las dos mitades de 16 bits
+            v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xB1), 0xB1);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), v);
+    }
+#endif
+    for (; i + width <= size; i += width) {
+        std::reverse(data + i, data + i + width);
+    }
+}
+
+}
+
+bool ByteOps::transform(uchar *data, qint64 size, const TransformSpec &spec, const QAtomicInt *cancel) {
+    HT_PROFILE_SCOPE("byteTransform");
+    HT_PROFILE_BYTES(size);
+    const bool keyed = spec.op == Fill || spec.op == Xor || spec.op == Add || spec.op == Subtract;
+    if (keyed && spec.operand.isEmpty()) return true;
+    const QByteArray block = keyed ? keyBlock(spec.operand) : QByteArray();
+    const int bits = spec.op == RotateRight ? 8 - (spec.bits & 7) : spec.bits & 7;
+
+    // Trozos múltiplos de 4 para no partir palabras
+    for (qint64 offset = 0; offset < size; offset += CHUNK_BYTES) {
+        if (cancel && cancel->loadAcquire()) return false;
+        const qint64 n = std::min(CHUNK_BYTES, size - offset);
+        uchar *chunk = data + offset;
+        switch (spec.op) {
+        case Fill:
+        case Xor:
+        case Add:
+        case Subtract:
+            applyBlock(chunk, n, block, offset % block.size(), spec.op);
+            break;
+        case RotateLeft:
+        case RotateRight:
+            if (bits != 0) rotateLeft(chunk, n, bits);
+            break;
+        case Swap16:
+            swapWords(chunk, n, 2);
+            break;
+        case Swap32:
+            swapWords(chunk, n, 4);
+            break;
+        }
+    }
+    return true;
+}
+
+quint32 ByteOps::crc32(const uchar *data, qint64 size, quint32 previous) {
+    // La misma que comprueban los parches
+    return PatchEngine::crc32(data, size, previous);
+}
+
+bool ByteOps::digests(const PieceTable &buffer, qint64 from, qint64 length, Digests *out, const QAtomicInt *cancel) {
+    HT_PROFILE_SCOPE("selectionDigests");
+    HT_PROFILE_BYTES(length);
+    QCryptographicHash md5(QCryptographicHash::Md5);
+    QCryptographicHash sha1(QCryptographicHash::Sha1);
+    QCryptographicHash sha256(QCryptographicHash::Sha256);
+    quint32 crc = 0;
+    // Cada trozo pasa por los cuatro mientras sigue en caché
+    QByteArray block((int)std::min(CHUNK_BYTES, length), '\0');
+    for (qint64 offset = 0; offset < length; offset += CHUNK_BYTES) {
+        if (cancel && cancel->loadAcquire()) return false;
+        const int n = (int)std::min(CHUNK_BYTES, length - offset);
+        char *chunk = block.data();
+        buffer.read(from + offset, n, chunk);
+        crc = crc32(reinterpret_cast<const uchar *>(chunk), n, crc);
+        md5.addData(chunk, n);
+        sha1.addData(chunk, n);
+        sha256.addData(chunk, n);
+    }
+    out->crc32 = crc;
+    out->md5 = md5.result();
+    out->sha1 = sha1.result();
+    out->sha256 = sha256.result();
+    return true;
+}
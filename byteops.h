@@ -0,0 +1,48 @@
+#ifndef BYTEOPS_H
+#define BYTEOPS_H
+
+#include <QByteArray>
+#include <QAtomicInt>
+
+class PieceTable;
+
+// Operaciones sobre bloques de bytes para la selección: transformaciones en el sitio y sumas de control
+namespace ByteOps {
+
+enum Transform {
+    Fill,           // Repeat 'operand' over the range
+    Xor,            // Combine with 'operand' used as a repeating key
+    Add,
+    Subtract,
+    RotateLeft,     // Rotate the bits of every byte by 'bits'
+    RotateRight,
+    Swap16,         // Reverse the bytes of each 16/32-bit word; a trailing partial word is left alone
+    Swap32
+};
+
+struct TransformSpec {
+    Transform op = Xor;
+    QByteArray operand;
+    int bits = 1;
+};
+
+struct Digests {
+    quint32 crc32 = 0;
+    QByteArray md5;
+    QByteArray sha1;
+    QByteArray sha256;
+};
+
+// Applies 'spec' to data[0, size) in place. The key or pattern starts at data[0]. Returns false
+// when 'cancel' was set before it finished (the data is then partly transformed).
+bool transform(uchar *data, qint64 size, const TransformSpec &spec, const QAtomicInt *cancel = nullptr);
+
+// CRC-32 (IEEE, as in zip and png); pass the previous result to continue a running checksum
+quint32 crc32(const uchar *data, qint64 size, quint32 previous = 0);
+
+// All four digests of buffer[from, from + length) in a single pass, read a chunk at a time
+bool digests(const PieceTable &buffer, qint64 from, qint64 length, Digests *out, const QAtomicInt *cancel = nullptr);
+
+}
+
+#endif // BYTEOPS_H
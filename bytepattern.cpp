@@ -0,0 +1,675 @@
+#include "bytepattern.h"
+#include "chartable.h"
+
+#include <QCoreApplication>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const int MAX_POSITIONS = 4096;
+const int MAX_REPEAT = 1024;
+const int MAX_DFA_STATES = 2048;    // Beyond this the DFA cache is flushed and rebuilt
+const qint64 CANCEL_CHECK_BYTES = 1 << 20;
+
+QString tr(const char *text) {
+    return QCoreApplication::translate("BytePattern", text);
+}
+
+struct ByteSet {
+    quint64 w[4] = { 0, 0, 0, 0 };
+
+    void add(int b) { w[b >> 6] |= Q_UINT64_C(1) << (b & 63); }
+    bool has(int b) const { return (w[b >> 6] >> (b & 63)) & 1; }
+    void invert() { for (int i = 0; i < 4; ++i) w[i] = ~w[i]; }
+};
+
+struct Node {
+    enum Kind { Set, Concat, Alt, Repeat };
+    Kind kind = Set;
+    ByteSet set;
+    QVector<int> children;
+    int min = 1;
+    int max = 1;    // -1 = unbounded
+};
+
+inline void setBit(quint64 *words, int bit) {
+    words[bit >> 6] |= Q_UINT64_C(1) << (bit & 63);
+}
+
+int hexValue(QChar c) {
+    ushort u = c.unicode();
+    if (u >= '0' && u <= '9') return u - '0';
+    if (u >= 'a' && u <= 'f') return u - 'a' + 10;
+    if (u >= 'A' && u <= 'F') return u - 'A' + 10;
+    return -1;
+}
+
+}
+
+// Parser recursivo más construcción de Glushkov (una posición por byte del patrón)
+class PatternCompiler
+{
+public:
+    PatternCompiler(const QString &text, const CharTable *table) : m_text(text), m_table(table) {}
+
+    bool run(BytePattern *out, QString *error);
+
+private:
+    struct Frag {
+        QVector<int> first;
+        QVector<int> last;
+        bool nullable = true;
+    };
+
+    int addNode(const Node &node) {
+        m_nodes.push_back(node);
+        return (int)m_nodes.size() - 1;
+    }
+    int fail(const QString &message) {
+        if (m_error.isEmpty()) m_error = message;
+        return -1;
+    }
+
+    bool atEnd() const { return m_pos >= m_text.size(); }
+    QChar peek() const { return atEnd() ? QChar() : m_text.at(m_pos); }
+    void skipSpaces() {
+        while (!atEnd() && m_text.at(m_pos).isSpace()) ++m_pos;
+    }
+    int parseNumber();
+
+    int parseAlt();
+    int parseConcat();
+    int parseRepeat();
+    int parseAtom();
+    int parseByte(ByteSet *set, bool *exact);
+
+    Frag build(int node);
+    int maxLength(int node) const;
+    Frag concat(const Frag &a, const Frag &b);
+    void link(const QVector<int> &from, const QVector<int> &to);
+
+    QString m_text;
+    int m_pos = 0;
+    const CharTable *m_table;
+    QString m_error;
+    std::vector<Node> m_nodes;
+    QVector<ByteSet> m_sets;
+    QVector<QVector<int>> m_followList;
+    bool m_tooLarge = false;
+};
+
+int PatternCompiler::parseNumber() {
+    skipSpaces();
+    int start = m_pos;
+    int value = 0;
+    while (!atEnd() && peek().isDigit()) {
+        value = value * 10 + peek().digitValue();
+        if (value > MAX_REPEAT) {
+            return fail(tr("Repetition counts are limited to %1.").arg(MAX_REPEAT));
+        }
+        ++m_pos;
+    }
+    if (m_pos == start) {
+        return fail(tr("Number expected at position %1.").arg(m_pos + 1));
+    }
+    return value;
+}
+
+int PatternCompiler::parseAlt() {
+    int first = parseConcat();
+    if (first < 0) return -1;
+    skipSpaces();
+    if (peek() != '|') return first;
+
+    Node alt;
+    alt.kind = Node::Alt;
+    alt.children.append(first);
+    while (peek() == '|') {
+        ++m_pos;
+        int next = parseConcat();
+        if (next < 0) return -1;
+        alt.children.append(next);
+        skipSpaces();
+    }
+    return addNode(alt);
+}
+
+int PatternCompiler::parseConcat() {
+    Node concat;
+    concat.kind = Node::Concat;
+    for (;;) {
+        skipSpaces();
+        if (atEnd() || peek() == '|' || peek() == ')') break;
+        int item = parseRepeat();
+        if (item < 0) return -1;
+        concat.children.append(item);
+    }
+    if (concat.children.isEmpty()) {
+        return fail(tr("Empty pattern or alternative at position %1.").arg(m_pos + 1));
+    }
+    if (concat.children.size() == 1) return concat.children.first();
+    return addNode(concat);
+}
+
+int PatternCompiler::parseRepeat() {
+    int atom = parseAtom();
+    if (atom < 0) return -1;
+
+    for (;;) {
+        skipSpaces();
+        QChar c = peek();
+        Node repeat;
+        repeat.kind = Node::Repeat;
+        if (c == '*') {
+            ++m_pos;
+            repeat.min = 0;
+            repeat.max = -1;
+        } else if (c == '+') {
+            ++m_pos;
+            repeat.min = 1;
+            repeat.max = -1;
+        } else if (c == '{') {
+            ++m_pos;
+            repeat.min = parseNumber();
+            if (repeat.min < 0) return -1;
+            repeat.max = repeat.min;
+            skipSpaces();
+            if (peek() == ',') {
+                ++m_pos;
+                skipSpaces();
+                if (peek() == '}') {
+                    repeat.max = -1;
+                } else {
+                    repeat.max = parseNumber();
+                    if (repeat.max < 0) return -1;
+                }
+            }
+            skipSpaces();
+            if (peek() != '}') return fail(tr("'}' expected at position %1.").arg(m_pos + 1));
+            ++m_pos;
+            if (repeat.max == 0 || (repeat.max != -1 && repeat.max < repeat.min)) {
+                return fail(tr("Invalid repetition before position %1.").arg(m_pos + 1));
+            }
+        } else {
+            return atom;
+        }
+        repeat.children.append(atom);
+        atom = addNode(repeat);
+    }
+}
+
+// Two characters, each a hex digit or '?'. 'exact' tells whether no nibble was a wildcard.
+int PatternCompiler::parseByte(ByteSet *set, bool *exact) {
+    if (m_pos + 1 >= m_text.size()) {
+        return fail(tr("Incomplete byte at position %1.").arg(m_pos + 1));
+    }
+    QChar hiChar = m_text.at(m_pos);
+    QChar loChar = m_text.at(m_pos + 1);
+    int hi = hexValue(hiChar);
+    int lo = hexValue(loChar);
+    if ((hi < 0 && hiChar != '?') || (lo < 0 && loChar != '?')) {
+        return fail(tr("Invalid byte \"%1%2\" at position %3.").arg(hiChar).arg(loChar).arg(m_pos + 1));
+    }
+    m_pos += 2;
+
+    int mask = (hi >= 0 ? 0xF0 : 0) | (lo >= 0 ? 0x0F : 0);
+    int value = ((hi >= 0 ? hi : 0) << 4) | (lo >= 0 ? lo : 0);
+    for (int b = 0; b < 256; ++b) {
+        if ((b & mask) == value) set->add(b);
+    }
+    *exact = (mask == 0xFF);
+    return value;
+}
+
+int PatternCompiler::parseAtom() {
+    skipSpaces();
+    QChar c = peek();
+
+    if (c == '(') {
+        ++m_pos;
+        int inner = parseAlt();
+        if (inner < 0) return -1;
+        skipSpaces();
+        if (peek() != ')') return fail(tr("')' expected at position %1.").arg(m_pos + 1));
+        ++m_pos;
+        return inner;
+    }
+
+    if (c == '"') {
+        ++m_pos;
+        Node text;
+        text.kind = Node::Concat;
+        while (!atEnd() && peek() != '"') {
+            QChar ch = peek();
+            if (ch == '\\' && m_pos + 1 < m_text.size()) {
+                ch = m_text.at(++m_pos);
+            }
+            ++m_pos;
+            int byte = m_table ? m_table->byteFor(ch) : (ch.unicode() < 256 ? ch.unicode() : -1);
+            if (byte < 0) {
+                return fail(tr("Character '%1' is not in the table.").arg(ch));
+            }
+            Node n;
+            n.set.add(byte);
+            text.children.append(addNode(n));
+        }
+        if (atEnd()) return fail(tr("Unterminated text."));
+        ++m_pos;
+        if (text.children.isEmpty()) return fail(tr("Empty text at position %1.").arg(m_pos));
+        return text.children.size() == 1 ? text.children.first() : addNode(text);
+    }
+
+    if (c == '[') {
+        ++m_pos;
+        Node jump;
+        jump.kind = Node::Repeat;
+        jump.min = parseNumber();
+        if (jump.min < 0) return -1;
+        jump.max = jump.min;
+        skipSpaces();
+        if (peek() == '-') {
+            ++m_pos;
+            skipSpaces();
+            if (peek() == ']') {
+                jump.max = -1;
+            } else {
+                jump.max = parseNumber();
+                if (jump.max < 0) return -1;
+            }
+        }
+        skipSpaces();
+        if (peek() != ']') return fail(tr("']' expected at position %1.").arg(m_pos + 1));
+        ++m_pos;
+        if (jump.max == 0 || (jump.max != -1 && jump.max < jump.min)) {
+            return fail(tr("Invalid jump before position %1.").arg(m_pos + 1));
+        }
+        Node any;
+        any.set.invert();
+        jump.children.append(addNode(any));
+        return addNode(jump);
+    }
+
+    if (c == '~') {
+        ++m_pos;
+        Node n;
+        bool exact;
+        if (parseByte(&n.set, &exact) < 0) return -1;
+        n.set.invert();
+        return addNode(n);
+    }
+
+    if (hexValue(c) >= 0 || c == '?') {
+        Node n;
+        bool exact;
+        int low = parseByte(&n.set, &exact);
+        if (low < 0) return -1;
+
+        int save = m_pos;
+        skipSpaces();
+        if (exact && peek() == '-') {
+            ++m_pos;
+            skipSpaces();
+            ByteSet ignored;
+            bool highExact;
+            int high = parseByte(&ignored, &highExact);
+            if (high < 0) return -1;
+            if (!highExact || high < low) {
+                return fail(tr("Invalid byte range ending at position %1.").arg(m_pos));
+            }
+            for (int b = low; b <= high; ++b) n.set.add(b);
+        } else {
+            m_pos = save;
+        }
+        return addNode(n);
+    }
+
+    if (atEnd()) return fail(tr("Unexpected end of pattern."));
+    return fail(tr("Unexpected character '%1' at position %2.").arg(c).arg(m_pos + 1));
+}
+
+void PatternCompiler::link(const QVector<int> &from, const QVector<int> &to) {
+    for (int p : from) {
+        m_followList[p] += to;
+    }
+}
+
+PatternCompiler::Frag PatternCompiler::concat(const Frag &a, const Frag &b) {
+    link(a.last, b.first);
+    Frag f;
+    f.first = a.first;
+    if (a.nullable) f.first += b.first;
+    f.last = b.last;
+    if (b.nullable) f.last += a.last;
+    f.nullable = a.nullable && b.nullable;
+    return f;
+}
+
+int PatternCompiler::maxLength(int index) const {
+    const Node &node = m_nodes[index];
+    int length = 0;
+    switch (node.kind) {
+    case Node::Set:
+        return 1;
+    case Node::Concat:
+    case Node::Alt:
+        for (int child : node.children) {
+            const int l = maxLength(child);
+            if (l < 0) return -1;
+            length = node.kind == Node::Concat ? length + l : std::max(length, l);
+        }
+        return length;
+    case Node::Repeat:
+        if (node.max == -1) return -1;
+        length = maxLength(node.children.first());
+        return length < 0 ? -1 : length * node.max;
+    }
+    return -1;
+}
+
+PatternCompiler::Frag PatternCompiler::build(int index) {
+    Frag f;
+    if (m_tooLarge) return f;
+
+    // Copy: building may not touch m_nodes, but keep the node stable anyway
+    const Node node = m_nodes[index];
+    switch (node.kind) {
+    case Node::Set: {
+        int p = m_sets.size();
+        m_sets.append(node.set);
+        m_followList.append(QVector<int>());
+        if (m_sets.size() > MAX_POSITIONS) m_tooLarge = true;
+        f.first.append(p);
+        f.last.append(p);
+        f.nullable = false;
+        break;
+    }
+    case Node::Concat:
+        for (int child : node.children) {
+            f = concat(f, build(child));
+        }
+        break;
+    case Node::Alt:
+        f.nullable = false;
+        for (int child : node.children) {
+            Frag g = build(child);
+            f.first += g.first;
+            f.last += g.last;
+            f.nullable = f.nullable || g.nullable;
+        }
+        break;
+    case Node::Repeat:
+        for (int i = 0; i < node.min && !m_tooLarge; ++i) {
+            f = concat(f, build(node.children.first()));
+        }
+        if (node.max == -1) {
+            Frag loop = build(node.children.first());
+            link(loop.last, loop.first);
+            loop.nullable = true;
+            f = concat(f, loop);
+        } else {
+            for (int i = node.min; i < node.max && !m_tooLarge; ++i) {
+                Frag optional = build(node.children.first());
+                optional.nullable = true;
+                f = concat(f, optional);
+            }
+        }
+        break;
+    }
+    return f;
+}
+
+bool PatternCompiler::run(BytePattern *out, QString *error) {
+    int root = parseAlt();
+    if (root >= 0 && !atEnd()) {
+        root = fail(tr("Unexpected character '%1' at position %2.").arg(peek()).arg(m_pos + 1));
+    }
+
+    Frag f;
+    if (root >= 0) {
+        f = build(root);
+        if (m_tooLarge) {
+            root = fail(tr("The pattern is too large (more than %1 byte positions after expanding repetitions).").arg(MAX_POSITIONS));
+        } else if (f.nullable) {
+            root = fail(tr("The pattern can match an empty sequence."));
+        }
+    }
+    if (root < 0) {
+        if (error) *error = m_error;
+        return false;
+    }
+
+    const int positions = m_sets.size();
+    const int words = (positions + 1 + 63) / 64;
+    out->m_positions = positions;
+    out->m_words = words;
+    out->m_maxLength = maxLength(root);   // Bounded by the positions, already checked above
+    out->m_follow.assign((size_t)(positions + 1) * words, 0);
+    out->m_precede.assign((size_t)(positions + 1) * words, 0);
+    out->m_byteMask.assign((size_t)256 * words, 0);
+    out->m_first.assign(words, 0);
+    out->m_last.assign(words, 0);
+
+    for (int p = 0; p < positions; ++p) {
+        for (int q : m_followList.at(p)) {
+            setBit(&out->m_follow[(size_t)p * words], q);
+            setBit(&out->m_precede[(size_t)q * words], p);
+        }
+        for (int b = 0; b < 256; ++b) {
+            if (m_sets.at(p).has(b)) setBit(&out->m_byteMask[(size_t)b * words], p);
+        }
+    }
+
+    ByteSet firstBytes;
+    for (int p : f.first) {
+        setBit(&out->m_follow[(size_t)positions * words], p);
+        setBit(out->m_first.data(), p);
+        for (int i = 0; i < 4; ++i) firstBytes.w[i] |= m_sets.at(p).w[i];
+    }
+    for (int p : f.last) {
+        setBit(&out->m_precede[(size_t)positions * words], p);
+        setBit(out->m_last.data(), p);
+    }
+
+    out->m_firstByte = -1;
+    int count = 0;
+    for (int b = 0; b < 256 && count < 2; ++b) {
+        if (firstBytes.has(b)) {
+            out->m_firstByte = b;
+            ++count;
+        }
+    }
+    if (count != 1) out->m_firstByte = -1;
+    return true;
+}
+
+void BytePattern::LazyDfa::init(const BytePattern *owner, bool reverse, bool unanchored) {
+    m_owner = owner;
+    m_reverse = reverse;
+    m_unanchored = unanchored;
+    reset();
+}
+
+void BytePattern::LazyDfa::reset() {
+    m_sets.clear();
+    m_reach.clear();
+    m_transitions.clear();
+    m_accepting.clear();
+    m_deadFlags.clear();
+    m_index.clear();
+
+    // State 0 is always the start: only the virtual start position
+    std::vector<quint64> start(m_owner->m_words, 0);
+    setBit(start.data(), m_owner->m_positions);
+    addState(start.data());
+}
+
+int BytePattern::LazyDfa::addState(const quint64 *set) {
+    const int words = m_owner->m_words;
+    QByteArray key(reinterpret_cast<const char *>(set), words * (int)sizeof(quint64));
+    auto it = m_index.constFind(key);
+    if (it != m_index.constEnd()) return it.value();
+
+    int state = (int)m_accepting.size();
+    m_index.insert(key, state);
+    m_sets.insert(m_sets.end(), set, set + words);
+
+    const std::vector<quint64> &relation = m_reverse ? m_owner->m_precede : m_owner->m_follow;
+    const std::vector<quint64> &final = m_reverse ? m_owner->m_first : m_owner->m_last;
+    std::vector<quint64> reach(words, 0);
+    bool accepting = false;
+    bool empty = true;
+    for (int w = 0; w < words; ++w) {
+        quint64 bits = set[w];
+        if (bits) empty = false;
+        if (bits & final[w]) accepting = true;
+        while (bits) {
+            int p = w * 64 + qCountTrailingZeroBits(bits);
+            bits &= bits - 1;
+            const quint64 *row = &relation[(size_t)p * words];
+            for (int i = 0; i < words; ++i) reach[i] |= row[i];
+        }
+    }
+    m_reach.insert(m_reach.end(), reach.begin(), reach.end());
+    m_accepting.push_back(accepting ? 1 : 0);
+    m_deadFlags.push_back(empty ? 1 : 0);
+    m_transitions.insert(m_transitions.end(), 256, -1);
+    return state;
+}
+
+int BytePattern::LazyDfa::computeTransition(int state, uchar byte) {
+    const int words = m_owner->m_words;
+    std::vector<quint64> next(words);
+    const quint64 *reach = &m_reach[(size_t)state * words];
+    const quint64 *mask = &m_owner->m_byteMask[(size_t)byte * words];
+    for (int i = 0; i < words; ++i) next[i] = reach[i] & mask[i];
+    if (m_unanchored) setBit(next.data(), m_owner->m_positions);
+
+    if ((int)m_accepting.size() >= MAX_DFA_STATES) {
+        reset();
+        return addState(next.data());
+    }
+    int target = addState(next.data());
+    m_transitions[(size_t)state * 256 + byte] = target;
+    return target;
+}
+
+qint64 BytePattern::LazyDfa::scan(const uchar *data, qint64 from, qint64 to, bool backwards, int firstByte, const QAtomicInt *cancel) {
+    // Hot loop: table pointers kept in locals and reloaded only when a transition is built
+    int state = 0;
+    const int *table = m_transitions.data();
+    const char *accepting = m_accepting.data();
+    const qint64 step = backwards ? -1 : 1;
+    qint64 i = backwards ? from - 1 : from;
+    const qint64 stop = backwards ? to - 1 : to;
+    qint64 nextCheck = i + step * CANCEL_CHECK_BYTES;
+
+    for (; i != stop; i += step) {
+        if (cancel && (backwards ? i <= nextCheck : i >= nextCheck)) {
+            if (cancel->loadAcquire()) return -1;
+            nextCheck = i + step * CANCEL_CHECK_BYTES;
+        }
+        if (state == 0 && firstByte >= 0 && !backwards) {
+            const void *hit = memchr(data + i, firstByte, (size_t)(to - i));
+            if (!hit) return -1;
+            i = static_cast<const uchar *>(hit) - data;
+        }
+        int next = table[(size_t)state * 256 + data[i]];
+        if (next < 0) {
+            next = computeTransition(state, data[i]);
+            table = m_transitions.data();
+            accepting = m_accepting.data();
+        }
+        state = next;
+        if (accepting[state]) return i;
+    }
+    return -1;
+}
+
+BytePattern::BytePattern() {
+}
+
+BytePattern::BytePattern(const BytePattern &other) {
+    *this = other;
+}
+
+BytePattern &BytePattern::operator=(const BytePattern &other) {
+    if (this == &other) return *this;
+    m_positions = other.m_positions;
+    m_words = other.m_words;
+    m_follow = other.m_follow;
+    m_precede = other.m_precede;
+    m_byteMask = other.m_byteMask;
+    m_first = other.m_first;
+    m_last = other.m_last;
+    m_firstByte = other.m_firstByte;
+    m_maxLength = other.m_maxLength;
+    // The DFA caches point at their owner, so each copy starts its own
+    if (isValid()) initAutomata();
+    return *this;
+}
+
+void BytePattern::initAutomata() {
+    m_forward.init(this, false, true);
+    m_forwardAnchored.init(this, false, false);
+    m_backward.init(this, true, true);
+    m_backwardAnchored.init(this, true, false);
+}
+
+bool BytePattern::compile(const QString &pattern, const CharTable *table, QString *error) {
+    m_positions = 0;
+    PatternCompiler compiler(pattern, table);
+    if (!compiler.run(this, error)) {
+        m_positions = 0;
+        return false;
+    }
+    initAutomata();
+    return true;
+}
+
+bool BytePattern::findNext(const uchar *data, qint64 size, qint64 from, PatternMatch *match, const QAtomicInt *cancel) {
+    if (!isValid()) return false;
+    from = std::max((qint64)0, from);
+
+    qint64 end = m_forward.scan(data, from, size, false, m_firstByte, cancel);
+    if (end < 0) return false;
+
+    // Earliest end found; walk back for the leftmost start of a match ending there
+    qint64 start = end;
+    int back = 0;
+    for (qint64 j = end; j >= from; --j) {
+        back = m_backwardAnchored.next(back, data[j]);
+        if (m_backwardAnchored.isDead(back)) break;
+        if (m_backwardAnchored.isAccepting(back)) start = j;
+    }
+    match->start = start;
+    match->length = end - start + 1;
+    return true;
+}
+
+bool BytePattern::findPrevious(const uchar *data, qint64 size, qint64 before, PatternMatch *match) {
+    if (!isValid()) return false;
+    before = std::min(size, before);
+
+    qint64 start = m_backward.scan(data, before, 0, true, -1, nullptr);
+    if (start < 0) return false;
+
+    // Rightmost start found; as in findNext the earliest end is taken, and it stays before 'before'
+    qint64 end = start;
+    int forward = 0;
+    for (qint64 j = start; j < before; ++j) {
+        forward = m_forwardAnchored.next(forward, data[j]);
+        if (m_forwardAnchored.isDead(forward)) break;
+        if (m_forwardAnchored.isAccepting(forward)) {
+            end = j;
+            break;
+        }
+    }
+    match->start = start;
+    match->length = end - start + 1;
+    return true;
+}
+
+QString BytePattern::fromBytes(const QByteArray &bytes) {
+    return QString::fromLatin1(bytes.toHex(' ').toUpper());
+}
@@ -0,0 +1,99 @@
+#ifndef BYTEPATTERN_H
+#define BYTEPATTERN_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+#include <QHash>
+#include <QAtomicInt>
+#include <vector>
+
+class CharTable;
+
+struct PatternMatch {
+    qint64 start = 0;
+    qint64 length = 0;
+};
+
+// Patrones de bytes al estilo YARA compilados a un DFA perezoso:
+//   4A 0?  ?F  ??      bytes, nibbles comodín y cualquier byte
+//   20-7E  ~00         rango de bytes y negación
+//   "text"             caracteres codificados con la tabla activa
+//   [4] [2-8] [4-]     saltos de bytes arbitrarios
+//   (E8 | E9) ?? {2,4} * +   grupos, alternativas y repeticiones
+class BytePattern
+{
+public:
+    BytePattern();
+    BytePattern(const BytePattern &other);
+    BytePattern &operator=(const BytePattern &other);
+
+    // 'table' encodes quoted text; without one, text is Latin-1.
+    bool compile(const QString &pattern, const CharTable *table, QString *error);
+    bool isValid() const { return m_positions > 0; }
+    // Longest possible match in bytes, or -1 when a repetition is unbounded
+    int maxLength() const { return m_maxLength; }
+
+    // First match ending at or after 'from' (earliest end, then leftmost start).
+    // A non-zero 'cancel' stops the scan early, as if nothing was found.
+    bool findNext(const uchar *data, qint64 size, qint64 from, PatternMatch *match, const QAtomicInt *cancel = nullptr);
+    // Match with the rightmost start that ends before 'before'; its end is the earliest, as in findNext.
+    bool findPrevious(const uchar *data, qint64 size, qint64 before, PatternMatch *match);
+
+    // Pattern text matching exactly 'bytes'.
+    static QString fromBytes(const QByteArray &bytes);
+
+private:
+    // Subset states over the Glushkov positions, built on first use
+    class LazyDfa
+    {
+    public:
+        void init(const BytePattern *owner, bool reverse, bool unanchored);
+        int next(int state, uchar byte) {
+            int t = m_transitions[(size_t)state * 256 + byte];
+            return t >= 0 ? t : computeTransition(state, byte);
+        }
+        bool isAccepting(int state) const { return m_accepting[state] != 0; }
+        bool isDead(int state) const { return m_deadFlags[state] != 0; }
+        // Steps over data[from, to) (downwards from 'from' - 1 when 'backwards') and stops
+        // right after the first byte that leads to an accepting state. Returns its index or -1.
+        qint64 scan(const uchar *data, qint64 from, qint64 to, bool backwards, int firstByte, const QAtomicInt *cancel);
+
+    private:
+        int addState(const quint64 *set);
+        int computeTransition(int state, uchar byte);
+        void reset();
+
+        const BytePattern *m_owner = nullptr;
+        bool m_reverse = false;
+        bool m_unanchored = false;
+        std::vector<quint64> m_sets;      // states * words
+        std::vector<quint64> m_reach;     // Union of the follow sets of each state
+        std::vector<int> m_transitions;   // states * 256, -1 = not built yet
+        std::vector<char> m_accepting;
+        std::vector<char> m_deadFlags;
+        QHash<QByteArray, int> m_index;
+    };
+
+    void initAutomata();
+
+    int m_positions = 0;                  // Position 'm_positions' is the virtual start
+    int m_words = 0;
+    std::vector<quint64> m_follow;        // (positions + 1) * words
+    std::vector<quint64> m_precede;       // Transposed follow relation, for reverse scans
+    std::vector<quint64> m_byteMask;      // 256 * words: positions accepting each byte
+    std::vector<quint64> m_first;
+    std::vector<quint64> m_last;
+    int m_firstByte = -1;                 // Only byte that can start a match, if unique
+    int m_maxLength = -1;
+
+    LazyDfa m_forward;
+    LazyDfa m_forwardAnchored;
+    LazyDfa m_backward;
+    LazyDfa m_backwardAnchored;
+
+    friend class PatternCompiler;
+};
+
+#endif // BYTEPATTERN_H
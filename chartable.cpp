@@ -0,0 +1,93 @@
+#include "chartable.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+
+CharTable::CharTable(const QString &tableName)
+    : name(tableName)
+{
+    fillDefault();
+}
+
+void CharTable::fillDefault() {
+    for (int i = 0; i < 256; ++i) {
+        QChar c = QChar(i);
+        map[i] = c.isPrint() ? QString(c) : QString(".");
+    }
+    compile();
+}
+
+void CharTable::clear() {
+    for (int i = 0; i < 256; ++i) {
+        map[i] = ".";
+    }
+    terminators.clear();
+    compile();
+}
+
+void CharTable::compile() {
+    m_reverse.clear();
+    m_reverse.reserve(256);
+    // Walk backwards so the lowest byte value wins for duplicated characters.
+    // "." marks an unmapped byte everywhere else, so it only maps back from the ASCII dot itself.
+    for (int i = 255; i >= 0; --i) {
+        if (!map[i].isEmpty() && (map[i] != "." || i == '.')) {
+            m_reverse.insert(map[i].at(0), i);
+        }
+    }
+}
+
+bool CharTable::load(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream in(&file);
+
+    QString newMap[256];
+    for (int i = 0; i < 256; ++i) {
+        newMap[i] = map[i];
+    }
+
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith("#")) continue;
+
+        // "/XX" or "/XX=text" marks an end-of-string byte
+        if (line.startsWith("/")) {
+            bool ok;
+            int byteValue = line.mid(1, 2).toInt(&ok, 16);
+            if (ok && byteValue >= 0 && byteValue <= 255 && !terminators.contains((char)byteValue)) {
+                terminators.append((char)byteValue);
+            }
+            continue;
+        }
+
+        QStringList parts = line.split("=");
+        if (parts.size() == 2) {
+            QString hexCode = parts.at(0).trimmed();
+            QString charStr = parts.at(1).trimmed();
+
+            bool ok;
+            int byteValue = hexCode.toInt(&ok, 16);
+
+            if (ok && byteValue >= 0 && byteValue <= 255) {
+                QString displayChar = charStr.left(1);
+                if (displayChar.isEmpty()) {
+                    displayChar = ".";
+                }
+                newMap[byteValue] = displayChar;
+            }
+        }
+    }
+    file.close();
+
+    for (int i = 0; i < 256; ++i) {
+        map[i] = newMap[i];
+    }
+    filePath = path;
+    compile();
+    return true;
+}
@@ -0,0 +1,49 @@
+#ifndef CHARTABLE_H
+#define CHARTABLE_H
+
+#include <QString>
+#include <QChar>
+#include <QHash>
+#include <QVector>
+#include <QSharedPointer>
+#include <QByteArray>
+
+// Tabla de conversión byte -> carácter con su decodificador inverso precompilado
+class CharTable
+{
+public:
+    explicit CharTable(const QString &tableName = QString());
+
+    QString name;
+    QString filePath;
+    QString map[256];
+    // End-of-string bytes, from '/XX' lines of the .tbl file
+    QByteArray terminators;
+
+    // Rebuilds the reverse (character -> byte) lookup. Must be called after editing 'map'.
+    void compile();
+
+    // Byte encoding 'ch' (first entry wins, like the old linear scan), or -1 if unmapped.
+    // The "." shown for unmapped bytes is not a mapping; only byte 0x2E can encode '.'.
+    int byteFor(QChar ch) const { return m_reverse.value(ch, -1); }
+
+    // Overlays the entries of a .tbl file on top of the current map.
+    bool load(const QString &path);
+
+    void fillDefault();
+    void clear();
+
+private:
+    QHash<QChar, int> m_reverse;
+};
+
+typedef QSharedPointer<CharTable> CharTablePtr;
+
+// Rango de offsets [start, end) que se decodifica con una tabla concreta
+struct TableRegion {
+    qint64 start = 0;
+    qint64 end = 0;
+    CharTablePtr table;
+};
+
+#endif // CHARTABLE_H
@@ -0,0 +1,803 @@
+#include "compression.h"
+#include "perftrace.h"
+
+#include <QObject>
+#include <QVector>
+#include <algorithm>
+
+const qint64 MAX_DECODED = qint64(256) << 20;  // Garbage read as LZSS can expand a lot
+const int CANCEL_CHECK_STEPS = 1 << 16;         // Tokens between two looks at the cancel flag
+
+const int WINDOW = 4096;            // Back references of all three LZ formats reach this far
+const int MIN_MATCH = 3;
+const int MAX_CHAIN = 256;          // Earlier positions tried per match search
+const int LZSS_RING_START = 0xFEE;
+const int LZSS_MAX_MATCH = 18;
+const int LZ10_MAX_MATCH = 18;
+const int LZ11_MAX_MATCH = 0x10110;
+const int RLE_MAX_RUN = 130;
+const int RLE_MAX_LITERAL = 128;
+const qint64 MAX_HEADER_SIZE = 0xFFFFFF;
+
+namespace {
+
+// Salida que crece por duplicación; las referencias hacia atrás leen de ella misma
+class Output
+{
+public:
+    explicit Output(qint64 expected) {
+        m_data.resize(int(std::min(std::max<qint64>(expected, 4096), MAX_DECODED)));
+        m_bytes = reinterpret_cast<uchar *>(m_data.data());
+    }
+
+    qint64 size() const { return m_size; }
+    const uchar *constData() const { return m_bytes; }
+
+    bool put(uchar byte) {
+        if (m_size == m_data.size() && !grow(1)) return false;
+        m_bytes[m_size++] = byte;
+        return true;
+    }
+
+    bool append(const uchar *bytes, qint64 length) {
+        if (m_size + length > m_data.size() && !grow(length)) return false;
+        std::copy(bytes, bytes + length, m_bytes + m_size);
+        m_size += length;
+        return true;
+    }
+
+    // 'length' bytes from 'distance' back, overlapping as LZ77 does; bytes before the start read as zero
+    bool copy(qint64 distance, qint64 length) {
+        if (m_size + length > m_data.size() && !grow(length)) return false;
+        for (qint64 i = 0; i < length; ++i, ++m_size) {
+            const qint64 from = m_size - distance;
+            m_bytes[m_size] = from >= 0 ? m_bytes[from] : 0;
+        }
+        return true;
+    }
+
+    QByteArray take() {
+        m_data.resize(int(m_size));
+        return m_data;
+    }
+
+private:
+    bool grow(qint64 needed) {
+        if (m_size + needed > MAX_DECODED) return false;
+        m_data.resize(int(std::min(std::max<qint64>(m_data.size() * 2, m_size + needed), MAX_DECODED)));
+        m_bytes = reinterpret_cast<uchar *>(m_data.data());
+        return true;
+    }
+
+    QByteArray m_data;
+    uchar *m_bytes = nullptr;
+    qint64 m_size = 0;
+};
+
+class Canceller
+{
+public:
+    explicit Canceller(const QAtomicInt *cancel) : m_cancel(cancel) {}
+    bool operator()() {
+        if (--m_steps > 0) return false;
+        m_steps = CANCEL_CHECK_STEPS;
+        return m_cancel && m_cancel->loadAcquire();
+    }
+
+private:
+    const QAtomicInt *m_cancel;
+    int m_steps = CANCEL_CHECK_STEPS;
+};
+
+bool fail(Compression::Decoded *out, const QString &error) {
+    out->error = error;
+    return false;
+}
+
+QString tooLarge() {
+    return QObject::tr("The decoded data would exceed %1 MB.").arg(MAX_DECODED >> 20);
+}
+
+QString truncated() {
+    return QObject::tr("The compressed data ends before the stream does.");
+}
+
+// Cabecera de la BIOS: tipo y tamaño descomprimido en 24 bits (0x11 admite 32 bits detrás de un 0)
+bool readBiosHeader(const uchar *data, qint64 size, uchar type, qint64 *decodedSize, qint64 *pos, Compression::Decoded *out) {
+    if (size < 4) return fail(out, truncated());
+    if (data[0] != type) {
+        return fail(out, QObject::tr("The data does not start with the 0x%1 header byte.").arg(type, 2, 16, QChar('0')));
+    }
+    *decodedSize = data[1] | (data[2] << 8) | (qint64(data[3]) << 16);
+    *pos = 4;
+    if (*decodedSize == 0 && type == 0x11 && size >= 8) {
+        *decodedSize = data[4] | (data[5] << 8) | (data[6] << 16) | (qint64(data[7]) << 24);
+        *pos = 8;
+    }
+    if (*decodedSize > MAX_DECODED) return fail(out, tooLarge());
+    return true;
+}
+
+bool decodeLzss(const uchar *in, qint64 size, Output &output, Compression::Decoded *out, Canceller &cancelled) {
+    qint64 pos = 0;
+    unsigned flags = 0;
+    int bits = 0;
+    while (pos < size) {
+        if (cancelled()) return false;
+        if (bits == 0) {
+            flags = in[pos++];
+            bits = 8;
+            continue;
+        }
+        const bool literal = flags & 1;
+        flags >>= 1;
+        --bits;
+        if (literal) {
+            if (!output.put(in[pos++])) return fail(out, tooLarge());
+            continue;
+        }
+        // Un byte suelto tras la última referencia es relleno
+        if (pos + 2 > size) break;
+        const int ringPos = in[pos] | ((in[pos + 1] & 0xF0) << 4);
+        const int length = (in[pos + 1] & 0x0F) + MIN_MATCH;
+        pos += 2;
+        const int ringWrite = int((LZSS_RING_START + output.size()) & (WINDOW - 1));
+        int distance = (ringWrite - ringPos) & (WINDOW - 1);
+        if (distance == 0) distance = WINDOW;
+        if (!output.copy(distance, length)) return fail(out, tooLarge());
+    }
+    out->consumed = pos;
+    return true;
+}
+
+bool decodeLz(uchar type, const uchar *in, qint64 size, Output &output, Compression::Decoded *out, Canceller &cancelled) {
+    qint64 decodedSize = 0;
+    qint64 pos = 0;
+    if (!readBiosHeader(in, size, type, &decodedSize, &pos, out)) return false;
+
+    unsigned flags = 0;
+    int bits = 0;
+    while (output.size() < decodedSize) {
+        if (cancelled()) return false;
+        if (pos >= size) return fail(out, truncated());
+        if (bits == 0) {
+            flags = in[pos++];
+            bits = 8;
+            continue;
+        }
+        const bool reference = flags & 0x80;
+        flags <<= 1;
+        --bits;
+        if (!reference) {
+            output.put(in[pos++]);
+            continue;
+        }
+
+        qint64 length = 0;
+        qint64 distance = 0;
+        const int b0 = in[pos];
+        if (type == 0x10 || (b0 >> 4) >= 2) {
+            if (pos + 2 > size) return fail(out, truncated());
+            length = (b0 >> 4) + (type == 0x10 ? MIN_MATCH : 1);
+            distance = (((b0 & 0x0F) << 8) | in[pos + 1]) + 1;
+            pos += 2;
+        } else if ((b0 >> 4) == 0) {
+            if (pos + 3 > size) return fail(out, truncated());
+            length = (((b0 & 0x0F) << 4) | (in[pos + 1] >> 4)) + 0x11;
+            distance = (((in[pos + 1] & 0x0F) << 8) | in[pos + 2]) + 1;
+            pos += 3;
+        } else {
+            if (pos + 4 > size) return fail(out, truncated());
+            length = (((b0 & 0x0F) << 12) | (in[pos + 1] << 4) | (in[pos + 2] >> 4)) + 0x111;
+            distance = (((in[pos + 2] & 0x0F) << 8) | in[pos + 3]) + 1;
+            pos += 4;
+        }
+        if (distance > output.size()) {
+            return fail(out, QObject::tr("A back reference at 0x%1 points before the start of the data.").arg(pos, 0, 16));
+        }
+        output.copy(distance, std::min(length, decodedSize - output.size()));
+    }
+    out->consumed = pos;
+    return true;
+}
+
+bool decodeRle(const uchar *in, qint64 size, Output &output, Compression::Decoded *out, Canceller &cancelled) {
+    qint64 decodedSize = 0;
+    qint64 pos = 0;
+    if (!readBiosHeader(in, size, 0x30, &decodedSize, &pos, out)) return false;
+
+    while (output.size() < decodedSize) {
+        if (cancelled()) return false;
+        if (pos >= size) return fail(out, truncated());
+        const int flag = in[pos++];
+        if (flag & 0x80) {
+            if (pos >= size) return fail(out, truncated());
+            const uchar byte = in[pos++];
+            const qint64 length = std::min<qint64>((flag & 0x7F) + MIN_MATCH, decodedSize - output.size());
+            for (qint64 i = 0; i < length; ++i) output.put(byte);
+        } else {
+            const qint64 length = std::min<qint64>((flag & 0x7F) + 1, decodedSize - output.size());
+            if (pos + length > size) return fail(out, truncated());
+            output.append(in + pos, length);
+            pos += length;
+        }
+    }
+    out->consumed = pos;
+    return true;
+}
+
+// Inflate de RFC 1951 con tablas canónicas, como el puff de zlib: lento pero corto, y cada símbolo
+// se decodifica sin leer más allá del final del flujo
+class Inflater
+{
+public:
+    Inflater(const uchar *in, qint64 size, Output &output, Canceller &cancelled)
+        : m_in(in), m_size(size), m_output(output), m_cancelled(cancelled) {}
+
+    bool run(Compression::Decoded *out);
+
+private:
+    enum { MAX_BITS = 15, MAX_LENGTH_CODES = 286, MAX_DISTANCE_CODES = 30, FIXED_LENGTH_CODES = 288 };
+
+    struct Huffman {
+        quint16 count[MAX_BITS + 1];
+        quint16 symbol[FIXED_LENGTH_CODES];
+    };
+
+    bool bits(int need, int *value);
+    int decodeSymbol(const Huffman &huffman);
+    static int build(Huffman &huffman, const quint8 *lengths, int n);
+    bool stored();
+    bool fixed();
+    bool dynamic();
+    bool codes(const Huffman &lengthCode, const Huffman &distanceCode);
+
+    const uchar *m_in;
+    qint64 m_size;
+    qint64 m_pos = 0;
+    quint32 m_bitBuffer = 0;
+    int m_bitCount = 0;
+    Output &m_output;
+    Canceller &m_cancelled;
+    QString m_error;
+};
+
+bool Inflater::bits(int need, int *value) {
+    quint32 buffer = m_bitBuffer;
+    while (m_bitCount < need) {
+        if (m_pos >= m_size) {
+            m_error = truncated();
+            return false;
+        }
+        buffer |= quint32(m_in[m_pos++]) << m_bitCount;
+        m_bitCount += 8;
+    }
+    m_bitBuffer = buffer >> need;
+    m_bitCount -= need;
+    *value = int(buffer & ((1u << need) - 1));
+    return true;
+}
+
+int Inflater::decodeSymbol(const Huffman &huffman) {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int length = 1; length <= MAX_BITS; ++length) {
+        int bit = 0;
+        if (!bits(1, &bit)) return -1;
+        code |= bit;
+        const int count = huffman.count[length];
+        if (code - count < first) return huffman.symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    m_error = QObject::tr("Invalid Huffman code in the deflate stream.");
+    return -1;
+}
+
+// 0 = complete code, > 0 = incomplete, < 0 = over-subscribed
+int Inflater::build(Huffman &huffman, const quint8 *lengths, int n) {
+    std::fill(huffman.count, huffman.count + MAX_BITS + 1, quint16(0));
+    for (int symbol = 0; symbol < n; ++symbol) huffman.count[lengths[symbol]]++;
+    if (huffman.count[0] == n) return 0;
+
+    int left = 1;
+    for (int length = 1; length <= MAX_BITS; ++length) {
+        left <<= 1;
+        left -= huffman.count[length];
+        if (left < 0) return left;
+    }
+
+    quint16 offsets[MAX_BITS + 1];
+    offsets[1] = 0;
+    for (int length = 1; length < MAX_BITS; ++length) offsets[length + 1] = offsets[length] + huffman.count[length];
+    for (int symbol = 0; symbol < n; ++symbol) {
+        if (lengths[symbol] != 0) huffman.symbol[offsets[lengths[symbol]]++] = quint16(symbol);
+    }
+    return left;
+}
+
+bool Inflater::stored() {
+    // Descarta los bits que queden del byte actual
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+    if (m_pos + 4 > m_size) {
+        m_error = truncated();
+        return false;
+    }
+    const int length = m_in[m_pos] | (m_in[m_pos + 1] << 8);
+    const int complement = m_in[m_pos + 2] | (m_in[m_pos + 3] << 8);
+    m_pos += 4;
+    if (length != (~complement & 0xFFFF)) {
+        m_error = QObject::tr("A stored deflate block has a corrupt length.");
+        return false;
+    }
+    if (m_pos + length > m_size) {
+        m_error = truncated();
+        return false;
+    }
+    if (!m_output.append(m_in + m_pos, length)) {
+        m_error = tooLarge();
+        return false;
+    }
+    m_pos += length;
+    return true;
+}
+
+bool Inflater::fixed() {
+    // Se construyen una vez; varios trabajos pueden descomprimir a la vez
+    struct FixedCodes {
+        Huffman length;
+        Huffman distance;
+        FixedCodes() {
+            quint8 lengths[FIXED_LENGTH_CODES];
+            int symbol = 0;
+            for (; symbol < 144; ++symbol) lengths[symbol] = 8;
+            for (; symbol < 256; ++symbol) lengths[symbol] = 9;
+            for (; symbol < 280; ++symbol) lengths[symbol] = 7;
+            for (; symbol < FIXED_LENGTH_CODES; ++symbol) lengths[symbol] = 8;
+            build(length, lengths, FIXED_LENGTH_CODES);
+            for (symbol = 0; symbol < MAX_DISTANCE_CODES; ++symbol) lengths[symbol] = 5;
+            build(distance, lengths, MAX_DISTANCE_CODES);
+        }
+    };
+    static const FixedCodes fixedCodes;
+    return codes(fixedCodes.length, fixedCodes.distance);
+}
+
+bool Inflater::dynamic() {
+    static const quint8 order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    int lengthCount = 0;
+    int distanceCount = 0;
+    int codeCount = 0;
+    if (!bits(5, &lengthCount) || !bits(5, &distanceCount) || !bits(4, &codeCount)) return false;
+    lengthCount += 257;
+    distanceCount += 1;
+    codeCount += 4;
+    if (lengthCount > MAX_LENGTH_CODES || distanceCount > MAX_DISTANCE_CODES) {
+        m_error = QObject::tr("A deflate block declares too many codes.");
+        return false;
+    }
+
+    quint8 lengths[MAX_LENGTH_CODES + MAX_DISTANCE_CODES] = {};
+    for (int i = 0; i < codeCount; ++i) {
+        int length = 0;
+        if (!bits(3, &length)) return false;
+        lengths[order[i]] = quint8(length);
+    }
+    Huffman lengthCode;
+    Huffman distanceCode;
+    if (build(lengthCode, lengths, 19) != 0) {
+        m_error = QObject::tr("A deflate block has an incomplete code length code.");
+        return false;
+    }
+
+    int index = 0;
+    while (index < lengthCount + distanceCount) {
+        int symbol = decodeSymbol(lengthCode);
+        if (symbol < 0) return false;
+        if (symbol < 16) {
+            lengths[index++] = quint8(symbol);
+            continue;
+        }
+        int length = 0;
+        int repeat = 0;
+        if (symbol == 16) {
+            if (index == 0) {
+                m_error = QObject::tr("A deflate block repeats a code length before the first one.");
+                return false;
+            }
+            length = lengths[index - 1];
+            if (!bits(2, &repeat)) return false;
+            repeat += 3;
+        } else if (symbol == 17) {
+            if (!bits(3, &repeat)) return false;
+            repeat += 3;
+        } else {
+            if (!bits(7, &repeat)) return false;
+            repeat += 11;
+        }
+        if (index + repeat > lengthCount + distanceCount) {
+            m_error = QObject::tr("A deflate block has too many code lengths.");
+            return false;
+        }
+        while (repeat--) lengths[index++] = quint8(length);
+    }
+    if (lengths[256] == 0) {
+        m_error = QObject::tr("A deflate block has no end-of-block code.");
+        return false;
+    }
+
+    // Solo se admite un código incompleto si tiene un único símbolo
+    int left = build(lengthCode, lengths, lengthCount);
+    if (left < 0 || (left > 0 && lengthCount - lengthCode.count[0] != 1)) {
+        m_error = QObject::tr("A deflate block has an invalid literal/length code.");
+        return false;
+    }
+    left = build(distanceCode, lengths + lengthCount, distanceCount);
+    if (left < 0 || (left > 0 && distanceCount - distanceCode.count[0] != 1)) {
+        m_error = QObject::tr("A deflate block has an invalid distance code.");
+        return false;
+    }
+    return codes(lengthCode, distanceCode);
+}
+
+bool Inflater::codes(const Huffman &lengthCode, const Huffman &distanceCode) {
+    static const quint16 lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const quint8 lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                           3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const quint16 distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                             257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                             8193, 12289, 16385, 24577};
+    static const quint8 distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                             7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    for (;;) {
+        if (m_cancelled()) return false;
+        int symbol = decodeSymbol(lengthCode);
+        if (symbol < 0) return false;
+        if (symbol < 256) {
+            if (!m_output.put(uchar(symbol))) {
+                m_error = tooLarge();
+                return false;
+            }
+            continue;
+        }
+        if (symbol == 256) return true;
+
+        symbol -= 257;
+        if (symbol >= 29) {
+            m_error = QObject::tr("Invalid length code in the deflate stream.");
+            return false;
+        }
+        int extra = 0;
+        if (!bits(lengthExtra[symbol], &extra)) return false;
+        const int length = lengthBase[symbol] + extra;
+
+        symbol = decodeSymbol(distanceCode);
+        if (symbol < 0) return false;
+        if (symbol >= 30) {
+            m_error = QObject::tr("Invalid distance code in the deflate stream.");
+            return false;
+        }
+        if (!bits(distanceExtra[symbol], &extra)) return false;
+        const qint64 distance = distanceBase[symbol] + extra;
+        if (distance > m_output.size()) {
+            m_error = QObject::tr("A back reference points before the start of the data.");
+            return false;
+        }
+        if (!m_output.copy(distance, length)) {
+            m_error = tooLarge();
+            return false;
+        }
+    }
+}
+
+quint32 adler32(const uchar *data, qint64 size) {
+    const quint32 MOD_ADLER = 65521;
+    const qint64 NMAX = 5552;   // Longest run before the sums can overflow 32 bits
+    quint32 a = 1;
+    quint32 b = 0;
+    while (size > 0) {
+        const qint64 n = std::min(size, NMAX);
+        for (qint64 i = 0; i < n; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= MOD_ADLER;
+        b %= MOD_ADLER;
+        data += n;
+        size -= n;
+    }
+    return (b << 16) | a;
+}
+
+bool Inflater::run(Compression::Decoded *out) {
+    if (m_size < 2) return fail(out, truncated());
+    const int cmf = m_in[0];
+    const int flg = m_in[1];
+    if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || (cmf * 256 + flg) % 31 != 0) {
+        return fail(out, QObject::tr("The data does not start with a zlib header."));
+    }
+    if (flg & 0x20) return fail(out, QObject::tr("zlib streams with a preset dictionary are not supported."));
+    m_pos = 2;
+
+    int last = 0;
+    do {
+        int type = 0;
+        if (!bits(1, &last) || !bits(2, &type)) return fail(out, m_error);
+        bool ok = false;
+        if (type == 0) ok = stored();
+        else if (type == 1) ok = fixed();
+        else if (type == 2) ok = dynamic();
+        else m_error = QObject::tr("Invalid deflate block type.");
+        if (!ok) return fail(out, m_error);
+    } while (!last);
+
+    // Tras el último bloque, al byte siguiente: la suma Adler-32 en big endian
+    m_bitBuffer = 0;
+    m_bitCount = 0;
+    if (m_pos + 4 > m_size) return fail(out, truncated());
+    const quint32 checksum = (quint32(m_in[m_pos]) << 24) | (m_in[m_pos + 1] << 16) | (m_in[m_pos + 2] << 8) | m_in[m_pos + 3];
+    m_pos += 4;
+    if (checksum != adler32(m_output.constData(), m_output.size())) {
+        return fail(out, QObject::tr("The zlib checksum does not match the decoded data."));
+    }
+    out->consumed = m_pos;
+    return true;
+}
+
+// Cadenas hash sobre 3 bytes: el emparejamiento más largo dentro de la ventana, el más cercano si empatan
+class MatchFinder
+{
+public:
+    struct Match {
+        int length = 0;
+        int distance = 0;
+    };
+
+    MatchFinder(const uchar *data, int size, int minDistance, int maxLength)
+        : m_data(data), m_size(size), m_minDistance(minDistance), m_maxLength(maxLength),
+          m_head(1 << HASH_BITS, -1), m_previous(size) {}
+
+    Match find(int pos) const {
+        Match best;
+        if (pos + MIN_MATCH > m_size) return best;
+        const int limit = std::min(m_maxLength, m_size - pos);
+        int candidate = m_head[hash(pos)];
+        for (int chain = 0; candidate >= 0 && pos - candidate <= WINDOW && chain < MAX_CHAIN; ++chain) {
+            const int distance = pos - candidate;
+            if (distance >= m_minDistance) {
+                int length = 0;
+                while (length < limit && m_data[candidate + length] == m_data[pos + length]) ++length;
+                if (length > best.length) {
+                    best.length = length;
+                    best.distance = distance;
+                    if (length == limit) break;
+                }
+            }
+            candidate = m_previous[candidate];
+        }
+        if (best.length < MIN_MATCH) best = Match();
+        return best;
+    }
+
+    // Every position passed over has to be inserted, in order
+    void insert(int pos) {
+        if (pos + MIN_MATCH > m_size) return;
+        const int h = hash(pos);
+        m_previous[pos] = m_head[h];
+        m_head[h] = pos;
+    }
+
+private:
+    enum { HASH_BITS = 16 };
+
+    int hash(int pos) const {
+        const quint32 key = m_data[pos] | (m_data[pos + 1] << 8) | (m_data[pos + 2] << 16);
+        return int((key * 2654435761u) >> (32 - HASH_BITS));
+    }
+
+    const uchar *m_data;
+    int m_size;
+    int m_minDistance;
+    int m_maxLength;
+    QVector<int> m_head;
+    QVector<int> m_previous;
+};
+
+// Bytes de bandera: se reserva el sitio y se rellena conforme se emiten los ocho elementos
+class FlagWriter
+{
+public:
+    FlagWriter(QByteArray &out, bool msbFirst) : m_out(out), m_msbFirst(msbFirst) {}
+
+    void next(bool set) {
+        if (m_bit == 8) {
+            m_flagPos = m_out.size();
+            m_out.append('\0');
+            m_bit = 0;
+        }
+        if (set) m_out[m_flagPos] = char(uchar(m_out[m_flagPos]) | (m_msbFirst ? 0x80 >> m_bit : 1 << m_bit));
+        ++m_bit;
+    }
+
+private:
+    QByteArray &m_out;
+    bool m_msbFirst;
+    int m_flagPos = 0;
+    int m_bit = 8;
+};
+
+void appendBiosHeader(QByteArray &out, uchar type, int size) {
+    out.append(char(type));
+    // Con tamaño 0 también la forma larga: la corta con 0 es la que anuncia los 32 bits
+    if (type == 0x11 && (size > MAX_HEADER_SIZE || size == 0)) {
+        out.append(3, '\0');
+        for (int i = 0; i < 4; ++i) out.append(char(size >> (8 * i)));
+        return;
+    }
+    for (int i = 0; i < 3; ++i) out.append(char(size >> (8 * i)));
+}
+
+QByteArray encodeLz(Compression::Codec codec, const QByteArray &data, Canceller &cancelled) {
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    const int size = data.size();
+    QByteArray out;
+    out.reserve(size / 2 + 16);
+    if (codec == Compression::Lz10) appendBiosHeader(out, 0x10, size);
+    if (codec == Compression::Lz11) appendBiosHeader(out, 0x11, size);
+
+    // 0x10 evita la distancia 1, que la copia de la BIOS a VRAM (de 16 en 16 bits) no puede leer
+    const int maxLength = codec == Compression::Lzss ? LZSS_MAX_MATCH : codec == Compression::Lz10 ? LZ10_MAX_MATCH : LZ11_MAX_MATCH;
+    MatchFinder finder(bytes, size, codec == Compression::Lz10 ? 2 : 1, maxLength);
+    FlagWriter flags(out, codec != Compression::Lzss);
+    int pos = 0;
+    while (pos < size) {
+        if (cancelled()) return QByteArray();
+        const MatchFinder::Match match = finder.find(pos);
+        if (match.length == 0) {
+            flags.next(codec == Compression::Lzss);
+            out.append(char(bytes[pos]));
+            finder.insert(pos++);
+            continue;
+        }
+
+        flags.next(codec != Compression::Lzss);
+        const int length = match.length;
+        const int distance = match.distance - 1;
+        if (codec == Compression::Lzss) {
+            const int ringPos = (LZSS_RING_START + pos - match.distance) & (WINDOW - 1);
+            out.append(char(ringPos & 0xFF));
+            out.append(char(((ringPos >> 4) & 0xF0) | (length - MIN_MATCH)));
+        } else if (codec == Compression::Lz10) {
+            out.append(char(((length - MIN_MATCH) << 4) | (distance >> 8)));
+            out.append(char(distance & 0xFF));
+        } else if (length <= 0x10) {
+            out.append(char(((length - 1) << 4) | (distance >> 8)));
+            out.append(char(distance & 0xFF));
+        } else if (length <= 0x110) {
+            const int l = length - 0x11;
+            out.append(char(l >> 4));
+            out.append(char(((l & 0x0F) << 4) | (distance >> 8)));
+            out.append(char(distance & 0xFF));
+        } else {
+            const int l = length - 0x111;
+            out.append(char(0x10 | (l >> 12)));
+            out.append(char((l >> 4) & 0xFF));
+            out.append(char(((l & 0x0F) << 4) | (distance >> 8)));
+            out.append(char(distance & 0xFF));
+        }
+        for (int end = pos + length; pos < end; ++pos) finder.insert(pos);
+    }
+    return out;
+}
+
+QByteArray encodeRle(const QByteArray &data, Canceller &cancelled) {
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    const int size = data.size();
+    QByteArray out;
+    out.reserve(size + size / RLE_MAX_LITERAL + 8);
+    appendBiosHeader(out, 0x30, size);
+
+    int literalStart = 0;
+    auto flushLiterals = [&](int end) {
+        while (literalStart < end) {
+            const int length = std::min(RLE_MAX_LITERAL, end - literalStart);
+            out.append(char(length - 1));
+            out.append(data.constData() + literalStart, length);
+            literalStart += length;
+        }
+    };
+    int pos = 0;
+    while (pos < size) {
+        if (cancelled()) return QByteArray();
+        int run = 1;
+        while (run < RLE_MAX_RUN && pos + run < size && bytes[pos + run] == bytes[pos]) ++run;
+        if (run < MIN_MATCH) {
+            pos += run;
+            continue;
+        }
+        flushLiterals(pos);
+        out.append(char(0x80 | (run - MIN_MATCH)));
+        out.append(char(bytes[pos]));
+        pos += run;
+        literalStart = pos;
+    }
+    flushLiterals(size);
+    return out;
+}
+
+}
+
+namespace Compression {
+
+QString codecName(Codec codec) {
+    switch (codec) {
+    case Lzss: return QObject::tr("LZSS (Okumura)");
+    case Lz10: return QObject::tr("LZ77 (GBA/DS 0x10)");
+    case Lz11: return QObject::tr("LZ77 (DS 0x11)");
+    case Rle30: return QObject::tr("RLE (GBA/DS 0x30)");
+    case Zlib: return QObject::tr("zlib");
+    }
+    return QString();
+}
+
+bool isSelfTerminating(Codec codec) {
+    return codec != Lzss;
+}
+
+bool decode(Codec codec, const uchar *data, qint64 size, Decoded *out, const QAtomicInt *cancel) {
+    HT_PROFILE_SCOPE("Compression::decode");
+    *out = Decoded();
+    // Las cabeceras de la BIOS dicen el tamaño; para el resto se estima a partir de la entrada
+    qint64 expected = size * 4;
+    if (codec != Lzss && codec != Zlib && size >= 4) {
+        expected = std::min(size * 64, data[1] | (data[2] << 8) | (qint64(data[3]) << 16));
+    }
+    Output output(expected);
+    Canceller cancelled(cancel);
+
+    bool ok = false;
+    switch (codec) {
+    case Lzss: ok = decodeLzss(data, size, output, out, cancelled); break;
+    case Lz10: ok = decodeLz(0x10, data, size, output, out, cancelled); break;
+    case Lz11: ok = decodeLz(0x11, data, size, output, out, cancelled); break;
+    case Rle30: ok = decodeRle(data, size, output, out, cancelled); break;
+    case Zlib: ok = Inflater(data, size, output, cancelled).run(out); break;
+    }
+    if (!ok) return false;
+    out->data = output.take();
+    HT_PROFILE_BYTES(out->data.size());
+    return true;
+}
+
+bool encode(Codec codec, const QByteArray &data, QByteArray *out, QString *error, const QAtomicInt *cancel) {
+    HT_PROFILE_SCOPE("Compression::encode");
+    HT_PROFILE_BYTES(data.size());
+    if ((codec == Lz10 || codec == Rle30) && data.size() > MAX_HEADER_SIZE) {
+        if (error) *error = QObject::tr("%1 cannot hold more than %2 bytes.").arg(codecName(codec)).arg(MAX_HEADER_SIZE);
+        return false;
+    }
+    Canceller cancelled(cancel);
+    switch (codec) {
+    case Lzss:
+    case Lz10:
+    case Lz11:
+        *out = encodeLz(codec, data, cancelled);
+        break;
+    case Rle30:
+        *out = encodeRle(data, cancelled);
+        break;
+    case Zlib:
+        // qCompress antepone el tamaño en 4 bytes; con datos vacíos no da un flujo válido
+        *out = data.isEmpty() ? QByteArray::fromHex("789c030000000001") : qCompress(data, 9).mid(4);
+        break;
+    }
+    return !(cancel && cancel->loadAcquire());
+}
+
+}
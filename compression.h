@@ -0,0 +1,40 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <QByteArray>
+#include <QString>
+#include <QAtomicInt>
+
+// Formatos de compresión habituales en datos de juegos, para abrir un tramo como vista descomprimida
+namespace Compression {
+
+enum Codec {
+    Lzss,       // Okumura LZSS: 4 KB ring zeroed and starting at 0xFEE, flag bits LSB first, 1 = literal
+    Lz10,       // GBA/DS BIOS LZ77, header 0x10: flag bits MSB first, 1 = back reference
+    Lz11,       // DS LZ77, header 0x11: like 0x10 with lengths up to 65808
+    Rle30,      // GBA/DS BIOS RLE, header 0x30
+    Zlib        // RFC 1950 stream
+};
+const int CODEC_COUNT = Zlib + 1;
+
+QString codecName(Codec codec);
+// True when the stream says where it ends; raw LZSS runs to the end of what it is given
+bool isSelfTerminating(Codec codec);
+
+struct Decoded {
+    QByteArray data;
+    qint64 consumed = 0;    // Compressed bytes the stream took up
+    QString error;
+};
+
+// Decodes the stream at data[0], reading no further than 'size'. Returns false on corrupt or
+// truncated data (out->error says why) or when 'cancel' was set.
+bool decode(Codec codec, const uchar *data, qint64 size, Decoded *out, const QAtomicInt *cancel = nullptr);
+
+// Compressed form of 'data' that decode() turns back into it. Returns false if the format cannot
+// hold it (the BIOS headers have 24 bits for the size) or when 'cancel' was set.
+bool encode(Codec codec, const QByteArray &data, QByteArray *out, QString *error = nullptr, const QAtomicInt *cancel = nullptr);
+
+}
+
+#endif // COMPRESSION_H
@@ -0,0 +1,350 @@
+#include "datainspector.h"
+#include "hexeditorarea.h"
+
+#include <QTableWidget>
+#include <QTableWidgetItem>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QHeaderView>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QPlainTextEdit>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFont>
+#include <algorithm>
+
+const int MAX_LISTED_FIELDS = 1000;     // Around the cursor's field, for records with huge arrays
+const int INSPECTED_BYTES = 8;
+
+// Hasta que el usuario guarde las suyas
+const char DEFAULT_TEMPLATES[] =
+    "// Examples; \"Edit...\" to change them\n"
+    "struct Header {\n"
+    "    char magic[4];\n"
+    "    u32 size;\n"
+    "    u16 version;\n"
+    "    u16 flags;\n"
+    "}\n"
+    "\n"
+    "struct PointerTable {\n"
+    "    u16 pointers[16];\n"
+    "}\n"
+    "\n"
+    "struct SpriteEntry {\n"
+    "    u8 y;\n"
+    "    u8 tile;\n"
+    "    u8 attributes;\n"
+    "    u8 x;\n"
+    "}\n";
+
+namespace {
+
+struct ValueRow {
+    const char *name;
+    StructTemplate::FieldKind kind;
+    int size;
+};
+
+const ValueRow VALUE_ROWS[] = {
+    {"int8", StructTemplate::Signed, 1}, {"uint8", StructTemplate::Unsigned, 1},
+    {"int16", StructTemplate::Signed, 2}, {"uint16", StructTemplate::Unsigned, 2},
+    {"int24", StructTemplate::Signed, 3}, {"uint24", StructTemplate::Unsigned, 3},
+    {"int32", StructTemplate::Signed, 4}, {"uint32", StructTemplate::Unsigned, 4},
+    {"int64", StructTemplate::Signed, 8}, {"uint64", StructTemplate::Unsigned, 8},
+    {"float", StructTemplate::Float, 4}, {"double", StructTemplate::Float, 8}
+};
+const int VALUE_ROW_COUNT = sizeof(VALUE_ROWS) / sizeof(VALUE_ROWS[0]);
+
+QFont monospaceFont() {
+    QFont mono("Monospace");
+    mono.setStyleHint(QFont::Monospace);
+    return mono;
+}
+
+}
+
+DataInspectorDock::DataInspectorDock(QWidget *parent)
+    : QDockWidget(tr("Data Inspector"), parent)
+{
+    setObjectName("dataInspectorDock");
+    setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetClosable);
+
+    QWidget *content = new QWidget(this);
+
+    // Una fila por tipo más el binario del primer byte; los ítems se crean una vez y solo cambia el texto
+    m_valueTable = new QTableWidget(VALUE_ROW_COUNT + 1, 2, content);
+    m_valueTable->setHorizontalHeaderLabels({tr("Little Endian"), tr("Big Endian")});
+    m_valueTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_valueTable->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    m_valueTable->verticalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    m_valueTable->setFont(monospaceFont());
+    QStringList rowNames;
+    for (const ValueRow &row : VALUE_ROWS) rowNames << QString::fromLatin1(row.name);
+    rowNames << tr("binary");
+    m_valueTable->setVerticalHeaderLabels(rowNames);
+    for (int row = 0; row < m_valueTable->rowCount(); ++row) {
+        for (int column = 0; column < 2; ++column) {
+            m_valueTable->setItem(row, column, new QTableWidgetItem);
+        }
+    }
+
+    m_templateCombo = new QComboBox(content);
+    m_recordsSpinBox = new QSpinBox(content);
+    m_recordsSpinBox->setRange(1, 1000000);
+    m_recordsSpinBox->setPrefix(tr("x "));
+    QPushButton *applyButton = new QPushButton(tr("Apply at Cursor"), content);
+    QPushButton *clearButton = new QPushButton(tr("Clear"), content);
+    QPushButton *editButton = new QPushButton(tr("Edit..."), content);
+
+    m_recordLabel = new QLabel(content);
+    m_fieldTree = new QTreeWidget(content);
+    m_fieldTree->setHeaderLabels({tr("Field"), tr("Offset"), tr("Value")});
+    m_fieldTree->setRootIsDecorated(false);
+    m_fieldTree->setUniformRowHeights(true);
+    m_fieldTree->setFont(monospaceFont());
+
+    QHBoxLayout *templateLayout = new QHBoxLayout;
+    templateLayout->addWidget(m_templateCombo, 1);
+    templateLayout->addWidget(m_recordsSpinBox);
+    templateLayout->addWidget(editButton);
+    QHBoxLayout *buttonLayout = new QHBoxLayout;
+    buttonLayout->addWidget(applyButton);
+    buttonLayout->addWidget(clearButton);
+    buttonLayout->addStretch(1);
+
+    QVBoxLayout *layout = new QVBoxLayout(content);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_valueTable);
+    layout->addLayout(templateLayout);
+    layout->addLayout(buttonLayout);
+    layout->addWidget(m_recordLabel);
+    layout->addWidget(m_fieldTree, 1);
+    setWidget(content);
+
+    // Arrastrar con el ratón mueve el cursor muchas veces por evento: se refresca una vez
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(0);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &DataInspectorDock::refresh);
+    connect(applyButton, &QPushButton::clicked, this, &DataInspectorDock::applyTemplate);
+    connect(clearButton, &QPushButton::clicked, this, &DataInspectorDock::clearTemplates);
+    connect(editButton, &QPushButton::clicked, this, &DataInspectorDock::editTemplates);
+    connect(m_fieldTree, &QTreeWidget::itemActivated, this, &DataInspectorDock::handleFieldActivated);
+    connect(m_fieldTree, &QTreeWidget::itemClicked, this, &DataInspectorDock::handleFieldActivated);
+    connect(this, &QDockWidget::visibilityChanged, this, &DataInspectorDock::handleVisibilityChanged);
+
+    setTemplateSource(QString::fromLatin1(DEFAULT_TEMPLATES));
+}
+
+DataInspectorDock::~DataInspectorDock() {
+    for (auto it = m_overlays.begin(); it != m_overlays.end(); ++it) {
+        it.key()->removeOverlay(it.value());
+        delete it.value();
+    }
+}
+
+void DataInspectorDock::setEditor(HexEditorArea *editor) {
+    if (m_editor == editor) return;
+    m_editor = editor;
+    m_shownInstance = nullptr;
+
+    if (editor && !m_overlays.contains(editor)) {
+        TemplateOverlay *overlay = new TemplateOverlay;
+        m_overlays.insert(editor, overlay);
+        if (isVisible()) editor->addOverlay(overlay);
+
+        connect(editor, &HexEditorArea::cursorPositionChanged, this, &DataInspectorDock::scheduleRefresh);
+        connect(editor, &HexEditorArea::dataChanged, this, &DataInspectorDock::scheduleRefresh);
+        connect(editor, &HexEditorArea::dataReplaced, this, &DataInspectorDock::scheduleRefresh);
+        connect(editor, &QObject::destroyed, this, [this, editor]() {
+            delete m_overlays.take(editor);
+            m_shownInstance = nullptr;
+        });
+    }
+    scheduleRefresh();
+}
+
+void DataInspectorDock::setTemplateSource(const QString &source) {
+    QVector<StructTemplate::Layout> layouts;
+    if (!StructTemplate::compile(source, &layouts, nullptr)) return;
+    m_templateSource = source;
+    m_layouts = layouts;
+
+    const QString current = m_templateCombo->currentData().toString();
+    m_templateCombo->clear();
+    for (const StructTemplate::Layout &layout : m_layouts) {
+        m_templateCombo->addItem(tr("%1 (%2 bytes)").arg(layout.name).arg(layout.size), layout.name);
+    }
+    const int index = m_templateCombo->findData(current);
+    if (index >= 0) m_templateCombo->setCurrentIndex(index);
+}
+
+void DataInspectorDock::editTemplates() {
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Struct Templates"));
+    QPlainTextEdit *editor = new QPlainTextEdit(m_templateSource, &dialog);
+    editor->setFont(monospaceFont());
+    editor->setLineWrapMode(QPlainTextEdit::NoWrap);
+    QLabel *help = new QLabel(tr("struct Name { u16 field; u8 pad[2]; Other nested; }  -  types: u8 s8 char u16 s16 u24 s24 "
+                                 "u32 s32 u64 s64 f32 f64, \"be\" suffix for big endian"), &dialog);
+    help->setWordWrap(true);
+    QLabel *errorLabel = new QLabel(&dialog);
+    errorLabel->setStyleSheet("color: red;");
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(help);
+    layout->addWidget(editor);
+    layout->addWidget(errorLabel);
+    layout->addWidget(buttons);
+    dialog.resize(560, 420);
+
+    // Con errores el diálogo sigue abierto para corregirlos
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, [&]() {
+        QVector<StructTemplate::Layout> layouts;
+        QString error;
+        if (StructTemplate::compile(editor->toPlainText(), &layouts, &error)) {
+            dialog.accept();
+        } else {
+            errorLabel->setText(error);
+        }
+    });
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    if (dialog.exec() != QDialog::Accepted) return;
+
+    setTemplateSource(editor->toPlainText());
+    emit templateSourceChanged(m_templateSource);
+}
+
+void DataInspectorDock::applyTemplate() {
+    const int index = m_templateCombo->currentIndex();
+    TemplateOverlay *overlay = m_overlays.value(m_editor);
+    if (!overlay || index < 0 || index >= m_layouts.size()) return;
+
+    TemplateInstance instance;
+    instance.start = m_editor->cursorPosition() / 2;
+    instance.layout = m_layouts.at(index);
+    // No more records than the rest of the document holds
+    const qint64 available = (m_editor->dataSize() - instance.start) / instance.layout.size;
+    instance.count = std::max<qint64>(1, std::min<qint64>(m_recordsSpinBox->value(), available));
+    overlay->addInstance(instance);
+    m_shownInstance = nullptr;
+
+    m_editor->invalidateView();
+    scheduleRefresh();
+}
+
+void DataInspectorDock::clearTemplates() {
+    TemplateOverlay *overlay = m_overlays.value(m_editor);
+    if (!overlay) return;
+    overlay->clear();
+    m_shownInstance = nullptr;
+    m_editor->invalidateView();
+    scheduleRefresh();
+}
+
+void DataInspectorDock::handleVisibilityChanged(bool visible) {
+    // Oculto no se pintan las plantillas ni se leen valores
+    attachOverlays(visible);
+    if (visible) scheduleRefresh();
+}
+
+void DataInspectorDock::attachOverlays(bool attach) {
+    for (auto it = m_overlays.constBegin(); it != m_overlays.constEnd(); ++it) {
+        if (attach) it.key()->addOverlay(it.value());
+        else it.key()->removeOverlay(it.value());
+        it.key()->invalidateView();
+    }
+}
+
+void DataInspectorDock::scheduleRefresh() {
+    if (isVisible()) m_refreshTimer.start();
+}
+
+void DataInspectorDock::refresh() {
+    if (!m_editor) {
+        fillValues(QByteArray());
+        fillFields(-1);
+        return;
+    }
+    const qint64 offset = m_editor->cursorPosition() / 2;
+    fillValues(m_editor->buffer().read(offset, INSPECTED_BYTES));
+    fillFields(offset);
+}
+
+void DataInspectorDock::fillValues(const QByteArray &bytes) {
+    const uchar *data = reinterpret_cast<const uchar *>(bytes.constData());
+    for (int row = 0; row < VALUE_ROW_COUNT; ++row) {
+        const ValueRow &value = VALUE_ROWS[row];
+        const bool fits = bytes.size() >= value.size;
+        m_valueTable->item(row, 0)->setText(fits ? StructTemplate::formatValue(value.kind, value.size, false, data) : QString("-"));
+        m_valueTable->item(row, 1)->setText(fits ? StructTemplate::formatValue(value.kind, value.size, true, data) : QString("-"));
+    }
+    const QString bits = bytes.isEmpty() ? QString("-") : QString("%1").arg(data[0], 8, 2, QChar('0'));
+    m_valueTable->item(VALUE_ROW_COUNT, 0)->setText(bits);
+    m_valueTable->item(VALUE_ROW_COUNT, 1)->setText(bits);
+}
+
+void DataInspectorDock::fillFields(qint64 offset) {
+    const TemplateOverlay *overlay = m_overlays.value(m_editor);
+    const TemplateInstance *instance = overlay && offset >= 0 ? overlay->instanceAt(offset) : nullptr;
+    if (!instance) {
+        m_shownInstance = nullptr;
+        m_fieldTree->clear();
+        m_recordLabel->setText(tr("No template at the cursor"));
+        return;
+    }
+
+    const StructTemplate::Layout &layout = instance->layout;
+    const qint64 record = (offset - instance->start) / layout.size;
+    const qint64 recordStart = instance->start + record * layout.size;
+    const int cursorField = std::min(layout.firstFieldAfter(offset - recordStart), layout.fields.size() - 1);
+    const int first = std::max(0, std::min(cursorField - MAX_LISTED_FIELDS / 2, layout.fields.size() - MAX_LISTED_FIELDS));
+    const int last = std::min(layout.fields.size(), first + MAX_LISTED_FIELDS);
+
+    // Mismo registro, mismos bytes y mismos campos listados: solo cambia la fila marcada
+    const bool sameRecord = instance == m_shownInstance && record == m_shownRecord
+        && m_editor->buffer().isSameVersion(m_shownBuffer) && m_fieldTree->topLevelItemCount() == last - first
+        && m_fieldTree->topLevelItemCount() > 0
+        && m_fieldTree->topLevelItem(0)->data(0, Qt::UserRole).toLongLong() == recordStart + layout.fields.at(first).offset;
+    if (!sameRecord) {
+        m_recordLabel->setText(tr("%1 #%2 at %3").arg(layout.name).arg(record)
+                               .arg(QString("%1").arg(recordStart, 8, 16, QChar('0')).toUpper()));
+        m_fieldTree->setUpdatesEnabled(false);
+        m_fieldTree->clear();
+        for (int i = first; i < last; ++i) {
+            const StructTemplate::Field &field = layout.fields.at(i);
+            const qint64 fieldStart = recordStart + field.offset;
+            const qint64 fieldLength = field.end() - field.offset;
+            const QByteArray bytes = m_editor->buffer().read(fieldStart, std::min<qint64>(fieldLength, StructTemplate::FORMATTED_BYTES));
+            const bool complete = bytes.size() == std::min<qint64>(fieldLength, StructTemplate::FORMATTED_BYTES);
+
+            QTreeWidgetItem *item = new QTreeWidgetItem(m_fieldTree);
+            item->setText(0, field.name);
+            item->setText(1, QString("%1").arg(fieldStart, 8, 16, QChar('0')).toUpper());
+            item->setText(2, complete ? StructTemplate::formatField(field, reinterpret_cast<const uchar *>(bytes.constData()))
+                                      : tr("(past the end)"));
+            item->setData(0, Qt::UserRole, fieldStart);
+            item->setData(0, Qt::UserRole + 1, fieldLength);
+        }
+        m_fieldTree->setUpdatesEnabled(true);
+        m_shownInstance = instance;
+        m_shownRecord = record;
+        m_shownBuffer = m_editor->buffer();
+    }
+
+    QTreeWidgetItem *current = m_fieldTree->topLevelItem(cursorField - first);
+    if (current) {
+        m_fieldTree->setCurrentItem(current);
+        m_fieldTree->scrollToItem(current);
+    }
+}
+
+void DataInspectorDock::handleFieldActivated(QTreeWidgetItem *item) {
+    if (!item || !m_editor) return;
+    emit fieldActivated(m_editor, item->data(0, Qt::UserRole).toLongLong(), item->data(0, Qt::UserRole + 1).toLongLong());
+}
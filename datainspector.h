@@ -0,0 +1,72 @@
+#ifndef DATAINSPECTOR_H
+#define DATAINSPECTOR_H
+
+#include <QDockWidget>
+#include <QVector>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+
+#include "piecetable.h"
+#include "structtemplate.h"
+
+class QTableWidget;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QComboBox;
+class QSpinBox;
+class QLabel;
+class HexEditorArea;
+
+// Valores de los bytes bajo el cursor y plantillas de estructuras aplicadas sobre el documento
+class DataInspectorDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit DataInspectorDock(QWidget *parent = nullptr);
+    ~DataInspectorDock() override;
+
+    void setEditor(HexEditorArea *editor);
+
+    // Struct definitions, compiled here once; see StructTemplate::compile() for the syntax
+    void setTemplateSource(const QString &source);
+    QString templateSource() const { return m_templateSource; }
+
+signals:
+    void templateSourceChanged(const QString &source);
+    void fieldActivated(HexEditorArea *editor, qint64 offset, qint64 length);
+
+private slots:
+    void scheduleRefresh();
+    void refresh();
+    void editTemplates();
+    void applyTemplate();
+    void clearTemplates();
+    void handleFieldActivated(QTreeWidgetItem *item);
+    void handleVisibilityChanged(bool visible);
+
+private:
+    void attachOverlays(bool attach);
+    void fillValues(const QByteArray &bytes);
+    void fillFields(qint64 offset);
+
+    QPointer<HexEditorArea> m_editor;
+    QHash<HexEditorArea *, TemplateOverlay *> m_overlays;
+    QString m_templateSource;
+    QVector<StructTemplate::Layout> m_layouts;
+
+    QTableWidget *m_valueTable = nullptr;
+    QComboBox *m_templateCombo = nullptr;
+    QSpinBox *m_recordsSpinBox = nullptr;
+    QLabel *m_recordLabel = nullptr;
+    QTreeWidget *m_fieldTree = nullptr;
+
+    // Record the field list shows; moving inside it only moves the highlighted row
+    const TemplateInstance *m_shownInstance = nullptr;
+    qint64 m_shownRecord = -1;
+    PieceTable m_shownBuffer;
+
+    QTimer m_refreshTimer;
+};
+
+#endif // DATAINSPECTOR_H
@@ -0,0 +1,356 @@
+#include "diffview.h"
+#include "hexeditorarea.h"
+
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QListWidget>
+#include <QListWidgetItem>
+#include <QLabel>
+#include <QPushButton>
+#include <QSplitter>
+#include <QScrollBar>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFont>
+#include <algorithm>
+
+const qint64 DIFF_CHUNK_SIZE = 4 * 1024 * 1024;
+const int MAX_LISTED_RANGES = 100000;
+
+DiffSession::DiffSession(const PieceTable &a, const PieceTable &b, QThreadPool *pool, QObject *parent)
+    : QObject(parent),
+      m_a(a),
+      m_b(b),
+      m_equalPrefix(a.firstDifference(b)),
+      m_pool(pool)
+{
+    if (isSameSize()) {
+        int chunks = (int)((m_a.size() + DIFF_CHUNK_SIZE - 1) / DIFF_CHUNK_SIZE);
+        m_chunkState.fill(ChunkPending, chunks);
+        m_chunkRanges.resize(chunks);
+    }
+}
+
+DiffSession::~DiffSession() {
+    m_cancel.storeRelease(1);
+    m_future.waitForFinished();
+}
+
+void DiffSession::start() {
+    m_future = QtConcurrent::run(m_pool, [this]() { run(); });
+}
+
+void DiffSession::run() {
+    if (isSameSize()) {
+        int chunks = m_chunkState.size();
+        for (int c = 0; c < chunks && !m_cancel.loadAcquire(); ++c) {
+            computeChunk(c);
+            emit rangesAvailable();
+            emit progressChanged((c + 1) * 100 / chunks);
+        }
+    } else {
+        // Alinear salta a cualquier parte de A, así que aquí sí hacen falta los dos seguidos,
+        // copiados en este hilo y solo mientras dura
+        const QByteArray flatA = m_a.toByteArray();
+        const QByteArray flatB = m_b.toByteArray();
+        const uchar *a = reinterpret_cast<const uchar *>(flatA.constData());
+        const uchar *b = reinterpret_cast<const uchar *>(flatB.constData());
+        const qint64 bSize = m_b.size();
+        QElapsedTimer throttle;
+        throttle.start();
+        BinDiff::alignedDiff(a, m_a.size(), b, bSize, [&](const QVector<DiffRange> &ranges, qint64 bProcessed) {
+            {
+                QMutexLocker locker(&m_mutex);
+                for (const DiffRange &r : ranges) {
+                    qint64 shift = m_alignedShift.isEmpty() ? 0 : m_alignedShift.last();
+                    m_aligned.append(r);
+                    m_alignedShift.append(shift + r.bLength - r.aLength);
+                }
+            }
+            if (throttle.elapsed() > 100 || bProcessed >= bSize) {
+                throttle.restart();
+                emit rangesAvailable();
+                emit progressChanged(bSize > 0 ? (int)(bProcessed * 100 / bSize) : 100);
+            }
+            return !m_cancel.loadAcquire();
+        });
+    }
+
+    emit rangesAvailable();
+    emit finished();
+}
+
+bool DiffSession::computeChunk(int chunk) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_chunkState.at(chunk) != ChunkPending) return false;
+        m_chunkState[chunk] = ChunkComputing;
+    }
+
+    qint64 from = chunk * DIFF_CHUNK_SIZE;
+    qint64 to = std::min(m_a.size(), from + DIFF_CHUNK_SIZE);
+    QVector<DiffRange> ranges;
+    if (to > m_equalPrefix) {
+        // Cada bloque se lee por su cuenta; los rangos salen relativos a él
+        const QByteArray a = m_a.read(from, to - from);
+        const QByteArray b = m_b.read(from, to - from);
+        ranges = BinDiff::compareBlock(reinterpret_cast<const uchar *>(a.constData()),
+                                       reinterpret_cast<const uchar *>(b.constData()),
+                                       0, to - from);
+        for (DiffRange &r : ranges) {
+            r.aStart += from;
+            r.bStart += from;
+        }
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_chunkRanges[chunk] = ranges;
+    m_chunkState[chunk] = ChunkDone;
+    return true;
+}
+
+void DiffSession::ensureComputed(qint64 start, qint64 end) {
+    if (!isSameSize() || end <= start) return;
+    int first = (int)(start / DIFF_CHUNK_SIZE);
+    int last = (int)std::min((qint64)m_chunkState.size() - 1, (end - 1) / DIFF_CHUNK_SIZE);
+    for (int c = first; c <= last; ++c) {
+        computeChunk(c);
+    }
+}
+
+void DiffSession::highlights(bool sideB, qint64 start, qint64 end, const QColor &color, QVector<HexHighlight> &out) {
+    HexHighlight h;
+    h.color = color;
+
+    if (isSameSize()) {
+        ensureComputed(start, end);
+        QMutexLocker locker(&m_mutex);
+        int first = (int)(start / DIFF_CHUNK_SIZE);
+        int last = (int)std::min((qint64)m_chunkState.size() - 1, (end - 1) / DIFF_CHUNK_SIZE);
+        for (int c = first; c <= last; ++c) {
+            if (m_chunkState.at(c) != ChunkDone) continue;
+            for (const DiffRange &r : m_chunkRanges.at(c)) {
+                if (r.aStart + r.aLength <= start || r.aStart >= end) continue;
+                h.start = r.aStart;
+                h.end = r.aStart + r.aLength;
+                out.append(h);
+            }
+        }
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    // Ranges are ordered and disjoint on both sides, so their ends are sorted too
+    auto it = std::upper_bound(m_aligned.constBegin(), m_aligned.constEnd(), start,
+                               [sideB](qint64 value, const DiffRange &r) {
+                                   return sideB ? value < r.bStart + r.bLength : value < r.aStart + r.aLength;
+                               });
+    for (; it != m_aligned.constEnd(); ++it) {
+        qint64 s = sideB ? it->bStart : it->aStart;
+        qint64 len = sideB ? it->bLength : it->aLength;
+        if (s >= end) break;
+        if (len == 0) continue;
+        h.start = s;
+        h.end = s + len;
+        out.append(h);
+    }
+}
+
+QVector<DiffRange> DiffSession::takeNewOrderedRanges() {
+    QVector<DiffRange> result;
+    QMutexLocker locker(&m_mutex);
+    if (isSameSize()) {
+        while (m_deliveredChunks < m_chunkState.size() && m_chunkState.at(m_deliveredChunks) == ChunkDone) {
+            result += m_chunkRanges.at(m_deliveredChunks);
+            ++m_deliveredChunks;
+        }
+    } else {
+        result = m_aligned.mid(m_deliveredAligned);
+        m_deliveredAligned = m_aligned.size();
+    }
+    return result;
+}
+
+qint64 DiffSession::mapOffset(bool fromB, qint64 offset) const {
+    if (isSameSize()) return offset;
+
+    QMutexLocker locker(&m_mutex);
+    auto it = std::upper_bound(m_aligned.constBegin(), m_aligned.constEnd(), offset,
+                               [fromB](qint64 value, const DiffRange &r) {
+                                   return value < (fromB ? r.bStart : r.aStart);
+                               });
+    if (it == m_aligned.constBegin()) return offset;
+    --it;
+
+    qint64 sideStart = fromB ? it->bStart : it->aStart;
+    qint64 sideLength = fromB ? it->bLength : it->aLength;
+    qint64 otherStart = fromB ? it->aStart : it->bStart;
+    qint64 otherLength = fromB ? it->aLength : it->bLength;
+    if (offset < sideStart + sideLength) {
+        return otherStart + std::min(offset - sideStart, otherLength);
+    }
+
+    qint64 shift = m_alignedShift.at(it - m_aligned.constBegin());
+    return fromB ? offset - shift : offset + shift;
+}
+
+
+DiffView::DiffView(const QString &nameA, const PieceTable &dataA,
+                   const QString &nameB, const PieceTable &dataB,
+                   const CharTablePtr &table, QThreadPool *pool, QWidget *parent)
+    : QWidget(parent, Qt::Window)
+{
+    setWindowTitle(tr("Compare: %1 - %2").arg(nameA).arg(nameB));
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    m_session = new DiffSession(dataA, dataB, pool, this);
+
+    m_editorA = new HexEditorArea;
+    m_editorA->setBuffer(dataA);
+    m_editorA->setCharTable(table);
+    m_editorA->setReadOnly(true);
+
+    m_editorB = new HexEditorArea;
+    m_editorB->setBuffer(dataB);
+    m_editorB->setCharTable(table);
+    m_editorB->setReadOnly(true);
+
+    m_overlayA = new DiffOverlay(m_session, false, QColor(220, 60, 60, 120));
+    m_overlayB = new DiffOverlay(m_session, true, QColor(60, 170, 60, 120));
+    m_editorA->addOverlay(m_overlayA);
+    m_editorB->addOverlay(m_overlayB);
+
+    QWidget *paneA = new QWidget;
+    QVBoxLayout *layoutA = new QVBoxLayout(paneA);
+    layoutA->setContentsMargins(0, 0, 0, 0);
+    layoutA->addWidget(new QLabel(tr("A: %1 (%2 bytes)").arg(nameA).arg(dataA.size())));
+    layoutA->addWidget(m_editorA);
+
+    QWidget *paneB = new QWidget;
+    QVBoxLayout *layoutB = new QVBoxLayout(paneB);
+    layoutB->setContentsMargins(0, 0, 0, 0);
+    layoutB->addWidget(new QLabel(tr("B: %1 (%2 bytes)").arg(nameB).arg(dataB.size())));
+    layoutB->addWidget(m_editorB);
+
+    QSplitter *panes = new QSplitter(Qt::Horizontal);
+    panes->addWidget(paneA);
+    panes->addWidget(paneB);
+
+    m_rangeList = new QListWidget;
+    m_rangeList->setFont(QFont("Monospace", 10));
+
+    QSplitter *vertical = new QSplitter(Qt::Vertical);
+    vertical->addWidget(panes);
+    vertical->addWidget(m_rangeList);
+    vertical->setStretchFactor(0, 4);
+    vertical->setStretchFactor(1, 1);
+
+    m_statusLabel = new QLabel(tr("Comparing..."));
+    QPushButton *previousButton = new QPushButton(tr("Previous Difference"));
+    QPushButton *nextButton = new QPushButton(tr("Next Difference"));
+
+    QHBoxLayout *bottomLayout = new QHBoxLayout;
+    bottomLayout->addWidget(m_statusLabel, 1);
+    bottomLayout->addWidget(previousButton);
+    bottomLayout->addWidget(nextButton);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->addWidget(vertical);
+    mainLayout->addLayout(bottomLayout);
+
+    connect(m_session, &DiffSession::rangesAvailable, this, &DiffView::handleRangesAvailable);
+    connect(m_session, &DiffSession::progressChanged, this, &DiffView::handleProgress);
+    connect(m_session, &DiffSession::finished, this, [this]() {
+        m_finished = true;
+        handleRangesAvailable();
+    });
+    connect(m_rangeList, &QListWidget::itemActivated, this, &DiffView::handleItemActivated);
+    connect(m_rangeList, &QListWidget::itemClicked, this, &DiffView::handleItemActivated);
+    connect(previousButton, &QPushButton::clicked, this, &DiffView::goToPreviousDifference);
+    connect(nextButton, &QPushButton::clicked, this, &DiffView::goToNextDifference);
+
+    connect(m_editorA, &HexEditorArea::viewScrolled, this, [this]() { syncScroll(false); });
+    connect(m_editorB, &HexEditorArea::viewScrolled, this, [this]() { syncScroll(true); });
+
+    resize(1200, 750);
+    m_session->start();
+}
+
+DiffView::~DiffView() {
+    // Stop the worker before the editors and overlays go away
+    delete m_session;
+    m_session = nullptr;
+    m_editorA->removeOverlay(m_overlayA);
+    m_editorB->removeOverlay(m_overlayB);
+    delete m_overlayA;
+    delete m_overlayB;
+}
+
+void DiffView::handleRangesAvailable() {
+    if (!m_session) return;
+
+    QVector<DiffRange> newRanges = m_session->takeNewOrderedRanges();
+    for (const DiffRange &r : qAsConst(newRanges)) {
+        int index = m_ranges.size();
+        m_ranges.append(r);
+        if (index >= MAX_LISTED_RANGES) continue;
+
+        QListWidgetItem *item = new QListWidgetItem(
+            QString("A %1 (+%2)  |  B %3 (+%4)")
+                .arg(r.aStart, 8, 16, QChar('0')).arg(r.aLength)
+                .arg(r.bStart, 8, 16, QChar('0')).arg(r.bLength).toUpper(),
+            m_rangeList);
+        item->setData(Qt::UserRole, index);
+    }
+
+    if (m_finished) {
+        m_statusLabel->setText(tr("%n difference(s).", "", m_ranges.size()));
+    }
+    m_editorA->invalidateView();
+    m_editorB->invalidateView();
+}
+
+void DiffView::handleProgress(int percent) {
+    if (!m_finished) {
+        m_statusLabel->setText(tr("Comparing... %1% (%n difference(s) so far)", "", m_ranges.size()).arg(percent));
+    }
+}
+
+void DiffView::handleItemActivated(QListWidgetItem *item) {
+    if (!item) return;
+    int index = item->data(Qt::UserRole).toInt();
+    if (index < 0 || index >= m_ranges.size()) return;
+
+    const DiffRange &r = m_ranges.at(index);
+    m_syncing = true;
+    m_editorA->goToOffset(r.aStart);
+    m_editorA->setSelection(r.aStart * 2, (r.aStart + r.aLength) * 2);
+    m_editorB->goToOffset(r.bStart);
+    m_editorB->setSelection(r.bStart * 2, (r.bStart + r.bLength) * 2);
+    m_syncing = false;
+}
+
+void DiffView::goToNextDifference() {
+    int row = std::min(m_rangeList->currentRow() + 1, m_rangeList->count() - 1);
+    if (row < 0) return;
+    m_rangeList->setCurrentRow(row);
+    handleItemActivated(m_rangeList->item(row));
+}
+
+void DiffView::goToPreviousDifference() {
+    int row = std::max(m_rangeList->currentRow() - 1, 0);
+    if (row >= m_rangeList->count()) return;
+    m_rangeList->setCurrentRow(row);
+    handleItemActivated(m_rangeList->item(row));
+}
+
+void DiffView::syncScroll(bool fromB) {
+    if (m_syncing || !m_session) return;
+    m_syncing = true;
+    HexEditorArea *source = fromB ? m_editorB : m_editorA;
+    HexEditorArea *target = fromB ? m_editorA : m_editorB;
+    target->setTopOffset(m_session->mapOffset(fromB, source->topOffset()));
+    m_syncing = false;
+}
@@ -0,0 +1,123 @@
+#ifndef DIFFVIEW_H
+#define DIFFVIEW_H
+
+#include <QWidget>
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QString>
+
+#include "bindiff.h"
+#include "chartable.h"
+#include "hexoverlay.h"
+#include "piecetable.h"
+
+class QThreadPool;
+class QListWidget;
+class QListWidgetItem;
+class QLabel;
+class HexEditorArea;
+
+// Comparación de dos buffers calculada en segundo plano y, si tienen el mismo
+// tamaño, por bloques bajo demanda según lo que se esté viendo.
+class DiffSession : public QObject
+{
+    Q_OBJECT
+public:
+    // 'a' and 'b' should be snapshots: the worker reads them while the editors go on
+    DiffSession(const PieceTable &a, const PieceTable &b, QThreadPool *pool, QObject *parent = nullptr);
+    ~DiffSession() override;
+
+    void start();
+    bool isSameSize() const { return m_a.size() == m_b.size(); }
+
+    // Compares the same-size chunks covering [start, end) right away if nobody did yet.
+    void ensureComputed(qint64 start, qint64 end);
+    void highlights(bool sideB, qint64 start, qint64 end, const QColor &color, QVector<HexHighlight> &out);
+
+    // Ranges that became available in order since the previous call (GUI thread only).
+    QVector<DiffRange> takeNewOrderedRanges();
+
+    qint64 mapOffset(bool fromB, qint64 offset) const;
+
+signals:
+    void rangesAvailable();
+    void progressChanged(int percent);
+    void finished();
+
+private:
+    enum ChunkState { ChunkPending, ChunkComputing, ChunkDone };
+
+    void run();
+    bool computeChunk(int chunk);
+
+    PieceTable m_a;
+    PieceTable m_b;
+    qint64 m_equalPrefix;   // Known equal from the pieces alone
+    QThreadPool *m_pool;
+    QFuture<void> m_future;
+    QAtomicInt m_cancel;
+
+    mutable QMutex m_mutex;
+    // Same-size mode
+    QVector<int> m_chunkState;
+    QVector<QVector<DiffRange>> m_chunkRanges;
+    int m_deliveredChunks = 0;
+    // Aligned mode: ranges in order plus the running (bLength - aLength) shift after each one
+    QVector<DiffRange> m_aligned;
+    QVector<qint64> m_alignedShift;
+    int m_deliveredAligned = 0;
+};
+
+class DiffOverlay : public HexOverlay
+{
+public:
+    DiffOverlay(DiffSession *session, bool sideB, const QColor &color)
+        : m_session(session), m_sideB(sideB), m_color(color) {}
+
+    void query(qint64 start, qint64 end, QVector<HexHighlight> &out) const override {
+        m_session->highlights(m_sideB, start, end, m_color, out);
+    }
+
+private:
+    DiffSession *m_session;
+    bool m_sideB;
+    QColor m_color;
+};
+
+// Ventana de comparación con dos paneles sincronizados y la lista de diferencias
+class DiffView : public QWidget
+{
+    Q_OBJECT
+public:
+    DiffView(const QString &nameA, const PieceTable &dataA,
+             const QString &nameB, const PieceTable &dataB,
+             const CharTablePtr &table, QThreadPool *pool, QWidget *parent = nullptr);
+    ~DiffView() override;
+
+private slots:
+    void handleRangesAvailable();
+    void handleProgress(int percent);
+    void handleItemActivated(QListWidgetItem *item);
+    void goToNextDifference();
+    void goToPreviousDifference();
+
+private:
+    void syncScroll(bool fromB);
+
+    DiffSession *m_session = nullptr;
+    DiffOverlay *m_overlayA = nullptr;
+    DiffOverlay *m_overlayB = nullptr;
+    HexEditorArea *m_editorA = nullptr;
+    HexEditorArea *m_editorB = nullptr;
+    QListWidget *m_rangeList = nullptr;
+    QLabel *m_statusLabel = nullptr;
+    QVector<DiffRange> m_ranges;
+    bool m_syncing = false;
+    bool m_finished = false;
+};
+
+#endif // DIFFVIEW_H
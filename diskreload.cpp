@@ -0,0 +1,94 @@
+#include "diskreload.h"
+#include "byteops.h"
+#include "perftrace.h"
+
+#include <QFile>
+#include <algorithm>
+
+namespace DiskReload {
+
+QVector<quint32> blockHashes(const QByteArray &data) {
+    HT_PROFILE_SCOPE("DiskReload::blockHashes");
+    HT_PROFILE_BYTES(data.size());
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    const qint64 size = data.size();
+    QVector<quint32> hashes;
+    hashes.reserve(int((size + BLOCK_SIZE - 1) / BLOCK_SIZE));
+    for (qint64 pos = 0; pos < size; pos += BLOCK_SIZE) {
+        hashes.append(ByteOps::crc32(bytes + pos, std::min(BLOCK_SIZE, size - pos)));
+    }
+    return hashes;
+}
+
+Changes compare(const QString &filePath, const QVector<quint32> &previous, qint64 previousSize) {
+    HT_PROFILE_SCOPE("DiskReload::compare");
+    Changes changes;
+    // Antes de leer: si el fichero cambia mientras tanto, la fecha ya no coincidirá y se vuelve a mirar
+    changes.stamp = FileStamp::of(filePath);
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        changes.error = file.errorString();
+        return changes;
+    }
+
+    // Solo se guardan los bloques distintos: un cambio pequeño en una imagen grande ocupa poco
+    QByteArray block(int(BLOCK_SIZE), Qt::Uninitialized);
+    qint64 pos = 0;
+    for (;;) {
+        const qint64 count = file.read(block.data(), BLOCK_SIZE);
+        if (count < 0) {
+            changes.error = file.errorString();
+            return changes;
+        }
+        if (count == 0) break;
+
+        const int index = changes.hashes.size();
+        const quint32 hash = ByteOps::crc32(reinterpret_cast<const uchar *>(block.constData()), count);
+        changes.hashes.append(hash);
+        const qint64 previousCount = std::max<qint64>(0, std::min(BLOCK_SIZE, previousSize - pos));
+        if (index >= previous.size() || previousCount != count || previous[index] != hash) {
+            if (!changes.ranges.isEmpty() && changes.ranges.last().bStart + changes.ranges.last().bLength == pos) {
+                changes.ranges.last().bLength += count;
+            } else {
+                DiffRange range;
+                range.aStart = range.bStart = pos;
+                range.bLength = count;
+                changes.ranges.append(range);
+            }
+            changes.bytes.append(block.constData(), int(count));
+        }
+        pos += count;
+    }
+    HT_PROFILE_BYTES(pos);
+    const qint64 size = pos;
+
+    // Hasta aquí los dos lados coinciden en posición; solo el final puede crecer o encoger
+    for (DiffRange &range : changes.ranges) {
+        range.aLength = std::max<qint64>(0, std::min(range.bStart + range.bLength, previousSize) - range.aStart);
+    }
+    if (previousSize > size) {
+        if (!changes.ranges.isEmpty() && changes.ranges.last().bStart + changes.ranges.last().bLength == size) {
+            changes.ranges.last().aLength = previousSize - changes.ranges.last().aStart;
+        } else {
+            DiffRange range;
+            range.aStart = range.bStart = size;
+            range.aLength = previousSize - size;
+            changes.ranges.append(range);
+        }
+    }
+    return changes;
+}
+
+PieceTable apply(const PieceTable &buffer, const Changes &changes) {
+    PieceTable result = buffer;
+    qint64 shift = 0;
+    int used = 0;
+    for (const DiffRange &range : changes.ranges) {
+        result.replace(range.aStart + shift, range.aLength, changes.bytes.mid(used, int(range.bLength)));
+        used += int(range.bLength);
+        shift += range.bLength - range.aLength;
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef DISKRELOAD_H
+#define DISKRELOAD_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "bindiff.h"
+#include "piecetable.h"
+#include "session.h"
+
+// Recarga de un fichero cambiado por otro programa: se comparan resúmenes por bloques con los del
+// fichero tal como se cargó o guardó, y solo se sustituyen en el buffer los bloques distintos.
+namespace DiskReload {
+
+const qint64 BLOCK_SIZE = 64 * 1024;
+
+// CRC-32 of every BLOCK_SIZE bytes of 'data'; the last block may be shorter
+QVector<quint32> blockHashes(const QByteArray &data);
+
+struct Changes {
+    FileStamp stamp;                // Of the file that was read
+    QVector<quint32> hashes;        // Its blocks, the baseline for the next reload
+    QVector<DiffRange> ranges;      // A = the previous file, B = the new one; same offsets but in the last range
+    QByteArray bytes;               // The B side of every range, one after the other
+    QString error;
+
+    bool isEmpty() const { return ranges.isEmpty(); }
+};
+
+// Reads 'filePath' block by block and keeps only the blocks whose hash differs from 'previous',
+// the hashes of a 'previousSize' byte file. An empty 'previous' makes the whole file one range.
+Changes compare(const QString &filePath, const QVector<quint32> &previous, qint64 previousSize);
+
+// 'buffer' (holding the previous file) with the changed blocks replaced
+PieceTable apply(const PieceTable &buffer, const Changes &changes);
+
+}
+
+#endif // DISKRELOAD_H
@@ -0,0 +1,349 @@
+#include "encodingsolver.h"
+
+#include <QThreadPool>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrent>
+#include <QHash>
+#include <QObject>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+const qint64 HISTOGRAM_CHUNK_MIN = 256 * 1024;
+const int EXTRA_CLASSES = 24;       // Bytes considered beyond the alphabet size
+const int ITERATIONS = 150000;
+const double START_TEMPERATURE = 0.02;
+const double END_TEMPERATURE = 0.00002;
+const int MAX_SOLUTIONS = 5;
+const double BACKOFF_WEIGHT = 4.0;
+
+// Textos de entrenamiento: las minúsculas (y el espacio) forman el alfabeto; lo demás es "otro"
+const char englishCorpus[] =
+    "the old harbour town woke slowly every morning. fishermen carried their nets down to the water while "
+    "the baker opened his shop and the smell of fresh bread drifted along the narrow streets. children ran "
+    "past the church on their way to school, laughing and shouting as they jumped over puddles left by the "
+    "night rain. at the end of the quay an old woman sold flowers, and she always knew the name of everyone "
+    "who stopped to buy a few. the king of this quiet kingdom had never visited the town, but people told "
+    "stories about him as if he lived next door. some said he was wise and gentle; others swore he was a "
+    "lazy man who spent his days sleeping in a golden chair. nobody could prove either story, so both were "
+    "repeated with equal joy. one summer a young traveller arrived with a heavy box tied to his back. he "
+    "said he was looking for a map that would lead him to a hidden valley where the rivers ran quickly "
+    "between green hills and the sky was always clear. the villagers thought he was foolish, yet they gave "
+    "him food and a warm place to sleep. each evening he sat by the fire and asked questions about the "
+    "roads, the forests and the mountains to the north. after a week he thanked everyone and walked away "
+    "before sunrise. what do you want from me? i have nothing to give you but my thanks. do not worry, we "
+    "will find the way together if you follow me and keep your sword ready. the door is locked, you need a "
+    "key. you found a potion! your strength has increased. months later a letter came back to the town. "
+    "it was written in a strange hand and explained that the valley was real, that the journey had been "
+    "long and difficult, and that the traveller would return next year with gifts for every family who "
+    "had helped him. the whole town waited, and this is the story they still tell when the winter nights "
+    "grow long and the wind howls over the sea.";
+
+const char spanishCorpus[] =
+    "el viejo puerto despertaba despacio cada mañana. los pescadores llevaban sus redes hasta el agua "
+    "mientras el panadero abría la tienda y el olor del pan recién hecho llenaba las calles estrechas. los "
+    "niños corrían junto a la iglesia camino de la escuela, riendo y gritando mientras saltaban los charcos "
+    "que había dejado la lluvia de la noche. al final del muelle una anciana vendía flores y siempre sabía "
+    "el nombre de quien se acercaba a comprar. el rey de aquel reino tranquilo nunca había visitado el "
+    "pueblo, pero la gente contaba historias sobre él como si fuera un vecino más. unos decían que era "
+    "sabio y generoso; otros juraban que era un hombre perezoso que pasaba los días durmiendo en una silla "
+    "de oro. nadie podía probar ninguna de las dos, así que ambas se repetían con la misma alegría. un "
+    "verano llegó un joven viajero con una caja pesada atada a la espalda. explicó que buscaba un mapa que "
+    "lo llevaría a un valle escondido donde los ríos bajaban rápidos entre colinas verdes y el cielo "
+    "estaba siempre despejado. los vecinos pensaron que estaba loco, pero le dieron comida y un lugar "
+    "caliente para dormir. cada noche se sentaba junto al fuego y hacía preguntas sobre los caminos, los "
+    "bosques y las montañas del norte. después de una semana dio las gracias a todos y se marchó antes del "
+    "amanecer. qué quieres de mí? no tengo nada que darte, solo mi gratitud. no te preocupes, encontraremos "
+    "el camino juntos si me sigues y tienes la espada preparada. la puerta está cerrada, necesitas una "
+    "llave. has encontrado una poción! tu fuerza ha aumentado. meses después llegó una carta al pueblo. "
+    "estaba escrita con una letra extraña y contaba que el valle existía, que el viaje había sido largo y "
+    "difícil, y que el viajero volvería al año siguiente con regalos para cada familia que le había "
+    "ayudado. todo el pueblo esperó, y esta es la historia que todavía cuentan cuando las noches de "
+    "invierno se hacen largas y el viento sopla sobre el mar.";
+
+const char kanaCorpus[] =
+    "いろはにほへとちりぬるをわかよたれそつねならむうゐのおくやまけふこえてあさきゆめみしゑひもせす。"
+    "むかしむかし、あるところに、おじいさんとおばあさんがすんでいました。おじいさんはやまへしばかりに、"
+    "おばあさんはかわへせんたくにいきました。おばあさんがかわでせんたくをしていると、おおきなももが"
+    "どんぶらこ、どんぶらこと、ながれてきました。ゆうしゃよ、よくきてくれた。このくにはいま、まおうの"
+    "ちからでくるしんでいる。どうかわたしたちをたすけてほしい。きたのどうくつにはつよいまものがいるので、"
+    "きをつけてすすむのじゃ。おかねがたりなければ、まちのみせでどうぐをうるとよいだろう。とびらには"
+    "かぎがかかっている。たからばこをあけた。やくそうをてにいれた。ちからがあがった。きょうはもう"
+    "おそいから、やどやでやすんでいきなさい。あしたのあさ、ふねがみなとをでるそうだ。";
+
+struct LanguageModel {
+    QVector<QChar> symbols;     // Most frequent first; index symbols.size() is "other"
+    QVector<double> logProb;    // (symbols + 1)^2, log P(second | first)
+    int alphabet() const { return symbols.size(); }
+};
+
+bool inAlphabet(QChar ch, EncodingSolver::Language language) {
+    if (language == EncodingSolver::JapaneseKana) {
+        return (ch.unicode() >= 0x3041 && ch.unicode() <= 0x3096) || ch == QChar(0x3001) || ch == QChar(0x3002);
+    }
+    return ch == QChar(' ') || ch.isLower();
+}
+
+LanguageModel buildModel(const QString &corpus, EncodingSolver::Language language) {
+    LanguageModel model;
+    QHash<QChar, int> counts;
+    for (QChar ch : corpus) {
+        if (inAlphabet(ch, language)) ++counts[ch];
+    }
+    model.symbols = counts.keys().toVector();
+    std::sort(model.symbols.begin(), model.symbols.end(), [&counts](QChar a, QChar b) {
+        return counts.value(a) != counts.value(b) ? counts.value(a) > counts.value(b) : a < b;
+    });
+
+    QHash<QChar, int> index;
+    for (int i = 0; i < model.symbols.size(); ++i) {
+        index.insert(model.symbols.at(i), i);
+    }
+
+    const int n = model.alphabet() + 1;
+    QVector<double> pair(n * n, 0.0);
+    QVector<double> single(n, 0.0);
+    int previous = -1;
+    for (QChar ch : corpus) {
+        int current = index.value(ch, n - 1);
+        ++single[current];
+        if (previous >= 0) ++pair[previous * n + current];
+        previous = current;
+    }
+
+    // Bigramas suavizados con los unigramas para que ningún par tenga probabilidad cero
+    const double total = corpus.size();
+    model.logProb.resize(n * n);
+    for (int a = 0; a < n; ++a) {
+        double rowTotal = 0;
+        for (int b = 0; b < n; ++b) rowTotal += pair[a * n + b];
+        for (int b = 0; b < n; ++b) {
+            double unigram = (single[b] + 1.0) / (total + n);
+            model.logProb[a * n + b] = std::log((pair[a * n + b] + BACKOFF_WEIGHT * unigram) / (rowTotal + BACKOFF_WEIGHT));
+        }
+    }
+    return model;
+}
+
+const LanguageModel &languageModel(EncodingSolver::Language language) {
+    // Estáticas locales: C++11 garantiza una sola inicialización aunque haya varios hilos
+    static const LanguageModel english = buildModel(QString::fromUtf8(englishCorpus), EncodingSolver::English);
+    static const LanguageModel spanish = buildModel(QString::fromUtf8(spanishCorpus), EncodingSolver::Spanish);
+    static const LanguageModel kana = buildModel(QString::fromUtf8(kanaCorpus), EncodingSolver::JapaneseKana);
+    switch (language) {
+    case EncodingSolver::Spanish: return spanish;
+    case EncodingSolver::JapaneseKana: return kana;
+    default: return english;
+    }
+}
+
+// The data reduced to its most frequent bytes plus one class for the rest
+struct Problem {
+    const LanguageModel *model = nullptr;
+    QVector<int> classBytes;    // Byte of each class; the last class (the rest) has none
+    QVector<double> pairs;      // classes^2 byte-pair frequencies, summing to 1
+    int classes() const { return classBytes.size() + 1; }
+};
+
+struct Solution {
+    QVector<int> symbolOf;      // Per class; model->alphabet() means "other"
+    double score = 0;
+};
+
+double scoreOf(const Problem &problem, const QVector<int> &symbolOf) {
+    const int n = problem.classes();
+    const int symbols = problem.model->alphabet() + 1;
+    double score = 0;
+    for (int x = 0; x < n; ++x) {
+        const double *row = problem.pairs.constData() + x * n;
+        const double *logRow = problem.model->logProb.constData() + symbolOf[x] * symbols;
+        for (int y = 0; y < n; ++y) {
+            score += row[y] * logRow[symbolOf[y]];
+        }
+    }
+    return score;
+}
+
+// Contribución de las filas y columnas de las clases i y j, las únicas que cambia un intercambio
+double partialScore(const Problem &problem, const QVector<int> &symbolOf, int i, int j) {
+    const int n = problem.classes();
+    const int symbols = problem.model->alphabet() + 1;
+    const double *pairs = problem.pairs.constData();
+    const double *logProb = problem.model->logProb.constData();
+    double score = 0;
+    for (int y = 0; y < n; ++y) {
+        score += pairs[i * n + y] * logProb[symbolOf[i] * symbols + symbolOf[y]];
+        score += pairs[j * n + y] * logProb[symbolOf[j] * symbols + symbolOf[y]];
+    }
+    for (int x = 0; x < n; ++x) {
+        if (x == i || x == j) continue;
+        score += pairs[x * n + i] * logProb[symbolOf[x] * symbols + symbolOf[i]];
+        score += pairs[x * n + j] * logProb[symbolOf[x] * symbols + symbolOf[j]];
+    }
+    return score;
+}
+
+Solution anneal(const Problem &problem, unsigned seed, const QAtomicInt *cancel) {
+    const int movable = problem.classes() - 1; // The rest class always stays "other"
+    const int other = problem.model->alphabet();
+    std::mt19937 random(seed);
+
+    // Start from plain frequency analysis; later restarts shuffle it
+    Solution current;
+    current.symbolOf.resize(problem.classes());
+    for (int c = 0; c < problem.classes(); ++c) {
+        current.symbolOf[c] = c < std::min(movable, other) ? c : other;
+    }
+    if (seed != 0) {
+        std::uniform_int_distribution<int> pick(0, std::max(0, movable - 1));
+        for (int k = 0; k < movable; ++k) {
+            std::swap(current.symbolOf[pick(random)], current.symbolOf[pick(random)]);
+        }
+    }
+    current.score = scoreOf(problem, current.symbolOf);
+    Solution best = current;
+    if (movable < 2) return best;
+
+    std::uniform_int_distribution<int> pick(0, movable - 1);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    const double cooling = std::pow(END_TEMPERATURE / START_TEMPERATURE, 1.0 / ITERATIONS);
+    double temperature = START_TEMPERATURE;
+
+    for (int iteration = 0; iteration < ITERATIONS; ++iteration, temperature *= cooling) {
+        if (cancel && (iteration & 4095) == 0 && cancel->loadAcquire()) break;
+
+        int i = pick(random);
+        int j = pick(random);
+        if (current.symbolOf[i] == current.symbolOf[j]) continue;
+
+        double before = partialScore(problem, current.symbolOf, i, j);
+        std::swap(current.symbolOf[i], current.symbolOf[j]);
+        double delta = partialScore(problem, current.symbolOf, i, j) - before;
+
+        if (delta >= 0 || chance(random) < std::exp(delta / temperature)) {
+            current.score += delta;
+            if (current.score > best.score) best = current;
+        } else {
+            std::swap(current.symbolOf[i], current.symbolOf[j]);
+        }
+    }
+    return best;
+}
+
+}
+
+namespace EncodingSolver {
+
+QString languageName(Language language) {
+    switch (language) {
+    case Spanish: return QObject::tr("Spanish");
+    case JapaneseKana: return QObject::tr("Japanese (kana)");
+    default: return QObject::tr("English");
+    }
+}
+
+ByteStats histogram(const uchar *data, qint64 size, QThreadPool *pool) {
+    // Cada trozo cuenta con cuatro tablas de unigramas intercaladas, para que bytes repetidos
+    // seguidos no esperen unos por otros al incrementar el mismo contador
+    auto countChunk = [data, size](qint64 from, qint64 to) -> ByteStats {
+        ByteStats stats;
+        stats.bigram.fill(0, 256 * 256);
+        quint32 lanes[4][256] = {};
+        quint32 *bigram = stats.bigram.data();
+        qint64 i = from;
+        for (; i + 4 <= to; i += 4) {
+            ++lanes[0][data[i]];
+            ++lanes[1][data[i + 1]];
+            ++lanes[2][data[i + 2]];
+            ++lanes[3][data[i + 3]];
+        }
+        for (; i < to; ++i) {
+            ++lanes[0][data[i]];
+        }
+        const qint64 pairEnd = std::min(to, size - 1);
+        for (qint64 k = from; k < pairEnd; ++k) {
+            ++bigram[data[k] << 8 | data[k + 1]];
+        }
+        stats.unigram.fill(0, 256);
+        for (int b = 0; b < 256; ++b) {
+            stats.unigram[b] = lanes[0][b] + lanes[1][b] + lanes[2][b] + lanes[3][b];
+        }
+        stats.total = to - from;
+        return stats;
+    };
+
+    const qint64 chunkSize = std::max(HISTOGRAM_CHUNK_MIN, size / std::max(1, pool->maxThreadCount()) + 1);
+    QVector<QFuture<ByteStats>> futures;
+    for (qint64 from = chunkSize; from < size; from += chunkSize) {
+        const qint64 to = std::min(size, from + chunkSize);
+        futures.append(QtConcurrent::run(pool, [countChunk, from, to]() { return countChunk(from, to); }));
+    }
+    ByteStats stats = countChunk(0, std::min(size, chunkSize));
+    for (QFuture<ByteStats> &future : futures) {
+        const ByteStats part = future.result();
+        for (int b = 0; b < 256; ++b) stats.unigram[b] += part.unigram[b];
+        for (int p = 0; p < 256 * 256; ++p) stats.bigram[p] += part.bigram[p];
+        stats.total += part.total;
+    }
+    return stats;
+}
+
+QList<QMap<QChar, quint8>> solve(const uchar *data, qint64 size, Language language,
+                                 QThreadPool *pool, const QAtomicInt *cancel) {
+    QList<QMap<QChar, quint8>> results;
+    if (size < 2) return results;
+
+    const ByteStats stats = histogram(data, size, pool);
+
+    Problem problem;
+    problem.model = &languageModel(language);
+
+    // Bytes presentes, del más al menos frecuente
+    QVector<int> bytes;
+    for (int b = 0; b < 256; ++b) {
+        if (stats.unigram[b]) bytes.append(b);
+    }
+    std::sort(bytes.begin(), bytes.end(), [&stats](int a, int b) { return stats.unigram[a] > stats.unigram[b]; });
+    bytes.resize(std::min(bytes.size(), problem.model->alphabet() + EXTRA_CLASSES));
+    problem.classBytes = bytes;
+
+    const int n = problem.classes();
+    QVector<int> classOf(256, n - 1);
+    for (int c = 0; c < bytes.size(); ++c) classOf[bytes[c]] = c;
+    problem.pairs.fill(0.0, n * n);
+    const double pairTotal = size - 1;
+    for (int p = 0; p < 256 * 256; ++p) {
+        if (stats.bigram[p]) problem.pairs[classOf[p >> 8] * n + classOf[p & 0xFF]] += stats.bigram[p] / pairTotal;
+    }
+
+    // Reinicios independientes repartidos por los núcleos
+    const int restarts = std::max(1, pool->maxThreadCount()) * 2;
+    QVector<QFuture<Solution>> futures;
+    for (int r = 1; r < restarts; ++r) {
+        futures.append(QtConcurrent::run(pool, anneal, problem, (unsigned)r, cancel));
+    }
+    QVector<Solution> solutions;
+    solutions.append(anneal(problem, 0, cancel));
+    for (QFuture<Solution> &future : futures) {
+        solutions.append(future.result());
+    }
+    std::sort(solutions.begin(), solutions.end(), [](const Solution &a, const Solution &b) { return a.score > b.score; });
+
+    for (const Solution &solution : solutions) {
+        QMap<QChar, quint8> mapping;
+        for (int c = 0; c < bytes.size(); ++c) {
+            if (solution.symbolOf[c] < problem.model->alphabet()) {
+                mapping.insert(problem.model->symbols.at(solution.symbolOf[c]), (quint8)bytes[c]);
+            }
+        }
+        if (!mapping.isEmpty() && !results.contains(mapping)) {
+            results.append(mapping);
+            if (results.size() == MAX_SOLUTIONS) break;
+        }
+    }
+    return results;
+}
+
+}
@@ -0,0 +1,41 @@
+#ifndef ENCODINGSOLVER_H
+#define ENCODINGSOLVER_H
+
+#include <QtGlobal>
+#include <QList>
+#include <QMap>
+#include <QChar>
+#include <QVector>
+#include <QString>
+#include <QAtomicInt>
+
+class QThreadPool;
+
+// Adivina una tabla sin frases conocidas: compara los bigramas de los bytes con un modelo de idioma
+namespace EncodingSolver {
+
+enum Language {
+    English,
+    Spanish,
+    JapaneseKana
+};
+
+QString languageName(Language language);
+
+struct ByteStats {
+    QVector<quint32> unigram;   // 256 counts
+    QVector<quint32> bigram;    // 256 * 256 counts, first byte * 256 + second byte
+    qint64 total = 0;
+};
+
+// Byte and byte-pair counts of [data, data + size), split across 'pool'.
+ByteStats histogram(const uchar *data, qint64 size, QThreadPool *pool);
+
+// Proposes character -> byte maps for the lower case letters and the space (kana and 、。 for
+// Japanese), best first. Runs simulated annealing restarts in parallel on 'pool'.
+QList<QMap<QChar, quint8>> solve(const uchar *data, qint64 size, Language language,
+                                 QThreadPool *pool, const QAtomicInt *cancel = nullptr);
+
+}
+
+#endif // ENCODINGSOLVER_H
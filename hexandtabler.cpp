@@ -21,6 +21,7 @@
 #include <QDebug>
 #include <QFont>
 #include <algorithm>
+#include <functional>
 #include <cctype> 
 #include <QSignalBlocker> 
 #include <QInputDialog> 
@@ -41,15 +42,114 @@
 #include <QListWidget>
 #include <QListWidgetItem>
 #include <QDialogButtonBox>
+#include <QComboBox>
+#include <QStatusBar>
+#include <QTabWidget>
+#include <QThread>
+#include <QSpinBox>
+#include <QActionGroup>
+#include <QProgressDialog>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QTemporaryFile>
 
 
 #include "hexeditorarea.h" 
+#include "diffview.h"
+#include "patchengine.h"
+#include "perftrace.h"
+#include "bytepattern.h"
+#include "searchresults.h"
+#include "datainspector.h"
+#include "bookmarks.h"
+#include "pointerscan.h"
+#include "relativesearch.h"
+#include "encodingsolver.h"
+#include "minimap.h"
+#include "textregions.h"
+#include "byteops.h"
+#include "diskreload.h"
+#include "compression.h"
 
 const char organizationName[] = "FEES"; 
 const char applicationName[] = "hexandtabler"; 
 const int MAX_UNDO_STATES = 50; 
 const int MIN_CHARS_FOR_RELATIVE_SEARCH = 3; 
-const qint16 WILD_CARD_OFFSET = SHRT_MIN; 
+const qint64 RELATIVE_CHUNK_MIN = 1 << 20;
+const int MAX_RELATIVE_HITS_PER_CHUNK = 100000;
+const int MAX_LISTED_ENCODINGS = 1000;       // Encoding guesses shown in the dialog; the session keeps them all
+const int FILE_CHANGE_DELAY_MS = 500;   // Quiet time before a rewritten file is looked at
+const qint64 SCAN_BLOCK = 4 << 20;      // Searches read the buffer this much at a time
+
+// Searches read the buffer in SCAN_BLOCK windows overlapping by 'overlap' bytes, so any match of
+// up to overlap + 1 bytes lies whole in one of them. The finder returns the offset of the match it
+// picks in a window (the first one forwards, the last one backwards) or -1.
+typedef std::function<qint64(const uchar *data, qint64 size)> WindowFinder;
+
+static qint64 scanForward(const PieceTable &buffer, qint64 from, qint64 to, qint64 overlap, const WindowFinder &find) {
+    to = std::min(to, buffer.size());
+    for (qint64 start = std::max<qint64>(0, from); start < to; start += SCAN_BLOCK) {
+        const qint64 end = std::min(to, start + SCAN_BLOCK + overlap);
+        const QByteArray window = buffer.read(start, end - start);
+        const qint64 found = find(reinterpret_cast<const uchar *>(window.constData()), window.size());
+        if (found >= 0) return start + found;
+        if (end == to) break;
+    }
+    return -1;
+}
+
+static qint64 scanBackward(const PieceTable &buffer, qint64 from, qint64 to, qint64 overlap, const WindowFinder &find) {
+    from = std::max<qint64>(0, from);
+    for (qint64 end = std::min(to, buffer.size()); end > from;) {
+        const qint64 start = std::max(from, end - SCAN_BLOCK - overlap);
+        const QByteArray window = buffer.read(start, end - start);
+        const qint64 found = find(reinterpret_cast<const uchar *>(window.constData()), window.size());
+        if (found >= 0) return start + found;
+        if (start == from) break;
+        end = start + overlap;
+    }
+    return -1;
+}
+
+// Literal search for a match lying whole in [from, to); backwards, the one starting last
+static qint64 findBytes(const PieceTable &buffer, const QByteArray &needle, bool caseSensitive,
+                        qint64 from, qint64 to, bool backwards) {
+    const QByteArray searchNeedle = caseSensitive ? needle : needle.toLower();
+    const WindowFinder find = [&](const uchar *data, qint64 size) -> qint64 {
+        QByteArray window = QByteArray::fromRawData(reinterpret_cast<const char *>(data), (int)size);
+        if (!caseSensitive) window = window.toLower();
+        return backwards ? window.lastIndexOf(searchNeedle) : window.indexOf(searchNeedle);
+    };
+    return backwards ? scanBackward(buffer, from, to, needle.size() - 1, find)
+                     : scanForward(buffer, from, to, needle.size() - 1, find);
+}
+
+// Every match, without overlaps and in order, window by window
+static QVector<qint64> findAllBytes(const PieceTable &buffer, const QByteArray &needle, bool caseSensitive) {
+    const QByteArray searchNeedle = caseSensitive ? needle : needle.toLower();
+    const qint64 overlap = needle.size() - 1;
+    QVector<qint64> found;
+    for (qint64 from = 0; from < buffer.size();) {
+        const qint64 end = std::min(buffer.size(), from + SCAN_BLOCK + overlap);
+        QByteArray window = buffer.read(from, end - from);
+        if (!caseSensitive) window = window.toLower();
+        int next = 0;
+        for (int pos = window.indexOf(searchNeedle); pos >= 0; pos = window.indexOf(searchNeedle, next)) {
+            found.append(from + pos);
+            next = pos + searchNeedle.size();
+        }
+        if (end == buffer.size()) break;
+        from = std::max(from + next, end - overlap);
+    }
+    return found;
+}
+
+// Longest match minus one, or the whole buffer for patterns with unbounded repetitions
+static qint64 patternOverlap(const BytePattern &pattern, const PieceTable &buffer) {
+    return pattern.maxLength() > 0 ? pattern.maxLength() - 1 : buffer.size();
+}
 
 
 class FindReplaceDialog : public QDialog
@@ -60,7 +160,8 @@ public:
     enum SearchType {
         HexSearch,
         CharSearch,
-        RelativeSearch 
+        RelativeSearch,
+        PatternSearch
     };
 
     FindReplaceDialog(QWidget *parent = nullptr);
@@ -74,9 +175,19 @@ public:
     SearchType searchType() const { 
         if (hexRadioButton->isChecked()) return HexSearch;
         if (relativeRadioButton->isChecked()) return RelativeSearch; 
+        if (patternRadioButton->isChecked()) return PatternSearch;
         return CharSearch; 
     } 
     
+    RelativeSearchOptions relativeOptions() const {
+        RelativeSearchOptions options;
+        options.width = relativeWidthCombo->currentIndex() == 0 ? 1 : 2;
+        options.bigEndian = relativeWidthCombo->currentIndex() == 2;
+        options.stride = relativeStrideSpinBox->value();
+        options.separateCaseBases = separateCaseCheckBox->isChecked();
+        return options;
+    }
+    
     void setFindMode() { 
         setWindowTitle(tr("Find")); 
         replaceLabel->hide(); 
@@ -95,6 +206,7 @@ public:
 
 signals:
     void findNextClicked(bool backwards);
+    void findAllClicked();
     void replaceClicked();
     void replaceAllClicked();
     
@@ -111,9 +223,15 @@ private:
     QRadioButton *hexRadioButton; 
     QRadioButton *charRadioButton; 
     QRadioButton *relativeRadioButton;
+    QRadioButton *patternRadioButton;
+    
+    QComboBox *relativeWidthCombo;
+    QSpinBox *relativeStrideSpinBox;
+    QCheckBox *separateCaseCheckBox;
     
     QLabel *replaceLabel;
     QPushButton *findNextButton;
+    QPushButton *findAllButton;
     QPushButton *replaceButton;
     QPushButton *replaceAllButton;
 };
@@ -136,6 +254,9 @@ FindReplaceDialog::FindReplaceDialog(QWidget *parent)
     hexRadioButton = new QRadioButton(tr("Hexadecimal (FF 1A)"));
     charRadioButton = new QRadioButton(tr("Character (Table)"));
     relativeRadioButton = new QRadioButton(tr("Relative (ADA -> 000300)")); 
+    patternRadioButton = new QRadioButton(tr("Pattern (E8 ?? [2-4] (00|FF))"));
+    patternRadioButton->setToolTip(tr("Hex bytes with ?? and ?F wildcards, 20-7E ranges, ~00 negation, \"text\" in the current table,\n"
+                                      "[n-m] jumps, ( | ) alternatives and {n,m} * + repetitions."));
     hexRadioButton->setChecked(true); 
 
     QHBoxLayout *typeLayout = new QHBoxLayout;
@@ -143,6 +264,27 @@ FindReplaceDialog::FindReplaceDialog(QWidget *parent)
     typeLayout->addWidget(hexRadioButton);
     typeLayout->addWidget(charRadioButton);
     typeLayout->addWidget(relativeRadioButton); 
+    typeLayout->addWidget(patternRadioButton);
+
+    // Opciones de la búsqueda relativa
+    relativeWidthCombo = new QComboBox;
+    relativeWidthCombo->addItem(tr("8-bit"));
+    relativeWidthCombo->addItem(tr("16-bit LE"));
+    relativeWidthCombo->addItem(tr("16-bit BE"));
+    relativeStrideSpinBox = new QSpinBox;
+    relativeStrideSpinBox->setRange(0, 64);
+    relativeStrideSpinBox->setSpecialValueText(tr("Auto"));
+    relativeStrideSpinBox->setToolTip(tr("Bytes from one character to the next. Auto uses the character width."));
+    separateCaseCheckBox = new QCheckBox(tr("Separate upper/lower case bases"));
+    separateCaseCheckBox->setChecked(true);
+
+    QHBoxLayout *relativeLayout = new QHBoxLayout;
+    relativeLayout->addWidget(new QLabel(tr("Relative:")));
+    relativeLayout->addWidget(relativeWidthCombo);
+    relativeLayout->addWidget(new QLabel(tr("Stride:")));
+    relativeLayout->addWidget(relativeStrideSpinBox);
+    relativeLayout->addWidget(separateCaseCheckBox);
+    relativeLayout->addStretch();
 
     caseSensitiveCheckBox = new QCheckBox(tr("Case sensitive"));
     wrapCheckBox = new QCheckBox(tr("Wrap around"));
@@ -155,12 +297,14 @@ FindReplaceDialog::FindReplaceDialog(QWidget *parent)
     
     findNextButton = new QPushButton(tr("Find Next"));
     findNextButton->setDefault(true);
+    findAllButton = new QPushButton(tr("Find All"));
     replaceButton = new QPushButton(tr("Replace"));
     replaceAllButton = new QPushButton(tr("Replace All"));
     QPushButton *closeButton = new QPushButton(tr("Close"));
 
     QHBoxLayout *buttonLayout = new QHBoxLayout;
     buttonLayout->addWidget(findNextButton);
+    buttonLayout->addWidget(findAllButton);
     buttonLayout->addWidget(replaceButton);
     buttonLayout->addWidget(replaceAllButton);
     buttonLayout->addWidget(closeButton);
@@ -168,11 +312,13 @@ FindReplaceDialog::FindReplaceDialog(QWidget *parent)
     QVBoxLayout *mainLayout = new QVBoxLayout;
     mainLayout->addLayout(formLayout);
     mainLayout->addLayout(typeLayout); 
+    mainLayout->addLayout(relativeLayout);
     mainLayout->addLayout(optionsLayout);
     mainLayout->addLayout(buttonLayout);
     setLayout(mainLayout);
     
     connect(findNextButton, &QPushButton::clicked, this, &FindReplaceDialog::onFindNext);
+    connect(findAllButton, &QPushButton::clicked, this, &FindReplaceDialog::findAllClicked);
     connect(replaceButton, &QPushButton::clicked, this, &FindReplaceDialog::replaceClicked);
     connect(replaceAllButton, &QPushButton::clicked, this, &FindReplaceDialog::replaceAllClicked);
     connect(closeButton, &QPushButton::clicked, this, &FindReplaceDialog::close);
@@ -180,6 +326,10 @@ FindReplaceDialog::FindReplaceDialog(QWidget *parent)
     connect(findLineEdit, &QLineEdit::textEdited, [=](){
         backwardsCheckBox->setChecked(false);
     });
+    for (QWidget *widget : { (QWidget *)relativeWidthCombo, (QWidget *)relativeStrideSpinBox, (QWidget *)separateCaseCheckBox }) {
+        widget->setEnabled(false);
+        connect(relativeRadioButton, &QRadioButton::toggled, widget, &QWidget::setEnabled);
+    }
     
     setFindMode();
     setFixedSize(sizeHint());
@@ -205,17 +355,11 @@ QByteArray hexandtabler::convertSearchString(const QString &input, int type) con
         QString searchString = input;
         
         for (const QChar &ch : searchString) {
-            bool found = false;
-            for (int byteValue = 0; byteValue < 256; ++byteValue) {
-                if (!m_charMap[byteValue].isEmpty() && m_charMap[byteValue].at(0) == ch) { 
-                    result.append((char)byteValue);
-                    found = true;
-                    break; 
-                }
-            }
-            if (!found) {
+            int byteValue = m_activeTable->byteFor(ch);
+            if (byteValue == -1) {
                 return QByteArray(); 
             }
+            result.append((char)byteValue);
         }
         return result;
     }
@@ -240,35 +384,56 @@ hexandtabler::hexandtabler(QWidget *parent) :
     addDockWidget(Qt::RightDockWidgetArea, m_tableDock);
     setupConversionTable();
     
+    m_workerPool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+    
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(FILE_CHANGE_DELAY_MS);
+    connect(&m_reloadTimer, &QTimer::timeout, this, &hexandtabler::checkChangedFiles);
+    connect(&m_fileWatcher, &QFileSystemWatcher::fileChanged, this, &hexandtabler::handleFileChanged);
+    connect(&m_fileWatcher, &QFileSystemWatcher::directoryChanged, this, &hexandtabler::handleDirectoryChanged);
+    
+    m_tabWidget = new QTabWidget(this);
+    m_tabWidget->setDocumentMode(true);
+    m_tabWidget->setTabsClosable(true);
+    m_tabWidget->setMovable(true);
+    
+    // El minimapa va a la derecha de las pestañas y sigue a la pestaña activa
+    m_minimap = new MinimapWidget(&m_workerPool, this);
+    QWidget *editorPane = new QWidget(this);
+    QHBoxLayout *editorLayout = new QHBoxLayout(editorPane);
+    editorLayout->setContentsMargins(0, 0, 0, 0);
+    editorLayout->setSpacing(2);
+    editorLayout->addWidget(m_tabWidget, 1);
+    editorLayout->addWidget(m_minimap);
+    
     if (ui->hexEdit) {
         QWidget *placeholder = ui->hexEdit;
         QVBoxLayout *layout = qobject_cast<QVBoxLayout*>(placeholder->parentWidget()->layout());
         
         if (layout) {
-            m_hexEditorArea = new HexEditorArea(this);
-            m_hexEditorArea->setHexData(m_fileData);
-            
             int index = layout->indexOf(placeholder);
             if (index != -1) {
-                layout->insertWidget(index, m_hexEditorArea);
+                layout->insertWidget(index, editorPane);
             } else {
-                layout->addWidget(m_hexEditorArea);
+                layout->addWidget(editorPane);
             }
             
             delete placeholder;
             ui->hexEdit = nullptr; 
-        } else {
-            m_hexEditorArea = nullptr; 
         }
-    } else {
-        m_hexEditorArea = nullptr;
     }
     
-    m_findReplaceDialog = new FindReplaceDialog(this); 
+    connect(m_tabWidget, &QTabWidget::currentChanged, this, &hexandtabler::handleCurrentTabChanged);
+    connect(m_tabWidget, &QTabWidget::tabCloseRequested, this, &hexandtabler::handleTabCloseRequested);
     
-    if (m_hexEditorArea) {
-         connect(m_hexEditorArea, &HexEditorArea::dataChanged, this, &hexandtabler::handleDataEdited);
-    }
+    setupLayoutMenu();
+    setupCopyAsMenu();
+    m_insertModeLabel = new QLabel(tr("OVR"), this);
+    m_insertModeLabel->setToolTip(tr("Overwrite mode (Ins toggles insert mode)"));
+    statusBar()->addPermanentWidget(m_insertModeLabel);
+    createDocument();
+    
+    m_findReplaceDialog = new FindReplaceDialog(this); 
     
     if (m_tableWidget) {
         connect(m_tableWidget, &QTableWidget::itemChanged, this, &hexandtabler::handleTableItemChanged);
@@ -278,7 +443,12 @@ hexandtabler::hexandtabler(QWidget *parent) :
         connect(m_findReplaceDialog, &FindReplaceDialog::findNextClicked, this, [this](bool backwards) {
             
             if (m_findReplaceDialog->searchType() == FindReplaceDialog::RelativeSearch) {
-                this->findNextRelative(m_findReplaceDialog->findText(), m_findReplaceDialog->isWrapped(), backwards);
+                this->findNextRelative(m_findReplaceDialog->findText(), m_findReplaceDialog->relativeOptions(),
+                                       m_findReplaceDialog->isWrapped(), backwards);
+                return;
+            }
+            if (m_findReplaceDialog->searchType() == FindReplaceDialog::PatternSearch) {
+                this->findNextPattern(m_findReplaceDialog->findText(), m_findReplaceDialog->isWrapped(), backwards);
                 return;
             }
             
@@ -304,13 +474,54 @@ hexandtabler::hexandtabler(QWidget *parent) :
         });
         
         connect(m_findReplaceDialog, &FindReplaceDialog::replaceClicked, this, &hexandtabler::replaceOne); 
-    }
+        connect(m_findReplaceDialog, &FindReplaceDialog::findAllClicked, this, &hexandtabler::findAll);
+    }
+    
+    m_searchDock = new SearchResultsDock(this);
+    addDockWidget(Qt::BottomDockWidgetArea, m_searchDock);
+    m_searchDock->hide();
+    connect(m_searchDock, &SearchResultsDock::hitActivated, this, &hexandtabler::handleSearchHitActivated);
+    connect(m_searchDock, &SearchResultsDock::hitContextMenuRequested, this, &hexandtabler::handleSearchHitContextMenu);
+    
+    m_textRegionsDock = new TextRegionsDock(&m_workerPool, this);
+    addDockWidget(Qt::BottomDockWidgetArea, m_textRegionsDock);
+    tabifyDockWidget(m_searchDock, m_textRegionsDock);
+    m_textRegionsDock->hide();
+    m_textRegionsDock->setEditor(m_hexEditorArea);
+    connect(m_textRegionsDock, &TextRegionsDock::runActivated, this, &hexandtabler::handleSearchHitActivated);
+    connect(m_textRegionsDock, &QDockWidget::visibilityChanged, ui->actionTextRegions, &QAction::setChecked);
+
+    m_dataInspectorDock = new DataInspectorDock(this);
+    addDockWidget(Qt::RightDockWidgetArea, m_dataInspectorDock);
+    m_dataInspectorDock->hide();
+    {
+        QSettings settings(organizationName, applicationName);
+        const QString templates = settings.value("structTemplates").toString();
+        if (!templates.isEmpty()) m_dataInspectorDock->setTemplateSource(templates);
+    }
+    m_dataInspectorDock->setEditor(m_hexEditorArea);
+    connect(m_dataInspectorDock, &DataInspectorDock::fieldActivated, this, &hexandtabler::handleSearchHitActivated);
+    connect(m_dataInspectorDock, &DataInspectorDock::templateSourceChanged, this, [](const QString &source) {
+        QSettings settings(organizationName, applicationName);
+        settings.setValue("structTemplates", source);
+    });
+    connect(m_dataInspectorDock, &QDockWidget::visibilityChanged, ui->actionDataInspector, &QAction::setChecked);
+
+    m_bookmarksDock = new BookmarksDock(this);
+    addDockWidget(Qt::RightDockWidgetArea, m_bookmarksDock);
+    tabifyDockWidget(m_dataInspectorDock, m_bookmarksDock);
+    m_bookmarksDock->hide();
+    m_bookmarksDock->setEditor(m_hexEditorArea);
+    connect(m_bookmarksDock, &BookmarksDock::bookmarkActivated, this, &hexandtabler::handleSearchHitActivated);
+    connect(m_bookmarksDock, &BookmarksDock::bookmarksEdited, this, &hexandtabler::handleBookmarksEdited);
+    connect(m_bookmarksDock, &QDockWidget::visibilityChanged, ui->actionBookmarks, &QAction::setChecked);
 
     on_actionDarkMode_triggered(ui->actionDarkMode->isChecked());
     
-    if (m_hexEditorArea) {
-        m_hexEditorArea->setCharMapping(m_charMap); 
-    } 
+#ifndef HEXANDTABLER_PROFILING
+    ui->actionPerfOverlay->setVisible(false);
+    ui->actionExportTrace->setVisible(false);
+#endif
     
     connect(ui->actionToggleTable, &QAction::toggled, m_tableDock, &QDockWidget::setVisible);
     connect(m_tableDock, &QDockWidget::visibilityChanged, ui->actionToggleTable, &QAction::setChecked);
@@ -318,27 +529,377 @@ hexandtabler::hexandtabler(QWidget *parent) :
     createRecentFileActions();
     loadRecentFiles();
     updateUndoRedoActions();
+    updateDocumentTitle(m_doc);
     
-    setWindowTitle(QString("%1 - %2").arg(applicationName).arg(tr("No File")));
+    {
+        QSettings settings(organizationName, applicationName);
+        ui->actionRestoreSession->setChecked(settings.value("restoreSession", true).toBool());
+    }
+    if (ui->actionRestoreSession->isChecked() && QFile::exists(Session::defaultPath())) {
+        // Después de mostrar la ventana, para que la vista tenga ya su tamaño
+        QTimer::singleShot(0, this, [this]() { restoreSession(Session::defaultPath()); });
+    }
 }
 
 hexandtabler::~hexandtabler()
 {
+    // Compare windows cancel their jobs on destruction; do it before draining the pool
+    qDeleteAll(findChildren<DiffView*>());
+    m_searchDock->clear();
+    m_workerPool.waitForDone();
+    qDeleteAll(m_documents);
     delete ui;
 }
 
 void hexandtabler::closeEvent(QCloseEvent *event)
 {
-    if (maybeSave()) {
-        event->accept();
+    // Las vistas descomprimidas primero, de la más nueva a la más vieja: guardarlas modifica su origen
+    QList<HexDocument*> order;
+    for (int i = m_documents.size() - 1; i >= 0; --i) {
+        if (m_documents.at(i)->source.editor) order.append(m_documents.at(i));
+    }
+    for (HexDocument *doc : qAsConst(m_documents)) {
+        if (!doc->source.editor) order.append(doc);
+    }
+    for (HexDocument *doc : qAsConst(order)) {
+        if (!doc->isModified) continue;
+        m_tabWidget->setCurrentWidget(doc->editor);
+        if (!maybeSave(doc)) {
+            event->ignore();
+            return;
+        }
+    }
+    if (ui->actionRestoreSession->isChecked()) {
+        saveSession(Session::defaultPath());
+    }
+    event->accept();
+}
+
+HexDocument *hexandtabler::createDocument() {
+    HexDocument *doc = new HexDocument;
+    doc->editor = new HexEditorArea(m_tabWidget);
+    doc->table = m_activeTable;
+    doc->editor->setCharTable(doc->table);
+    doc->editor->setBytesPerLine(m_bytesPerLine);
+    doc->editor->setGroupSize(m_groupSize);
+    doc->editor->setInsertMode(m_insertMode);
+    m_documents.append(doc);
+    
+    connect(doc->editor, &HexEditorArea::dataChanged, this, &hexandtabler::handleDataEdited);
+    
+    int index = m_tabWidget->addTab(doc->editor, tr("Untitled"));
+    m_tabWidget->setCurrentIndex(index);
+    handleCurrentTabChanged(index);
+    return doc;
+}
+
+HexDocument *hexandtabler::documentForEditor(QObject *editor) const {
+    for (HexDocument *doc : m_documents) {
+        if (doc->editor == editor) return doc;
+    }
+    return nullptr;
+}
+
+void hexandtabler::handleCurrentTabChanged(int index) {
+    if (index < 0) return;
+    HexDocument *doc = documentForEditor(m_tabWidget->widget(index));
+    if (!doc) return;
+    
+    m_doc = doc;
+    m_hexEditorArea = doc->editor;
+    if (m_minimap) m_minimap->setEditor(doc->editor);
+    if (m_textRegionsDock) m_textRegionsDock->setEditor(doc->editor);
+    if (m_dataInspectorDock) m_dataInspectorDock->setEditor(doc->editor);
+    if (m_bookmarksDock) m_bookmarksDock->setEditor(doc->editor);
+    
+    // Cada documento recuerda su tabla; cambiar de pestaña solo cambia el puntero activo
+    if (doc->table && doc->table != m_activeTable) {
+        m_activeTable = doc->table;
+        refreshTableWidget();
+    }
+    if (m_tableDock) {
+        m_tableDock->setWindowTitle(tr("Conversion Table - %1").arg(m_activeTable->name));
+    }
+    
+    updateUndoRedoActions();
+    updateDocumentTitle(doc);
+}
+
+void hexandtabler::handleTabCloseRequested(int index) {
+    closeDocument(index);
+}
+
+void hexandtabler::on_actionCloseTab_triggered() {
+    closeDocument(m_tabWidget->currentIndex());
+}
+
+void hexandtabler::closeDocument(int index) {
+    HexDocument *doc = documentForEditor(m_tabWidget->widget(index));
+    if (!doc) return;
+    
+    m_tabWidget->setCurrentIndex(index);
+    if (!maybeSave(doc)) return;
+    
+    // Always keep one document so the editor pointers stay valid
+    if (m_documents.size() == 1) {
+        createDocument();
+    }
+    
+    if (!doc->filePath.isEmpty()) {
+        m_fileWatcher.removePath(doc->filePath);
+        forgetMissingFile(doc->filePath);
+    }
+    // Una adivinación en curso trabaja con su propia copia; se corta y su resultado se descarta
+    if (doc->guessCancel) doc->guessCancel->storeRelease(1);
+    // Sus vistas descomprimidas conservan los bytes, pero ya no tienen dónde guardarlos
+    for (HexDocument *view : qAsConst(m_documents)) {
+        if (view->source.editor != doc->editor) continue;
+        view->source = PackedSource();
+        view->isModified = true;
+        updateDocumentTitle(view);
+    }
+    m_documents.removeAll(doc);
+    m_tabWidget->removeTab(m_tabWidget->indexOf(doc->editor));
+    doc->editor->deleteLater();
+    delete doc;
+    
+    handleCurrentTabChanged(m_tabWidget->currentIndex());
+    updateMemoryCounters();
+}
+
+void hexandtabler::on_actionCompare_triggered() {
+    QStringList items;
+    QList<HexDocument*> candidates;
+    for (HexDocument *doc : qAsConst(m_documents)) {
+        if (doc == m_doc) continue;
+        candidates.append(doc);
+        items.append(doc->filePath.isEmpty() ? tr("Untitled") : QFileInfo(doc->filePath).fileName());
+    }
+    const QString otherFile = tr("Other file...");
+    items.append(otherFile);
+
+    bool ok = true;
+    QString choice = otherFile;
+    if (items.size() > 1) {
+        choice = QInputDialog::getItem(this, tr("Compare With"), tr("Compare the current document with:"), items, 0, false, &ok);
+    }
+    if (!ok || choice.isEmpty()) return;
+
+    QString nameB;
+    PieceTable dataB;
+    int index = items.indexOf(choice);
+    if (choice == otherFile || index < 0 || index >= candidates.size()) {
+        QString filePath = QFileDialog::getOpenFileName(this, tr("Compare With"), m_doc->filePath.isEmpty() ? QDir::homePath() : QFileInfo(m_doc->filePath).absoluteDir().path(), tr("All Files (*.*)"));
+        if (filePath.isEmpty()) return;
+
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            QMessageBox::critical(this, tr("Error"), tr("Could not read file %1:\n%2.").arg(filePath).arg(file.errorString()));
+            return;
+        }
+        dataB = PieceTable(file.readAll());
+        nameB = QFileInfo(filePath).fileName();
     } else {
-        event->ignore();
+        dataB = candidates.at(index)->editor->buffer().snapshot();
+        nameB = choice;
     }
+
+    QString nameA = m_doc->filePath.isEmpty() ? tr("Untitled") : QFileInfo(m_doc->filePath).fileName();
+    DiffView *view = new DiffView(nameA, m_hexEditorArea->buffer().snapshot(), nameB, dataB, m_activeTable, &m_workerPool, this);
+    view->show();
 }
 
-void hexandtabler::on_actionOpen_triggered() {
-    if (!maybeSave()) return; 
+void hexandtabler::on_actionCreatePatch_triggered() {
+    // El original es el fichero en disco; el resultado, lo que hay ahora en el editor
+    QString startDir = m_doc->filePath.isEmpty() ? QDir::homePath() : QFileInfo(m_doc->filePath).absoluteDir().path();
+    QString sourcePath = m_doc->filePath;
+    if (sourcePath.isEmpty() || !QFileInfo::exists(sourcePath)) {
+        sourcePath = QFileDialog::getOpenFileName(this, tr("Select Original File"), startDir, tr("All Files (*.*)"));
+        if (sourcePath.isEmpty()) return;
+    }
+
+    QString selectedFilter;
+    QString patchPath = QFileDialog::getSaveFileName(this, tr("Save Patch As"), startDir,
+                                                     tr("BPS Patch (*.bps);;UPS Patch (*.ups);;IPS Patch (*.ips)"), &selectedFilter);
+    if (patchPath.isEmpty()) return;
+
+    PatchEngine::Format format = PatchEngine::formatForFileName(patchPath);
+    if (format == PatchEngine::UnknownFormat) {
+        if (selectedFilter.contains("*.ips")) {
+            format = PatchEngine::IpsFormat;
+            patchPath += ".ips";
+        } else if (selectedFilter.contains("*.ups")) {
+            format = PatchEngine::UpsFormat;
+            patchPath += ".ups";
+        } else {
+            format = PatchEngine::BpsFormat;
+            patchPath += ".bps";
+        }
+    }
+
+    const PieceTable target = m_hexEditorArea->buffer().snapshot();
+    QFuture<QString> future = QtConcurrent::run(&m_workerPool, [format, sourcePath, patchPath, target]() -> QString {
+        QFile sourceFile(sourcePath);
+        if (!sourceFile.open(QIODevice::ReadOnly)) {
+            return sourceFile.errorString();
+        }
+        static const uchar empty = 0;
+        const uchar *source = sourceFile.size() > 0 ? sourceFile.map(0, sourceFile.size()) : &empty;
+        if (!source) {
+            return sourceFile.errorString();
+        }
+
+        // El diff recorre el resultado seguido: se vuelca por bloques a un temporal y se mapea
+        // como el original, en vez de aplanarlo en memoria
+        QTemporaryFile targetFile;
+        if (!targetFile.open()) {
+            return targetFile.errorString();
+        }
+        for (qint64 pos = 0; pos < target.size(); pos += SCAN_BLOCK) {
+            const QByteArray block = target.read(pos, std::min(SCAN_BLOCK, target.size() - pos));
+            if (targetFile.write(block) != block.size()) {
+                return targetFile.errorString();
+            }
+        }
+        targetFile.flush();
+        const uchar *targetData = target.size() > 0 ? targetFile.map(0, target.size()) : &empty;
+        if (!targetData) {
+            return targetFile.errorString();
+        }
+
+        QFile patchFile(patchPath);
+        if (!patchFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return patchFile.errorString();
+        }
+        QString error;
+        if (!PatchEngine::createPatch(format, source, sourceFile.size(), targetData, target.size(), &patchFile, &error)) {
+            patchFile.remove();
+            return error;
+        }
+        return QString();
+    });
+
+    statusBar()->showMessage(tr("Creating patch..."));
+    QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, patchPath]() {
+        QString error = watcher->result();
+        if (error.isEmpty()) {
+            statusBar()->showMessage(tr("Patch saved to %1 (%2 bytes).").arg(patchPath).arg(QFileInfo(patchPath).size()), 5000);
+        } else {
+            statusBar()->clearMessage();
+            QMessageBox::critical(this, tr("Create Patch"), tr("Could not create the patch:\n%1").arg(error));
+        }
+    });
+    connect(watcher, &QFutureWatcher<QString>::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(future);
+}
+
+void hexandtabler::on_actionApplyPatch_triggered() {
+    if (!m_hexEditorArea || m_hexEditorArea->isReadOnly()) return;
+    QString patchPath = QFileDialog::getOpenFileName(this, tr("Apply Patch"), m_doc->filePath.isEmpty() ? QDir::homePath() : QFileInfo(m_doc->filePath).absoluteDir().path(),
+                                                     tr("Patches (*.ips *.ups *.bps);;All Files (*.*)"));
+    if (patchPath.isEmpty()) return;
+
+    QFile patchFile(patchPath);
+    if (!patchFile.open(QIODevice::ReadOnly)) {
+        QMessageBox::critical(this, tr("Error"), tr("Could not read file %1:\n%2.").arg(patchPath).arg(patchFile.errorString()));
+        return;
+    }
+    QByteArray patch = patchFile.readAll();
+    const QByteArray source = m_hexEditorArea->buffer().toByteArray();
+    const uchar *patchData = reinterpret_cast<const uchar *>(patch.constData());
+    const uchar *sourceData = reinterpret_cast<const uchar *>(source.constData());
+
+    QString error;
+    qint64 size = PatchEngine::targetSize(patchData, patch.size(), source.size(), &error);
+    if (size > INT_MAX) {
+        error = tr("The patched file would be too large to edit.");
+        size = -1;
+    }
+    QByteArray result;
+    if (size >= 0) {
+        result = QByteArray((int)size, '\0');
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        bool ok = PatchEngine::applyPatch(patchData, patch.size(), sourceData, source.size(),
+                                          reinterpret_cast<uchar *>(result.data()), size, &error);
+        QApplication::restoreOverrideCursor();
+        if (!ok) size = -1;
+    }
+    if (size < 0) {
+        QMessageBox::critical(this, tr("Apply Patch"), tr("Could not apply the patch:\n%1").arg(error));
+        return;
+    }
+
+    // Solo se reescribe el tramo que cambia, como una edición más: deshacer, título y marcadores
+    // (que se mueven con los bytes insertados o quitados) siguen a replaceBytes()
+    const int common = std::min(source.size(), result.size());
+    int prefix = 0;
+    while (prefix < common && source.at(prefix) == result.at(prefix)) ++prefix;
+    int suffix = 0;
+    while (suffix < common - prefix && source.at(source.size() - 1 - suffix) == result.at(result.size() - 1 - suffix)) ++suffix;
+    if (prefix < source.size() || prefix < result.size()) {
+        qint64 cursor = m_hexEditorArea->cursorPosition();
+        m_hexEditorArea->replaceBytes(prefix, source.size() - prefix - suffix, result.mid(prefix, result.size() - prefix - suffix));
+        m_hexEditorArea->setCursorPosition(std::min<qint64>(cursor, qint64(result.size()) * 2));
+    }
+    statusBar()->showMessage(tr("Patch %1 applied.").arg(QFileInfo(patchPath).fileName()), 5000);
+}
+
+void hexandtabler::on_actionApplyPatchToFile_triggered() {
+    QString startDir = m_doc->filePath.isEmpty() ? QDir::homePath() : QFileInfo(m_doc->filePath).absoluteDir().path();
+    QString patchPath = QFileDialog::getOpenFileName(this, tr("Select Patch"), startDir, tr("Patches (*.ips *.ups *.bps);;All Files (*.*)"));
+    if (patchPath.isEmpty()) return;
+    QString sourcePath = QFileDialog::getOpenFileName(this, tr("Select Original File"), QFileInfo(patchPath).absoluteDir().path(), tr("All Files (*.*)"));
+    if (sourcePath.isEmpty()) return;
+    QString outputPath = QFileDialog::getSaveFileName(this, tr("Save Patched File As"), QFileInfo(sourcePath).absoluteDir().path(), tr("All Files (*.*)"));
+    if (outputPath.isEmpty()) return;
+
+    // Todo mapeado en memoria, en segundo plano: sirve para ficheros de cualquier tamaño
+    QFuture<QString> future = QtConcurrent::run(&m_workerPool, [patchPath, sourcePath, outputPath]() -> QString {
+        QString error;
+        if (!PatchEngine::applyPatchFile(patchPath, sourcePath, outputPath, &error)) {
+            return error.isEmpty() ? tr("Unknown error.") : error;
+        }
+        return QString();
+    });
+
+    statusBar()->showMessage(tr("Applying patch..."));
+    QFutureWatcher<QString> *watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, outputPath]() {
+        QString error = watcher->result();
+        statusBar()->clearMessage();
+        if (!error.isEmpty()) {
+            QMessageBox::critical(this, tr("Apply Patch"), tr("Could not apply the patch:\n%1").arg(error));
+            return;
+        }
+        if (QMessageBox::question(this, tr("Apply Patch"), tr("Patched file saved to %1.\nOpen it now?").arg(outputPath)) == QMessageBox::Yes) {
+            loadFile(outputPath);
+        }
+    });
+    connect(watcher, &QFutureWatcher<QString>::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(future);
+}
+
+void hexandtabler::updateDocumentTitle(HexDocument *doc) {
+    if (!doc) return;
+    
+    QString name = doc->filePath.isEmpty() ? tr("Untitled") : QFileInfo(doc->filePath).fileName();
+    if (HexDocument *source = documentForEditor(doc->source.editor)) {
+        name = tr("%1 [%2 at %3]").arg(source->filePath.isEmpty() ? tr("Untitled") : QFileInfo(source->filePath).fileName())
+                   .arg(Compression::codecName(doc->source.codec)).arg(QString::number(doc->source.start, 16).toUpper());
+    }
+    int index = m_tabWidget->indexOf(doc->editor);
+    if (index != -1) {
+        m_tabWidget->setTabText(index, doc->isModified ? name + "*" : name);
+        m_tabWidget->setTabToolTip(index, doc->filePath);
+    }
     
+    if (doc == m_doc) {
+        setWindowTitle(QString("%1 - %2").arg(applicationName).arg(doc->filePath.isEmpty() ? tr("No File") : name));
+    }
+}
+
+void hexandtabler::on_actionOpen_triggered() {
     QString filePath = QFileDialog::getOpenFileName(this, tr("Open File"), "", tr("All Files (*.*)"));
     if (!filePath.isEmpty()) {
         loadFile(filePath);
@@ -346,7 +907,7 @@ void hexandtabler::on_actionOpen_triggered() {
 }
 
 void hexandtabler::on_actionSave_triggered() {
-    if (m_currentFilePath.isEmpty()) {
+    if (m_doc->filePath.isEmpty() && !m_doc->source.editor) {
         on_actionSaveAs_triggered(); 
         return;
     }
@@ -358,39 +919,50 @@ void hexandtabler::on_actionSaveAs_triggered() {
 }
 
 bool hexandtabler::saveFileAs() {
-    QString fileName = QFileDialog::getSaveFileName(this, tr("Save File As"), m_currentFilePath.isEmpty() ? QDir::homePath() : QFileInfo(m_currentFilePath).absoluteDir().path(), tr("All Files (*.*)"));
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save File As"), m_doc->filePath.isEmpty() ? QDir::homePath() : QFileInfo(m_doc->filePath).absoluteDir().path(), tr("All Files (*.*)"));
     if (fileName.isEmpty()) {
         return false;
     }
 
     if (saveDataToFile(fileName)) {
-        m_currentFilePath = fileName;
-        setWindowTitle(QString("%1 - %2").arg(applicationName).arg(QFileInfo(m_currentFilePath).fileName()));
-        prependToRecentFiles(m_currentFilePath); 
+        if (!m_doc->filePath.isEmpty()) {
+            m_fileWatcher.removePath(m_doc->filePath);
+            forgetMissingFile(m_doc->filePath);
+        }
+        m_doc->filePath = fileName;
+        m_doc->source = PackedSource();    // A view saved as a file is a document of its own
+        m_fileWatcher.addPath(fileName);
+        updateDocumentTitle(m_doc);
+        prependToRecentFiles(m_doc->filePath); 
         return true;
     }
     return false;
 }
 
 bool hexandtabler::saveCurrentFile() {
-    if (m_currentFilePath.isEmpty()) {
+    if (m_doc->source.editor) {
+        // Se recomprime en segundo plano: queda guardada cuando termina, no ahora
+        saveToSource(m_doc);
+        return false;
+    }
+    if (m_doc->filePath.isEmpty()) {
         return saveFileAs();
     }
     
-    if (saveDataToFile(m_currentFilePath)) {
-        setWindowTitle(QString("%1 - %2").arg(applicationName).arg(QFileInfo(m_currentFilePath).fileName()));
+    if (saveDataToFile(m_doc->filePath)) {
+        updateDocumentTitle(m_doc);
         return true;
     }
     return false;
 }
 
 bool hexandtabler::saveDataToFile(const QString &filePath) {
-    if (m_hexEditorArea) {
-        m_fileData = m_hexEditorArea->hexData();
-    } else {
+    HT_PROFILE_SCOPE("saveDataToFile");
+    if (!m_hexEditorArea) {
         QMessageBox::critical(this, tr("Error"), tr("Editor area is not initialized. Cannot save data."));
         return false;
     }
+    const PieceTable &fileData = m_hexEditorArea->buffer();
 
     QFile file(filePath);
     if (!file.open(QIODevice::WriteOnly)) {
@@ -398,54 +970,98 @@ bool hexandtabler::saveDataToFile(const QString &filePath) {
         return false;
     }
 
-    if (file.write(m_fileData) == -1) {
-        QMessageBox::critical(this, tr("Error"), tr("Could not write all data to file %1:\n%2.").arg(filePath).arg(file.errorString()));
-        file.close();
-        return false;
+    HT_PROFILE_BYTES(fileData.size());
+    // Por bloques; SCAN_BLOCK es múltiplo del bloque de DiskReload, así que los resúmenes encadenan
+    QVector<quint32> blocks;
+    for (qint64 pos = 0; pos < fileData.size(); pos += SCAN_BLOCK) {
+        const QByteArray block = fileData.read(pos, std::min(SCAN_BLOCK, fileData.size() - pos));
+        if (file.write(block) != block.size()) {
+            QMessageBox::critical(this, tr("Error"), tr("Could not write all data to file %1:\n%2.").arg(filePath).arg(file.errorString()));
+            file.close();
+            return false;
+        }
+        blocks += DiskReload::blockHashes(block);
     }
 
     file.close();
-    m_isModified = false;
+    m_doc->diskStamp = FileStamp::of(filePath);
+    m_doc->diskBlocks = blocks;
+
+    // Los marcadores van en un fichero aparte, con los desplazamientos de lo que se acaba de guardar
+    QString bookmarkError;
+    if (!m_hexEditorArea->bookmarks().save(BookmarkIndex::sidecarPath(filePath), &bookmarkError)) {
+        QMessageBox::warning(this, tr("Bookmarks"), tr("Could not save the bookmarks of %1:\n%2.").arg(filePath).arg(bookmarkError));
+    }
+
+    m_doc->isModified = false;
     updateUndoRedoActions();
+    updateDocumentTitle(m_doc);
     return true;
 }
 
 void hexandtabler::loadFile(const QString &filePath) {
+    QString canonicalPath = QFileInfo(filePath).canonicalFilePath();
+    for (HexDocument *doc : qAsConst(m_documents)) {
+        if (!doc->filePath.isEmpty() && QFileInfo(doc->filePath).canonicalFilePath() == canonicalPath) {
+            m_tabWidget->setCurrentWidget(doc->editor);
+            return;
+        }
+    }
+
+    const FileStamp stamp = FileStamp::of(filePath);
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly)) {
         QMessageBox::critical(this, tr("Error"), tr("Could not read file %1:\n%2.").arg(filePath).arg(file.errorString()));
         return;
     }
 
-    m_fileData = file.readAll();
+    HT_PROFILE_SCOPE("loadFile");
+    QByteArray fileData = file.readAll();
     file.close();
+    HT_PROFILE_BYTES(fileData.size());
+
+    // Reuse the current tab only if it is an untouched empty document
+    if (!m_doc->filePath.isEmpty() || m_doc->isModified || m_hexEditorArea->dataSize() > 0) {
+        createDocument();
+    }
 
     if (m_hexEditorArea) {
-        m_hexEditorArea->setHexData(m_fileData);
+        m_hexEditorArea->setHexData(fileData);
         m_hexEditorArea->goToOffset(0); 
         m_hexEditorArea->setSelection(-1, -1); // Clear selection
+
+        BookmarkIndex bookmarks;
+        QString bookmarkError;
+        if (!bookmarks.load(BookmarkIndex::sidecarPath(filePath), &bookmarkError)) {
+            statusBar()->showMessage(tr("Could not read the bookmarks of %1: %2").arg(filePath).arg(bookmarkError), 5000);
+        }
+        m_hexEditorArea->setBookmarks(bookmarks);
     }
     
-    m_currentFilePath = filePath;
-    m_isModified = false;
-    m_undoStack.clear();
-    m_redoStack.clear();
-    pushUndoState();
+    m_doc->filePath = filePath;
+    m_doc->diskStamp = stamp;
+    m_doc->diskBlocks = DiskReload::blockHashes(fileData);
+    m_fileWatcher.addPath(filePath);
+    m_doc->isModified = false;
+    m_doc->undoStack.clear();
+    m_doc->redoStack.clear();
+    pushUndoState(m_doc);
     updateUndoRedoActions();
     
-    setWindowTitle(QString("%1 - %2").arg(applicationName).arg(QFileInfo(filePath).fileName()));
+    updateDocumentTitle(m_doc);
     prependToRecentFiles(filePath);
 }
 
-bool hexandtabler::maybeSave()
+bool hexandtabler::maybeSave(HexDocument *doc)
 {
-    if (!m_isModified)
+    if (!doc || !doc->isModified)
         return true;
 
     const QMessageBox::StandardButton ret
         = QMessageBox::warning(this, applicationName,
-                             tr("The document has been modified.\n"
-                                "Do you want to save your changes?"),
+                             tr("The document %1 has been modified.\n"
+                                "Do you want to save your changes?")
+                                .arg(doc->filePath.isEmpty() ? tr("Untitled") : QFileInfo(doc->filePath).fileName()),
                              QMessageBox::Save | QMessageBox::Discard
                              | QMessageBox::Cancel);
     switch (ret) {
@@ -459,6 +1075,336 @@ bool hexandtabler::maybeSave()
     }
 }
 
+void hexandtabler::on_actionOpenDecompressed_triggered() {
+    if (!m_hexEditorArea || m_hexEditorArea->dataSize() == 0) return;
+
+    // La selección, o desde el cursor hasta el final: los formatos con cabecera saben dónde acaban
+    const bool hasSelection = m_hexEditorArea->selectionStart() != -1;
+    qint64 start = 0;
+    qint64 length = 0;
+    if (hasSelection) {
+        start = m_hexEditorArea->selectionStart() / 2;
+        length = m_hexEditorArea->selectionEnd() / 2 - start;
+    } else {
+        start = std::min<qint64>(m_hexEditorArea->cursorPosition() / 2, m_hexEditorArea->dataSize() - 1);
+        length = m_hexEditorArea->dataSize() - start;
+    }
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Open Decompressed View"));
+
+    QSettings settings(organizationName, applicationName);
+    QComboBox *codecCombo = new QComboBox;
+    for (int codec = 0; codec < Compression::CODEC_COUNT; ++codec) {
+        codecCombo->addItem(Compression::codecName(Compression::Codec(codec)), codec);
+    }
+    codecCombo->setCurrentIndex(std::max(0, codecCombo->findData(settings.value("decompressCodec", int(Compression::Lz10)).toInt())));
+
+    QFormLayout *formLayout = new QFormLayout;
+    formLayout->addRow(tr("Format:"), codecCombo);
+    formLayout->addRow(hasSelection ? tr("Selection:") : tr("From cursor:"),
+                       new QLabel(tr("%1 bytes at %2").arg(length).arg(QString::number(start, 16).toUpper())));
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(buttonBox);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    const Compression::Codec codec = static_cast<Compression::Codec>(codecCombo->currentData().toInt());
+    settings.setValue("decompressCodec", int(codec));
+    if (!hasSelection && !Compression::isSelfTerminating(codec)) {
+        QMessageBox::information(this, tr("Open Decompressed View"),
+                                 tr("%1 does not mark where it ends: select the compressed bytes first.").arg(Compression::codecName(codec)));
+        return;
+    }
+
+    QPointer<HexEditorArea> editor = m_hexEditorArea;
+    const PieceTable before = editor->buffer();
+    const QByteArray input = before.read(start, length);
+    QSharedPointer<Compression::Decoded> decoded(new Compression::Decoded);
+    QSharedPointer<QAtomicInt> cancel(new QAtomicInt(0));
+    QFuture<bool> future = QtConcurrent::run(&m_workerPool, [input, codec, decoded, cancel]() {
+        return Compression::decode(codec, reinterpret_cast<const uchar *>(input.constData()), input.size(), decoded.data(), cancel.data());
+    });
+
+    QProgressDialog *progress = new QProgressDialog(tr("Decompressing..."), tr("Cancel"), 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    connect(progress, &QProgressDialog::canceled, this, [cancel]() { cancel->storeRelease(1); });
+
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, progress, editor, before, input, decoded, codec, start]() {
+        progress->deleteLater();
+        if (!watcher->result()) {
+            if (!decoded->error.isEmpty()) {
+                QMessageBox::warning(this, tr("Open Decompressed View"),
+                                     tr("The data at %1 is not valid %2:\n%3").arg(QString::number(start, 16).toUpper())
+                                         .arg(Compression::codecName(codec)).arg(decoded->error));
+            }
+            return;
+        }
+        HexDocument *source = documentForEditor(editor);
+        if (!source || !editor->buffer().isSameVersion(before)) {
+            QMessageBox::warning(this, tr("Open Decompressed View"), tr("The document changed while the data was being decompressed; no view was opened."));
+            return;
+        }
+
+        // Una pestaña más, con la tabla del origen; guardarla la recomprime en él
+        const CharTablePtr table = source->table;
+        createDocument();
+        m_doc->source.editor = editor;
+        m_doc->source.start = start;
+        m_doc->source.packed = input.left(int(decoded->consumed));
+        m_doc->source.codec = codec;
+        m_doc->table = table;
+        m_hexEditorArea->setCharTable(table);
+        m_hexEditorArea->setHexData(decoded->data);
+        m_doc->isModified = false;
+        m_doc->undoStack.clear();
+        m_doc->redoStack.clear();
+        pushUndoState(m_doc);
+        updateUndoRedoActions();
+        updateDocumentTitle(m_doc);
+        statusBar()->showMessage(tr("Decompressed %1 bytes into %2.").arg(decoded->consumed).arg(decoded->data.size()), 5000);
+    });
+    connect(watcher, &QFutureWatcher<bool>::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(future);
+}
+
+void hexandtabler::saveToSource(HexDocument *doc) {
+    QPointer<HexEditorArea> view = doc->editor;
+    QPointer<HexEditorArea> target = doc->source.editor;
+    const qint64 start = doc->source.start;
+    const QByteArray original = doc->source.packed;
+    const Compression::Codec codec = doc->source.codec;
+    const QString title = tr("Save Decompressed View");
+
+    // Si otra edición ha tocado el tramo, ya no son los bytes que se descomprimieron
+    auto sourceIntact = [target, start, original]() {
+        return target && start + original.size() <= target->dataSize()
+               && target->buffer().read(start, original.size()) == original;
+    };
+    if (!sourceIntact()) {
+        QMessageBox::warning(this, title, tr("The compressed data at %1 has changed since this view was opened, so it was not overwritten.")
+                                              .arg(QString::number(start, 16).toUpper()));
+        return;
+    }
+
+    const PieceTable before = view->buffer();
+    QSharedPointer<QByteArray> packed(new QByteArray);
+    QSharedPointer<QString> error(new QString);
+    QSharedPointer<QAtomicInt> cancel(new QAtomicInt(0));
+    QFuture<bool> future = QtConcurrent::run(&m_workerPool, [before, codec, packed, error, cancel]() {
+        return Compression::encode(codec, before.toByteArray(), packed.data(), error.data(), cancel.data());
+    });
+
+    QProgressDialog *progress = new QProgressDialog(tr("Compressing..."), tr("Cancel"), 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    connect(progress, &QProgressDialog::canceled, this, [cancel]() { cancel->storeRelease(1); });
+
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this,
+            [this, watcher, progress, view, target, before, packed, error, start, original, title, sourceIntact]() {
+        progress->deleteLater();
+        if (!watcher->result()) {
+            if (!error->isEmpty()) QMessageBox::warning(this, title, *error);
+            return;
+        }
+        // Mientras se comprimía pudo cambiar la vista, el tramo de origen o guardarse otra vez
+        auto unchanged = [&]() -> HexDocument * {
+            HexDocument *doc = documentForEditor(view);
+            if (doc && view->buffer().isSameVersion(before) && doc->source.editor == target && doc->source.start == start
+                && doc->source.packed == original && sourceIntact()) {
+                return doc;
+            }
+            QMessageBox::warning(this, title, tr("The data changed while it was being compressed, so nothing was saved."));
+            return nullptr;
+        };
+        HexDocument *doc = unchanged();
+        if (!doc) return;
+
+        // Más corto, si el formato marca su final: encima, y lo que sobra se queda. Si no, lo que sigue se movería
+        const qint64 length = original.size();
+        qint64 replaced = length;
+        if (Compression::isSelfTerminating(doc->source.codec) && packed->size() <= length) {
+            replaced = packed->size();
+        } else if (packed->size() != length) {
+            const QMessageBox::StandardButton ret
+                = QMessageBox::question(this, title,
+                                        tr("The recompressed data takes %1 bytes instead of %2, so everything after it will move.\n"
+                                           "Do you want to continue?").arg(packed->size()).arg(length),
+                                        QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+            if (ret != QMessageBox::Yes) return;
+            // La pregunta deja correr el bucle de eventos: se vuelve a mirar antes de escribir
+            doc = unchanged();
+            if (!doc) return;
+        }
+
+        if (*packed != original) {
+            target->replaceBytes(start, replaced, *packed);
+            doc->source.packed = *packed;
+        }
+        doc->isModified = false;
+        updateUndoRedoActions();
+        updateDocumentTitle(doc);
+        statusBar()->showMessage(tr("Recompressed %1 bytes into %2 at %3.").arg(before.size()).arg(packed->size())
+                                     .arg(QString::number(start, 16).toUpper()), 5000);
+    });
+    connect(watcher, &QFutureWatcher<bool>::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(future);
+}
+
+void hexandtabler::handleFileChanged(const QString &filePath) {
+    // Quien escribe a trozos avisa varias veces: se mira cuando deja de hacerlo
+    m_changedFiles.insert(filePath);
+    m_reloadTimer.start();
+}
+
+void hexandtabler::checkChangedFiles() {
+    const QSet<QString> changed = m_changedFiles;
+    m_changedFiles.clear();
+    for (const QString &filePath : changed) {
+        HexDocument *doc = nullptr;
+        for (HexDocument *candidate : qAsConst(m_documents)) {
+            if (candidate->filePath == filePath) {
+                doc = candidate;
+                break;
+            }
+        }
+        if (!doc || doc->reloadPending) continue;
+
+        const FileStamp stamp = FileStamp::of(filePath);
+        if (!stamp.isValid()) {
+            // El buffer es ahora la única copia: que cerrar pregunte si guardarlo
+            statusBar()->showMessage(tr("%1 was deleted or moved on disk.").arg(filePath), 5000);
+            if (!doc->isModified) {
+                doc->isModified = true;
+                updateDocumentTitle(doc);
+            }
+            // El vigilante suelta la ruta al borrarse: se mira la carpeta hasta que vuelva
+            if (!m_missingFiles.contains(filePath)) {
+                m_missingFiles.insert(filePath);
+                const QString dirPath = QFileInfo(filePath).absolutePath();
+                if (!m_fileWatcher.directories().contains(dirPath)) m_fileWatcher.addPath(dirPath);
+                // Pudo volver antes de vigilar la carpeta
+                if (QFileInfo::exists(filePath)) handleDirectoryChanged(dirPath);
+            }
+            continue;
+        }
+        // Escribir aparte y renombrar encima deja al vigilante sin la ruta
+        if (!m_fileWatcher.files().contains(filePath)) m_fileWatcher.addPath(filePath);
+        // Lo que acabamos de guardar nosotros
+        if (stamp == doc->diskStamp) continue;
+        reloadFromDisk(doc);
+    }
+}
+
+void hexandtabler::handleDirectoryChanged(const QString &dirPath) {
+    // Un fichero borrado que vuelve a aparecer se trata como reescrito
+    const QSet<QString> missing = m_missingFiles;
+    for (const QString &filePath : missing) {
+        if (QFileInfo(filePath).absolutePath() != dirPath || !QFileInfo::exists(filePath)) continue;
+        forgetMissingFile(filePath);
+        handleFileChanged(filePath);
+    }
+}
+
+void hexandtabler::forgetMissingFile(const QString &filePath) {
+    if (!m_missingFiles.remove(filePath)) return;
+    const QString dirPath = QFileInfo(filePath).absolutePath();
+    for (const QString &other : qAsConst(m_missingFiles)) {
+        if (QFileInfo(other).absolutePath() == dirPath) return;
+    }
+    m_fileWatcher.removePath(dirPath);
+}
+
+void hexandtabler::reloadFromDisk(HexDocument *doc) {
+    const QString name = QFileInfo(doc->filePath).fileName();
+    doc->reloadPending = true;
+    if (doc->isModified) {
+        const QMessageBox::StandardButton ret
+            = QMessageBox::question(this, applicationName,
+                                    tr("%1 has been changed by another program.\n"
+                                       "Do you want to reload it? Your unsaved changes stay in the undo history.").arg(name),
+                                    QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+        if (ret != QMessageBox::Yes) {
+            // No volver a preguntar por este mismo cambio
+            doc->diskStamp = FileStamp::of(doc->filePath);
+            doc->diskBlocks.clear();
+            doc->reloadPending = false;
+            return;
+        }
+    }
+
+    // Sin cambios el buffer es el fichero anterior, bloque a bloque; con cambios se sustituye entero
+    const QString filePath = doc->filePath;
+    const QVector<quint32> previous = doc->isModified ? QVector<quint32>() : doc->diskBlocks;
+    const qint64 previousSize = doc->editor->dataSize();
+    const PieceTable base = doc->editor->buffer();
+    const FileStamp baseStamp = doc->diskStamp;
+    QPointer<HexEditorArea> editor = doc->editor;
+
+    QFuture<DiskReload::Changes> future = QtConcurrent::run(&m_workerPool, [filePath, previous, previousSize]() {
+        return DiskReload::compare(filePath, previous, previousSize);
+    });
+    QFutureWatcher<DiskReload::Changes> *watcher = new QFutureWatcher<DiskReload::Changes>(this);
+    connect(watcher, &QFutureWatcher<DiskReload::Changes>::finished, this, [this, watcher, editor, base, baseStamp, name]() {
+        HexDocument *doc = documentForEditor(editor);
+        if (!doc) return;
+        doc->reloadPending = false;
+        const DiskReload::Changes changes = watcher->result();
+        if (!changes.error.isEmpty()) {
+            statusBar()->showMessage(tr("Could not reload %1: %2").arg(name).arg(changes.error), 5000);
+            return;
+        }
+        // Editado o guardado mientras se leía: se vuelve a mirar con el estado nuevo
+        if (!doc->editor->buffer().isSameVersion(base) || doc->diskStamp != baseStamp) {
+            handleFileChanged(doc->filePath);
+            return;
+        }
+
+        HexEditorArea *area = doc->editor;
+        if (!changes.isEmpty()) {
+            const qint64 cursorPos = area->cursorPosition();
+            const qint64 selectionStart = area->selectionStart();
+            const qint64 selectionEnd = area->selectionEnd();
+            const qint64 top = area->topOffset();
+            const qint64 previousSize = area->dataSize();
+
+            area->setBuffer(DiskReload::apply(area->buffer(), changes));
+            const qint64 size = area->dataSize();
+            if (size < previousSize) {
+                BookmarkIndex bookmarks = area->bookmarks();
+                if (bookmarks.removeBytes(size, previousSize - size)) area->setBookmarks(bookmarks);
+            }
+
+            // La vista queda donde estaba, dentro del tamaño nuevo
+            area->setCursorPosition(std::min(cursorPos, size * 2));
+            if (selectionStart != -1 && selectionEnd <= size * 2) area->setSelection(selectionStart, selectionEnd);
+            area->setTopOffset(top);
+        }
+
+        doc->diskStamp = changes.stamp;
+        doc->diskBlocks = changes.hashes;
+        doc->isModified = false;
+        pushUndoState(doc);
+        updateDocumentTitle(doc);
+        statusBar()->showMessage(tr("%1 reloaded from disk: %2 bytes changed.").arg(name).arg(changes.bytes.size()), 5000);
+
+        // Reescrito otra vez mientras se leía
+        if (FileStamp::of(doc->filePath) != doc->diskStamp) handleFileChanged(doc->filePath);
+    });
+    connect(watcher, &QFutureWatcher<DiskReload::Changes>::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(future);
+}
+
 void hexandtabler::on_actionExit_triggered() {
     close();
 }
@@ -502,6 +1448,252 @@ void hexandtabler::on_actionZoomOut_triggered() {
     if (m_hexEditorArea) m_hexEditorArea->setFont(QFont(m_hexEditorArea->font().family(), std::max(8, m_hexEditorArea->font().pointSize() - 1)));
 }
 
+void hexandtabler::on_actionPerfOverlay_triggered(bool checked) {
+    PerfTrace::setOverlayEnabled(checked);
+    updateMemoryCounters();
+    for (HexDocument *doc : qAsConst(m_documents)) {
+        doc->editor->viewport()->update();
+    }
+}
+
+void hexandtabler::setupLayoutMenu() {
+    QSettings settings(organizationName, applicationName);
+    m_bytesPerLine = settings.value("bytesPerLine", 16).toInt();
+    m_groupSize = settings.value("groupSize", 0).toInt();
+    
+    // 0 = ajustar a la ventana / sin grupos
+    QMenu *bytesMenu = new QMenu(tr("Bytes per Line"), this);
+    QActionGroup *bytesGroup = new QActionGroup(bytesMenu);
+    const QList<int> widths = {8, 16, 32, 64, 0};
+    for (int width : widths) {
+        QAction *action = bytesMenu->addAction(width > 0 ? QString::number(width) : tr("Fit to Window"));
+        action->setCheckable(true);
+        action->setChecked(width == m_bytesPerLine);
+        bytesGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, width]() { setLayoutOptions(width, m_groupSize); });
+    }
+    
+    QMenu *groupMenu = new QMenu(tr("Group Bytes"), this);
+    QActionGroup *groupGroup = new QActionGroup(groupMenu);
+    const QList<int> groups = {0, 2, 4, 8};
+    for (int group : groups) {
+        QAction *action = groupMenu->addAction(group > 0 ? tr("Every %1").arg(group) : tr("None"));
+        action->setCheckable(true);
+        action->setChecked(group == m_groupSize);
+        groupGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, group]() { setLayoutOptions(m_bytesPerLine, group); });
+    }
+    
+    ui->menuOptions->insertMenu(ui->actionMinimap, bytesMenu);
+    ui->menuOptions->insertMenu(ui->actionMinimap, groupMenu);
+}
+
+void hexandtabler::setupCopyAsMenu() {
+    QMenu *copyAsMenu = new QMenu(tr("Copy As"), this);
+    const QList<QPair<QString, HexFormat::Style>> styles = {
+        {tr("Hex Text"), HexFormat::Hex},
+        {tr("Escaped String"), HexFormat::Escaped},
+        {tr("C Array"), HexFormat::CArray},
+        {tr("Base64"), HexFormat::Base64},
+        {tr("Table Text"), HexFormat::TableText}
+    };
+    for (const auto &style : styles) {
+        HexFormat::Style value = style.second;
+        connect(copyAsMenu->addAction(style.first), &QAction::triggered, this, [this, value]() {
+            if (m_hexEditorArea) m_hexEditorArea->copySelection(value);
+        });
+    }
+    ui->menuEdit->insertMenu(ui->actionPaste, copyAsMenu);
+}
+
+void hexandtabler::setLayoutOptions(int bytesPerLine, int groupSize) {
+    m_bytesPerLine = bytesPerLine;
+    m_groupSize = groupSize;
+    for (HexDocument *doc : qAsConst(m_documents)) {
+        doc->editor->setBytesPerLine(bytesPerLine);
+        doc->editor->setGroupSize(groupSize);
+    }
+    
+    QSettings settings(organizationName, applicationName);
+    settings.setValue("bytesPerLine", bytesPerLine);
+    settings.setValue("groupSize", groupSize);
+}
+
+void hexandtabler::on_actionInsertMode_triggered(bool checked) {
+    m_insertMode = checked;
+    for (HexDocument *doc : qAsConst(m_documents)) {
+        doc->editor->setInsertMode(checked);
+    }
+    m_insertModeLabel->setText(checked ? tr("INS") : tr("OVR"));
+    m_insertModeLabel->setToolTip(checked ? tr("Insert mode (Ins toggles overwrite mode)") : tr("Overwrite mode (Ins toggles insert mode)"));
+}
+
+void hexandtabler::on_actionTransformSelection_triggered() {
+    if (!m_hexEditorArea || m_hexEditorArea->isReadOnly()) return;
+    if (m_hexEditorArea->selectionStart() == -1) {
+        QMessageBox::information(this, tr("Transform Selection"), tr("Select the bytes to transform first."));
+        return;
+    }
+    const qint64 start = m_hexEditorArea->selectionStart() / 2;
+    const qint64 length = m_hexEditorArea->selectionEnd() / 2 - start;
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Transform Selection"));
+
+    QComboBox *opCombo = new QComboBox;
+    opCombo->addItem(tr("Fill with pattern"), ByteOps::Fill);
+    opCombo->addItem(tr("XOR with key"), ByteOps::Xor);
+    opCombo->addItem(tr("Add key"), ByteOps::Add);
+    opCombo->addItem(tr("Subtract key"), ByteOps::Subtract);
+    opCombo->addItem(tr("Rotate bits left"), ByteOps::RotateLeft);
+    opCombo->addItem(tr("Rotate bits right"), ByteOps::RotateRight);
+    opCombo->addItem(tr("Swap bytes of 16-bit words"), ByteOps::Swap16);
+    opCombo->addItem(tr("Swap bytes of 32-bit words"), ByteOps::Swap32);
+    opCombo->setCurrentIndex(1);
+
+    QLineEdit *operandEdit = new QLineEdit("FF");
+    operandEdit->setToolTip(tr("Repeated from the start of the selection, e.g. \"00 FF\"."));
+    QSpinBox *bitsSpin = new QSpinBox;
+    bitsSpin->setRange(1, 7);
+
+    QFormLayout *formLayout = new QFormLayout;
+    formLayout->addRow(tr("Operation:"), opCombo);
+    formLayout->addRow(tr("Pattern / Key (Hex):"), operandEdit);
+    formLayout->addRow(tr("Bits:"), bitsSpin);
+    formLayout->addRow(tr("Selection:"), new QLabel(tr("%1 bytes at %2").arg(length).arg(QString::number(start, 16).toUpper())));
+
+    auto updateInputs = [opCombo, operandEdit, bitsSpin]() {
+        const int op = opCombo->currentData().toInt();
+        operandEdit->setEnabled(op <= ByteOps::Subtract);
+        bitsSpin->setEnabled(op == ByteOps::RotateLeft || op == ByteOps::RotateRight);
+    };
+    connect(opCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), &dialog, updateInputs);
+    updateInputs();
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(buttonBox);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    ByteOps::TransformSpec spec;
+    spec.op = static_cast<ByteOps::Transform>(opCombo->currentData().toInt());
+    spec.bits = bitsSpin->value();
+    if (spec.op <= ByteOps::Subtract) {
+        QString hex = operandEdit->text();
+        hex.remove(QRegularExpression("\\s"));
+        if (hex.isEmpty() || hex.size() % 2 != 0 || hex.contains(QRegularExpression("[^0-9A-Fa-f]"))) {
+            QMessageBox::warning(this, tr("Transform Selection"), tr("The pattern must be whole bytes in hexadecimal."));
+            return;
+        }
+        spec.operand = QByteArray::fromHex(hex.toLatin1());
+    }
+
+    // Se trabaja sobre una copia propia de la selección; si el documento cambia mientras tanto se descarta
+    QPointer<HexEditorArea> editor = m_hexEditorArea;
+    const PieceTable before = editor->buffer();
+    QSharedPointer<QByteArray> bytes(new QByteArray(before.read(start, length)));
+    QSharedPointer<QAtomicInt> cancel(new QAtomicInt(0));
+    QFuture<bool> future = QtConcurrent::run(&m_workerPool, [bytes, spec, cancel]() {
+        return ByteOps::transform(reinterpret_cast<uchar *>(bytes->data()), bytes->size(), spec, cancel.data());
+    });
+
+    QProgressDialog *progress = new QProgressDialog(tr("Transforming selection..."), tr("Cancel"), 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    connect(progress, &QProgressDialog::canceled, this, [cancel]() { cancel->storeRelease(1); });
+
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, progress, editor, before, bytes, start, length]() {
+        progress->deleteLater();
+        if (!watcher->result()) return;
+        if (!editor || !editor->buffer().isSameVersion(before)) {
+            QMessageBox::warning(this, tr("Transform Selection"), tr("The document changed while the selection was being transformed; nothing was applied."));
+            return;
+        }
+        editor->replaceBytes(start, length, *bytes);
+        statusBar()->showMessage(tr("Transformed %1 bytes.").arg(length), 3000);
+    });
+    connect(watcher, &QFutureWatcher<bool>::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(future);
+}
+
+void hexandtabler::on_actionSelectionChecksums_triggered() {
+    if (!m_hexEditorArea) return;
+
+    // La selección, o el documento entero si no hay
+    const PieceTable data = m_hexEditorArea->buffer().snapshot();
+    qint64 start = 0;
+    qint64 length = data.size();
+    if (m_hexEditorArea->selectionStart() != -1) {
+        start = m_hexEditorArea->selectionStart() / 2;
+        length = m_hexEditorArea->selectionEnd() / 2 - start;
+    }
+
+    QSharedPointer<ByteOps::Digests> digests(new ByteOps::Digests);
+    QSharedPointer<QAtomicInt> cancel(new QAtomicInt(0));
+    QFuture<bool> future = QtConcurrent::run(&m_workerPool, [data, start, length, digests, cancel]() {
+        return ByteOps::digests(data, start, length, digests.data(), cancel.data());
+    });
+
+    QProgressDialog *progress = new QProgressDialog(tr("Computing checksums..."), tr("Cancel"), 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(300);
+    connect(progress, &QProgressDialog::canceled, this, [cancel]() { cancel->storeRelease(1); });
+
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, progress, digests, start, length]() {
+        progress->deleteLater();
+        if (!watcher->result()) return;
+
+        QDialog dialog(this);
+        dialog.setWindowTitle(tr("Checksums"));
+        QFormLayout *formLayout = new QFormLayout;
+        formLayout->addRow(tr("Range:"), new QLabel(tr("%1 bytes at %2").arg(length).arg(QString::number(start, 16).toUpper())));
+        auto addRow = [formLayout](const QString &label, const QString &value) {
+            QLineEdit *edit = new QLineEdit(value);
+            edit->setReadOnly(true);
+            edit->setMinimumWidth(edit->fontMetrics().horizontalAdvance(QString(66, 'W')) / 2);
+            formLayout->addRow(label, edit);
+        };
+        addRow(tr("CRC-32:"), QString("%1").arg(digests->crc32, 8, 16, QChar('0')).toUpper());
+        addRow(tr("MD5:"), QString::fromLatin1(digests->md5.toHex()).toUpper());
+        addRow(tr("SHA-1:"), QString::fromLatin1(digests->sha1.toHex()).toUpper());
+        addRow(tr("SHA-256:"), QString::fromLatin1(digests->sha256.toHex()).toUpper());
+
+        QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+        connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+        QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+        mainLayout->addLayout(formLayout);
+        mainLayout->addWidget(buttonBox);
+        dialog.exec();
+    });
+    connect(watcher, &QFutureWatcher<bool>::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(future);
+}
+
+void hexandtabler::on_actionMinimap_triggered(bool checked) {
+    if (m_minimap) m_minimap->setVisible(checked);
+}
+
+void hexandtabler::on_actionExportTrace_triggered() {
+    QString filePath = QFileDialog::getSaveFileName(this, tr("Export Performance Trace"), QDir::homePath() + "/hexandtabler-trace.json", tr("Chrome Trace (*.json)"));
+    if (filePath.isEmpty()) return;
+
+    QString error;
+    if (!PerfTrace::exportChromeTrace(filePath, &error)) {
+        QMessageBox::critical(this, tr("Error"), tr("Could not write file %1:\n%2.").arg(filePath).arg(error));
+        return;
+    }
+    statusBar()->showMessage(tr("Trace exported to %1.").arg(filePath), 5000);
+}
+
 void hexandtabler::on_actionGoTo_triggered() {
     if (!m_hexEditorArea) return;
 
@@ -521,215 +1713,358 @@ void hexandtabler::on_actionGoTo_triggered() {
     }
 }
 
+void hexandtabler::on_actionFindPointerTables_triggered() {
+    if (!m_hexEditorArea) return;
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Find Pointer Tables"));
+
+    const PointerFormat current = m_hexEditorArea->pointerFormat();
+    QComboBox *widthCombo = new QComboBox;
+    widthCombo->addItem(tr("16-bit"), 2);
+    widthCombo->addItem(tr("24-bit"), 3);
+    widthCombo->addItem(tr("32-bit"), 4);
+    widthCombo->setCurrentIndex(current.width - 2);
+
+    QComboBox *endianCombo = new QComboBox;
+    endianCombo->addItem(tr("Little endian"));
+    endianCombo->addItem(tr("Big endian"));
+    endianCombo->setCurrentIndex(current.bigEndian ? 1 : 0);
+
+    QLineEdit *baseEdit = new QLineEdit(current.base < 0 ? "-" + QString::number(-current.base, 16).toUpper()
+                                                         : QString::number(current.base, 16).toUpper());
+    baseEdit->setToolTip(tr("Added to every pointer value to get the file offset it points to (may be negative)."));
+
+    // Por defecto, los terminadores de la tabla activa
+    QString terminatorText;
+    for (char terminator : m_activeTable->terminators) {
+        terminatorText += QString("%1 ").arg((uchar)terminator, 2, 16, QChar('0')).toUpper();
+    }
+    QLineEdit *terminatorEdit = new QLineEdit(terminatorText.isEmpty() ? QString("00") : terminatorText.trimmed());
+    terminatorEdit->setToolTip(tr("Bytes that end a string; pointers must land right after one of them."));
 
-void hexandtabler::pushUndoState() {
+    QSpinBox *minCountSpin = new QSpinBox;
+    minCountSpin->setRange(2, 100000);
+    minCountSpin->setValue(4);
+
+    QFormLayout *formLayout = new QFormLayout;
+    formLayout->addRow(tr("Pointer Size:"), widthCombo);
+    formLayout->addRow(tr("Byte Order:"), endianCombo);
+    formLayout->addRow(tr("Base Offset (Hex):"), baseEdit);
+    formLayout->addRow(tr("String Terminators (Hex):"), terminatorEdit);
+    formLayout->addRow(tr("Minimum Entries:"), minCountSpin);
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(buttonBox);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    PointerFormat format;
+    format.width = widthCombo->currentData().toInt();
+    format.bigEndian = endianCombo->currentIndex() == 1;
+
+    QString baseText = baseEdit->text().trimmed();
+    bool negative = baseText.startsWith('-');
+    bool baseOk;
+    format.base = baseText.mid(negative ? 1 : 0).toLongLong(&baseOk, 16);
+    if (negative) format.base = -format.base;
+
+    QByteArray terminators;
+    bool terminatorsOk = true;
+    for (const QString &part : terminatorEdit->text().split(' ', Qt::SkipEmptyParts)) {
+        bool ok;
+        int value = part.toInt(&ok, 16);
+        if (!ok || value < 0 || value > 255) {
+            terminatorsOk = false;
+            break;
+        }
+        terminators.append((char)value);
+    }
+
+    if (!baseOk || !terminatorsOk || terminators.isEmpty()) {
+        QMessageBox::warning(this, tr("Find Pointer Tables"), tr("Invalid base offset or terminator bytes."));
+        return;
+    }
+
+    m_hexEditorArea->setPointerFormat(format);
+
+    const int minCount = minCountSpin->value();
+    const PieceTable data = m_hexEditorArea->buffer().snapshot();
+    QThreadPool *pool = &m_workerPool;
+    SearchJob *job = new SearchJob([data, format, terminators, minCount, pool](SearchJob *job) {
+        HT_PROFILE_SCOPE("findPointerTables");
+        HT_PROFILE_BYTES(data.size());
+        // Un puntero puede apuntar a cualquier parte: este escaneo sí necesita el fichero seguido,
+        // y lo copia aquí y solo mientras dura
+        const QByteArray flat = data.toByteArray();
+        const uchar *bytes = reinterpret_cast<const uchar *>(flat.constData());
+        const QVector<qint64> starts = PointerScan::stringStarts(bytes, flat.size(), terminators);
+        job->setProgress(1, 10);
+        const QVector<PointerTable> tables = PointerScan::findTables(bytes, flat.size(), format, starts,
+                                                                     minCount, pool, job->cancelFlag());
+        for (const PointerTable &table : tables) {
+            if (job->isCancelled()) break;
+            SearchHit hit;
+            hit.offset = table.offset;
+            hit.length = (qint64)table.count * format.width;
+            hit.note = tr("%1 pointers -> %2-%3, %4% of strings")
+                           .arg(table.count)
+                           .arg(QString::number(table.firstTarget, 16).toUpper())
+                           .arg(QString::number(table.lastTarget, 16).toUpper())
+                           .arg(qRound(table.coverage * 100));
+            job->addHit(hit);
+        }
+        job->setProgress(1, 1);
+    }, &m_workerPool);
+
+    m_dockRelativeSearch = RelativeSearch();
+    m_searchDock->startSearch(tr("Pointer tables"), m_hexEditorArea, data, job);
+}
+
+void hexandtabler::on_actionFollowPointer_triggered() {
     if (!m_hexEditorArea) return;
+    if (!m_hexEditorArea->followPointer()) {
+        statusBar()->showMessage(tr("The value under the cursor does not point inside the file."), 3000);
+    }
+}
+
+void hexandtabler::on_actionJumpBack_triggered() {
+    if (!m_hexEditorArea) return;
+    m_hexEditorArea->jumpBack();
+}
+
+
+void hexandtabler::pushUndoState(HexDocument *doc) {
+    if (!doc || !doc->editor) return;
     
     // USANDO LA ESTRUCTURA DEFINIDA EN EL .H
     EditorState currentState;
-    currentState.data = m_hexEditorArea->hexData();
-    currentState.cursorPos = m_hexEditorArea->cursorPosition();
-    currentState.selectionStart = m_hexEditorArea->selectionStart();
-    currentState.selectionEnd = m_hexEditorArea->selectionEnd();
-    
-    if (!m_undoStack.isEmpty() && m_undoStack.last().data == currentState.data) {
+    currentState.data = doc->editor->buffer();
+    currentState.bookmarks = doc->editor->bookmarks();
+    currentState.cursorPos = doc->editor->cursorPosition();
+    currentState.selectionStart = doc->editor->selectionStart();
+    currentState.selectionEnd = doc->editor->selectionEnd();
+    
+    if (!doc->undoStack.isEmpty() && doc->undoStack.last().data.isSameVersion(currentState.data)
+        && doc->undoStack.last().bookmarks.isSameVersion(currentState.bookmarks)) {
         return; 
     }
     
-    m_undoStack.append(currentState);
+    doc->undoStack.append(currentState);
     
-    if (m_undoStack.size() > MAX_UNDO_STATES) {
-        m_undoStack.removeFirst();
+    if (doc->undoStack.size() > MAX_UNDO_STATES) {
+        doc->undoStack.removeFirst();
     }
-    m_redoStack.clear(); 
+    doc->redoStack.clear(); 
     updateUndoRedoActions();
+    updateMemoryCounters();
+}
+
+void hexandtabler::updateMemoryCounters() {
+#ifdef HEXANDTABLER_PROFILING
+    // Memoria real: lo que una instantánea comparte con el buffer o con otra solo se cuenta una vez,
+    // y a la cuenta de deshacer solo va lo que no está ya en los buffers abiertos
+    QSet<const void *> seen;
+    qint64 buffers = 0;
+    qint64 undo = 0;
+    for (HexDocument *doc : qAsConst(m_documents)) {
+        doc->editor->buffer().addFootprint(&seen, &buffers);
+    }
+    for (HexDocument *doc : qAsConst(m_documents)) {
+        for (const EditorState &state : qAsConst(doc->undoStack)) state.data.addFootprint(&seen, &undo);
+        for (const EditorState &state : qAsConst(doc->redoStack)) state.data.addFootprint(&seen, &undo);
+    }
+    HT_PROFILE_COUNTER("Buffers", buffers);
+    HT_PROFILE_COUNTER("Undo", undo);
+#endif
 }
 
 void hexandtabler::updateUndoRedoActions() {
     if (ui->actionUndo) {
-        ui->actionUndo->setEnabled(m_undoStack.size() > 1);
+        ui->actionUndo->setEnabled(m_doc && m_doc->undoStack.size() > 1);
     }
     if (ui->actionRedo) {
-        ui->actionRedo->setEnabled(!m_redoStack.isEmpty());
+        ui->actionRedo->setEnabled(m_doc && !m_doc->redoStack.isEmpty());
     }
 }
 
 void hexandtabler::on_actionUndo_triggered() {
-    if (!m_hexEditorArea || m_undoStack.size() <= 1) return;
+    if (!m_hexEditorArea || m_doc->undoStack.size() <= 1) return;
     
     // USANDO LA ESTRUCTURA DEFINIDA EN EL .H
-    EditorState currentState = m_undoStack.takeLast();
-    m_redoStack.append(currentState);
+    EditorState currentState = m_doc->undoStack.takeLast();
+    m_doc->redoStack.append(currentState);
     
-    EditorState newState = m_undoStack.last();
+    EditorState newState = m_doc->undoStack.last();
     
-    m_fileData = newState.data;
-    m_hexEditorArea->setHexData(m_fileData);
+    m_hexEditorArea->setBuffer(newState.data);
+    m_hexEditorArea->setBookmarks(newState.bookmarks);
     
     // RESTAURAR CURSOR Y SELECCIÓN (FIX)
     m_hexEditorArea->setCursorPosition(newState.cursorPos); 
     m_hexEditorArea->setSelection(newState.selectionStart, newState.selectionEnd);
     
-    m_isModified = true; 
+    m_doc->isModified = true; 
     updateUndoRedoActions();
+    updateDocumentTitle(m_doc);
 }
 
 void hexandtabler::on_actionRedo_triggered() {
-    if (!m_hexEditorArea || m_redoStack.isEmpty()) return;
+    if (!m_hexEditorArea || m_doc->redoStack.isEmpty()) return;
     
     // USANDO LA ESTRUCTURA DEFINIDA EN EL .H
-    EditorState newState = m_redoStack.takeLast();
-    m_undoStack.append(newState);
+    EditorState newState = m_doc->redoStack.takeLast();
+    m_doc->undoStack.append(newState);
     
-    m_fileData = newState.data;
-    m_hexEditorArea->setHexData(m_fileData);
+    m_hexEditorArea->setBuffer(newState.data);
+    m_hexEditorArea->setBookmarks(newState.bookmarks);
     
     // RESTAURAR CURSOR Y SELECCIÓN (FIX)
     m_hexEditorArea->setCursorPosition(newState.cursorPos);
     m_hexEditorArea->setSelection(newState.selectionStart, newState.selectionEnd);
     
-    m_isModified = true;
+    m_doc->isModified = true;
     updateUndoRedoActions();
+    updateDocumentTitle(m_doc);
 }
 
-QVector<qint16> hexandtabler::calculateRelativeOffsets(const QString &input) const {
-    QVector<qint16> offsets;
-    
-    if (input.length() < MIN_CHARS_FOR_RELATIVE_SEARCH) {
-        return offsets; 
-    }
-
-    int firstCharIndex = -1;
-    for (int i = 0; i < input.length(); ++i) {
-        if (input.at(i).isLetter()) { 
-            firstCharIndex = i;
-            break;
-        }
-    }
-    
-    if (firstCharIndex == -1) {
-        return offsets; 
-    }
-
-    quint16 baseValue = input.at(firstCharIndex).unicode(); 
-
-    for (int i = 0; i < input.length(); ++i) {
-        QChar currentChar = input.at(i);
-
-        if (!currentChar.isLetter()) {
-            offsets.append(WILD_CARD_OFFSET);
-        } else {
-            quint16 currentValue = currentChar.unicode();
-            
-            qint16 offset = (qint16)currentValue - (qint16)baseValue; 
-            
-            offsets.append(offset);
-        }
-    }
-
-    return offsets;
-}
-
-void hexandtabler::findNextRelative(const QString &searchText, bool wrap, bool backwards) {
-    
-    QVector<qint16> offsets = calculateRelativeOffsets(searchText);
+void hexandtabler::findNextRelative(const QString &searchText, const RelativeSearchOptions &options, bool wrap, bool backwards) {
     
-    if (offsets.isEmpty()) {
+    RelativeSearch search;
+    QString error;
+    if (searchText.length() < MIN_CHARS_FOR_RELATIVE_SEARCH || !search.compile(searchText, options, &error)) {
         QMessageBox::information(this, tr("Relative Search"), 
             tr("It requires %1 characters at least, and must contain at least one letter.")
-            .arg(MIN_CHARS_FOR_RELATIVE_SEARCH));
+            .arg(MIN_CHARS_FOR_RELATIVE_SEARCH) + (error.isEmpty() ? QString() : "\n" + error));
         return;
     }
 
-    int n = offsets.size();
-    const QByteArray &data = m_fileData;
-    int dataSize = data.size();
+    const PieceTable &data = m_hexEditorArea->buffer();
+    const qint64 dataSize = data.size();
+    const qint64 span = search.span();
     
-    if (dataSize < n) {
+    if (dataSize < span) {
         QMessageBox::information(this, tr("Relative Search"), 
             tr("File too small for a sequence of %1 bytes.")
-            .arg(n));
+            .arg(span));
         return;
     }
 
     qint64 currentBytePos = m_hexEditorArea->cursorPosition() / 2;
-    qint64 startIndex = currentBytePos; 
+    qint64 foundPos = -1;
+    HT_PROFILE_SCOPE("findNextRelative");
+    const WindowFinder findFirst = [&search](const uchar *bytes, qint64 size) { return search.findNext(bytes, size, 0); };
+    const WindowFinder findLast = [&search](const uchar *bytes, qint64 size) { return search.findPrevious(bytes, size, size); };
     
     if (!backwards) {
-        startIndex = std::min((qint64)dataSize - n, startIndex + 1); 
+        qint64 startIndex = currentBytePos + 1;
+        foundPos = scanForward(data, startIndex, dataSize, span - 1, findFirst);
+        if (foundPos == -1 && wrap) {
+            foundPos = scanForward(data, 0, startIndex + span - 1, span - 1, findFirst);
+        }
+        // Bytes recorridos hasta la coincidencia (o todo el fichero)
+        HT_PROFILE_BYTES(foundPos == -1 ? dataSize : (foundPos >= startIndex ? foundPos - startIndex : dataSize - startIndex + foundPos) + span);
     } else {
-        QMessageBox::warning(this, tr("Relative search"), tr("Not implemented."));
-        return;
+        foundPos = scanBackward(data, 0, currentBytePos + span - 1, span - 1, findLast);
+        if (foundPos == -1 && wrap) {
+            foundPos = scanBackward(data, 0, dataSize, span - 1, findLast);
+        }
+        HT_PROFILE_BYTES(foundPos == -1 ? dataSize : (foundPos < currentBytePos ? currentBytePos - foundPos : dataSize - foundPos + currentBytePos));
     }
 
+    if (foundPos != -1) {
+        m_hexEditorArea->goToOffset(foundPos);
+        m_hexEditorArea->setSelection(foundPos * 2, (foundPos + span) * 2);
+    } else {
+        QMessageBox::information(this, tr("Relative Search"), 
+            tr("No coincidences found for this relative search \"%1\".")
+            .arg(searchText));
+    }
+}
 
-    qint64 foundPos = -1;
-    
-    for (qint64 i = startIndex; i <= dataSize - n; ++i) {
-        
-        qint8 baseByte = data.at(i);
-        bool match = true;
-        
-        for (int k = 0; k < n; ++k) {
-            
-            qint16 expectedOffset = offsets.at(k); 
-
-            if (expectedOffset == WILD_CARD_OFFSET) {
-                continue; 
-            }
+// "A=80 a=1A", en hexadecimal con el ancho del carácter
+static QString relativeBaseText(const QVector<RelativeBase> &bases, int width) {
+    QStringList parts;
+    for (const RelativeBase &base : bases) {
+        parts.append(QString("%1=%2").arg(base.letter).arg(QString("%1").arg(base.value, width * 2, 16, QChar('0')).toUpper()));
+    }
+    return parts.join(' ');
+}
 
-            qint8 currentByte = data.at(i + k); 
-            qint16 actualOffset = (qint16)currentByte - (qint16)baseByte; 
-            
-            if (actualOffset != expectedOffset) {
-                match = false;
-                break;
-            }
-        }
-        
-        if (match) {
-            foundPos = i;
-            break; 
-        }
+void hexandtabler::findAllRelative(const QString &searchText, const RelativeSearchOptions &options) {
+    RelativeSearch search;
+    QString error;
+    if (searchText.length() < MIN_CHARS_FOR_RELATIVE_SEARCH || !search.compile(searchText, options, &error)) {
+        QMessageBox::information(m_findReplaceDialog, tr("Relative Search"), 
+            tr("It requires %1 characters at least, and must contain at least one letter.")
+            .arg(MIN_CHARS_FOR_RELATIVE_SEARCH) + (error.isEmpty() ? QString() : "\n" + error));
+        return;
     }
-    
-    if (foundPos == -1 && wrap) {
-        for (qint64 i = 0; i < startIndex; ++i) {
-            qint8 baseByte = data.at(i);
-            bool match = true;
-            
-            for (int k = 0; k < n; ++k) {
-                
-                qint16 expectedOffset = offsets.at(k); 
-                
-                if (expectedOffset == WILD_CARD_OFFSET) {
-                    continue; 
-                }
 
-                qint8 currentByte = data.at(i + k); 
-                qint16 actualOffset = (qint16)currentByte - (qint16)baseByte; 
-                
-                if (actualOffset != expectedOffset) {
-                    match = false;
-                    break;
+    const PieceTable data = m_hexEditorArea->buffer().snapshot();
+    QThreadPool *pool = &m_workerPool;
+    SearchJob *job = new SearchJob([search, data, pool](SearchJob *job) {
+        HT_PROFILE_SCOPE("findAllRelative");
+        HT_PROFILE_BYTES(data.size());
+        const qint64 size = data.size();
+        const QAtomicInt *cancel = job->cancelFlag();
+
+        // Trozos en paralelo, cada uno leído por su cuenta; devuelven sus coincidencias en orden
+        // junto con la base que implica cada una
+        typedef QVector<QPair<qint64, QString>> Found;
+        const qint64 chunkSize = std::max(RELATIVE_CHUNK_MIN, size / (std::max(1, pool->maxThreadCount()) * 4) + 1);
+        QVector<QFuture<Found>> futures;
+        for (qint64 from = 0; from < size; from += chunkSize) {
+            futures.append(QtConcurrent::run(pool, [search, data, from, chunkSize, cancel]() -> Found {
+                const QByteArray window = data.read(from, std::min(data.size(), from + chunkSize + search.span() - 1) - from);
+                const uchar *bytes = reinterpret_cast<const uchar *>(window.constData());
+                Found found;
+                for (qint64 pos = search.findNext(bytes, window.size(), 0, chunkSize);
+                     pos >= 0 && found.size() < MAX_RELATIVE_HITS_PER_CHUNK && !cancel->loadAcquire();
+                     pos = search.findNext(bytes, window.size(), pos + 1, chunkSize)) {
+                    found.append(qMakePair(from + pos, relativeBaseText(search.impliedBases(bytes, pos), search.options().width)));
                 }
+                return found;
+            }));
+        }
+
+        // Agrupa por la base que implica cada coincidencia; la más repetida es la candidata
+        QHash<QString, QVector<qint64>> groups;
+        for (int i = 0; i < futures.size(); ++i) {
+            for (const QPair<qint64, QString> &hit : futures[i].result()) {
+                groups[hit.second].append(hit.first);
             }
-            
-            if (match) {
-                foundPos = i;
-                break; 
+            job->setProgress((qint64)(i + 1) * chunkSize, size);
+        }
+
+        QStringList ranked = groups.keys();
+        std::sort(ranked.begin(), ranked.end(), [&groups](const QString &a, const QString &b) {
+            if (groups[a].size() != groups[b].size()) return groups[a].size() > groups[b].size();
+            return groups[a].first() < groups[b].first();
+        });
+
+        for (int rank = 0; rank < ranked.size() && !job->isCancelled(); ++rank) {
+            const QVector<qint64> &hits = groups[ranked.at(rank)];
+            const QString note = tr("%1  (#%2, %n hit(s))", "", hits.size()).arg(ranked.at(rank)).arg(rank + 1);
+            for (qint64 pos : hits) {
+                SearchHit hit;
+                hit.offset = pos;
+                hit.length = search.span();
+                hit.note = note;
+                job->addHit(hit);
             }
         }
-    }
+    }, &m_workerPool);
 
-    if (foundPos != -1) {
-        m_hexEditorArea->goToOffset(foundPos);
-        m_hexEditorArea->setSelection(foundPos * 2, (foundPos + n) * 2);
-    } else {
-        QMessageBox::information(this, tr("Relative Search"), 
-            tr("No coincidences found for this relative search \"%1\".")
-            .arg(searchText));
-    }
+    m_dockRelativeSearch = search;
+    m_searchDock->startSearch(searchText, m_hexEditorArea, data, job);
 }
 
 void hexandtabler::on_actionFind_triggered() {
@@ -748,15 +2083,17 @@ void hexandtabler::on_actionReplace_triggered() {
 
 void hexandtabler::findNext(const QByteArray &needle, bool caseSensitive, bool wrap, bool backwards) {
     if (!m_hexEditorArea || needle.isEmpty()) return;
+    HT_PROFILE_SCOPE("findNext");
     
-    QByteArray data = m_hexEditorArea->hexData();
+    const PieceTable &data = m_hexEditorArea->buffer();
     qint64 dataSize = data.size();
+    HT_PROFILE_BYTES(dataSize);
     qint64 needleSize = needle.size();
     
     qint64 currentBytePos = m_hexEditorArea->cursorPosition() / 2; 
-
-    QByteArray searchData = caseSensitive ? data : data.toLower();
-    QByteArray searchNeedle = caseSensitive ? needle : needle.toLower();
+    auto matchesAt = [&](qint64 pos) {
+        return pos >= 0 && findBytes(data, needle, caseSensitive, pos, pos + needleSize, false) == pos;
+    };
 
     qint64 foundPos = -1;
     
@@ -766,7 +2103,7 @@ void hexandtabler::findNext(const QByteArray &needle, bool caseSensitive, bool w
         if (m_hexEditorArea->selectionEnd() != -1) { 
             searchStart = m_hexEditorArea->selectionEnd() / 2; 
         } 
-        else if (currentBytePos < dataSize && searchData.mid(currentBytePos, needleSize) == searchNeedle) {
+        else if (matchesAt(currentBytePos)) {
             searchStart = currentBytePos + 1;
         } else {
             searchStart = currentBytePos;
@@ -774,14 +2111,11 @@ void hexandtabler::findNext(const QByteArray &needle, bool caseSensitive, bool w
 
         searchStart = std::min(searchStart, dataSize); 
 
-        foundPos = searchData.indexOf(searchNeedle, searchStart);
+        foundPos = findBytes(data, needle, caseSensitive, searchStart, dataSize, false);
         
         if (foundPos == -1 && wrap) {
-            foundPos = searchData.indexOf(searchNeedle, 0);
-            
-            if (foundPos != -1 && foundPos >= searchStart) {
-                foundPos = -1; 
-            }
+            // Solo lo que empieza antes de searchStart
+            foundPos = findBytes(data, needle, caseSensitive, 0, searchStart + needleSize - 1, false);
         }
         
     } else {
@@ -793,30 +2127,200 @@ void hexandtabler::findNext(const QByteArray &needle, bool caseSensitive, bool w
         else {
              searchEnd = currentBytePos - 1;
              
-             if (currentBytePos >= needleSize && searchData.mid(currentBytePos - needleSize, needleSize) == searchNeedle) {
+             if (currentBytePos >= needleSize && matchesAt(currentBytePos - needleSize)) {
                 searchEnd = currentBytePos - needleSize - 1;
              }
         }
         
         searchEnd = std::max((qint64)0, searchEnd); 
 
-        foundPos = searchData.lastIndexOf(searchNeedle, searchEnd);
+        // Matches starting at or before searchEnd
+        foundPos = findBytes(data, needle, caseSensitive, 0, searchEnd + needleSize, true);
         
         if (foundPos == -1 && wrap) {
-            foundPos = searchData.lastIndexOf(searchNeedle, dataSize - 1);
-            
-            if (foundPos != -1 && foundPos <= searchEnd) {
-                foundPos = -1;
+            foundPos = findBytes(data, needle, caseSensitive, searchEnd + 1, dataSize, true);
+        }
+    }
+
+    if (foundPos != -1) {
+        m_hexEditorArea->goToOffset(foundPos);
+        m_hexEditorArea->setSelection(foundPos * 2, (foundPos + needleSize) * 2);
+    } else {
+        QMessageBox::information(this, tr("Find Result"), tr("Search pattern not found."));
+    }
+}
+
+void hexandtabler::findNextPattern(const QString &patternText, bool wrap, bool backwards) {
+    if (!m_hexEditorArea) return;
+
+    BytePattern pattern;
+    QString error;
+    if (!pattern.compile(patternText, m_activeTable.data(), &error)) {
+        QMessageBox::warning(m_findReplaceDialog, tr("Pattern Search"), error);
+        return;
+    }
+
+    HT_PROFILE_SCOPE("findNextPattern");
+    const PieceTable &data = m_hexEditorArea->buffer();
+    qint64 dataSize = data.size();
+    qint64 currentBytePos = m_hexEditorArea->cursorPosition() / 2;
+    HT_PROFILE_BYTES(dataSize);
+
+    PatternMatch match;
+    const qint64 overlap = patternOverlap(pattern, data);
+    const WindowFinder findFirst = [&](const uchar *bytes, qint64 size) -> qint64 {
+        return pattern.findNext(bytes, size, 0, &match) ? match.start : -1;
+    };
+    const WindowFinder findLast = [&](const uchar *bytes, qint64 size) -> qint64 {
+        return pattern.findPrevious(bytes, size, size, &match) ? match.start : -1;
+    };
+    qint64 found;
+    if (!backwards) {
+        qint64 from = m_hexEditorArea->selectionEnd() != -1 ? m_hexEditorArea->selectionEnd() / 2 : currentBytePos;
+        found = scanForward(data, from, dataSize, overlap, findFirst);
+        if (found < 0 && wrap) {
+            found = scanForward(data, 0, dataSize, overlap, findFirst);
+        }
+    } else {
+        qint64 before = m_hexEditorArea->selectionStart() != -1 ? m_hexEditorArea->selectionStart() / 2 : currentBytePos;
+        found = scanBackward(data, 0, before, overlap, findLast);
+        if (found < 0 && wrap) {
+            found = scanBackward(data, 0, dataSize, overlap, findLast);
+        }
+    }
+
+    if (found >= 0) {
+        match.start = found;    // The window gave it relative to its own start
+        m_hexEditorArea->goToOffset(match.start);
+        m_hexEditorArea->setSelection(match.start * 2, (match.start + match.length) * 2);
+    } else {
+        QMessageBox::information(this, tr("Find Result"), tr("Search pattern not found."));
+    }
+}
+
+void hexandtabler::findAll() {
+    if (!m_hexEditorArea || !m_findReplaceDialog) return;
+
+    const QString text = m_findReplaceDialog->findText();
+    const int type = m_findReplaceDialog->searchType();
+    QString patternText;
+
+    if (type == FindReplaceDialog::RelativeSearch) {
+        findAllRelative(text, m_findReplaceDialog->relativeOptions());
+        return;
+    }
+
+    if (type == FindReplaceDialog::PatternSearch) {
+        patternText = text;
+    } else if (type == FindReplaceDialog::CharSearch && !m_findReplaceDialog->isCaseSensitive()) {
+        // Cada letra acepta sus dos variantes si la tabla tiene ambas
+        QStringList parts;
+        for (const QChar &ch : text) {
+            int lower = m_activeTable->byteFor(ch.toLower());
+            int upper = m_activeTable->byteFor(ch.toUpper());
+            int exact = m_activeTable->byteFor(ch);
+            if (lower >= 0 && upper >= 0 && lower != upper) {
+                parts.append(QString("(%1|%2)").arg(lower, 2, 16, QChar('0')).arg(upper, 2, 16, QChar('0')));
+            } else if (exact >= 0) {
+                parts.append(QString("%1").arg(exact, 2, 16, QChar('0')));
+            } else {
+                parts.clear();
+                break;
+            }
+        }
+        patternText = parts.join(' ');
+    } else {
+        patternText = BytePattern::fromBytes(convertSearchString(text, type));
+    }
+
+    if (patternText.isEmpty()) {
+        QMessageBox::warning(m_findReplaceDialog, tr("Input Error"),
+            tr("Invalid search pattern or character not found in map for the selected mode."));
+        return;
+    }
+
+    BytePattern pattern;
+    QString error;
+    if (!pattern.compile(patternText, m_activeTable.data(), &error)) {
+        QMessageBox::warning(m_findReplaceDialog, tr("Pattern Search"), error);
+        return;
+    }
+
+    const PieceTable data = m_hexEditorArea->buffer().snapshot();
+    SearchJob *job = new SearchJob([pattern, data](SearchJob *job) mutable {
+        HT_PROFILE_SCOPE("findAll");
+        HT_PROFILE_BYTES(data.size());
+        const qint64 size = data.size();
+        const qint64 overlap = patternOverlap(pattern, data);
+        PatternMatch match;
+        qint64 from = 0;
+        // Coincidencias sin solapes, en orden. Lo que empieza en una ventana sin pasar de su
+        // solape cabe entero en ella, así que la siguiente empieza ahí o tras la última coincidencia.
+        while (from < size && !job->isCancelled()) {
+            const qint64 end = std::min(size, from + SCAN_BLOCK + overlap);
+            const QByteArray window = data.read(from, end - from);
+            const uchar *bytes = reinterpret_cast<const uchar *>(window.constData());
+            qint64 next = 0;
+            while (!job->isCancelled() && pattern.findNext(bytes, window.size(), next, &match, job->cancelFlag())) {
+                SearchHit hit;
+                hit.offset = from + match.start;
+                hit.length = match.length;
+                job->addHit(hit);
+                next = match.start + match.length;
             }
+            if (end == size) break;
+            job->setProgress(end - overlap, size);
+            from = std::max(from + next, end - overlap);
+        }
+        job->setProgress(size, size);
+    }, &m_workerPool);
+
+    m_dockRelativeSearch = RelativeSearch();
+    m_searchDock->startSearch(text, m_hexEditorArea, data, job);
+}
+
+void hexandtabler::handleSearchHitActivated(HexEditorArea *editor, qint64 offset, qint64 length) {
+    if (!documentForEditor(editor)) return;
+
+    m_tabWidget->setCurrentWidget(editor);
+    if (offset + length > editor->dataSize()) return; // The buffer shrank since the search
+
+    editor->goToOffset(offset);
+    editor->setSelection(offset * 2, (offset + length) * 2);
+    editor->setFocus();
+}
+
+void hexandtabler::handleSearchHitContextMenu(HexEditorArea *editor, qint64 offset, qint64 length, const QPoint &globalPos) {
+    Q_UNUSED(length);
+    if (!m_dockRelativeSearch.isValid() || !documentForEditor(editor)) return;
+
+    if (offset + m_dockRelativeSearch.span() > editor->dataSize()) return;
+    const QByteArray bytes = editor->buffer().read(offset, m_dockRelativeSearch.span());
+
+    const QVector<RelativeBase> bases = m_dockRelativeSearch.impliedBases(reinterpret_cast<const uchar *>(bytes.constData()), 0);
+    const int width = m_dockRelativeSearch.options().width;
+
+    // Solo las bases latinas de 8 bits caben en la tabla
+    QVector<RelativeBase> latin;
+    for (const RelativeBase &base : bases) {
+        if (width == 1 && (base.letter == QChar('A') || base.letter == QChar('a'))) {
+            latin.append(base);
         }
     }
 
-    if (foundPos != -1) {
-        m_hexEditorArea->goToOffset(foundPos);
-        m_hexEditorArea->setSelection(foundPos * 2, (foundPos + needleSize) * 2);
-    } else {
-        QMessageBox::information(this, tr("Find Result"), tr("Search pattern not found."));
+    QMenu menu;
+    QAction *applyAction = menu.addAction(tr("Apply %1 to the Table").arg(relativeBaseText(bases, width)));
+    applyAction->setEnabled(!latin.isEmpty());
+    if (menu.exec(globalPos) != applyAction) return;
+
+    for (const RelativeBase &base : latin) {
+        QList<QString> series;
+        for (int i = 0; i < 26; ++i) {
+            series.append(QString(QChar(base.letter.unicode() + i)));
+        }
+        insertSeries(series, base.value);
     }
+    statusBar()->showMessage(tr("Applied %1 to table \"%2\".").arg(relativeBaseText(latin, width)).arg(m_activeTable->name), 5000);
 }
 
 void hexandtabler::replaceOne() {
@@ -842,16 +2346,13 @@ void hexandtabler::replaceOne() {
                             ? (m_hexEditorArea->selectionStart() / 2) 
                             : (m_hexEditorArea->cursorPosition() / 2); 
     
-    QByteArray data = m_hexEditorArea->hexData();
-
-    QByteArray currentDataCheck = caseSensitive ? data.mid(currentBytePos, needle.size()) : data.mid(currentBytePos, needle.size()).toLower();
-    QByteArray searchNeedle = caseSensitive ? needle : needle.toLower();
+    const PieceTable &data = m_hexEditorArea->buffer();
+    const bool atMatch = findBytes(data, needle, caseSensitive, currentBytePos, currentBytePos + needle.size(), false) == currentBytePos;
 
     bool replaced = false;
-    if (currentDataCheck == searchNeedle) {
-        data.replace(currentBytePos, needle.size(), replacement);
-        m_hexEditorArea->setHexData(data);
-        pushUndoState();
+    if (atMatch) {
+        // Como una edición más: deshacer, marcadores y título siguen a replaceBytes()
+        m_hexEditorArea->replaceBytes(currentBytePos, needle.size(), replacement);
         
         m_hexEditorArea->goToOffset(currentBytePos + replacement.size());
         m_hexEditorArea->setSelection(-1, -1); 
@@ -861,22 +2362,17 @@ void hexandtabler::replaceOne() {
 
     qint64 searchStart = replaced ? currentBytePos + replacement.size() : currentBytePos;
     if (!replaced) {
-        if (currentDataCheck == searchNeedle) {
-             searchStart = currentBytePos + 1;
-        } else {
-             searchStart = m_hexEditorArea->cursorPosition() / 2;
-        }
+        searchStart = m_hexEditorArea->cursorPosition() / 2;
     }
     
-    QByteArray searchData = caseSensitive ? m_hexEditorArea->hexData() : m_hexEditorArea->hexData().toLower();
-    qint64 foundPos = searchData.indexOf(searchNeedle, searchStart);
+    qint64 foundPos = findBytes(data, needle, caseSensitive, searchStart, data.size(), false);
     
     if (foundPos != -1) {
         m_hexEditorArea->goToOffset(foundPos);
         m_hexEditorArea->setSelection(foundPos * 2, (foundPos + needle.size()) * 2);
     } else if (wrap) {
-        foundPos = searchData.indexOf(searchNeedle, 0);
-        if (foundPos != -1 && foundPos < searchStart) {
+        foundPos = findBytes(data, needle, caseSensitive, 0, searchStart + needle.size() - 1, false);
+        if (foundPos != -1) {
              m_hexEditorArea->goToOffset(foundPos);
              m_hexEditorArea->setSelection(foundPos * 2, (foundPos + needle.size()) * 2);
         } else {
@@ -895,51 +2391,17 @@ void hexandtabler::replaceAll(const QByteArray &needle, const QByteArray &replac
         return;
     }
 
-    QByteArray data = m_hexEditorArea->hexData();
-    QByteArray searchNeedle = m_findReplaceDialog->isCaseSensitive() ? needle : needle.toLower();
-    
-    if (!m_findReplaceDialog->isCaseSensitive()) {
-        int count = 0;
-        QByteArray temp_data = data;
-        
-        QByteArray lower_data = data.toLower(); 
-        qint64 pos = lower_data.indexOf(searchNeedle, 0);
-        
-        qint64 offset = 0; 
-        
-        while (pos != -1) {
-            temp_data.replace(pos + offset, needle.size(), replacement);
-            
-            offset += (replacement.size() - needle.size()); 
-            
-            pos = lower_data.indexOf(searchNeedle, pos + replacement.size() + offset);
-            
-            count++;
-        }
-        
-        data = temp_data;
-        
-        if (count > 0) {
-            QMessageBox::information(this, tr("Replace All"), tr("Replaced %n occurrence(s).", "", count));
-        } else {
-            QMessageBox::information(this, tr("Replace All"), tr("No occurrences found."));
-        }
-        
-    } else {
-        int count = data.count(needle);
-        
-        if (count > 0) {
-            data.replace(needle, replacement);
-            QMessageBox::information(this, tr("Replace All"), tr("Replaced %n occurrence(s).", "", count));
-        } else {
-            QMessageBox::information(this, tr("Replace All"), tr("No occurrences found."));
-        }
-    }
-
-    m_hexEditorArea->setHexData(data);
-    pushUndoState();
+    // Todas en una sola edición: un paso de deshacer, y los marcadores se mueven con cada una
+    const QVector<qint64> found = findAllBytes(m_hexEditorArea->buffer(), needle, m_findReplaceDialog->isCaseSensitive());
+    m_hexEditorArea->replaceEach(found, needle.size(), replacement);
     m_hexEditorArea->goToOffset(0); 
     m_hexEditorArea->setSelection(-1, -1);
+
+    if (!found.isEmpty()) {
+        QMessageBox::information(this, tr("Replace All"), tr("Replaced %n occurrence(s).", "", found.size()));
+    } else {
+        QMessageBox::information(this, tr("Replace All"), tr("No occurrences found."));
+    }
 }
 
 
@@ -970,6 +2432,9 @@ void hexandtabler::setupConversionTable() {
     m_tableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_tableWidget->setFont(QFont("Monospace", 10)); 
 
+    m_activeTable = CharTablePtr(new CharTable(tr("Default")));
+    m_tableSet.insert(m_activeTable->name, m_activeTable);
+
     for (int i = 0; i < 256; ++i) {
         QTableWidgetItem *hexItem = new QTableWidgetItem(QString("%1").arg(i, 2, 16, QChar('0')).toUpper());
         hexItem->setFlags(hexItem->flags() & ~Qt::ItemIsEditable);
@@ -987,8 +2452,9 @@ void hexandtabler::setupConversionTable() {
         QTableWidgetItem *charItem = new QTableWidgetItem(defaultChar);
         m_tableWidget->setItem(i, 1, charItem);
         
-        m_charMap[i] = defaultChar;
+        m_activeTable->map[i] = defaultChar;
     }
+    m_activeTable->compile();
 }
 
 void hexandtabler::on_actionToggleTable_triggered(bool checked) {
@@ -997,14 +2463,220 @@ void hexandtabler::on_actionToggleTable_triggered(bool checked) {
     }
 }
 
+void hexandtabler::on_actionTextRegions_triggered(bool checked) {
+    if (m_textRegionsDock) {
+        m_textRegionsDock->setVisible(checked);
+        if (checked) m_textRegionsDock->raise();
+    }
+}
+
+void hexandtabler::on_actionDataInspector_triggered(bool checked) {
+    if (m_dataInspectorDock) {
+        m_dataInspectorDock->setVisible(checked);
+        if (checked) m_dataInspectorDock->raise();
+    }
+}
+
+void hexandtabler::on_actionBookmarks_triggered(bool checked) {
+    if (m_bookmarksDock) {
+        m_bookmarksDock->setVisible(checked);
+        if (checked) m_bookmarksDock->raise();
+    }
+}
+
+void hexandtabler::on_actionOpenProject_triggered() {
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Project"), QDir::homePath(), tr("Projects (*.htproj);;All Files (*.*)"));
+    if (!fileName.isEmpty()) {
+        restoreSession(fileName);
+    }
+}
+
+void hexandtabler::on_actionSaveProject_triggered() {
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Project As"), QDir::homePath(), tr("Projects (*.htproj)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+    if (!fileName.endsWith(".htproj", Qt::CaseInsensitive)) {
+        fileName += ".htproj";
+    }
+    if (saveSession(fileName)) {
+        statusBar()->showMessage(tr("Project saved to %1.").arg(fileName), 3000);
+    }
+}
+
+void hexandtabler::on_actionRestoreSession_triggered(bool checked) {
+    QSettings settings(organizationName, applicationName);
+    settings.setValue("restoreSession", checked);
+}
+
+Session hexandtabler::currentSession() {
+    Session session;
+    for (auto it = m_tableSet.constBegin(); it != m_tableSet.constEnd(); ++it) {
+        SessionTable table;
+        table.name = it.key();
+        table.filePath = it.value()->filePath;
+        for (int i = 0; i < 256; ++i) table.map << it.value()->map[i];
+        table.terminators = it.value()->terminators;
+        session.tables.append(table);
+    }
+    session.activeTable = m_activeTable ? m_activeTable->name : QString();
+
+    // En el orden de las pestañas; las que no tienen fichero no se pueden reabrir
+    for (int index = 0; index < m_tabWidget->count(); ++index) {
+        HexDocument *doc = documentForEditor(m_tabWidget->widget(index));
+        if (!doc || doc->filePath.isEmpty()) continue;
+
+        SessionDocument entry;
+        entry.filePath = doc->filePath;
+        entry.stamp = doc->diskStamp;
+        entry.table = doc->table ? doc->table->name : QString();
+        for (const TableRegion &region : qAsConst(doc->tableRegions)) {
+            if (!region.table) continue;
+            SessionRegion r;
+            r.start = region.start;
+            r.end = region.end;
+            r.table = region.table->name;
+            entry.regions.append(r);
+        }
+        entry.cursorPos = doc->editor->cursorPosition();
+        entry.selectionStart = doc->editor->selectionStart();
+        entry.selectionEnd = doc->editor->selectionEnd();
+        entry.topOffset = doc->editor->topOffset();
+
+        // Las cachés solo sirven si el buffer es el fichero tal como está en disco
+        if (m_minimap && !doc->isModified && FileStamp::of(doc->filePath) == doc->diskStamp) {
+            const QString cache = Session::cachePath(doc->filePath, "minimap");
+            if (m_minimap->saveCache(doc->editor, cache, doc->diskStamp)) entry.minimapCache = cache;
+        }
+
+        if (doc == m_doc) session.currentDocument = session.documents.size();
+        session.documents.append(entry);
+    }
+
+    session.geometry = saveGeometry();
+    session.windowState = saveState();
+    return session;
+}
+
+bool hexandtabler::saveSession(const QString &path) {
+    HT_PROFILE_SCOPE("saveSession");
+    QString error;
+    if (!currentSession().save(path, &error)) {
+        QMessageBox::warning(this, tr("Project"), tr("Could not save the project %1:\n%2.").arg(path).arg(error));
+        return false;
+    }
+    return true;
+}
+
+void hexandtabler::restoreSession(const QString &path) {
+    HT_PROFILE_SCOPE("restoreSession");
+    QElapsedTimer timer;
+    timer.start();
+
+    Session session;
+    QString error;
+    if (!session.load(path, &error)) {
+        QMessageBox::warning(this, tr("Project"), tr("Could not open the project %1:\n%2.").arg(path).arg(error));
+        return;
+    }
+
+    // Las tablas con el mismo nombre se rellenan en el sitio, como al añadirlas al conjunto
+    for (const SessionTable &entry : qAsConst(session.tables)) {
+        CharTablePtr table = m_tableSet.value(entry.name);
+        if (!table) {
+            table = CharTablePtr(new CharTable(entry.name));
+            m_tableSet.insert(entry.name, table);
+        }
+        for (int i = 0; i < 256; ++i) table->map[i] = entry.map.at(i);
+        table->filePath = entry.filePath;
+        table->terminators = entry.terminators;
+        table->compile();
+    }
+    setActiveTable(session.activeTable);
+    refreshTableWidget();
+
+    // Los documentos que faltan se saltan: la pestaña actual se busca por su índice en el proyecto
+    HexEditorArea *current = nullptr;
+    for (int i = 0; i < session.documents.size(); ++i) {
+        const SessionDocument &entry = session.documents.at(i);
+        if (!QFile::exists(entry.filePath)) continue;
+        loadFile(entry.filePath);
+        HexDocument *doc = m_doc;
+        if (!doc || doc->filePath != entry.filePath) continue;
+        if (i == session.currentDocument) current = doc->editor;
+
+        if (CharTablePtr table = m_tableSet.value(entry.table)) {
+            doc->table = table;
+            doc->editor->setCharTable(table);
+        }
+        doc->tableRegions.clear();
+        for (const SessionRegion &r : entry.regions) {
+            TableRegion region;
+            region.start = r.start;
+            region.end = r.end;
+            region.table = m_tableSet.value(r.table);
+            if (region.table) doc->tableRegions.append(region);
+        }
+        doc->editor->setTableRegions(doc->tableRegions);
+
+        // Si el fichero es el mismo que cuando se guardó el proyecto, el minimapa no se recalcula
+        if (m_minimap && !entry.minimapCache.isEmpty() && entry.stamp == doc->diskStamp) {
+            m_minimap->restoreCache(doc->editor, entry.minimapCache, doc->diskStamp);
+        }
+
+        doc->editor->setCursorPosition(entry.cursorPos);
+        doc->editor->setSelection(entry.selectionStart, entry.selectionEnd);
+        doc->editor->setTopOffset(entry.topOffset);
+    }
+
+    if (current) m_tabWidget->setCurrentWidget(current);
+    if (!session.geometry.isEmpty()) restoreGeometry(session.geometry);
+    if (!session.windowState.isEmpty()) restoreState(session.windowState);
+
+    statusBar()->showMessage(tr("Workspace restored in %1 ms.").arg(timer.elapsed()), 5000);
+}
+
+void hexandtabler::on_actionAddBookmark_triggered() {
+    if (!m_hexEditorArea || m_hexEditorArea->dataSize() == 0) return;
+
+    // La selección, o el byte del cursor si no hay
+    Bookmark bookmark;
+    if (m_hexEditorArea->selectionStart() != -1) {
+        bookmark.start = m_hexEditorArea->selectionStart() / 2;
+        bookmark.end = m_hexEditorArea->selectionEnd() / 2;
+    } else {
+        bookmark.start = std::min<qint64>(m_hexEditorArea->cursorPosition() / 2, m_hexEditorArea->dataSize() - 1);
+        bookmark.end = bookmark.start + 1;
+    }
+    bookmark.name = tr("Bookmark %1").arg(m_hexEditorArea->bookmarks().size() + 1);
+    if (!BookmarksDock::editLabel(this, tr("Add Bookmark"), &bookmark)) return;
+
+    BookmarkIndex bookmarks = m_hexEditorArea->bookmarks();
+    bookmarks.add(bookmark);
+    m_hexEditorArea->setBookmarks(bookmarks);
+    handleBookmarksEdited(m_hexEditorArea);
+}
+
+void hexandtabler::handleBookmarksEdited(HexEditorArea *editor) {
+    HexDocument *doc = documentForEditor(editor);
+    if (!doc) return;
+
+    // Forman parte del documento: se deshacen y piden guardar como cualquier edición
+    const bool wasModified = doc->isModified;
+    doc->isModified = true;
+    pushUndoState(doc);
+    if (!wasModified) {
+        updateDocumentTitle(doc);
+    }
+}
+
 void hexandtabler::on_actionLoadTable_triggered() {
-    QString fileName = QFileDialog::getOpenFileName(this, tr("Load Conversion Table"), m_currentTablePath.isEmpty() ? QDir::homePath() : QFileInfo(m_currentTablePath).absoluteDir().path(), tr("Table Files (*.tbl);;All Files (*.*)"));
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Load Conversion Table"), m_activeTable->filePath.isEmpty() ? QDir::homePath() : QFileInfo(m_activeTable->filePath).absoluteDir().path(), tr("Table Files (*.tbl);;All Files (*.*)"));
     if (fileName.isEmpty()) {
         return;
     }
 
     if (loadTableFile(fileName)) {
-        m_currentTablePath = fileName;
         QMessageBox::information(this, tr("Table Loaded"), tr("Conversion table loaded successfully from %1.").arg(QFileInfo(fileName).fileName()));
     } else {
         QMessageBox::critical(this, tr("Error"), tr("Failed to load conversion table from %1.").arg(QFileInfo(fileName).fileName()));
@@ -1012,15 +2684,15 @@ void hexandtabler::on_actionLoadTable_triggered() {
 }
 
 void hexandtabler::on_actionSaveTable_triggered() {
-    if (m_currentTablePath.isEmpty()) {
+    if (m_activeTable->filePath.isEmpty()) {
         on_actionSaveTableAs_triggered();
     } else {
-        saveTableFile(m_currentTablePath);
+        saveTableFile(m_activeTable->filePath);
     }
 }
 
 void hexandtabler::on_actionSaveTableAs_triggered() {
-    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Conversion Table As"), m_currentTablePath.isEmpty() ? QDir::homePath() : QFileInfo(m_currentTablePath).absoluteDir().path(), tr("Table Files (*.tbl);;All Files (*.*)"));
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Conversion Table As"), m_activeTable->filePath.isEmpty() ? QDir::homePath() : QFileInfo(m_activeTable->filePath).absoluteDir().path(), tr("Table Files (*.tbl);;All Files (*.*)"));
     if (fileName.isEmpty()) {
         return; 
     }
@@ -1030,7 +2702,7 @@ void hexandtabler::on_actionSaveTableAs_triggered() {
     }
 
     if (saveTableFile(fileName)) {
-        m_currentTablePath = fileName;
+        m_activeTable->filePath = fileName;
     }
 }
 
@@ -1047,7 +2719,10 @@ bool hexandtabler::saveTableFile(const QString &filePath) {
     out << "# Conversion Table File\n";
     
     for (int i = 0; i < 256; ++i) {
-        out << QString("%1=%2\n").arg(i, 2, 16, QChar('0')).toUpper().arg(m_charMap[i]);
+        out << QString("%1=%2\n").arg(i, 2, 16, QChar('0')).toUpper().arg(m_activeTable->map[i]);
+    }
+    for (char terminator : m_activeTable->terminators) {
+        out << QString("/%1\n").arg((uchar)terminator, 2, 16, QChar('0')).toUpper();
     }
 
     file.close();
@@ -1057,77 +2732,201 @@ bool hexandtabler::saveTableFile(const QString &filePath) {
 bool hexandtabler::loadTableFile(const QString &filePath) {
     if (!m_tableWidget) return false;
 
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!m_activeTable->load(filePath)) {
         return false;
     }
 
-    QTextStream in(&file);
-    
-    QString newMap[256];
-    
-    for (int i = 0; i < 256; ++i) {
-        newMap[i] = m_charMap[i];
-    }
-    
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        if (line.isEmpty() || line.startsWith("#")) continue;
+    refreshTableWidget();
+    activeTableEdited();
 
-        QStringList parts = line.split("=");
-        if (parts.size() == 2) {
-            QString hexCode = parts.at(0).trimmed();
-            QString charStr = parts.at(1).trimmed();
-            
-            bool ok;
-            int byteValue = hexCode.toInt(&ok, 16); 
+    return true;
+}
 
-            if (ok && byteValue >= 0 && byteValue <= 255) {
-                QString displayChar = charStr.left(1); 
-                if (displayChar.isEmpty()) {
-                    displayChar = "."; 
-                }
-                newMap[byteValue] = displayChar;
-            }
-        }
-    }
-    file.close();
+void hexandtabler::refreshTableWidget() {
+    if (!m_tableWidget) return;
 
     QSignalBlocker blocker(m_tableWidget);
     for (int i = 0; i < 256; ++i) {
-        m_charMap[i] = newMap[i];
         QTableWidgetItem *item = m_tableWidget->item(i, 1); 
         if (item) {
-            item->setText(m_charMap[i]);
+            item->setText(m_activeTable->map[i]);
         }
     }
-    
+}
+
+void hexandtabler::activeTableEdited() {
+    m_activeTable->compile();
     if (m_hexEditorArea) {
-        m_hexEditorArea->setCharMapping(m_charMap);
+        m_hexEditorArea->setCharTable(m_activeTable);
     }
+}
 
-    return true;
+void hexandtabler::setActiveTable(const QString &name) {
+    CharTablePtr table = m_tableSet.value(name);
+    if (!table || table == m_activeTable) return;
+
+    // Solo se cambia el puntero: el decodificador ya está compilado
+    m_activeTable = table;
+    if (m_doc) {
+        m_doc->table = table;
+    }
+    refreshTableWidget();
+    if (m_hexEditorArea) {
+        m_hexEditorArea->setCharTable(m_activeTable);
+    }
+    if (m_tableDock) {
+        m_tableDock->setWindowTitle(tr("Conversion Table - %1").arg(name));
+    }
 }
 
+void hexandtabler::assignTableRegion(const TableRegion &region) {
+    QVector<TableRegion> regions;
+    for (const TableRegion &r : qAsConst(m_doc->tableRegions)) {
+        if (r.end <= region.start || r.start >= region.end) {
+            regions.append(r);
+            continue;
+        }
+        // The new range wins: keep only the parts of 'r' outside it
+        if (r.start < region.start) {
+            TableRegion left = r;
+            left.end = region.start;
+            regions.append(left);
+        }
+        if (r.end > region.end) {
+            TableRegion right = r;
+            right.start = region.end;
+            regions.append(right);
+        }
+    }
+    regions.append(region);
+    std::sort(regions.begin(), regions.end(), [](const TableRegion &a, const TableRegion &b) {
+        return a.start < b.start;
+    });
+    m_doc->tableRegions = regions;
 
-void hexandtabler::clearCharMappingTable() {
-    if (!m_tableWidget) return; 
+    if (m_hexEditorArea) {
+        m_hexEditorArea->setTableRegions(m_doc->tableRegions);
+    }
+}
 
-    QSignalBlocker blocker(m_tableWidget); 
-    
-    for (int i = 0; i < 256; ++i) {
-        m_charMap[i] = "."; 
-        
-        QTableWidgetItem *item = m_tableWidget->item(i, 1); 
-        if (item) {
-            item->setText(".");
+void hexandtabler::on_actionAddTableToSet_triggered() {
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Add Table to Set"), m_activeTable->filePath.isEmpty() ? QDir::homePath() : QFileInfo(m_activeTable->filePath).absoluteDir().path(), tr("Table Files (*.tbl);;All Files (*.*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    bool ok;
+    QString name = QInputDialog::getText(this, tr("Add Table to Set"), tr("Table name:"), QLineEdit::Normal,
+                                         QFileInfo(fileName).completeBaseName(), &ok).trimmed();
+    if (!ok || name.isEmpty()) {
+        return;
+    }
+
+    CharTablePtr table(new CharTable(name));
+    if (!table->load(fileName)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to load conversion table from %1.").arg(QFileInfo(fileName).fileName()));
+        return;
+    }
+
+    CharTablePtr previous = m_tableSet.value(name);
+    if (previous) {
+        // Replace the contents in place so regions and the active pointer stay valid
+        for (int i = 0; i < 256; ++i) {
+            previous->map[i] = table->map[i];
+        }
+        previous->filePath = table->filePath;
+        previous->compile();
+        if (previous == m_activeTable) {
+            refreshTableWidget();
         }
+        if (m_hexEditorArea) {
+            m_hexEditorArea->invalidateView();
+        }
+    } else {
+        m_tableSet.insert(name, table);
     }
-    
-    if (m_hexEditorArea) { 
-        m_hexEditorArea->setCharMapping(m_charMap); 
+    statusBar()->showMessage(tr("Table \"%1\" added to the set.").arg(name), 3000);
+}
+
+void hexandtabler::on_actionSwitchTable_triggered() {
+    QStringList names = m_tableSet.keys();
+    bool ok;
+    QString name = QInputDialog::getItem(this, tr("Switch Active Table"), tr("Table:"), names,
+                                         std::max(0, names.indexOf(m_activeTable->name)), false, &ok);
+    if (ok && !name.isEmpty()) {
+        setActiveTable(name);
+    }
+}
+
+void hexandtabler::on_actionAssignTableRange_triggered() {
+    if (!m_hexEditorArea) return;
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Assign Table to Range"));
+
+    QComboBox *tableCombo = new QComboBox;
+    tableCombo->addItems(m_tableSet.keys());
+    tableCombo->setCurrentText(m_activeTable->name);
+
+    qint64 start = 0;
+    qint64 end = m_hexEditorArea->dataSize();
+    if (m_hexEditorArea->selectionStart() != -1) {
+        start = m_hexEditorArea->selectionStart() / 2;
+        end = m_hexEditorArea->selectionEnd() / 2;
+    }
+    QLineEdit *startEdit = new QLineEdit(QString::number(start, 16).toUpper());
+    QLineEdit *endEdit = new QLineEdit(QString::number(std::max((qint64)0, end - 1), 16).toUpper());
+
+    QFormLayout *formLayout = new QFormLayout;
+    formLayout->addRow(tr("Table:"), tableCombo);
+    formLayout->addRow(tr("Start Offset (Hex):"), startEdit);
+    formLayout->addRow(tr("End Offset (Hex, inclusive):"), endEdit);
+
+    QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttonBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
+    mainLayout->addLayout(formLayout);
+    mainLayout->addWidget(buttonBox);
+
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    bool startOk, endOk;
+    qint64 startOffset = startEdit->text().toLongLong(&startOk, 16);
+    qint64 endOffset = endEdit->text().toLongLong(&endOk, 16);
+    if (!startOk || !endOk || startOffset < 0 || startOffset > endOffset) {
+        QMessageBox::warning(this, tr("Assign Table to Range"), tr("Invalid start/end offsets."));
+        return;
+    }
+
+    TableRegion region;
+    region.start = startOffset;
+    region.end = endOffset + 1;
+    region.table = m_tableSet.value(tableCombo->currentText());
+    if (!region.table) return;
+
+    assignTableRegion(region);
+}
+
+void hexandtabler::on_actionClearTableRanges_triggered() {
+    m_doc->tableRegions.clear();
+    if (m_hexEditorArea) {
+        m_hexEditorArea->setTableRegions(m_doc->tableRegions);
     }
-    m_isModified = true;
+}
+
+
+void hexandtabler::clearCharMappingTable() {
+    if (!m_tableWidget) return; 
+
+    m_activeTable->clear();
+    refreshTableWidget();
+    activeTableEdited();
+    m_doc->isModified = true;
+    updateDocumentTitle(m_doc);
 }
 
 void hexandtabler::on_actionClearTable_triggered() {
@@ -1135,11 +2934,15 @@ void hexandtabler::on_actionClearTable_triggered() {
 }
 
 
-void hexandtabler::insertSeries(const QList<QString> &series) {
+void hexandtabler::insertSeries(const QList<QString> &series, int startRow) {
     if (!m_tableWidget || series.isEmpty()) return;
 
     QModelIndexList selectedIndexes = m_tableWidget->selectionModel()->selectedIndexes(); 
-    int startRow = 0;
+    if (startRow < 0) {
+        startRow = 0;
+    } else {
+        selectedIndexes.clear();
+    }
     if (!selectedIndexes.isEmpty()) {
         startRow = selectedIndexes.at(0).row();
         for (const QModelIndex &index : selectedIndexes) {
@@ -1151,24 +2954,21 @@ void hexandtabler::insertSeries(const QList<QString> &series) {
 
     QSignalBlocker blocker(m_tableWidget); 
     
-    for (int i = 0; i < series.size(); ++i) {
-        int currentRow = startRow + i;
-        if (currentRow >= 0 && currentRow < 256) {
-            QString character = series.at(i).left(1);
-            if (character.isEmpty()) character = ".";
+    // Los bytes dan la vuelta como en la búsqueda relativa: tras FF viene 00
+    for (int i = 0; i < series.size() && i < 256; ++i) {
+        int currentRow = (startRow + i) & 0xFF;
+        QString character = series.at(i).left(1);
+        if (character.isEmpty()) character = ".";
 
-            QTableWidgetItem *item = m_tableWidget->item(currentRow, 1); 
-            if (item) {
-                item->setText(character);
-            }
-            
-            m_charMap[currentRow] = character;
+        QTableWidgetItem *item = m_tableWidget->item(currentRow, 1); 
+        if (item) {
+            item->setText(character);
         }
+        
+        m_activeTable->map[currentRow] = character;
     }
 
-    if (m_hexEditorArea) {
-        m_hexEditorArea->setCharMapping(m_charMap);
-    }
+    activeTableEdited();
 }
 
 void hexandtabler::on_actionInsertLatinUpper_triggered() {
@@ -1235,8 +3035,15 @@ void hexandtabler::on_actionInsertCyrillic_triggered() {
 }
 
 void hexandtabler::handleDataEdited() {
-    m_isModified = true;
-    pushUndoState();
+    HexDocument *doc = documentForEditor(sender());
+    if (!doc) return;
+    
+    bool wasModified = doc->isModified;
+    doc->isModified = true;
+    pushUndoState(doc);
+    if (!wasModified) {
+        updateDocumentTitle(doc);
+    }
 }
 
 void hexandtabler::handleTableItemChanged(QTableWidgetItem *item) {
@@ -1258,19 +3065,16 @@ void hexandtabler::handleTableItemChanged(QTableWidgetItem *item) {
         item->setText(finalChar);
     }
     
-    m_charMap[row] = finalChar;
+    m_activeTable->map[row] = finalChar;
     
-    if (m_hexEditorArea) {
-        m_hexEditorArea->setCharMapping(m_charMap);
-    }
+    activeTableEdited();
 }
 
 
 void hexandtabler::openRecentFile() {
     QAction *action = qobject_cast<QAction *>(sender());
     if (action) {
-        if (maybeSave())
-            loadFile(action->data().toString());
+        loadFile(action->data().toString());
     }
 }
 
@@ -1372,111 +3176,18 @@ QMap<QChar, QList<int>> hexandtabler::calculatePattern(const QString &text) cons
 }
 
 
-QList<QMap<QChar, quint8>> hexandtabler::guessEncoding(const QList<KnownPhrase> &phrases,
-                                                     quint64 startOffset, 
-                                                     quint64 endOffset) { // <- 'backwards' removed
-    // NOTE: This function is executed in a background thread via QtConcurrent::run
-    // It must not interact with the UI.
-    if (m_fileData.isEmpty()) return QList<QMap<QChar, quint8>>();
-
-    QList<QMap<QChar, quint8>> possibleMappings;
-    const QByteArray data = m_fileData; 
-    
-    // Convert to qint64 for safe use with QByteArray::size() and loop counters
-    qint64 dataSize = data.size(); 
-    qint64 start = (qint64)startOffset;
-    qint64 end = (qint64)endOffset; // End offset is the last byte *index* to check (inclusive)
-    
-    // Sanity check of limits
-    start = std::max((qint64)0, start);
-    end = std::min(dataSize - 1, end); 
-    
-    if (start > end) return QList<QMap<QChar, quint8>>(); // Invalid range
-    
-    // Core logic to check for a potential match and build the mapping for a given starting index 'i'
-    // This function is defined inside guessEncoding to capture the 'data' QByteArray by reference efficiently.
-    auto checkMatchAndMap = [&](qint64 i, const KnownPhrase &phrase) -> QMap<QChar, quint8> {
-        QMap<QChar, quint8> currentMapping;
-        bool potentialMatch = true;
-        
-        for (auto it = phrase.pattern.constBegin(); it != phrase.pattern.constEnd(); ++it) {
-            QChar character = it.key();
-            const QList<int> &positions = it.value();
-            
-            // Get the byte value from the first occurrence of the character
-            quint8 byteValue = (quint8)data.at(i + positions.first());
-
-            // Check all other positions of this character for consistency (A-A check)
-            for (int pos : positions) {
-                if ((quint8)data.at(i + pos) != byteValue) {
-                    potentialMatch = false;
-                    break; 
-                }
-            }
-            
-            if (!potentialMatch) break;
-
-            // Check for character-to-byte conflict (char 'A' maps to 0x41, then to 0x42)
-            if (currentMapping.contains(character) && currentMapping.value(character) != byteValue) {
-                potentialMatch = false;
-                break;
-            }
-            
-            // Check for byte-to-character conflict (0x41 maps to 'A', then 0x41 maps to 'B')
-            bool byteConflict = false;
-            for (quint8 existingByte : currentMapping.values()) {
-                if (existingByte == byteValue && currentMapping.key(existingByte) != character) {
-                    byteConflict = true; 
-                    break;
-                }
-            }
-            if (byteConflict) {
-                 potentialMatch = false;
-                 break;
-            }
-
-            currentMapping.insert(character, byteValue);
-        }
-        
-        if (potentialMatch && !currentMapping.isEmpty()) {
-            return currentMapping;
-        }
-        return QMap<QChar, quint8>(); // Return empty map if no match
-    };
-
-    for (const KnownPhrase &phrase : phrases) {
-        int phraseLength = phrase.length;
-        
-        if (end - start + 1 < phraseLength) continue; // Range is too small for the phrase
-
-        // Forward Search: i goes from startOffset to the last possible start index
-        qint64 max_i = end - phraseLength + 1;
-        // Ensure max_i is also within file bounds
-        max_i = std::min(max_i, dataSize - phraseLength); 
-
-        for (qint64 i = start; i <= max_i; ++i) {
-            QMap<QChar, quint8> mapping = checkMatchAndMap(i, phrase);
-            if (!mapping.isEmpty()) {
-                if (!possibleMappings.contains(mapping)) {
-                    possibleMappings.append(mapping);
-                }
-            }
-        }
-    }
-    
-    return possibleMappings;
-}
-
-void hexandtabler::addFoundMappingToTable(const QMap<QChar, quint8> &mapping) {
-    if (!m_tableWidget) return;
+void hexandtabler::addFoundMappingToTable(const QMap<QChar, quint8> &mapping, const CharTablePtr &table) {
+    if (!table) return;
 
-    QSignalBlocker blocker(m_tableWidget);
+    // El dock solo muestra la tabla activa; otra tabla se edita sin tocarlo
+    QTableWidget *widget = table == m_activeTable ? m_tableWidget : nullptr;
+    QSignalBlocker blocker(widget);
     
     // Clear existing mappings that will be overwritten (set to '.')
     for (int i = 0; i < 256; ++i) {
         if (mapping.values().contains(i)) {
-             m_charMap[i] = ".";
-             QTableWidgetItem *item = m_tableWidget->item(i, 1);
+             table->map[i] = ".";
+             QTableWidgetItem *item = widget ? widget->item(i, 1) : nullptr;
              if (item) item->setText(".");
         }
     }
@@ -1486,26 +3197,28 @@ void hexandtabler::addFoundMappingToTable(const QMap<QChar, quint8> &mapping) {
         QChar character = it.key();
         quint8 byteValue = it.value();
         
-        m_charMap[byteValue] = QString(character);
-        QTableWidgetItem *item = m_tableWidget->item(byteValue, 1);
+        table->map[byteValue] = QString(character);
+        QTableWidgetItem *item = widget ? widget->item(byteValue, 1) : nullptr;
         if (item) {
             item->setText(QString(character));
         }
     }
 
-    if (m_hexEditorArea) {
-        m_hexEditorArea->setCharMapping(m_charMap);
+    table->compile();
+    for (HexDocument *doc : qAsConst(m_documents)) {
+        if (doc->table == table) doc->editor->setCharTable(table);
     }
 }
 
 void hexandtabler::on_actionGuessEncoding_triggered() {
     
-    if (m_fileData.isEmpty()) {
+    const PieceTable fileData = m_hexEditorArea->buffer().snapshot();
+    if (fileData.isEmpty()) {
         QMessageBox::warning(this, tr("Encoding Guess"), tr("Please load a file first."));
         return;
     }
 
-    if (m_guessSearchFuture.isRunning()) {
+    if (m_doc->guessFuture.isRunning()) {
         QMessageBox::information(this, tr("Encoding Guess"), tr("A search is already running. Please wait."));
         return;
     }
@@ -1522,13 +3235,38 @@ void hexandtabler::on_actionGuessEncoding_triggered() {
     
     // Search Configuration Input
     // Default end offset is the size of the file in hex
-    qint64 fileSize = m_fileData.size();
+    qint64 fileSize = fileData.size();
     QString maxOffsetHex = QString::number(fileSize > 0 ? fileSize - 1 : 0, 16).toUpper(); 
     QLineEdit *startOffsetEdit = new QLineEdit("0");
     QLineEdit *endOffsetEdit = new QLineEdit(maxOffsetHex);
+    // Si hay candidatos de la vez anterior sobre este mismo buffer, se parte de ellos
+    QSharedPointer<PhraseGuessSession> session = m_doc->guessSession;
+    if (session && !session->covers(fileData, session->start(), session->end())) {
+        session.reset();
+        m_doc->guessSession.reset();
+    }
+    if (session) {
+        phrasesEdit->setPlainText(session->phrases().join('\n'));
+        startOffsetEdit->setText(QString::number(session->start(), 16).toUpper());
+        endOffsetEdit->setText(QString::number(session->end(), 16).toUpper());
+    } else if (m_hexEditorArea->selectionStart() != -1 && m_hexEditorArea->selectionEnd() > m_hexEditorArea->selectionStart()) {
+        startOffsetEdit->setText(QString::number(m_hexEditorArea->selectionStart() / 2, 16).toUpper());
+        endOffsetEdit->setText(QString::number(m_hexEditorArea->selectionEnd() / 2 - 1, 16).toUpper());
+    }
     // Removed QCheckBox *backwardsCheck
     
+    // Sin frases: propone una tabla completa a partir de las estadísticas del idioma
+    QComboBox *methodCombo = new QComboBox;
+    methodCombo->addItem(tr("Known phrases"), -1);
+    for (EncodingSolver::Language language : { EncodingSolver::English, EncodingSolver::Spanish, EncodingSolver::JapaneseKana }) {
+        methodCombo->addItem(tr("Statistical (%1)").arg(EncodingSolver::languageName(language)), (int)language);
+    }
+    connect(methodCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), phrasesEdit, [phrasesEdit](int index) {
+        phrasesEdit->setEnabled(index == 0);
+    });
+    
     QFormLayout *formLayout = new QFormLayout;
+    formLayout->addRow(tr("Method:"), methodCombo);
     formLayout->addRow(tr("Known Phrases:"), phrasesEdit);
     formLayout->addRow(tr("Start Offset (Hex):"), startOffsetEdit);
     formLayout->addRow(tr("End Offset (Hex, inclusive):"), endOffsetEdit); // User provides the last byte index
@@ -1562,6 +3300,25 @@ void hexandtabler::on_actionGuessEncoding_triggered() {
         return;
     }
     
+    const int method = methodCombo->currentData().toInt();
+    QSharedPointer<QAtomicInt> cancel(new QAtomicInt(0));
+    m_doc->guessCancel = cancel;
+    if (method >= 0) {
+        const EncodingSolver::Language language = (EncodingSolver::Language)method;
+        QThreadPool *pool = &m_workerPool;
+        m_doc->guessFuture = QtConcurrent::run(&m_workerPool, [fileData, startOffset, endOffset, language, pool, cancel]() {
+            HT_PROFILE_SCOPE("guessEncodingStatistical");
+            HT_PROFILE_BYTES(endOffset - startOffset + 1);
+            const QByteArray range = fileData.read(startOffset, endOffset - startOffset + 1);
+            EncodingGuess guess;
+            guess.mappings = EncodingSolver::solve(reinterpret_cast<const uchar *>(range.constData()), range.size(), language, pool, cancel.data());
+            guess.total = guess.mappings.size();
+            return guess;
+        });
+        watchGuessEncoding();
+        return;
+    }
+    
     // Phrase processing: ONLY split by new line
     QStringList rawPhrases = input.split('\n', Qt::SkipEmptyParts);
     
@@ -1583,27 +3340,52 @@ void hexandtabler::on_actionGuessEncoding_triggered() {
         return;
     }
     
-    // 4. Execute the function with the new parameters
-    // Removed 'backwards' argument
-    m_guessSearchFuture = QtConcurrent::run(this, 
-                                            &hexandtabler::guessEncoding, 
-                                            searchPhrases, 
-                                            startOffset, 
-                                            endOffset); 
+    // 4. Reuse the previous candidates when the earlier phrases are unchanged; only the new ones are checked
+    bool reuse = session && session->covers(fileData, startOffset, endOffset)
+                 && session->phrases().size() <= searchPhrases.size();
+    for (int i = 0; reuse && i < session->phrases().size(); ++i) {
+        reuse = session->phrases().at(i) == searchPhrases.at(i).text;
+    }
+    if (reuse) {
+        searchPhrases = searchPhrases.mid(session->phrases().size());
+    } else {
+        session.reset(new PhraseGuessSession(fileData, startOffset, endOffset));
+        m_doc->guessSession = session;
+    }
+
+    m_doc->guessFuture = QtConcurrent::run(&m_workerPool, [session, searchPhrases, cancel]() {
+        EncodingGuess guess;
+        for (const KnownPhrase &phrase : searchPhrases) {
+            if (!session->addPhrase(phrase, cancel.data())) return guess;
+        }
+        // Every candidate is kept for the next phrases; the dialog only lists the first ones
+        guess.mappings = session->mappings(MAX_LISTED_ENCODINGS);
+        guess.total = session->candidateCount();
+        return guess;
+    });
+    watchGuessEncoding();
+}
 
+void hexandtabler::watchGuessEncoding() {
     // Connect the result to a QFutureWatcher to ensure processing on the main thread
-    QFutureWatcher<QList<QMap<QChar, quint8>>> *watcher = new QFutureWatcher<QList<QMap<QChar, quint8>>>(this);
-    connect(watcher, &QFutureWatcher<QList<QMap<QChar, quint8>>>::finished, this, &hexandtabler::handleGuessEncodingFinished);
-    connect(watcher, &QFutureWatcher<QList<QMap<QChar, quint8>>>::finished, watcher, &QObject::deleteLater); 
-    watcher->setFuture(m_guessSearchFuture);
+    // El resultado es del documento y la tabla que lanzaron la búsqueda, no de los activos al terminar
+    QPointer<HexEditorArea> editor = m_doc->editor;
+    const CharTablePtr table = m_doc->table;
+    QFutureWatcher<EncodingGuess> *watcher = new QFutureWatcher<EncodingGuess>(this);
+    connect(watcher, &QFutureWatcher<EncodingGuess>::finished, this, [this, watcher, editor, table]() {
+        if (!documentForEditor(editor)) return;
+        handleGuessEncodingFinished(watcher->result(), table);
+    });
+    connect(watcher, &QFutureWatcher<EncodingGuess>::finished, watcher, &QObject::deleteLater); 
+    watcher->setFuture(m_doc->guessFuture);
 
     // Non-blocking notification
     QMessageBox::information(this, tr("Encoding Guess"), tr("Search started in the background. The selection window will appear when the results are ready."));
 }
 
 
-void hexandtabler::handleGuessEncodingFinished() {
-    QList<QMap<QChar, quint8>> results = m_guessSearchFuture.result();
+void hexandtabler::handleGuessEncodingFinished(const EncodingGuess &guess, const CharTablePtr &table) {
+    const QList<QMap<QChar, quint8>> &results = guess.mappings;
     if (results.isEmpty()) {
         QMessageBox::information(this, tr("Encoding Guess Result"),
             tr("No patterns matching the known phrases were found."));
@@ -1614,8 +3396,11 @@ void hexandtabler::handleGuessEncodingFinished() {
     dialog.setWindowTitle(tr("Select Encoding Map"));
 
     QVBoxLayout *mainLayout = new QVBoxLayout(&dialog);
-    QLabel *label = new QLabel(
-        tr("Found %n potential encoding(s). Select one to apply, or use 'Apply All'.", "", results.size()));
+    QString found = tr("Found %n potential encoding(s).", "", guess.total);
+    if (guess.total > results.size()) {
+        found += " " + tr("Showing the first %1; add another phrase to narrow them down.").arg(results.size());
+    }
+    QLabel *label = new QLabel(found + " " + tr("Select one to apply, or use 'Apply All'."));
     mainLayout->addWidget(label);
 
     QListWidget *listWidget = new QListWidget(&dialog);
@@ -1649,7 +3434,7 @@ void hexandtabler::handleGuessEncodingFinished() {
     connect(buttonBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
     connect(applyAllBtn, &QPushButton::clicked, [&]() {
         for (const auto &mapping : results) {
-            addFoundMappingToTable(mapping);
+            addFoundMappingToTable(mapping, table);
         }
         QMessageBox::information(&dialog, tr("Encoding Applied"),
                                  tr("All mappings applied successfully."));
@@ -1659,13 +3444,13 @@ void hexandtabler::handleGuessEncodingFinished() {
     if (dialog.exec() == QDialog::Accepted) {
         QList<QListWidgetItem*> selectedItems = listWidget->selectedItems();
         if (selectedItems.isEmpty()) {
-            addFoundMappingToTable(results.first());
+            addFoundMappingToTable(results.first(), table);
             return; 
         }
         for (QListWidgetItem *selectedItem : selectedItems) {
             int mapIndex = selectedItem->data(Qt::UserRole).toInt();
             if (mapIndex >= 0 && mapIndex < results.size()) {
-                addFoundMappingToTable(results.at(mapIndex));
+                addFoundMappingToTable(results.at(mapIndex), table);
             }
         }
         QMessageBox::information(this, tr("Encoding Applied"),
@@ -13,24 +13,33 @@
 #include <QMap>
 #include <QFuture>
 #include <QFutureWatcher>
+#include <QThreadPool>
+#include <QFileSystemWatcher>
+#include <QSet>
+#include <QTimer>
+
+#include "chartable.h"
+#include "hexdocument.h"
+#include "relativesearch.h"
+#include "phraseguess.h"
 
 class HexEditorArea;
 class QTableWidget;
 class QDockWidget;
 class FindReplaceDialog; 
+class SearchResultsDock;
+class MinimapWidget;
+class TextRegionsDock;
+class DataInspectorDock;
+class BookmarksDock;
 class QRadioButton; 
+class QTabWidget;
+class QLabel;
 
 namespace Ui {
 class hexandtabler;
 }
 
-// Estructura para manejar frases conocidas
-struct KnownPhrase {
-    QString text;
-    int length = 0;
-    QMap<QChar, QList<int>> pattern;
-};
-
 class hexandtabler : public QMainWindow
 {
     Q_OBJECT
@@ -46,6 +55,12 @@ protected:
 
 private slots:
     void on_actionOpen_triggered();
+    void on_actionCloseTab_triggered();
+    void on_actionCompare_triggered();
+    void on_actionOpenDecompressed_triggered();
+    void on_actionCreatePatch_triggered();
+    void on_actionApplyPatch_triggered();
+    void on_actionApplyPatchToFile_triggered();
     void on_actionSave_triggered();
     void on_actionSaveAs_triggered(); 
     void on_actionExit_triggered();
@@ -55,24 +70,45 @@ private slots:
     
     void on_actionUndo_triggered();
     void on_actionRedo_triggered();
+    void on_actionInsertMode_triggered(bool checked);
+    void on_actionTransformSelection_triggered();
+    void on_actionSelectionChecksums_triggered();
     
     void on_actionZoomIn_triggered();
     void on_actionZoomOut_triggered();
+    void on_actionPerfOverlay_triggered(bool checked);
+    void on_actionMinimap_triggered(bool checked);
+    void on_actionExportTrace_triggered();
     
     void on_actionGoTo_triggered(); 
     
     void on_actionFind_triggered();
     void on_actionReplace_triggered(); 
+    void on_actionFindPointerTables_triggered();
+    void on_actionFollowPointer_triggered();
+    void on_actionJumpBack_triggered();
     void on_actionCopy_triggered();       
     void on_actionPaste_triggered();
     
     void on_actionToggleTable_triggered(bool checked);
+    void on_actionTextRegions_triggered(bool checked);
+    void on_actionDataInspector_triggered(bool checked);
+    void on_actionBookmarks_triggered(bool checked);
+    void on_actionAddBookmark_triggered();
+    void on_actionOpenProject_triggered();
+    void on_actionSaveProject_triggered();
+    void on_actionRestoreSession_triggered(bool checked);
     
     void on_actionLoadTable_triggered();
     void on_actionSaveTable_triggered();
     void on_actionSaveTableAs_triggered();
     void on_actionClearTable_triggered();
     
+    void on_actionAddTableToSet_triggered();
+    void on_actionSwitchTable_triggered();
+    void on_actionAssignTableRange_triggered();
+    void on_actionClearTableRanges_triggered();
+    
     void on_actionInsertLatinUpper_triggered();
     void on_actionInsertLatinLower_triggered();
     void on_actionInsertHiragana_triggered();
@@ -82,66 +118,116 @@ private slots:
     void openRecentFile(); 
     void handleTableItemChanged(QTableWidgetItem *item);
     void handleDataEdited(); 
+    void handleBookmarksEdited(HexEditorArea *editor);
+    void handleCurrentTabChanged(int index);
+    void handleTabCloseRequested(int index);
+    void handleFileChanged(const QString &filePath);
+    void handleDirectoryChanged(const QString &dirPath);
+    void checkChangedFiles();
 
     void on_actionGuessEncoding_triggered();
-    void handleGuessEncodingFinished();
+    void handleGuessEncodingFinished(const EncodingGuess &guess, const CharTablePtr &table);
+    
+    void findAll();
+    void handleSearchHitActivated(HexEditorArea *editor, qint64 offset, qint64 length);
+    void handleSearchHitContextMenu(HexEditorArea *editor, qint64 offset, qint64 length, const QPoint &globalPos);
 
 private:
     Ui::hexandtabler *ui;
     HexEditorArea *m_hexEditorArea = nullptr;
     QTableWidget *m_tableWidget = nullptr; 
     QDockWidget *m_tableDock = nullptr;
-    QByteArray m_fileData;
+    QTabWidget *m_tabWidget = nullptr;
     FindReplaceDialog *m_findReplaceDialog = nullptr;
-    
-    QString m_currentFilePath;
-    QString m_currentTablePath; 
-    bool m_isModified = false;
+    SearchResultsDock *m_searchDock = nullptr;
+    MinimapWidget *m_minimap = nullptr;
+    TextRegionsDock *m_textRegionsDock = nullptr;
+    DataInspectorDock *m_dataInspectorDock = nullptr;
+    BookmarksDock *m_bookmarksDock = nullptr;
+    RelativeSearch m_dockRelativeSearch; // Query behind the listed hits, if they come from a relative search
+    
+    // Documentos abiertos; m_doc y m_hexEditorArea apuntan a la pestaña actual
+    QList<HexDocument*> m_documents;
+    HexDocument *m_doc = nullptr;
+    
+    // Pool acotado compartido por los trabajos en segundo plano de todos los documentos
+    QThreadPool m_workerPool;
+    
+    // Ficheros abiertos vigilados por si otro programa los reescribe; los avisos seguidos se agrupan
+    QFileSystemWatcher m_fileWatcher;
+    QSet<QString> m_changedFiles;
+    QSet<QString> m_missingFiles;   // Deleted while open; their folders are watched until they come back
+    QTimer m_reloadTimer;
+
+    // Ancho de línea y agrupación que usan todas las pestañas
+    int m_bytesPerLine = 16;
+    int m_groupSize = 0;
+    void setupLayoutMenu();
+    void setupCopyAsMenu();
+    void setLayoutOptions(int bytesPerLine, int groupSize);
+    
+    // Inserción o sobrescritura, común a todas las pestañas; la barra de estado lo indica
+    bool m_insertMode = false;
+    QLabel *m_insertModeLabel = nullptr;
 
-    QFuture<QList<QMap<QChar, quint8>>> m_guessSearchFuture; 
     QMap<QChar, QList<int>> calculatePattern(const QString &text) const;
-    QList<QMap<QChar, quint8>> guessEncoding(const QList<KnownPhrase> &phrases, quint64 startOffset,quint64 endOffset);
-    void addFoundMappingToTable(const QMap<QChar, quint8> &mapping);
-    
-    struct EditorState {
-        QByteArray data;
-        int cursorPos;
-        int selectionStart;
-        int selectionEnd;
-    };
-    
-    QList<EditorState> m_undoStack;
-    QList<EditorState> m_redoStack;
+    void watchGuessEncoding();
+    void addFoundMappingToTable(const QMap<QChar, quint8> &mapping, const CharTablePtr &table);
 
-    QString m_charMap[256]; 
+    // Conjunto de tablas por nombre; la activa es la que edita el dock
+    QMap<QString, CharTablePtr> m_tableSet;
+    CharTablePtr m_activeTable;
 
     void findNext(const QByteArray &needle, bool caseSensitive, bool wrap, bool backwards);
     void replaceOne();
     void replaceAll(const QByteArray &needle, const QByteArray &replacement);
     
-    void findNextRelative(const QString &searchText, bool wrap, bool backwards);
-    QVector<qint16> calculateRelativeOffsets(const QString &input) const; 
+    void findNextRelative(const QString &searchText, const RelativeSearchOptions &options, bool wrap, bool backwards);
+    void findAllRelative(const QString &searchText, const RelativeSearchOptions &options);
+    void findNextPattern(const QString &patternText, bool wrap, bool backwards);
     
     enum { MaxRecentFiles = 5 };
     QAction *recentFileActions[MaxRecentFiles];
     
     void setupConversionTable();
     
+    HexDocument *createDocument();
+    HexDocument *documentForEditor(QObject *editor) const;
+    void closeDocument(int index);
+    void updateDocumentTitle(HexDocument *doc);
+    
     void loadFile(const QString &filePath);
     void setCurrentFile(const QString &filePath); 
     bool saveDataToFile(const QString &filePath); 
     bool saveFileAs();                            
     bool saveCurrentFile();
-    bool maybeSave();
+    bool maybeSave(HexDocument *doc);
+    // Recompresses a decompressed view into the range it came from, as one edit there. The encode
+    // runs on the worker pool: the view is saved when it finishes, not on return.
+    void saveToSource(HexDocument *doc);
+    // Drops a deleted file from m_missingFiles, and its folder from the watcher once unused
+    void forgetMissingFile(const QString &filePath);
+    // Brings in what changed on disk, block by block, as one undoable step
+    void reloadFromDisk(HexDocument *doc);
     
     void refreshModelFromArea(); 
-    void pushUndoState();
+    void pushUndoState(HexDocument *doc);
+    void updateMemoryCounters();
     void updateUndoRedoActions();
     
     bool saveTableFile(const QString &filePath); 
     bool loadTableFile(const QString &filePath);
-    void insertSeries(const QList<QString> &series); 
+    void insertSeries(const QList<QString> &series, int startRow = -1); 
     void clearCharMappingTable();
+    void activeTableEdited();
+    void refreshTableWidget();
+    void setActiveTable(const QString &name);
+    void assignTableRegion(const TableRegion &region);
+    
+    // Proyecto: pestañas, tablas, posiciones y cachés válidas para reabrir sin recalcular
+    Session currentSession();
+    bool saveSession(const QString &path);
+    void restoreSession(const QString &path);
     
     void createRecentFileActions();
     void loadRecentFiles();
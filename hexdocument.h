@@ -0,0 +1,69 @@
+#ifndef HEXDOCUMENT_H
+#define HEXDOCUMENT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <QMap>
+#include <QChar>
+#include <QFuture>
+#include <QSharedPointer>
+#include <QPointer>
+#include <QAtomicInt>
+
+#include "chartable.h"
+#include "piecetable.h"
+#include "bookmarks.h"
+#include "session.h"
+#include "compression.h"
+
+class HexEditorArea;
+class PhraseGuessSession;
+
+// Una versión del buffer: las piezas que no cambiaron se comparten con las demás
+struct EditorState {
+    PieceTable data;
+    BookmarkIndex bookmarks;
+    qint64 cursorPos;
+    qint64 selectionStart;
+    qint64 selectionEnd;
+};
+
+// Resultado de "adivinar codificación": las asignaciones que se muestran y cuántas se encontraron
+struct EncodingGuess {
+    QList<QMap<QChar, quint8>> mappings;
+    int total = 0;
+};
+
+// Tramo comprimido de otro documento del que sale una vista descomprimida
+struct PackedSource {
+    QPointer<HexEditorArea> editor;     // Null for ordinary documents
+    qint64 start = 0;
+    QByteArray packed;                  // The compressed bytes as they stand there now
+    Compression::Codec codec = Compression::Lzss;
+};
+
+// Documento abierto en una pestaña: su buffer vive en el editor,
+// junto con su historial de deshacer y la tabla que tiene asignada.
+struct HexDocument {
+    HexEditorArea *editor = nullptr;
+    QString filePath;
+    FileStamp diskStamp;    // The file as it was last loaded or saved
+    QVector<quint32> diskBlocks;    // Its DiskReload block hashes
+    bool reloadPending = false;     // A reload of the file is being read or asked about
+    PackedSource source;            // Saving a decompressed view recompresses it into its source
+    bool isModified = false;
+
+    QList<EditorState> undoStack;
+    QList<EditorState> redoStack;
+
+    CharTablePtr table;
+    QVector<TableRegion> tableRegions;
+
+    QFuture<EncodingGuess> guessFuture;
+    QSharedPointer<QAtomicInt> guessCancel;          // Set when the document closes under a running guess
+    QSharedPointer<PhraseGuessSession> guessSession; // Candidates kept between guesses
+};
+
+#endif // HEXDOCUMENT_H
@@ -14,7 +14,17 @@
 #include <QChar> 
 #include <QKeySequence>
 #include <QStyleOptionSlider>
+#include <QElapsedTimer>
+#include <QWheelEvent>
 
+#include "perftrace.h"
+
+const int MAX_BYTES_PER_LINE = 256;
+const int ROW_CACHE_PAGES = 1;        // Pages of rendered rows kept on each side of the view
+const int PREFETCH_BUDGET_MS = 4;
+const int SMOOTH_SCROLL_MS = 120;
+const int WHEEL_FLING_MS = 80;
+const int WHEEL_MAX_BOOST = 6;
 
 
 HexEditorArea::HexEditorArea(QWidget *parent)
@@ -26,15 +36,17 @@ HexEditorArea::HexEditorArea(QWidget *parent)
     font.setStyleHint(QFont::Monospace);
     setFont(font);
 
+    m_charTable = CharTablePtr(new CharTable);
     for (int i = 0; i < 32; ++i) {
-        m_charMap[i] = ".";
+        m_charTable->map[i] = ".";
     }
     for (int i = 32; i < 127; ++i) {
-        m_charMap[i] = QChar(i);
+        m_charTable->map[i] = QChar(i);
     }
     for (int i = 127; i < 256; ++i) {
-        m_charMap[i] = ".";
+        m_charTable->map[i] = ".";
     }
+    m_charTable->compile();
     
     calculateMetrics(); 
     m_editMode = HexMode; 
@@ -43,17 +55,28 @@ HexEditorArea::HexEditorArea(QWidget *parent)
     m_selectionStart = -1;
     m_selectionAnchor = -1;
     m_cursorPos = 0;
+    m_overlays.append(&m_bookmarks);
     
     setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     
     setMouseTracking(true); 
     setFocusPolicy(Qt::StrongFocus);
+    
+    m_prefetchTimer.setSingleShot(true);
+    m_prefetchTimer.setInterval(0);
+    connect(&m_prefetchTimer, &QTimer::timeout, this, &HexEditorArea::prefetchRows);
+    
+    m_scrollAnimation.setDuration(SMOOTH_SCROLL_MS);
+    m_scrollAnimation.setEasingCurve(QEasingCurve::OutCubic);
+    connect(&m_scrollAnimation, &QVariantAnimation::valueChanged, this, [this](const QVariant &value) {
+        setScrollY((qint64)value.toDouble());
+    });
 }
 
 QSize HexEditorArea::minimumSizeHint() const {
     
-    int minWidth = m_lineLength; 
+    int minWidth = viewport()->minimumWidth(); 
     
     minWidth += 2 * frameWidth(); 
     
@@ -64,11 +87,78 @@ QSize HexEditorArea::minimumSizeHint() const {
     return QSize(minWidth, 0); 
 }
 
-void HexEditorArea::setCharMapping(const QString (&mapping)[256]) {
-    for (int i = 0; i < 256; ++i) {
-        m_charMap[i] = mapping[i];
+void HexEditorArea::setCharTable(const CharTablePtr &table) {
+    if (!table) return;
+    m_charTable = table;
+    invalidateView();
+    emit charTableChanged();
+}
+
+void HexEditorArea::setTableRegions(const QVector<TableRegion> &regions) {
+    m_tableRegions = regions;
+    std::sort(m_tableRegions.begin(), m_tableRegions.end(), [](const TableRegion &a, const TableRegion &b) {
+        return a.start < b.start;
+    });
+    invalidateView();
+}
+
+const CharTable *HexEditorArea::tableAt(qint64 byteIndex) const {
+    auto it = std::upper_bound(m_tableRegions.constBegin(), m_tableRegions.constEnd(), byteIndex,
+                               [](qint64 value, const TableRegion &r) { return value < r.start; });
+    if (it != m_tableRegions.constBegin()) {
+        --it;
+        if (byteIndex < it->end && it->table) {
+            return it->table.data();
+        }
     }
-    viewport()->update();
+    return m_charTable.data();
+}
+
+void HexEditorArea::addOverlay(const HexOverlay *overlay) {
+    if (overlay && !m_overlays.contains(overlay)) {
+        m_overlays.append(overlay);
+        invalidateView();
+    }
+}
+
+void HexEditorArea::setBookmarks(const BookmarkIndex &bookmarks) {
+    m_bookmarks = bookmarks;
+    invalidateView();
+    emit bookmarksChanged();
+}
+
+void HexEditorArea::removeOverlay(const HexOverlay *overlay) {
+    if (m_overlays.removeAll(overlay) > 0) {
+        invalidateView();
+    }
+}
+
+qint64 HexEditorArea::topOffset() const {
+    if (m_charHeight <= 0) return 0;
+    return m_scrollY / m_charHeight * m_bytesPerLine;
+}
+
+qint64 HexEditorArea::visibleByteCount() const {
+    if (m_charHeight <= 0) return 0;
+    return (qint64)(viewport()->height() / m_charHeight + 1) * m_bytesPerLine;
+}
+
+void HexEditorArea::setTopOffset(qint64 offset) {
+    setScrollY(offset / m_bytesPerLine * m_charHeight);
+}
+
+void HexEditorArea::setBytesPerLine(int bytes) {
+    bytes = std::max(0, std::min(MAX_BYTES_PER_LINE, bytes));
+    if (bytes == m_requestedBytesPerLine) return;
+    m_requestedBytesPerLine = bytes;
+    updateViewMetrics();
+}
+
+void HexEditorArea::setGroupSize(int bytes) {
+    bytes = std::max(0, std::min(MAX_BYTES_PER_LINE, bytes));
+    if (bytes == m_groupSize) return;
+    m_groupSize = bytes;
+    updateViewMetrics();
 }
 
 void HexEditorArea::calculateMetrics() {
@@ -80,142 +170,353 @@ void HexEditorArea::calculateMetrics() {
     const int HEX_SLOTS_PER_BYTE = 3;     
     const int SEPARATOR_SLOTS = 3;        
     const int HEX_START_SLOT = OFFSET_SLOTS;
-    const int HEX_BLOCK_SLOTS = m_bytesPerLine * HEX_SLOTS_PER_BYTE; 
-    const int ASCII_START_SLOT = HEX_START_SLOT + HEX_BLOCK_SLOTS + SEPARATOR_SLOTS;
-    const int TOTAL_SLOTS = ASCII_START_SLOT + m_bytesPerLine; 
+    const int AUTO_STEP = 8;
+    
+    // Desplazamiento, bloque hex (con un hueco entre grupos), separador y texto
+    auto lineSlots = [&](int bytes) {
+        const int gaps = m_groupSize > 0 ? (bytes - 1) / m_groupSize : 0;
+        return HEX_START_SLOT + bytes * HEX_SLOTS_PER_BYTE + gaps + SEPARATOR_SLOTS + bytes;
+    };
+    
+    const int step = m_groupSize > 0 ? m_groupSize : AUTO_STEP;
+    if (m_requestedBytesPerLine > 0) {
+        m_bytesPerLine = m_requestedBytesPerLine;
+    } else {
+        // Se cuenta siempre con la barra de desplazamiento, o aparecer/desaparecer cambiaría el ancho otra vez
+        int availableWidth = viewport()->width();
+        if (!verticalScrollBar()->isVisible()) availableWidth -= verticalScrollBar()->sizeHint().width();
+        const int availableSlots = m_charWidth > 0 ? availableWidth / m_charWidth : 0;
+        m_bytesPerLine = step;
+        while (m_bytesPerLine + step <= MAX_BYTES_PER_LINE && lineSlots(m_bytesPerLine + step) <= availableSlots) {
+            m_bytesPerLine += step;
+        }
+    }
+    
+    const int totalSlots = lineSlots(m_bytesPerLine);
+    m_hexCellX.resize(m_bytesPerLine);
+    m_asciiCellX.resize(m_bytesPerLine);
+    m_slotByte.fill(-1, totalSlots);
+    
+    int slot = HEX_START_SLOT;
+    for (int i = 0; i < m_bytesPerLine; ++i) {
+        if (m_groupSize > 0 && i > 0 && i % m_groupSize == 0) ++slot;
+        m_hexCellX[i] = slot * m_charWidth;
+        for (int k = 0; k < HEX_SLOTS_PER_BYTE; ++k) {
+            m_slotByte[slot + k] = i;
+        }
+        slot += HEX_SLOTS_PER_BYTE;
+    }
+    const int asciiStartSlot = slot + SEPARATOR_SLOTS;
+    for (int i = 0; i < m_bytesPerLine; ++i) {
+        m_asciiCellX[i] = (asciiStartSlot + i) * m_charWidth;
+        m_slotByte[asciiStartSlot + i] = i;
+    }
     
     m_hexStartCol = HEX_START_SLOT * m_charWidth;
-    m_asciiStartCol = ASCII_START_SLOT * m_charWidth;
-    m_lineLength = TOTAL_SLOTS * m_charWidth;
+    m_asciiStartCol = asciiStartSlot * m_charWidth;
+    m_lineLength = totalSlots * m_charWidth;
 
-    viewport()->setMinimumWidth(m_lineLength); 
+    // En modo automático la ventana puede estrecharse hasta la línea más corta
+    viewport()->setMinimumWidth(m_requestedBytesPerLine > 0 ? m_lineLength : lineSlots(step) * m_charWidth); 
 }
 
 void HexEditorArea::updateViewMetrics() {
+    const qint64 top = topOffset();
+    const int previousBytesPerLine = m_bytesPerLine;
+    const int previousLineLength = m_lineLength;
+    const int previousCharHeight = m_charHeight;
     calculateMetrics();
-    int totalLines = (m_data.size() + m_bytesPerLine - 1) / m_bytesPerLine;
-    verticalScrollBar()->setRange(0, std::max(0, totalLines * m_charHeight - viewport()->height()));
+    if (m_bytesPerLine != previousBytesPerLine || m_lineLength != previousLineLength || m_charHeight != previousCharHeight) {
+        m_rowCache.clear();
+    }
+    updateScrollRange();
+    if (m_bytesPerLine != previousBytesPerLine) {
+        setTopOffset(top); // Same bytes at the top after the lines are rewrapped
+    }
     
     updateGeometry(); 
     
     viewport()->update();
 }
 
+void HexEditorArea::updateScrollRange() {
+    // El recorrido se calcula en 64 bits; la barra va escalada si no cabe en un int
+    const qint64 maximum = maxScrollY();
+    m_scrollScale = maximum / INT_MAX + 1;
+    QScrollBar *bar = verticalScrollBar();
+    m_syncingScrollBar = true;
+    bar->setRange(0, (int)(maximum / m_scrollScale));
+    bar->setSingleStep((int)std::max<qint64>(1, m_charHeight / m_scrollScale));
+    bar->setPageStep((int)std::max<qint64>(1, std::max(m_charHeight, viewport()->height() - m_charHeight) / m_scrollScale));
+    m_syncingScrollBar = false;
+    setScrollY(m_scrollY);
+}
+
+qint64 HexEditorArea::maxScrollY() const {
+    return std::max<qint64>(0, lineCount() * m_charHeight - viewport()->height());
+}
+
+void HexEditorArea::setScrollY(qint64 y) {
+    y = std::max<qint64>(0, std::min(y, maxScrollY()));
+    const qint64 dy = m_scrollY - y;
+    m_scrollY = y;
+    m_syncingScrollBar = true;
+    verticalScrollBar()->setValue((int)(y / m_scrollScale));
+    m_syncingScrollBar = false;
+    if (dy != 0) scrollViewBy(dy);
+}
+
 void HexEditorArea::changeEvent(QEvent *event) {
     QAbstractScrollArea::changeEvent(event);
     if (event->type() == QEvent::FontChange) {
         updateViewMetrics();
+    } else if (event->type() == QEvent::PaletteChange) {
+        invalidateView();
     }
 }
 
 void HexEditorArea::setHexData(const QByteArray &data) {
-    m_data = data;
+    m_buffer = PieceTable(data);
+    bufferReplaced();
+}
+
+void HexEditorArea::setBuffer(const PieceTable &buffer) {
+    m_buffer = buffer;
+    bufferReplaced();
+}
+
+void HexEditorArea::bufferReplaced() {
+    m_rowCache.clear();
     setCursorPosition(0); 
     clearSelection(); // <<< Corregido
     updateViewMetrics();
     viewport()->update();
+    emit dataReplaced();
+}
+
+void HexEditorArea::setInsertMode(bool insert) {
+    if (insert == m_insertMode) return;
+    m_insertMode = insert;
+    m_currentNibbleIndex = 0;
+    emit insertModeChanged(insert);
 }
 
-QByteArray HexEditorArea::hexData() const {
-    return m_data;
+void HexEditorArea::writeBytes(qint64 pos, qint64 removed, const QByteArray &bytes) {
+    const qint64 oldSize = m_buffer.size();
+    m_buffer.replace(pos, removed, bytes);
+    
+    if (removed == bytes.size()) {
+        invalidateBytes(pos, pos + removed);
+        updateBytes(pos, pos + removed);
+        return;
+    }
+    // Los marcadores se mueven o estiran con la parte que cambia de tamaño
+    const qint64 added = bytes.size() - removed;
+    const bool moved = added > 0 ? m_bookmarks.insertBytes(pos + removed, added)
+                                 : m_bookmarks.removeBytes(pos + bytes.size(), -added);
+    if (moved) emit bookmarksChanged();
+    
+    // Todo lo que sigue se ha desplazado; fuera de la vista solo cambia el rango de la barra
+    const qint64 end = std::max(oldSize, m_buffer.size());
+    invalidateBytes(pos, end);
+    updateBytes(pos, end);
+    updateScrollRange();
+}
+
+void HexEditorArea::replaceBytes(qint64 pos, qint64 length, const QByteArray &bytes) {
+    if (m_readOnly) return;
+    writeBytes(pos, length, bytes);
+    emit dataChanged();
+}
+
+void HexEditorArea::replaceEach(const QVector<qint64> &offsets, qint64 length, const QByteArray &bytes) {
+    if (m_readOnly || offsets.isEmpty()) return;
+    // De atrás adelante: lo que queda por reemplazar no se ha movido
+    for (int i = offsets.size() - 1; i >= 0; --i) {
+        writeBytes(offsets.at(i), length, bytes);
+    }
+    emit dataChanged();
+}
+
+void HexEditorArea::removeSelection() {
+    const qint64 startByte = m_selectionStart / 2;
+    const qint64 length = m_selectionEnd / 2 - startByte;
+    clearSelection();
+    writeBytes(startByte, length, QByteArray());
+    setCursorPosition(startByte * 2);
+    emit dataChanged();
 }
 
 void HexEditorArea::goToOffset(quint64 offset) {
-    if (offset >= (quint64)m_data.size()) {
-        offset = m_data.size();
+    if (offset >= (quint64)dataSize()) {
+        offset = dataSize();
     }
     setCursorPosition(offset * 2); 
-    
-    int line = offset / m_bytesPerLine;
-    int lineY = line * m_charHeight;
-    int visibleHeight = viewport()->height();
-    int scrollY = verticalScrollBar()->value();
+    ensureLineVisible(offset / m_bytesPerLine);
+}
+
+void HexEditorArea::ensureLineVisible(qint64 line) {
+    // En 64 bits: línea por alto de fila pasa de int en ficheros grandes
+    const qint64 lineY = line * m_charHeight;
+    const qint64 visibleHeight = viewport()->height();
 
-    if (lineY < scrollY) {
-        verticalScrollBar()->setValue(lineY);
-    } else if (lineY + m_charHeight > scrollY + visibleHeight) {
-        verticalScrollBar()->setValue(lineY + m_charHeight - visibleHeight);
+    if (lineY < m_scrollY) {
+        setScrollY(lineY);
+    } else if (lineY + m_charHeight > m_scrollY + visibleHeight) {
+        setScrollY(lineY + m_charHeight - visibleHeight);
     }
 }
 
-void HexEditorArea::setSelection(int startPos, int endPos) {
-    startPos = std::max(0, startPos);
-    endPos = std::min(m_data.size() * 2, endPos);
+bool HexEditorArea::followPointer() {
+    qint64 offset = m_cursorPos / 2;
+    if (offset + m_pointerFormat.width > dataSize()) return false;
+
+    const QByteArray word = m_buffer.read(offset, m_pointerFormat.width);
+    const uchar *bytes = reinterpret_cast<const uchar *>(word.constData());
+    qint64 target = m_pointerFormat.base + PointerScan::readWord(bytes, m_pointerFormat.width, m_pointerFormat.bigEndian);
+    if (target < 0 || target >= dataSize()) return false;
+
+    m_jumpHistory.append(offset);
+    clearSelection();
+    goToOffset(target);
+    return true;
+}
+
+bool HexEditorArea::jumpBack() {
+    if (m_jumpHistory.isEmpty()) return false;
+    clearSelection();
+    goToOffset(m_jumpHistory.takeLast());
+    return true;
+}
+
+void HexEditorArea::setSelection(qint64 startPos, qint64 endPos) {
+    startPos = std::max<qint64>(0, startPos);
+    endPos = std::min(dataSize() * 2, endPos);
     
     startPos = (startPos / 2) * 2;
     endPos = ((endPos + 1) / 2) * 2; 
     
     if (startPos > endPos) std::swap(startPos, endPos);
 
+    const qint64 oldStart = m_selectionStart;
+    const qint64 oldEnd = m_selectionEnd;
     m_selectionStart = startPos;
     m_selectionEnd = endPos;
     
     if (m_selectionStart == m_selectionEnd) {
-        clearSelection(); // <<< Corregido
+        m_selectionStart = -1;
+        m_selectionEnd = -1;
+        m_selectionAnchor = -1;
     }
     
-    viewport()->update();
+    updateSelectionChange(oldStart, oldEnd);
 }
 
 void HexEditorArea::clearSelection() { // <<< Definición de función
+    const qint64 oldStart = m_selectionStart;
+    const qint64 oldEnd = m_selectionEnd;
     m_selectionStart = -1;
     m_selectionEnd = -1;
     m_selectionAnchor = -1;
-    viewport()->update();
+    updateSelectionChange(oldStart, oldEnd);
 }
 
-void HexEditorArea::setCursorPosition(int newPos) {
-    int maxPos = m_data.size() * 2;
-    newPos = std::max(0, std::min(maxPos, newPos));
+void HexEditorArea::updateSelectionChange(qint64 oldStart, qint64 oldEnd) {
+    // Solo las franjas que entran o salen de la selección; los extremos son nibbles pares
+    const bool hadOld = oldStart != -1 && oldStart < oldEnd;
+    const bool hasNew = m_selectionStart != -1 && m_selectionStart < m_selectionEnd;
+    if (!hadOld && !hasNew) return;
+    if (!hadOld || !hasNew) {
+        const qint64 start = hadOld ? oldStart : m_selectionStart;
+        const qint64 end = hadOld ? oldEnd : m_selectionEnd;
+        updateBytes(start / 2, end / 2);
+        return;
+    }
+    if (oldEnd <= m_selectionStart || m_selectionEnd <= oldStart) {
+        updateBytes(oldStart / 2, oldEnd / 2);
+        updateBytes(m_selectionStart / 2, m_selectionEnd / 2);
+        return;
+    }
+    updateBytes(std::min(oldStart, m_selectionStart) / 2, std::max(oldStart, m_selectionStart) / 2);
+    updateBytes(std::min(oldEnd, m_selectionEnd) / 2, std::max(oldEnd, m_selectionEnd) / 2);
+}
+
+void HexEditorArea::updateBytes(qint64 from, qint64 to) {
+    if (to <= from || m_charHeight <= 0 || m_bytesPerLine <= 0) return;
+#ifdef HEXANDTABLER_PROFILING
+    if (PerfTrace::overlayEnabled() && !m_perfOverlayRect.isNull()) {
+        viewport()->update(m_perfOverlayRect); // Keep the numbers current
+    }
+#endif
+    
+    // Lines outside the view are skipped, so y stays small even in huge files
+    const qint64 scrollY = m_scrollY;
+    const qint64 visibleFirst = scrollY / m_charHeight;
+    const qint64 visibleLast = (scrollY + viewport()->height()) / m_charHeight;
+    const qint64 firstLine = from / m_bytesPerLine;
+    const qint64 lastLine = (to - 1) / m_bytesPerLine;
+    if (lastLine < visibleFirst || firstLine > visibleLast) return;
+    
+    auto updateCells = [&](qint64 line, int firstColumn, int lastColumn) {
+        if (line < visibleFirst || line > visibleLast) return;
+        const int y = (int)(line * m_charHeight - scrollY);
+        const int hexRight = m_hexCellX.at(lastColumn) + 3 * m_charWidth;
+        const int asciiRight = m_asciiCellX.at(lastColumn) + m_charWidth;
+        viewport()->update(QRect(m_hexCellX.at(firstColumn), y, hexRight - m_hexCellX.at(firstColumn), m_charHeight));
+        viewport()->update(QRect(m_asciiCellX.at(firstColumn), y, asciiRight - m_asciiCellX.at(firstColumn), m_charHeight));
+    };
+    
+    if (firstLine == lastLine) {
+        updateCells(firstLine, (int)(from % m_bytesPerLine), (int)((to - 1) % m_bytesPerLine));
+        return;
+    }
+    updateCells(firstLine, (int)(from % m_bytesPerLine), m_bytesPerLine - 1);
+    updateCells(lastLine, 0, (int)((to - 1) % m_bytesPerLine));
+    
+    const qint64 bandFirst = std::max(firstLine + 1, visibleFirst);
+    const qint64 bandLast = std::min(lastLine - 1, visibleLast);
+    if (bandFirst <= bandLast) {
+        const int y = (int)(bandFirst * m_charHeight - scrollY);
+        viewport()->update(QRect(m_hexCellX.first(), y, m_lineLength - m_hexCellX.first(), (int)(bandLast - bandFirst + 1) * m_charHeight));
+    }
+}
+
+void HexEditorArea::setCursorPosition(qint64 newPos) {
+    const qint64 maxPos = dataSize() * 2;
+    newPos = std::max<qint64>(0, std::min(maxPos, newPos));
     
     newPos = (newPos / 2) * 2; 
 
     if (newPos == m_cursorPos) return;
     
+    const qint64 oldPos = m_cursorPos;
     m_cursorPos = newPos; 
     m_currentNibbleIndex = 0; 
     
-    int offset = m_cursorPos / 2;
-    int line = offset / m_bytesPerLine;
-    int lineY = line * m_charHeight;
-    int scrollY = verticalScrollBar()->value();
-    int visibleHeight = viewport()->height();
-    
-    if (lineY < scrollY) {
-        verticalScrollBar()->setValue(lineY);
-    } else if (lineY + m_charHeight > scrollY + visibleHeight) {
-        verticalScrollBar()->setValue(lineY + m_charHeight - visibleHeight);
-    }
+    const qint64 offset = m_cursorPos / 2;
+    ensureLineVisible(offset / m_bytesPerLine);
 
-    viewport()->update();
+    updateBytes(oldPos / 2, oldPos / 2 + 1);
+    updateBytes(offset, offset + 1);
+    emit cursorPositionChanged(m_cursorPos);
 }
 
-void HexEditorArea::copySelection()
+void HexEditorArea::copySelection(HexFormat::Style style)
 {
     if (m_selectionStart == -1 || m_selectionStart == m_selectionEnd)
         return;
 
-    int startByte = m_selectionStart / 2;
-    int endByte = m_selectionEnd / 2;
-    int length = endByte - startByte;
-
-    QByteArray selectedData = m_data.mid(startByte, length);
+    qint64 startByte = m_selectionStart / 2;
+    qint64 endByte = m_selectionEnd / 2;
+    qint64 length = endByte - startByte;
 
     QClipboard *clipboard = QApplication::clipboard();
-    
-    QMimeData *mimeData = new QMimeData();
-    mimeData->setData("application/octet-stream", selectedData); 
-    
-    QString hexText;
-    for (int i = 0; i < selectedData.size(); ++i) {
-        hexText += QString("%1 ").arg((unsigned char)selectedData.at(i), 2, 16, QChar('0')).toUpper();
-    }
-    mimeData->setText(hexText.trimmed());
-    
-    clipboard->setMimeData(mimeData);
+    clipboard->setMimeData(new HexMimeData(m_buffer, startByte, length, style, m_charTable, m_tableRegions));
 }
 
 void HexEditorArea::pasteFromClipboard() {
+    if (m_readOnly) return;
+    
     QClipboard *clipboard = QApplication::clipboard();
     const QMimeData *mimeData = clipboard->mimeData();
     QByteArray dataToPaste;
@@ -225,168 +526,367 @@ void HexEditorArea::pasteFromClipboard() {
     if (mimeData->hasFormat("application/octet-stream")) {
         dataToPaste = mimeData->data("application/octet-stream");
     } else if (mimeData->hasText()) {
-        QString text = mimeData->text();
-        QByteArray tempCharMappedData;
-        bool mappedSuccessfully = false;
-        
-        for (int i = 0; i < text.length(); ++i) {
-            QChar ch = text.at(i);
-            bool found = false;
-            for (int j = 0; j < 256; ++j) {
-                if (m_charMap[j].length() > 0 && m_charMap[j].at(0) == ch) {
-                    tempCharMappedData.append((char)j);
-                    found = true;
-                    mappedSuccessfully = true;
-                    break;
-                }
-            }
-            if (!found) {
-                tempCharMappedData.append('\0');
-            }
-        }
-        
-        if (!mappedSuccessfully || tempCharMappedData.toStdString() == std::string(tempCharMappedData.size(), '\0')) {
-            QString cleanedText = text.simplified();
-            cleanedText.remove(' ');
-            cleanedText.remove('\n');
-            cleanedText.remove('\r');
-            QByteArray hexParsedData = QByteArray::fromHex(cleanedText.toLower().toUtf8()); 
-            if (!hexParsedData.isEmpty()) {
-                dataToPaste = hexParsedData;
-            } else {
-                dataToPaste = text.toUtf8();
-            }
-        } else {
-            dataToPaste = tempCharMappedData;
-        }
+        const qint64 pasteByte = m_selectionStart != -1 ? m_selectionStart / 2 : m_cursorPos / 2;
+        dataToPaste = HexFormat::parse(mimeData->text(), *tableAt(pasteByte));
     }
 
     if (dataToPaste.isEmpty()) return;
 
-    if (m_selectionStart != -1 && m_selectionStart != m_selectionEnd) {
-        int startByte = m_selectionStart / 2;
-        int endByte = m_selectionEnd / 2;
-        int length = endByte - startByte;
+    const bool hasSelection = m_selectionStart != -1 && m_selectionStart != m_selectionEnd;
+    if (m_insertMode) {
+        // Lo pegado sustituye a la selección entera, o entra en el cursor
+        qint64 startByte = hasSelection ? m_selectionStart / 2 : m_cursorPos / 2;
+        qint64 length = hasSelection ? m_selectionEnd / 2 - startByte : 0;
+        clearSelection();
+        writeBytes(startByte, length, dataToPaste);
+        setCursorPosition((startByte + dataToPaste.size()) * 2);
+    } else if (hasSelection) {
+        qint64 startByte = m_selectionStart / 2;
+        qint64 endByte = m_selectionEnd / 2;
+        int length = (int)std::min<qint64>(endByte - startByte, dataToPaste.size());
         
-        for (int i = 0; i < length && i < dataToPaste.size(); ++i) {
-            m_data[startByte + i] = dataToPaste.at(i);
-        }
+        writeBytes(startByte, length, dataToPaste.left(length));
         setCursorPosition(m_selectionEnd);
         clearSelection(); // <<< Corregido
     } else {
-        int insertByte = m_cursorPos / 2;
-        int pasteSize = dataToPaste.size();
-        int availableSize = m_data.size() - insertByte;
-        int copySize = std::min(pasteSize, availableSize);
+        qint64 insertByte = m_cursorPos / 2;
+        int copySize = (int)std::min<qint64>(dataToPaste.size(), dataSize() - insertByte);
 
-        for (int i = 0; i < copySize; ++i) {
-            m_data[insertByte + i] = dataToPaste.at(i);
-        }
+        writeBytes(insertByte, copySize, dataToPaste.left(copySize));
         setCursorPosition((insertByte + copySize) * 2);
     }
 
-    updateViewMetrics();
     emit dataChanged();
 }
 
 void HexEditorArea::paintEvent(QPaintEvent *event) {
+    HT_PROFILE_SCOPE("paintEvent");
     QPainter painter(viewport());
     painter.setFont(font());
     
-    int scrollY = verticalScrollBar()->value();
-    int firstVisibleLine = scrollY / m_charHeight;
-    int lastVisibleLine = (scrollY + viewport()->height()) / m_charHeight;
+    // Solo las celdas de la zona dañada: tras un desplazamiento es la franja que entra,
+    // al escribir o mover el cursor unas pocas celdas
+    const qint64 scrollY = m_scrollY;
+    const qint64 cursorLine = (m_cursorPos / 2) / m_bytesPerLine;
+    const qint64 selectionFirstLine = m_selectionStart != -1 ? (m_selectionStart / 2) / m_bytesPerLine : -1;
+    const qint64 selectionLastLine = m_selectionStart != -1 ? (std::max(m_selectionStart, m_selectionEnd - 1) / 2) / m_bytesPerLine : -1;
+    const qint64 totalLines = lineCount();
+    qint64 paintedCells = 0;
+    
+    for (const QRect &rect : event->region()) {
+        const qint64 firstLine = (scrollY + rect.top()) / m_charHeight;
+        const qint64 lastLine = std::min((scrollY + rect.bottom()) / m_charHeight, totalLines - 1);
+        int firstColumn, lastColumn;
+        columnsIn(rect, &firstColumn, &lastColumn);
+        const bool offsetColumn = rect.left() < m_hexCellX.first();
+        const int rowWidth = std::min(rect.right() + 1, m_lineLength) - rect.left();
+        
+        for (qint64 line = firstLine; line <= lastLine; ++line) {
+            const int y = (int)(line * m_charHeight - scrollY);
+            const bool highlighted = line == cursorLine || (line >= selectionFirstLine && line <= selectionLastLine);
+            if (highlighted) {
+                paintLine(painter, line, y, true, firstColumn, lastColumn, offsetColumn);
+            } else if (rowWidth > 0) {
+                const QPixmap &row = cachedRow(line);
+                const qreal dpr = row.devicePixelRatio();
+                painter.drawPixmap(QRectF(rect.left(), y, rowWidth, m_charHeight), row,
+                                   QRectF(rect.left() * dpr, 0, rowWidth * dpr, m_charHeight * dpr));
+            }
+        }
+        paintedCells += std::max<qint64>(0, lastLine - firstLine + 1) * std::max(0, lastColumn - firstColumn + 1);
+    }
+    HT_PROFILE_BYTES(paintedCells);
+
+    // Prepara en segundo plano las líneas hacia donde se va
+    if (!m_prefetchTimer.isActive()) m_prefetchTimer.start();
+
+#ifdef HEXANDTABLER_PROFILING
+    if (PerfTrace::overlayEnabled()) {
+        drawPerfOverlay(painter);
+    }
+#endif
+}
+
+qint64 HexEditorArea::lineCount() const {
+    return (dataSize() + m_bytesPerLine - 1) / m_bytesPerLine;
+}
+
+void HexEditorArea::paintLine(QPainter &painter, qint64 line, int y, bool highlighted,
+                              int firstColumn, int lastColumn, bool drawOffset) {
+    const qint64 totalBytes = dataSize();
+    const qint64 startByteIndex = line * m_bytesPerLine;
+    if (startByteIndex >= totalBytes) return;
+    const qint64 endByteIndex = std::min(totalBytes, startByteIndex + m_bytesPerLine);
     
-    int totalBytes = m_data.size();
+    // One walk down the piece tree per line, not one per byte
+    char lineBytes[MAX_BYTES_PER_LINE];
+    m_buffer.read(startByteIndex, endByteIndex - startByteIndex, lineBytes);
     
     QPalette pal = palette();
-    int cursorByteIndex = m_cursorPos / 2;
+    qint64 cursorByteIndex = highlighted ? m_cursorPos / 2 : -1;
+    
+    // Overlays are queried once per line
+    QRgb overlayColors[MAX_BYTES_PER_LINE];
+    bool hasOverlay = false;
+    if (!m_overlays.isEmpty()) {
+        std::fill(overlayColors, overlayColors + m_bytesPerLine, 0);
+        QVector<HexHighlight> highlights;
+        for (const HexOverlay *overlay : qAsConst(m_overlays)) {
+            highlights.clear();
+            overlay->query(startByteIndex, endByteIndex, highlights);
+            for (const HexHighlight &h : qAsConst(highlights)) {
+                qint64 from = std::max(h.start, (qint64)startByteIndex);
+                qint64 to = std::min(h.end, (qint64)endByteIndex);
+                for (qint64 b = from; b < to; ++b) {
+                    overlayColors[b - startByteIndex] = h.color.rgba();
+                    hasOverlay = true;
+                }
+            }
+        }
+    }
+    
+    // Region lookup is done once per line; bytes walk the sorted list forward.
+    int regionIdx = std::upper_bound(m_tableRegions.constBegin(), m_tableRegions.constEnd(),
+                                     (qint64)startByteIndex,
+                                     [](qint64 value, const TableRegion &r) { return value < r.end; })
+                    - m_tableRegions.constBegin();
 
-    for (int line = firstVisibleLine; line <= lastVisibleLine; ++line) {
-        int startByteIndex = line * m_bytesPerLine;
-        if (startByteIndex >= totalBytes) break;
+    painter.setPen(pal.color(QPalette::WindowText));
+    if (drawOffset) {
+        QString offsetStr = QString("%1").arg(startByteIndex, 8, 16, QChar('0')).toUpper();
+        painter.drawText(0, y, m_charWidth * 10, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, offsetStr);
+    }
 
-        int currentY = line * m_charHeight - scrollY;
+    for (int i = std::max(0, firstColumn); i <= std::min(m_bytesPerLine - 1, lastColumn); ++i) {
+        qint64 byteIndex = startByteIndex + i;
+        if (byteIndex >= totalBytes) break;
         
+        unsigned char byte = (unsigned char)lineBytes[i];
+        qint64 currentNibbleStart = (qint64)byteIndex * 2;
+        qint64 currentNibbleEnd = currentNibbleStart + 2;
+        
+        bool isCursorByte = (cursorByteIndex == byteIndex);
+        bool isSelected = highlighted && (m_selectionStart != -1 && 
+                           std::max(m_selectionStart, currentNibbleStart) < std::min(m_selectionEnd, currentNibbleEnd));
+
+        QColor bgColor = pal.color(QPalette::Base);
+        if (isSelected) {
+            bgColor = pal.color(QPalette::Highlight);
+        } else if (isCursorByte) {
+            bgColor = pal.color(QPalette::Midlight);
+        } else if (hasOverlay && qAlpha(overlayColors[i]) != 0) {
+            bgColor = QColor::fromRgba(overlayColors[i]);
+        }
+
+        
+        painter.fillRect(m_hexCellX.at(i), y, 3 * m_charWidth, m_charHeight, bgColor);
+        
+        painter.fillRect(m_asciiCellX.at(i), y, m_charWidth, m_charHeight, bgColor);
+        
+        QString hexStr = QString("%1").arg(byte, 2, 16, QChar('0')).toUpper();
+        
+        if (isSelected || isCursorByte) {
+             painter.setPen(pal.color(QPalette::HighlightedText));
+        } else {
+             painter.setPen(pal.color(QPalette::WindowText));
+        }
+        
+        
+        int hexStart = m_hexCellX.at(i);
+        painter.drawText(hexStart, y, m_charWidth, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, hexStr.at(0));
+        
+        
+        painter.drawText(hexStart + m_charWidth, y, m_charWidth, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, hexStr.at(1));
+        
+        
+        while (regionIdx < m_tableRegions.size() && m_tableRegions.at(regionIdx).end <= byteIndex) {
+            ++regionIdx;
+        }
+        const CharTable *table = m_charTable.data();
+        if (regionIdx < m_tableRegions.size() && m_tableRegions.at(regionIdx).start <= byteIndex
+            && m_tableRegions.at(regionIdx).table) {
+            table = m_tableRegions.at(regionIdx).table.data();
+        }
+        const QString &charStr = table->map[byte];
+        if (!isSelected && !isCursorByte) {
+             painter.setPen(pal.color(QPalette::WindowText));
+        }
+        painter.drawText(m_asciiCellX.at(i), y, m_charWidth, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, charStr);
         
-        QString offsetStr = QString("%1").arg(startByteIndex, 8, 16, QChar('0')).toUpper();
         painter.setPen(pal.color(QPalette::WindowText));
-        painter.drawText(0, currentY, m_charWidth * 10, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, offsetStr);
+    }
+}
 
-        for (int i = 0; i < m_bytesPerLine; ++i) {
-            int byteIndex = startByteIndex + i;
-            if (byteIndex >= totalBytes) break;
-            
-            unsigned char byte = (unsigned char)m_data.at(byteIndex);
-            int currentNibbleStart = byteIndex * 2;
-            int currentNibbleEnd = currentNibbleStart + 2;
-            
-            bool isCursorByte = (cursorByteIndex == byteIndex);
-            bool isSelected = (m_selectionStart != -1 && 
-                               std::max(m_selectionStart, currentNibbleStart) < std::min(m_selectionEnd, currentNibbleEnd));
-
-            QColor bgColor = pal.color(QPalette::Base);
-            if (isSelected) {
-                bgColor = pal.color(QPalette::Highlight);
-            } else if (isCursorByte) {
-                bgColor = pal.color(QPalette::Midlight);
-            }
+const QPixmap &HexEditorArea::cachedRow(qint64 line) {
+    auto it = m_rowCache.find(line);
+    if (it == m_rowCache.end()) {
+        const qreal dpr = viewport()->devicePixelRatioF();
+        QPixmap pixmap(QSize(m_lineLength, m_charHeight) * dpr);
+        pixmap.setDevicePixelRatio(dpr);
+        pixmap.fill(palette().color(QPalette::Base));
+        QPainter painter(&pixmap);
+        painter.setFont(font());
+        paintLine(painter, line, 0, false);
+        it = m_rowCache.insert(line, pixmap);
+    }
+    return it.value();
+}
 
-            
-            painter.fillRect(m_hexStartCol + i * (3 * m_charWidth), currentY, 3 * m_charWidth, m_charHeight, bgColor);
-            
-            painter.fillRect(m_asciiStartCol + i * m_charWidth, currentY, m_charWidth, m_charHeight, bgColor);
-            
-            QString hexStr = QString("%1").arg(byte, 2, 16, QChar('0')).toUpper();
-            
-            if (isSelected || isCursorByte) {
-                 painter.setPen(pal.color(QPalette::HighlightedText));
-            } else {
-                 painter.setPen(pal.color(QPalette::WindowText));
-            }
-            
-            
-            int hexStart = m_hexStartCol + i * (3 * m_charWidth);
-            painter.drawText(hexStart, currentY, m_charWidth, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, hexStr.at(0));
-            
-            
-            painter.drawText(hexStart + m_charWidth, currentY, m_charWidth, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, hexStr.at(1));
-            
-            
-            painter.drawText(hexStart + 2 * m_charWidth, currentY, m_charWidth, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, " ");
-            
-            
-            
-            
-            QString charStr = m_charMap[byte];
-            if (!isSelected && !isCursorByte) {
-                 painter.setPen(pal.color(QPalette::WindowText));
+void HexEditorArea::columnsIn(const QRect &rect, int *firstColumn, int *lastColumn) const {
+    *firstColumn = m_bytesPerLine;
+    *lastColumn = -1;
+    if (m_charWidth <= 0) return;
+    const int from = std::max(0, rect.left() / m_charWidth);
+    const int to = std::min(m_slotByte.size() - 1, rect.right() / m_charWidth);
+    for (int slot = from; slot <= to; ++slot) {
+        const int column = m_slotByte.at(slot);
+        if (column < 0) continue;
+        *firstColumn = std::min(*firstColumn, column);
+        *lastColumn = std::max(*lastColumn, column);
+    }
+}
+
+void HexEditorArea::invalidateView() {
+    m_rowCache.clear();
+    viewport()->update();
+}
+
+void HexEditorArea::invalidateBytes(qint64 from, qint64 to) {
+    if (to <= from || m_bytesPerLine <= 0) return;
+    const qint64 firstLine = from / m_bytesPerLine;
+    const qint64 lastLine = (to - 1) / m_bytesPerLine;
+    if (lastLine - firstLine >= m_rowCache.size()) {
+        for (auto it = m_rowCache.begin(); it != m_rowCache.end();) {
+            if (it.key() >= firstLine && it.key() <= lastLine) it = m_rowCache.erase(it);
+            else ++it;
+        }
+    } else {
+        for (qint64 line = firstLine; line <= lastLine; ++line) {
+            m_rowCache.remove(line);
+        }
+    }
+}
+
+void HexEditorArea::prefetchRows() {
+    HT_PROFILE_SCOPE("prefetchRows");
+    if (m_charHeight <= 0 || !isVisible()) return;
+    const qint64 firstVisible = m_scrollY / m_charHeight;
+    const int pageLines = viewport()->height() / m_charHeight + 1;
+    const qint64 lastVisible = firstVisible + pageLines - 1;
+    
+    // Se conserva una página por encima y otra por debajo de lo visible
+    const qint64 keepFrom = firstVisible - pageLines * ROW_CACHE_PAGES;
+    const qint64 keepTo = lastVisible + pageLines * ROW_CACHE_PAGES;
+    for (auto it = m_rowCache.begin(); it != m_rowCache.end();) {
+        if (it.key() < keepFrom || it.key() > keepTo) it = m_rowCache.erase(it);
+        else ++it;
+    }
+    
+    // Primero en la dirección del desplazamiento, luego la otra
+    const qint64 total = lineCount();
+    QElapsedTimer budget;
+    budget.start();
+    for (int pass = 0; pass < 2; ++pass) {
+        const bool down = (m_scrollDirection >= 0) == (pass == 0);
+        for (int k = 1; k <= pageLines * ROW_CACHE_PAGES; ++k) {
+            const qint64 line = down ? lastVisible + k : firstVisible - k;
+            if (line < 0 || line >= total || m_rowCache.contains(line)) continue;
+            cachedRow(line);
+            if (budget.elapsed() >= PREFETCH_BUDGET_MS) {
+                m_prefetchTimer.start();    // Sigue en la próxima vuelta del bucle de eventos
+                return;
             }
-            painter.drawText(m_asciiStartCol + i * m_charWidth, currentY, m_charWidth, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, charStr);
-            
-            painter.setPen(pal.color(QPalette::WindowText));
         }
     }
 }
 
+void HexEditorArea::scrollContentsBy(int dx, int dy) {
+    Q_UNUSED(dx);
+    // Solo cuando el usuario mueve la barra; setScrollY() ya se ocupa de lo suyo
+    if (m_syncingScrollBar || dy == 0) return;
+    const qint64 y = std::min(maxScrollY(), (qint64)verticalScrollBar()->value() * m_scrollScale);
+    const qint64 delta = m_scrollY - y;
+    m_scrollY = y;
+    if (delta != 0) scrollViewBy(delta);
+}
+
+void HexEditorArea::scrollViewBy(qint64 dy) {
+    m_scrollDirection = dy < 0 ? 1 : -1;
+    emit viewScrolled();
+    
+#ifdef HEXANDTABLER_PROFILING
+    if (PerfTrace::overlayEnabled()) {
+        viewport()->update(); // The overlay stays put; don't drag it along
+        return;
+    }
+#endif
+    if (std::abs(dy) >= viewport()->height()) {
+        viewport()->update();
+    } else {
+        viewport()->scroll(0, (int)dy); // Blit; only the uncovered band is painted
+    }
+}
+
+void HexEditorArea::wheelEvent(QWheelEvent *event) {
+    // Touchpads already deliver smooth pixel deltas
+    if (!event->pixelDelta().isNull() || event->angleDelta().y() == 0 || m_charHeight <= 0) {
+        m_scrollAnimation.stop();
+        QAbstractScrollArea::wheelEvent(event);
+        return;
+    }
+    
+    // Giros seguidos de la rueda alargan el recorrido, como un lanzamiento
+    m_wheelBoost = m_wheelTimer.isValid() && m_wheelTimer.elapsed() < WHEEL_FLING_MS ? std::min(WHEEL_MAX_BOOST, m_wheelBoost + 1) : 1;
+    m_wheelTimer.restart();
+    
+    const qint64 from = m_scrollAnimation.state() == QAbstractAnimation::Running ? m_scrollTarget : m_scrollY;
+    const int lines = event->angleDelta().y() * QApplication::wheelScrollLines() * m_wheelBoost / 120;
+    m_scrollTarget = std::max<qint64>(0, std::min(maxScrollY(), from - (qint64)lines * m_charHeight));
+    
+    // double: QVariantAnimation no interpola qint64, y 53 bits bastan para cualquier fichero
+    m_scrollAnimation.stop();
+    m_scrollAnimation.setStartValue((double)m_scrollY);
+    m_scrollAnimation.setEndValue((double)m_scrollTarget);
+    m_scrollAnimation.start();
+    event->accept();
+}
+
+void HexEditorArea::showEvent(QShowEvent *event) {
+    QAbstractScrollArea::showEvent(event);
+    // Shared tables may have been edited while this tab was hidden
+    m_rowCache.clear();
+}
+
+void HexEditorArea::drawPerfOverlay(QPainter &painter) {
+    QStringList lines = PerfTrace::overlayLines();
+    if (lines.isEmpty()) return;
+
+    QFontMetrics fm(painter.font());
+    int width = 0;
+    for (const QString &line : qAsConst(lines)) {
+        width = std::max(width, fm.horizontalAdvance(line));
+    }
+    QRect box(viewport()->width() - width - 16, 4, width + 12, lines.size() * m_charHeight + 8);
+    m_perfOverlayRect = box;
+    painter.fillRect(box, QColor(0, 0, 0, 170));
+    painter.setPen(Qt::white);
+    for (int i = 0; i < lines.size(); ++i) {
+        painter.drawText(box.left() + 6, box.top() + 4 + i * m_charHeight, width, m_charHeight, Qt::AlignLeft | Qt::AlignVCenter, lines.at(i));
+    }
+}
+
 void HexEditorArea::handleAsciiInput(const QString &text) { // <<< Definición de función
-    if (text.isEmpty()) return;
+    if (text.isEmpty() || m_readOnly) return;
 
     QChar inputChar = text.at(0);
         
-    int byteValue = -1;
-    for (int i = 0; i < 256; ++i) {
-        if (m_charMap[i].length() > 0 && m_charMap[i].at(0) == inputChar) {
-            byteValue = i;
-            break;
-        }
-    }
+    int byteValue = tableAt(m_cursorPos / 2)->byteFor(inputChar);
 
     if (byteValue != -1) {
-        int byteIndex = m_cursorPos / 2;
+        qint64 byteIndex = m_cursorPos / 2;
         
-        if (byteIndex < m_data.size()) {
-            m_data[byteIndex] = (char)byteValue;
+        if (m_insertMode || byteIndex < dataSize()) {
+            writeBytes(byteIndex, m_insertMode ? 0 : 1, QByteArray(1, (char)byteValue));
             setCursorPosition(m_cursorPos + 2);
             emit dataChanged();
         }
@@ -394,7 +894,7 @@ void HexEditorArea::handleAsciiInput(const QString &text) { // <<< Definición d
 }
 
 void HexEditorArea::handleHexInput(const QString &text) { // <<< Definición de función
-    if (text.isEmpty()) return;
+    if (text.isEmpty() || m_readOnly) return;
 
     QChar inputChar = text.at(0);
     int hexValue = -1;
@@ -413,20 +913,27 @@ void HexEditorArea::handleHexInput(const QString &text) { // <<< Definición de
         return;
     }
 
-    int byteIndex = m_cursorPos / 2;
+    qint64 byteIndex = m_cursorPos / 2;
 
-    if (byteIndex < m_data.size()) {
-        unsigned char byte = (unsigned char)m_data[byteIndex];
+    if (m_insertMode && m_currentNibbleIndex == 0) {
+        // El primer nibble crea el byte; el segundo lo completa como en sobrescritura
+        writeBytes(byteIndex, 0, QByteArray(1, (char)(hexValue << 4)));
+        m_currentNibbleIndex = 1;
+        emit dataChanged();
+        return;
+    }
+
+    if (byteIndex < dataSize()) {
+        unsigned char byte = (unsigned char)m_buffer.at(byteIndex);
 
         if (m_currentNibbleIndex == 0) {
             byte = (byte & 0x0F) | (hexValue << 4);
-            m_data[byteIndex] = (char)byte;
+            writeBytes(byteIndex, 1, QByteArray(1, (char)byte));
             
             m_currentNibbleIndex = 1;
-            viewport()->update();
         } else {
             byte = (byte & 0xF0) | hexValue;
-            m_data[byteIndex] = (char)byte;
+            writeBytes(byteIndex, 1, QByteArray(1, (char)byte));
             
             setCursorPosition(m_cursorPos + 2);
             m_currentNibbleIndex = 0; 
@@ -437,22 +944,35 @@ void HexEditorArea::handleHexInput(const QString &text) { // <<< Definición de
 }
 
 void HexEditorArea::handleDelete() { // <<< Definición de función
-    if (m_cursorPos > 0) {
+    if (m_cursorPos > 0 && !m_readOnly) {
         setCursorPosition(m_cursorPos - 2); 
-        int byteIndex = m_cursorPos / 2;
+        qint64 byteIndex = m_cursorPos / 2;
         
-        if (byteIndex < m_data.size()) {
-            m_data[byteIndex] = 0x00;
+        if (byteIndex < dataSize()) {
+            if (m_insertMode) {
+                writeBytes(byteIndex, 1, QByteArray());
+            } else {
+                writeBytes(byteIndex, 1, QByteArray(1, '\0'));
+            }
             emit dataChanged();
         }
     }
 }
 
 void HexEditorArea::keyPressEvent(QKeyEvent *event) {
+    m_scrollAnimation.stop();
     bool shiftIsHeld = event->modifiers() & Qt::ShiftModifier;
-    int newCursorPos = m_cursorPos;
+    qint64 newCursorPos = m_cursorPos;
     bool moved = false;
     
+    // En modo inserción Supr y Retroceso se llevan la selección entera
+    if (m_insertMode && !m_readOnly && (event->key() == Qt::Key_Delete || event->key() == Qt::Key_Backspace)
+        && m_selectionStart != -1 && m_selectionStart != m_selectionEnd) {
+        removeSelection();
+        event->accept();
+        return;
+    }
+    
     if (!shiftIsHeld && event->key() != Qt::Key_Control) {
         clearSelection(); // <<< Corregido
     }
@@ -465,7 +985,7 @@ void HexEditorArea::keyPressEvent(QKeyEvent *event) {
             m_editMode = HexMode;
         }
         m_currentNibbleIndex = 0; 
-        viewport()->update();
+        updateBytes(m_cursorPos / 2, m_cursorPos / 2 + 1);
         event->accept(); 
         return;
     }
@@ -484,11 +1004,11 @@ void HexEditorArea::keyPressEvent(QKeyEvent *event) {
             moved = true;
             break;
         case Qt::Key_Up:
-            newCursorPos = m_cursorPos - m_bytesPerLine * 2;
+            newCursorPos = m_cursorPos - (qint64)m_bytesPerLine * 2;
             moved = true;
             break;
         case Qt::Key_Down:
-            newCursorPos = m_cursorPos + m_bytesPerLine * 2;
+            newCursorPos = m_cursorPos + (qint64)m_bytesPerLine * 2;
             moved = true;
             break;
         case Qt::Key_Home:
@@ -496,30 +1016,30 @@ void HexEditorArea::keyPressEvent(QKeyEvent *event) {
             moved = true;
             break;
         case Qt::Key_End:
-            newCursorPos = std::min(m_data.size() * 2, ((m_cursorPos / (m_bytesPerLine * 2)) + 1) * (m_bytesPerLine * 2));
+            newCursorPos = std::min(dataSize() * 2, ((m_cursorPos / (m_bytesPerLine * 2)) + 1) * (m_bytesPerLine * 2));
             moved = true;
             break;
         case Qt::Key_PageUp: {
             int linesPerPage = viewport()->height() / m_charHeight;
-            int currentByteIndex = m_cursorPos / 2;
-            int currentLine = currentByteIndex / m_bytesPerLine;
-            int offsetInLine = currentByteIndex % m_bytesPerLine;
-            int targetLine = std::max(0, currentLine - linesPerPage);
-            int newByteIndex = targetLine * m_bytesPerLine + offsetInLine;
-            newByteIndex = std::min((int)m_data.size(), newByteIndex);
+            qint64 currentByteIndex = m_cursorPos / 2;
+            qint64 currentLine = currentByteIndex / m_bytesPerLine;
+            int offsetInLine = (int)(currentByteIndex % m_bytesPerLine);
+            qint64 targetLine = std::max<qint64>(0, currentLine - linesPerPage);
+            qint64 newByteIndex = targetLine * m_bytesPerLine + offsetInLine;
+            newByteIndex = std::min(dataSize(), newByteIndex);
             newCursorPos = newByteIndex * 2;
             moved = true;
             break;
         }
         case Qt::Key_PageDown: {
             int linesPerPage = viewport()->height() / m_charHeight;
-            int currentByteIndex = m_cursorPos / 2;
-            int currentLine = currentByteIndex / m_bytesPerLine;
-            int offsetInLine = currentByteIndex % m_bytesPerLine;
-            int totalLines = (m_data.size() + m_bytesPerLine - 1) / m_bytesPerLine;
-            int targetLine = std::min(totalLines, currentLine + linesPerPage);
-            int newByteIndex = targetLine * m_bytesPerLine + offsetInLine;
-            newByteIndex = std::min((int)m_data.size(), newByteIndex);
+            qint64 currentByteIndex = m_cursorPos / 2;
+            qint64 currentLine = currentByteIndex / m_bytesPerLine;
+            int offsetInLine = (int)(currentByteIndex % m_bytesPerLine);
+            qint64 totalLines = lineCount();
+            qint64 targetLine = std::min(totalLines, currentLine + linesPerPage);
+            qint64 newByteIndex = targetLine * m_bytesPerLine + offsetInLine;
+            newByteIndex = std::min(dataSize(), newByteIndex);
             newCursorPos = newByteIndex * 2;
             moved = true;
             break;
@@ -528,9 +1048,14 @@ void HexEditorArea::keyPressEvent(QKeyEvent *event) {
             handleDelete(); // <<< Corregido
             return;
         case Qt::Key_Delete:
-            if (m_cursorPos / 2 < m_data.size()) {
-                 m_data[m_cursorPos / 2] = 0x00;
-                 setCursorPosition(m_cursorPos + 2);
+            if (m_cursorPos / 2 < dataSize() && !m_readOnly) {
+                 if (m_insertMode) {
+                     writeBytes(m_cursorPos / 2, 1, QByteArray());
+                     m_currentNibbleIndex = 0;
+                 } else {
+                     writeBytes(m_cursorPos / 2, 1, QByteArray(1, '\0'));
+                     setCursorPosition(m_cursorPos + 2);
+                 }
                  emit dataChanged();
             }
             return;
@@ -539,8 +1064,8 @@ void HexEditorArea::keyPressEvent(QKeyEvent *event) {
     }
     
     if (moved) {
-        int maxPos = m_data.size() * 2;
-        newCursorPos = std::max(0, std::min(maxPos, newCursorPos));
+        const qint64 maxPos = dataSize() * 2;
+        newCursorPos = std::max<qint64>(0, std::min(maxPos, newCursorPos));
         newCursorPos = (newCursorPos / 2) * 2;
         
         setCursorPosition(newCursorPos); 
@@ -578,41 +1103,30 @@ void HexEditorArea::keyPressEvent(QKeyEvent *event) {
     QAbstractScrollArea::keyPressEvent(event);
 }
 
-int HexEditorArea::byteIndexAt(const QPoint &point) const {
-    int scrollY = verticalScrollBar()->value();
-    int line = (point.y() + scrollY) / m_charHeight;
-    int offset = line * m_bytesPerLine;
+qint64 HexEditorArea::byteIndexAt(const QPoint &point) const {
+    const qint64 line = (point.y() + m_scrollY) / m_charHeight;
+    const qint64 offset = line * m_bytesPerLine;
     
-    if (offset >= m_data.size())
+    if (offset >= dataSize())
         return -1;
 
-    int colX = point.x();
-    int byteInLine = -1;
-    
-    const int HEX_MAX_X = m_asciiStartCol - (3 * m_charWidth); 
-    
-    if (colX >= m_hexStartCol && colX < HEX_MAX_X) {
-        int relX = colX - m_hexStartCol;
-        int charIndex = relX / m_charWidth;
-        byteInLine = charIndex / 3;
-    }
-    else if (colX >= m_asciiStartCol && colX < m_asciiStartCol + m_bytesPerLine * m_charWidth) {
-        int relX = colX - m_asciiStartCol;
-        byteInLine = relX / m_charWidth;
-    }
+    const int slot = m_charWidth > 0 ? point.x() / m_charWidth : -1;
+    if (point.x() < 0 || slot < 0 || slot >= m_slotByte.size()) return -1;
+    int byteInLine = m_slotByte.at(slot);
     
     if (byteInLine == -1 || byteInLine >= m_bytesPerLine) return -1;
     
-    int byteIndex = offset + byteInLine;
-    return (byteIndex < m_data.size()) ? byteIndex : -1;
+    const qint64 byteIndex = offset + byteInLine;
+    return (byteIndex < dataSize()) ? byteIndex : -1;
 }
 
 void HexEditorArea::mousePressEvent(QMouseEvent *event) {
+    m_scrollAnimation.stop();
     if (event->button() == Qt::LeftButton) {
-        int byteIndex = byteIndexAt(event->pos());
+        qint64 byteIndex = byteIndexAt(event->pos());
         if (byteIndex != -1) {
             int colX = event->pos().x();
-            int newPos = byteIndex * 2; 
+            qint64 newPos = (qint64)byteIndex * 2; 
 
             m_editMode = (colX >= m_asciiStartCol) ? AsciiMode : HexMode;
             m_currentNibbleIndex = 0;
@@ -648,15 +1162,15 @@ void HexEditorArea::mousePressEvent(QMouseEvent *event) {
 
 void HexEditorArea::mouseMoveEvent(QMouseEvent *event) {
     if (event->buttons() & Qt::LeftButton) {
-        int byteIndex = byteIndexAt(event->pos());
+        qint64 byteIndex = byteIndexAt(event->pos());
         if (byteIndex != -1 && m_selectionAnchor != -1) {
             
             
-            int currentByteStart = byteIndex * 2;
+            qint64 currentByteStart = (qint64)byteIndex * 2;
             
-            int anchorByteStart = m_selectionAnchor; 
+            qint64 anchorByteStart = m_selectionAnchor; 
 
-            int startPos, endPos;
+            qint64 startPos, endPos;
             
             
             if (anchorByteStart <= currentByteStart) {
@@ -672,19 +1186,14 @@ void HexEditorArea::mouseMoveEvent(QMouseEvent *event) {
             setSelection(startPos, endPos);
             
             
-            int line = byteIndex / m_bytesPerLine;
-            int lineY = line * m_charHeight;
-            int scrollY = verticalScrollBar()->value();
-            int visibleHeight = viewport()->height();
-
-            if (lineY < scrollY) {
-                verticalScrollBar()->setValue(lineY);
-            } else if (lineY + m_charHeight > scrollY + visibleHeight) {
-                verticalScrollBar()->setValue(lineY + m_charHeight - visibleHeight);
-            }
+            ensureLineVisible(byteIndex / m_bytesPerLine);
             
             
+            const qint64 oldCursorPos = m_cursorPos;
             m_cursorPos = endPos;
+            updateBytes(oldCursorPos / 2, oldCursorPos / 2 + 1);
+            updateBytes(endPos / 2, endPos / 2 + 1);
+            if (endPos != oldCursorPos) emit cursorPositionChanged(m_cursorPos);
         }
     }
     QAbstractScrollArea::mouseMoveEvent(event);
@@ -10,6 +10,22 @@
 #include <QKeySequence> 
 #include <QSize> 
 #include <QEvent> 
+#include <QVector>
+#include <QHash>
+#include <QPixmap>
+#include <QTimer>
+#include <QVariantAnimation>
+#include <QElapsedTimer>
+#include <climits>
+
+#include "chartable.h"
+#include "hexoverlay.h"
+#include "pointerscan.h"
+#include "piecetable.h"
+#include "hexformat.h"
+#include "bookmarks.h"
+
+class QPainter;
 
 class HexEditorArea : public QAbstractScrollArea
 {
@@ -19,26 +35,75 @@ public:
     QSize minimumSizeHint() const override; 
 
     void setHexData(const QByteArray &data);
-    QByteArray hexData() const;
+    qint64 dataSize() const { return m_buffer.size(); }
+    // The buffer itself; copies are O(1), so undo keeps one per step
+    const PieceTable &buffer() const { return m_buffer; }
+    void setBuffer(const PieceTable &buffer);
+    // Replaces [pos, pos + length) as a single edit, so it is one undo step
+    void replaceBytes(qint64 pos, qint64 length, const QByteArray &bytes);
+    // Same for 'length' bytes at each offset (ascending, not overlapping), all in one undo step
+    void replaceEach(const QVector<qint64> &offsets, qint64 length, const QByteArray &bytes);
+    
+    // Insertar: teclear y pegar desplazan lo que sigue, y borrar quita bytes en vez de ponerlos a cero
+    void setInsertMode(bool insert);
+    bool isInsertMode() const { return m_insertMode; }
     
-    void setCharMapping(const QString (&mapping)[256]); 
+    void setCharTable(const CharTablePtr &table);
+    CharTablePtr charTable() const { return m_charTable; }
+    void setTableRegions(const QVector<TableRegion> &regions);
     void goToOffset(quint64 offset); 
     
-    int byteIndexAt(const QPoint &point) const;
+    // Sigue el puntero bajo el cursor; jumpBack() vuelve a donde estaba
+    void setPointerFormat(const PointerFormat &format) { m_pointerFormat = format; }
+    PointerFormat pointerFormat() const { return m_pointerFormat; }
+    bool followPointer();
+    bool jumpBack();
+    
+    // Marcadores del documento; se pintan debajo de los overlays y siguen a los bytes al insertar o borrar
+    const BookmarkIndex &bookmarks() const { return m_bookmarks; }
+    void setBookmarks(const BookmarkIndex &bookmarks);
+    
+    void addOverlay(const HexOverlay *overlay);
+    void removeOverlay(const HexOverlay *overlay);
+    // Repaints from scratch; for changes the editor cannot see (overlay contents, a table edited in place)
+    void invalidateView();
+    
+    void setReadOnly(bool readOnly) { m_readOnly = readOnly; }
+    bool isReadOnly() const { return m_readOnly; }
+    
+    // Bytes por línea (0 = los que quepan en la ventana) y separación cada 'groupSize' bytes (0 = ninguna)
+    void setBytesPerLine(int bytes);
+    int bytesPerLine() const { return m_bytesPerLine; }
+    bool isAutoBytesPerLine() const { return m_requestedBytesPerLine == 0; }
+    void setGroupSize(int bytes);
+    int groupSize() const { return m_groupSize; }
+    
+    qint64 topOffset() const;
+    qint64 visibleByteCount() const;
+    void setTopOffset(qint64 offset);
+    
+    qint64 byteIndexAt(const QPoint &point) const;
     void updateViewMetrics();
     
-    int cursorPosition() const { return m_cursorPos; }
-    void setCursorPosition(int newPos); // Ahora es public para acceso desde hexandtabler.cpp
-    void setSelection(int startPos, int endPos);        
+    qint64 cursorPosition() const { return m_cursorPos; }
+    void setCursorPosition(qint64 newPos); // Ahora es public para acceso desde hexandtabler.cpp
+    void setSelection(qint64 startPos, qint64 endPos);        
     
-    int selectionStart() const { return m_selectionStart; } 
-    int selectionEnd() const { return m_selectionEnd; } 
+    qint64 selectionStart() const { return m_selectionStart; } 
+    qint64 selectionEnd() const { return m_selectionEnd; } 
     
-    void copySelection();                                  
+    // The clipboard gets a version of the buffer; the text in 'style' is only made when pasted
+    void copySelection(HexFormat::Style style = HexFormat::Hex);
     void pasteFromClipboard();
 
 signals:
     void dataChanged();
+    void dataReplaced();        // setHexData() swapped the whole buffer
+    void insertModeChanged(bool insert);
+    void cursorPositionChanged(qint64 position);   // Nibble index, as cursorPosition()
+    void bookmarksChanged();
+    void charTableChanged();
+    void viewScrolled();        // The top of the view moved, even by less than a scroll bar step
 
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -48,6 +113,9 @@ protected:
     void mouseReleaseEvent(QMouseEvent *event) override; 
     void resizeEvent(QResizeEvent *event) override;
     void changeEvent(QEvent *event) override; 
+    void scrollContentsBy(int dx, int dy) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void showEvent(QShowEvent *event) override;
 
 private:
     enum EditMode { 
@@ -55,31 +123,82 @@ private:
         AsciiMode
     };
     
-    QByteArray m_data;
-    int m_cursorPos = 0;
+    PieceTable m_buffer;
+    bool m_insertMode = false;
+    qint64 m_cursorPos = 0;
     EditMode m_editMode = HexMode; 
-    QString m_charMap[256]; 
+    CharTablePtr m_charTable;
+    QVector<TableRegion> m_tableRegions; // Ordenadas por inicio, sin solapes
+    QList<const HexOverlay*> m_overlays;
+    BookmarkIndex m_bookmarks;
+    bool m_readOnly = false;
+    PointerFormat m_pointerFormat;
+    QVector<qint64> m_jumpHistory;
     
     int m_charWidth = 0;
     int m_charHeight = 0;
-    const int m_bytesPerLine = 16;
+    int m_bytesPerLine = 16;
+    int m_requestedBytesPerLine = 16;
+    int m_groupSize = 0;
     int m_hexStartCol = 0; 
     int m_asciiStartCol = 0; 
     int m_lineLength = 0; 
+    // Layout precomputed by calculateMetrics(): x of each byte's cells, and the byte under each
+    // character slot of a line (-1 for none), so hit-testing is a division and a lookup
+    QVector<int> m_hexCellX;
+    QVector<int> m_asciiCellX;
+    QVector<qint16> m_slotByte;
     
-    int m_selectionAnchor = -1; 
-    int m_selectionStart = -1;
-    int m_selectionEnd = -1;   
+    qint64 m_selectionAnchor = -1; 
+    qint64 m_selectionStart = -1;
+    qint64 m_selectionEnd = -1;   
 
     int m_currentNibbleIndex = 0;
+    
+    // Líneas ya pintadas sin cursor ni selección: desplazarse es copiar y pintar solo las que entran
+    QHash<qint64, QPixmap> m_rowCache;
+    int m_scrollDirection = 1;
+    QTimer m_prefetchTimer;
+    QVariantAnimation m_scrollAnimation;
+    qint64 m_scrollTarget = 0;
+    // Pixels from the top of the file. The scroll bar only holds an int, so it shows this divided
+    // by m_scrollScale, which grows past 1 once lines times row height no longer fit.
+    qint64 m_scrollY = 0;
+    qint64 m_scrollScale = 1;
+    bool m_syncingScrollBar = false;
+    QElapsedTimer m_wheelTimer;
+    int m_wheelBoost = 1;
+    QRect m_perfOverlayRect;
 
     void calculateMetrics(); 
+    void updateScrollRange();
+    qint64 lineCount() const;
+    qint64 maxScrollY() const;
+    void setScrollY(qint64 y);
+    void scrollViewBy(qint64 dy);
+    // Paints columns [firstColumn, lastColumn] of a line; 'highlighted' adds cursor and selection
+    void paintLine(QPainter &painter, qint64 line, int y, bool highlighted,
+                   int firstColumn = 0, int lastColumn = INT_MAX, bool drawOffset = true);
+    void columnsIn(const QRect &rect, int *firstColumn, int *lastColumn) const;
+    // Damage tracking: asks for a repaint of just these bytes' cells; Qt merges the rects per frame
+    void updateBytes(qint64 from, qint64 to);
+    void updateSelectionChange(qint64 oldStart, qint64 oldEnd);
+    void ensureLineVisible(qint64 line);
+    const QPixmap &cachedRow(qint64 line);
+    void invalidateBytes(qint64 from, qint64 to);
+    void prefetchRows();
+    const CharTable *tableAt(qint64 byteIndex) const;
+    void drawPerfOverlay(QPainter &painter);
     void clearSelection(); // <<< Declaración de función
     
     // <<< Declaraciones de funciones de manejo de entrada
     void handleAsciiInput(const QString &text); 
     void handleHexInput(const QString &text); 
     void handleDelete(); 
+    // Every edit goes through here: replaces 'removed' bytes at 'pos' and repaints what moved
+    void writeBytes(qint64 pos, qint64 removed, const QByteArray &bytes);
+    void removeSelection();
+    void bufferReplaced();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,365 @@
+#include "hexformat.h"
+#include "perftrace.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+const int C_ARRAY_BYTES_PER_LINE = 16;
+const qint64 MAX_TEXT_SIZE = INT_MAX - 64;     // A QByteArray can't hold more
+const qint64 MAX_DECLARATION = 256;            // Text allowed before the first byte of a C array
+const qint64 BASE64_WORD_LENGTH = 32;          // Unpadded base64 needs a run this long to not pass for words
+
+namespace {
+
+// Los dos dígitos de cada byte y un espacio, listos para copiar de una vez
+struct HexPairs {
+    char pair[256][4];      // "AB " and one byte of padding, so a whole entry is one 4-byte store
+    HexPairs() {
+        static const char digits[] = "0123456789ABCDEF";
+        for (int b = 0; b < 256; ++b) {
+            pair[b][0] = digits[b >> 4];
+            pair[b][1] = digits[b & 15];
+            pair[b][2] = ' ';
+            pair[b][3] = ' ';
+        }
+    }
+};
+
+const HexPairs &hexPairs() {
+    static const HexPairs pairs;
+    return pairs;
+}
+
+}
+
+QByteArray HexFormat::hex(const uchar *data, qint64 size) {
+    HT_PROFILE_SCOPE("formatHex");
+    HT_PROFILE_BYTES(size);
+    if (size <= 0 || size * 3 > MAX_TEXT_SIZE) return QByteArray();
+    const HexPairs &pairs = hexPairs();
+    // Each store writes one byte past its entry; the next one (or the final resize) covers it
+    QByteArray text(int(size * 3 + 1), Qt::Uninitialized);
+    char *out = text.data();
+    for (qint64 i = 0; i < size; ++i) {
+        memcpy(out, pairs.pair[data[i]], 4);
+        out += 3;
+    }
+    text.resize(int(size * 3 - 1));
+    return text;
+}
+
+QByteArray HexFormat::escaped(const uchar *data, qint64 size) {
+    HT_PROFILE_SCOPE("formatEscaped");
+    HT_PROFILE_BYTES(size);
+    if (size <= 0 || size * 4 > MAX_TEXT_SIZE) return QByteArray();
+    const HexPairs &pairs = hexPairs();
+    QByteArray text(int(size * 4), Qt::Uninitialized);
+    char *out = text.data();
+    for (qint64 i = 0; i < size; ++i) {
+        out[0] = '\\';
+        out[1] = 'x';
+        memcpy(out + 2, pairs.pair[data[i]], 2);
+        out += 4;
+    }
+    return text;
+}
+
+QByteArray HexFormat::cArray(const uchar *data, qint64 size) {
+    HT_PROFILE_SCOPE("formatCArray");
+    HT_PROFILE_BYTES(size);
+    // "{\n", then per line 4 of indent, "0xAB, " per byte and "\n", then "}"
+    const qint64 lines = (size + C_ARRAY_BYTES_PER_LINE - 1) / C_ARRAY_BYTES_PER_LINE;
+    const qint64 bound = 2 + lines * 5 + size * 6 + 1;
+    if (size <= 0 || bound > MAX_TEXT_SIZE) return QByteArray();
+    const HexPairs &pairs = hexPairs();
+    QByteArray text(int(bound), Qt::Uninitialized);
+    char *out = text.data();
+    *out++ = '{';
+    *out++ = '\n';
+    for (qint64 i = 0; i < size; ++i) {
+        const bool lineStart = i % C_ARRAY_BYTES_PER_LINE == 0;
+        const bool lineEnd = (i + 1) % C_ARRAY_BYTES_PER_LINE == 0 || i + 1 == size;
+        if (lineStart) {
+            memcpy(out, "    ", 4);
+            out += 4;
+        }
+        out[0] = '0';
+        out[1] = 'x';
+        memcpy(out + 2, pairs.pair[data[i]], 2);
+        out += 4;
+        if (i + 1 < size) *out++ = ',';
+        *out++ = lineEnd ? '\n' : ' ';
+    }
+    *out++ = '}';
+    text.resize(int(out - text.constData()));
+    return text;
+}
+
+QString HexFormat::tableText(const uchar *data, qint64 size, qint64 offset, const CharTable &table,
+                             const QVector<TableRegion> &regions) {
+    HT_PROFILE_SCOPE("formatTableText");
+    HT_PROFILE_BYTES(size);
+    if (size <= 0 || size > MAX_TEXT_SIZE / 2) return QString();
+    QString text;
+    text.reserve(int(size));
+
+    // Las regiones están ordenadas; se avanza por ellas a la vez que por los bytes
+    int regionIdx = std::upper_bound(regions.constBegin(), regions.constEnd(), offset,
+                                     [](qint64 value, const TableRegion &r) { return value < r.end; })
+                    - regions.constBegin();
+    for (qint64 i = 0; i < size; ++i) {
+        const qint64 pos = offset + i;
+        while (regionIdx < regions.size() && regions.at(regionIdx).end <= pos) {
+            ++regionIdx;
+        }
+        const CharTable *current = &table;
+        if (regionIdx < regions.size() && regions.at(regionIdx).start <= pos && regions.at(regionIdx).table) {
+            current = regions.at(regionIdx).table.data();
+        }
+        text += current->map[data[i]];
+    }
+    return text;
+}
+
+namespace {
+
+bool isSpace(ushort c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+int hexDigit(ushort c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// "0A 1B2C": dígitos por pares, con espacios solo entre pares
+qint64 decodeHexDump(const QChar *s, qint64 n, char *out) {
+    qint64 count = 0;
+    int high = -1;
+    for (qint64 i = 0; i < n; ++i) {
+        const ushort c = s[i].unicode();
+        if (isSpace(c)) {
+            if (high >= 0) return -1;
+            continue;
+        }
+        const int v = hexDigit(c);
+        if (v < 0) return -1;
+        if (high < 0) {
+            high = v;
+        } else {
+            out[count++] = char(high << 4 | v);
+            high = -1;
+        }
+    }
+    return high < 0 ? count : -1;
+}
+
+// "{ 0x0A, 0x1B }" o "\x0A\x1B", con o sin la declaración de C delante
+qint64 decodeCArray(const QChar *s, qint64 n, char *out, bool *escaped) {
+    qint64 first = -1;
+    qint64 brace = -1;
+    for (qint64 i = 0; i + 1 < n && i < MAX_DECLARATION; ++i) {
+        const ushort c = s[i].unicode();
+        if (c == '{' && brace < 0) brace = i;
+        if ((c == '0' || c == '\\') && (s[i + 1] == 'x' || s[i + 1] == 'X')) {
+            first = i;
+            break;
+        }
+    }
+    if (first < 0) return -1;
+
+    qint64 count = 0;
+    *escaped = s[first] == '\\';
+    for (qint64 i = brace >= 0 && brace < first ? brace + 1 : 0; i < n;) {
+        const ushort c = s[i].unicode();
+        if (isSpace(c) || c == ',' || c == '"') {
+            ++i;
+            continue;
+        }
+        if (c == '}') break;    // Lo que sigue (";") es del código, no de los datos
+        if (!((c == '0' || c == '\\') && i + 1 < n && (s[i + 1] == 'x' || s[i + 1] == 'X'))) return -1;
+        i += 2;
+        int value = 0;
+        int digits = 0;
+        for (; digits < 2 && i < n && hexDigit(s[i].unicode()) >= 0; ++digits, ++i) {
+            value = value << 4 | hexDigit(s[i].unicode());
+        }
+        if (digits == 0 || (i < n && hexDigit(s[i].unicode()) >= 0)) return -1;
+        out[count++] = char(value);
+    }
+    return count;
+}
+
+int base64Digit(ushort c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+// 'wordLike' is set when nothing but the alphabet says it is base64: no '=' and only short runs
+// between spaces, as in "Level100" or "HP+MP/99"
+qint64 decodeBase64(const QChar *s, qint64 n, char *out, bool *wordLike) {
+    qint64 count = 0;
+    qint64 symbols = 0;
+    qint64 run = 0;
+    qint64 longestRun = 0;
+    int padding = 0;
+    bool marked = false;        // A digit, '+', '/' or '=': plain words rarely have them
+    quint32 bits = 0;
+    for (qint64 i = 0; i < n; ++i) {
+        const ushort c = s[i].unicode();
+        if (isSpace(c)) {
+            run = 0;
+            continue;
+        }
+        longestRun = std::max(longestRun, ++run);
+        if (c == '=') {
+            if (++padding > 2) return -1;
+            ++symbols;
+            marked = true;
+            continue;
+        }
+        const int v = base64Digit(c);
+        if (v < 0 || padding > 0) return -1;
+        marked = marked || v >= 52;
+        bits = bits << 6 | v;
+        if (++symbols % 4 == 0) {
+            out[count++] = char(bits >> 16);
+            out[count++] = char(bits >> 8);
+            out[count++] = char(bits);
+        }
+    }
+    if (symbols < 8 || symbols % 4 != 0 || !marked) return -1;
+    *wordLike = padding == 0 && longestRun < BASE64_WORD_LENGTH;
+    // El último grupo llevaba relleno: sus bytes salen de los bits que sí había
+    if (padding == 1) {
+        bits <<= 6;
+        out[count++] = char(bits >> 16);
+        out[count++] = char(bits >> 8);
+    } else if (padding == 2) {
+        bits <<= 12;
+        out[count++] = char(bits >> 16);
+    }
+    return count;
+}
+
+}
+
+QByteArray HexFormat::parse(const QString &text, const CharTable &table, Style *detected) {
+    HT_PROFILE_SCOPE("parsePaste");
+    HT_PROFILE_BYTES(text.size());
+    const QChar *s = text.constData();
+    const qint64 n = text.size();
+    // Ningún formato da más bytes que caracteres: un solo buffer sirve para todos los intentos
+    QByteArray bytes(int(n), Qt::Uninitialized);
+    char *out = bytes.data();
+    Style style = Hex;
+
+    bool escaped = false;
+    bool wordLike = false;
+    qint64 count = decodeCArray(s, n, out, &escaped);
+    if (count >= 0) {
+        style = escaped ? Escaped : CArray;
+    } else if ((count = decodeHexDump(s, n, out)) > 0) {
+        style = Hex;
+    } else if ((count = decodeBase64(s, n, out, &wordLike)) >= 0 && !wordLike) {
+        style = Base64;
+    } else {
+        // Texto que también vale como base64 ("Level100") va por la tabla si esta lo escribe entero
+        const bool maybeBase64 = count >= 0;
+        // Los caracteres Latin-1 por tabla directa; el resto por el hash de la tabla
+        short latin[256];
+        for (int c = 0; c < 256; ++c) {
+            latin[c] = (short)table.byteFor(QChar(c));
+        }
+        bool mapped = false;
+        bool complete = true;
+        for (qint64 i = 0; i < n; ++i) {
+            const ushort c = s[i].unicode();
+            const int b = c < 256 ? latin[c] : table.byteFor(s[i]);
+            mapped = mapped || b >= 0;
+            complete = complete && (b >= 0 || isSpace(c));
+            out[i] = b >= 0 ? char(b) : '\0';
+        }
+        count = n;
+        style = TableText;
+        if (maybeBase64 && !complete) {
+            count = decodeBase64(s, n, out, &wordLike);
+            style = Base64;
+        } else if (!mapped) {
+            bytes = text.toUtf8();
+            count = bytes.size();
+            style = Utf8Text;
+        }
+    }
+
+    bytes.resize(int(count));
+    if (detected) *detected = style;
+    return bytes;
+}
+
+HexMimeData::HexMimeData(const PieceTable &buffer, qint64 start, qint64 length, HexFormat::Style style,
+                         const CharTablePtr &table, const QVector<TableRegion> &regions)
+    : m_buffer(buffer),
+      m_start(start),
+      m_length(length),
+      m_style(style),
+      m_table(table ? CharTablePtr(new CharTable(*table)) : CharTablePtr()),
+      m_regions(regions)
+{
+    // Una copia por tabla distinta, aunque la usen varias regiones
+    QHash<const CharTable *, CharTablePtr> copies;
+    for (TableRegion &region : m_regions) {
+        if (!region.table) continue;
+        CharTablePtr &copy = copies[region.table.data()];
+        if (!copy) copy = region.table == table ? m_table : CharTablePtr(new CharTable(*region.table));
+        region.table = copy;
+    }
+}
+
+QStringList HexMimeData::formats() const {
+    return QStringList() << "application/octet-stream" << "text/plain";
+}
+
+bool HexMimeData::hasFormat(const QString &mimeType) const {
+    return mimeType == "application/octet-stream" || mimeType == "text/plain";
+}
+
+const QByteArray &HexMimeData::bytes() const {
+    if (!m_bytesReady) {
+        m_bytes = m_buffer.read(m_start, m_length);
+        m_bytesReady = true;
+    }
+    return m_bytes;
+}
+
+QVariant HexMimeData::retrieveData(const QString &mimeType, QVariant::Type type) const {
+    if (mimeType == "application/octet-stream") {
+        return bytes();
+    }
+    if (mimeType != "text/plain") {
+        return QMimeData::retrieveData(mimeType, type);
+    }
+    if (!m_text.isValid()) {
+        const uchar *data = reinterpret_cast<const uchar *>(bytes().constData());
+        const qint64 size = bytes().size();
+        switch (m_style) {
+        case HexFormat::Hex: m_text = HexFormat::hex(data, size); break;
+        case HexFormat::Escaped: m_text = HexFormat::escaped(data, size); break;
+        case HexFormat::CArray: m_text = HexFormat::cArray(data, size); break;
+        case HexFormat::Base64: m_text = bytes().toBase64(); break;
+        case HexFormat::Utf8Text: m_text = QString::fromUtf8(bytes()); break;
+        case HexFormat::TableText:
+            m_text = m_table ? HexFormat::tableText(data, size, m_start, *m_table, m_regions) : QString();
+            break;
+        }
+    }
+    // ASCII formats stay a QByteArray; QMimeData converts it if a QString is wanted
+    return m_text;
+}
@@ -0,0 +1,73 @@
+#ifndef HEXFORMAT_H
+#define HEXFORMAT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QMimeData>
+
+#include "chartable.h"
+#include "piecetable.h"
+
+// Conversión entre bytes y texto para el portapapeles; cada formato se escribe en un buffer reservado de antemano
+namespace HexFormat {
+
+enum Style {
+    Hex,            // 0A 1B 2C
+    Escaped,        // \x0A\x1B\x2C
+    CArray,         // { 0x0A, 0x1B, 0x2C } with 16 bytes per line
+    Base64,
+    TableText,      // Decoded with the table of each byte's region
+    Utf8Text        // Paste only: text the table can't encode at all
+};
+
+QByteArray hex(const uchar *data, qint64 size);
+QByteArray escaped(const uchar *data, qint64 size);
+QByteArray cArray(const uchar *data, qint64 size);
+// 'offset' is where data[0] sits in the document, to find the region tables
+QString tableText(const uchar *data, qint64 size, qint64 offset, const CharTable &table,
+                  const QVector<TableRegion> &regions);
+
+// Bytes for pasted text. Tries a C array or escaped string, a hex dump, base64 and finally
+// 'table' text, each in one pass that gives up at the first character that doesn't fit.
+// Base64 without '=' and without a long unbroken run could be words ("Item0001"), so it is
+// only taken when 'table' can't write every character.
+QByteArray parse(const QString &text, const CharTable &table, Style *detected = nullptr);
+
+}
+
+// Clipboard contents that are only rendered when something asks for them. Holds a version of the
+// buffer (O(1) to keep), so copying hundreds of megabytes costs nothing until it is pasted, and
+// copies of the tables, which are edited in place, as they were at copy time.
+class HexMimeData : public QMimeData
+{
+    Q_OBJECT
+public:
+    HexMimeData(const PieceTable &buffer, qint64 start, qint64 length, HexFormat::Style style,
+                const CharTablePtr &table, const QVector<TableRegion> &regions);
+
+    QStringList formats() const override;
+    bool hasFormat(const QString &mimeType) const override;
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QVariant::Type type) const override;
+
+private:
+    const QByteArray &bytes() const;
+
+    PieceTable m_buffer;
+    qint64 m_start;
+    qint64 m_length;
+    HexFormat::Style m_style;
+    CharTablePtr m_table;               // Private copies, never edited
+    QVector<TableRegion> m_regions;
+
+    // Rendered on first request and kept for the next paste
+    mutable QByteArray m_bytes;
+    mutable bool m_bytesReady = false;
+    mutable QVariant m_text;
+};
+
+#endif // HEXFORMAT_H
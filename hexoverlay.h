@@ -0,0 +1,24 @@
+#ifndef HEXOVERLAY_H
+#define HEXOVERLAY_H
+
+#include <QColor>
+#include <QVector>
+
+// Rango de bytes [start, end) pintado con un color de fondo
+struct HexHighlight {
+    qint64 start = 0;
+    qint64 end = 0;
+    QColor color;
+};
+
+// Fuente de resaltados que HexEditorArea consulta solo para las líneas visibles
+class HexOverlay
+{
+public:
+    virtual ~HexOverlay() {}
+
+    // Appends every highlight intersecting [start, end) to 'out'.
+    virtual void query(qint64 start, qint64 end, QVector<HexHighlight> &out) const = 0;
+};
+
+#endif // HEXOVERLAY_H
@@ -0,0 +1,370 @@
+#include "minimap.h"
+#include "hexeditorarea.h"
+#include "perftrace.h"
+
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <QPainter>
+#include <QMouseEvent>
+#include <QScrollBar>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <algorithm>
+#include <cmath>
+
+const int MINIMAP_WIDTH = 28;
+const int UPDATE_DELAY_MS = 50;
+const qint64 BLOCKS_PER_TASK = 1024;
+const quint32 CACHE_MAGIC = 0x48544d4d;  // "HTMM"
+const quint32 CACHE_VERSION = 1;
+
+MinimapBlock MinimapPyramid::summarize(const uchar *data, qint64 size, const bool textBytes[256]) {
+    // c * log2(c) para cada recuento posible de un bloque
+    static const QVector<float> nLog2N = []() {
+        QVector<float> table(BLOCK_SIZE + 1, 0.0f);
+        for (int c = 1; c <= BLOCK_SIZE; ++c) table[c] = c * std::log2((float)c);
+        return table;
+    }();
+
+    MinimapBlock block;
+    if (size <= 0) return block;
+
+    // Cuatro tablas intercaladas para que los bytes repetidos no se pisen el contador
+    quint32 lanes[4][256] = {};
+    qint64 i = 0;
+    for (; i + 4 <= size; i += 4) {
+        ++lanes[0][data[i]];
+        ++lanes[1][data[i + 1]];
+        ++lanes[2][data[i + 2]];
+        ++lanes[3][data[i + 3]];
+    }
+    for (; i < size; ++i) {
+        ++lanes[0][data[i]];
+    }
+
+    float sum = 0;
+    quint32 text = 0;
+    for (int b = 0; b < 256; ++b) {
+        const quint32 count = lanes[0][b] + lanes[1][b] + lanes[2][b] + lanes[3][b];
+        sum += nLog2N[count];
+        if (textBytes[b]) text += count;
+        if (b == 0) block.zeros = (quint8)(count * 255 / size);
+    }
+    const float entropy = std::log2((float)size) - sum / size;
+    block.entropy = (quint8)std::max(0, std::min(255, (int)(entropy * 255 / 8 + 0.5f)));
+    block.text = (quint8)(text * 255 / size);
+    return block;
+}
+
+static MinimapBlock merge(const MinimapBlock *blocks, int count) {
+    int entropy = 0, zeros = 0, text = 0;
+    for (int i = 0; i < count; ++i) {
+        entropy += blocks[i].entropy;
+        zeros += blocks[i].zeros;
+        text += blocks[i].text;
+    }
+    MinimapBlock merged;
+    if (count > 0) {
+        merged.entropy = (quint8)(entropy / count);
+        merged.zeros = (quint8)(zeros / count);
+        merged.text = (quint8)(text / count);
+    }
+    return merged;
+}
+
+void MinimapPyramid::update(qint64 firstBlock, const QVector<MinimapBlock> &blocks, qint64 totalBlocks) {
+    if (m_levels.isEmpty()) m_levels.append(QVector<MinimapBlock>());
+
+    const bool resized = m_levels.first().size() != totalBlocks;
+    QVector<MinimapBlock> &base = m_levels.first();
+    base.resize((int)totalBlocks);
+    for (int i = 0; i < blocks.size() && firstBlock + i < totalBlocks; ++i) {
+        base[(int)(firstBlock + i)] = blocks.at(i);
+    }
+
+    // Solo se recalculan los padres de lo que ha cambiado (y la cola si cambió el tamaño)
+    qint64 dirtyFrom = firstBlock;
+    qint64 dirtyTo = resized ? totalBlocks : firstBlock + blocks.size();
+    int level = 0;
+    while (m_levels.at(level).size() > 1) {
+        if (m_levels.size() == level + 1) m_levels.append(QVector<MinimapBlock>());
+        const QVector<MinimapBlock> &below = m_levels.at(level);
+        QVector<MinimapBlock> &above = m_levels[level + 1];
+        if (resized) above.resize((below.size() + 1) / 2);
+
+        dirtyFrom >>= 1;
+        dirtyTo = (dirtyTo + 1) >> 1;
+        for (qint64 p = dirtyFrom; p < std::min(dirtyTo, (qint64)above.size()); ++p) {
+            const int child = (int)(p * 2);
+            above[(int)p] = merge(below.constData() + child, std::min(2, below.size() - child));
+        }
+        ++level;
+    }
+    m_levels.resize(level + 1);
+}
+
+MinimapBlock MinimapPyramid::summary(qint64 firstBlock, qint64 endBlock) const {
+    if (blockCount() == 0 || firstBlock >= endBlock) return MinimapBlock();
+
+    int level = 0;
+    while (level + 1 < m_levels.size() && (qint64(2) << level) <= endBlock - firstBlock) {
+        ++level;
+    }
+    const QVector<MinimapBlock> &row = m_levels.at(level);
+    const qint64 from = std::min((qint64)row.size() - 1, firstBlock >> level);
+    const qint64 to = std::min((qint64)row.size(), ((endBlock - 1) >> level) + 1);
+    return merge(row.constData() + from, (int)std::max((qint64)1, to - from));
+}
+
+MinimapWidget::MinimapWidget(QThreadPool *pool, QWidget *parent)
+    : QWidget(parent),
+      m_pool(pool)
+{
+    setFixedWidth(MINIMAP_WIDTH);
+    setCursor(Qt::PointingHandCursor);
+    setToolTip(tr("Green: text, dark: zeros, red: high entropy (compressed or encrypted), blue: other data."));
+
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(UPDATE_DELAY_MS);
+    connect(&m_updateTimer, &QTimer::timeout, this, &MinimapWidget::startUpdate);
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, &MinimapWidget::handleUpdateFinished);
+}
+
+MinimapWidget::~MinimapWidget() {
+    m_watcher.waitForFinished();
+}
+
+QSize MinimapWidget::sizeHint() const {
+    return QSize(MINIMAP_WIDTH, 200);
+}
+
+void MinimapWidget::setEditor(HexEditorArea *editor) {
+    if (m_editor == editor) return;
+    m_editor = editor;
+
+    if (editor && !m_states.contains(editor)) {
+        m_states.insert(editor, State());
+        connect(editor, &HexEditorArea::dataChanged, this, &MinimapWidget::scheduleUpdate);
+        connect(editor, &HexEditorArea::dataReplaced, this, &MinimapWidget::scheduleUpdate);
+        connect(editor, &HexEditorArea::charTableChanged, this, &MinimapWidget::scheduleUpdate);
+        connect(editor, &HexEditorArea::viewScrolled, this, static_cast<void (QWidget::*)()>(&QWidget::update));
+        connect(editor, &QObject::destroyed, this, [this, editor]() {
+            m_states.remove(editor);
+            if (m_jobEditor == editor) m_jobEditor = nullptr;
+        });
+    }
+    scheduleUpdate();
+    update();
+}
+
+bool MinimapWidget::saveCache(HexEditorArea *editor, const QString &path, const FileStamp &stamp) const {
+    auto it = m_states.constFind(editor);
+    if (it == m_states.constEnd() || it->textKey.isEmpty()) return false;
+    if (!editor->buffer().isSameVersion(it->snapshot)) return false;
+
+    const QVector<MinimapBlock> blocks = it->pyramid.blocks();
+    QByteArray packed(blocks.size() * 3, Qt::Uninitialized);
+    for (int i = 0; i < blocks.size(); ++i) {
+        packed[i * 3] = char(blocks.at(i).entropy);
+        packed[i * 3 + 1] = char(blocks.at(i).zeros);
+        packed[i * 3 + 2] = char(blocks.at(i).text);
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    QDataStream out(&file);
+    out << CACHE_MAGIC << CACHE_VERSION << stamp.size << stamp.modified << qint64(MinimapPyramid::BLOCK_SIZE)
+        << it->textKey << packed;
+    return out.status() == QDataStream::Ok;
+}
+
+bool MinimapWidget::restoreCache(HexEditorArea *editor, const QString &path, const FileStamp &stamp) {
+    auto it = m_states.find(editor);
+    QFile file(path);
+    if (it == m_states.end() || !file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    FileStamp cached;
+    qint64 blockSize = 0;
+    QByteArray textKey;
+    QByteArray packed;
+    in >> magic >> version >> cached.size >> cached.modified >> blockSize >> textKey >> packed;
+    const qint64 totalBlocks = (editor->dataSize() + MinimapPyramid::BLOCK_SIZE - 1) / MinimapPyramid::BLOCK_SIZE;
+    if (in.status() != QDataStream::Ok || magic != CACHE_MAGIC || version != CACHE_VERSION || cached != stamp
+        || blockSize != MinimapPyramid::BLOCK_SIZE || packed.size() != totalBlocks * 3) {
+        return false;
+    }
+
+    QVector<MinimapBlock> blocks((int)totalBlocks);
+    for (int i = 0; i < blocks.size(); ++i) {
+        blocks[i].entropy = quint8(packed.at(i * 3));
+        blocks[i].zeros = quint8(packed.at(i * 3 + 1));
+        blocks[i].text = quint8(packed.at(i * 3 + 2));
+    }
+    // Como si acabara de calcularse sobre el buffer actual: startUpdate() no tendrá nada que hacer
+    it->pyramid = MinimapPyramid();
+    it->pyramid.update(0, blocks, totalBlocks);
+    it->snapshot = editor->buffer().snapshot();
+    it->textKey = textKey;
+    if (editor == m_editor) update();
+    return true;
+}
+
+void MinimapWidget::scheduleUpdate() {
+    m_updateTimer.start();
+}
+
+QByteArray MinimapWidget::textKeyFor(const HexEditorArea *editor) {
+    QByteArray key(256, '0');
+    const CharTablePtr table = editor->charTable();
+    for (int i = 0; i < 256; ++i) {
+        if (table ? table->map[i] != "." : (i >= 0x20 && i < 0x7F)) key[i] = '1';
+    }
+    return key;
+}
+
+void MinimapWidget::startUpdate() {
+    if (!m_editor || m_watcher.isRunning()) return; // handleUpdateFinished() comes back here
+
+    const State &state = m_states[m_editor];
+    const QByteArray key = textKeyFor(m_editor);
+    const bool full = key != state.textKey;
+    if (!full && m_editor->buffer().isSameVersion(state.snapshot)) {
+        return;
+    }
+
+    m_jobEditor = m_editor;
+    const PieceTable data = m_editor->buffer().snapshot();
+    const PieceTable previous = state.snapshot;
+    QThreadPool *pool = m_pool;
+    m_watcher.setFuture(QtConcurrent::run(m_pool, [previous, data, key, full, pool]() {
+        return compute(previous, data, key, full, pool);
+    }));
+}
+
+MinimapWidget::Result MinimapWidget::compute(const PieceTable &previous, const PieceTable &data,
+                                             const QByteArray &textKey, bool full, QThreadPool *pool) {
+    HT_PROFILE_SCOPE("minimap");
+    const qint64 blockSize = MinimapPyramid::BLOCK_SIZE;
+    Result result;
+    result.data = data;
+    result.textKey = textKey;
+
+    const qint64 size = data.size();
+    result.totalBlocks = (size + blockSize - 1) / blockSize;
+
+    // Solo los bloques que cambiaron desde la última vez, según los tramos de las dos versiones
+    qint64 from = 0;
+    qint64 to = size;
+    if (!full) {
+        from = std::min(size, data.firstDifference(previous));
+        if (previous.size() == size) {
+            to = size - std::min(size - from, data.commonSuffix(previous));
+        }
+    }
+    result.firstBlock = from / blockSize;
+    const qint64 endBlock = to > from ? std::min(result.totalBlocks, (to + blockSize - 1) / blockSize) : result.firstBlock;
+    HT_PROFILE_BYTES((endBlock - result.firstBlock) * blockSize);
+
+    bool textBytes[256];
+    for (int i = 0; i < 256; ++i) {
+        textBytes[i] = textKey.at(i) == '1';
+    }
+
+    result.blocks.resize((int)(endBlock - result.firstBlock));
+    MinimapBlock *out = result.blocks.data();
+    auto summarizeRange = [&](qint64 first, qint64 last) {
+        const qint64 start = first * blockSize;
+        const QByteArray chunk = data.read(start, std::min(size, last * blockSize) - start);
+        const uchar *bytes = reinterpret_cast<const uchar *>(chunk.constData());
+        for (qint64 b = first; b < last; ++b) {
+            const qint64 offset = b * blockSize - start;
+            out[b - result.firstBlock] = MinimapPyramid::summarize(bytes + offset, std::min(blockSize, chunk.size() - offset), textBytes);
+        }
+    };
+
+    // Trozos en paralelo; el primero se hace aquí mismo
+    QVector<QFuture<void>> futures;
+    for (qint64 first = result.firstBlock + BLOCKS_PER_TASK; first < endBlock; first += BLOCKS_PER_TASK) {
+        const qint64 last = std::min(endBlock, first + BLOCKS_PER_TASK);
+        futures.append(QtConcurrent::run(pool, [&summarizeRange, first, last]() { summarizeRange(first, last); }));
+    }
+    summarizeRange(result.firstBlock, std::min(endBlock, result.firstBlock + BLOCKS_PER_TASK));
+    for (QFuture<void> &future : futures) {
+        future.waitForFinished();
+    }
+    return result;
+}
+
+void MinimapWidget::handleUpdateFinished() {
+    const Result result = m_watcher.result();
+    auto it = m_states.find(m_jobEditor);
+    if (m_jobEditor && it != m_states.end()) {
+        it->pyramid.update(result.firstBlock, result.blocks, result.totalBlocks);
+        it->snapshot = result.data;
+        it->textKey = result.textKey;
+    }
+    m_jobEditor = nullptr;
+    update();
+    startUpdate(); // Catch up with edits made while this one ran
+}
+
+static QColor colorFor(const MinimapBlock &block) {
+    if (block.zeros > 230) return QColor(24, 24, 24);                                   // Relleno
+    if (block.text > 217 && block.entropy < 204) return QColor(50, 110 + block.text / 3, 60); // Texto
+    if (block.entropy > 230) return QColor(210, 40 + (255 - block.entropy) * 2, 40);     // Comprimido o cifrado
+    const int value = 50 + block.entropy * 2 / 3;
+    return QColor(value / 2, value / 2 + 10, value);                                      // Otros datos
+}
+
+void MinimapWidget::paintEvent(QPaintEvent *event) {
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(40, 40, 40));
+    if (!m_editor) return;
+
+    auto it = m_states.constFind(m_editor);
+    if (it == m_states.constEnd() || it->pyramid.blockCount() == 0) return;
+
+    const MinimapPyramid &pyramid = it->pyramid;
+    const qint64 blocks = pyramid.blockCount();
+    const int h = height();
+    for (int y = 0; y < h; ++y) {
+        const qint64 first = y * blocks / h;
+        const qint64 end = std::max(first + 1, (y + 1) * blocks / h);
+        painter.setPen(colorFor(pyramid.summary(first, end)));
+        painter.drawLine(0, y, width() - 1, y);
+    }
+
+    // Zona visible en el editor
+    const qint64 size = m_editor->dataSize();
+    if (size > 0) {
+        const qint64 top = m_editor->topOffset();
+        const int y0 = (int)(top * h / size);
+        const int y1 = std::max(y0 + 2, (int)((top + m_editor->visibleByteCount()) * h / size));
+        painter.setPen(QColor(255, 255, 255, 200));
+        painter.setBrush(QColor(255, 255, 255, 40));
+        painter.drawRect(0, y0, width() - 1, std::min(y1, h - 1) - y0);
+    }
+}
+
+void MinimapWidget::jumpTo(int y) {
+    if (!m_editor || height() <= 0) return;
+    const qint64 size = m_editor->dataSize();
+    const qint64 offset = std::max((qint64)0, std::min(size - 1, (qint64)y * size / height()));
+    m_editor->goToOffset(offset);
+    m_editor->setTopOffset(std::max((qint64)0, offset - m_editor->visibleByteCount() / 2));
+}
+
+void MinimapWidget::mousePressEvent(QMouseEvent *event) {
+    if (event->button() == Qt::LeftButton) jumpTo(event->pos().y());
+}
+
+void MinimapWidget::mouseMoveEvent(QMouseEvent *event) {
+    if (event->buttons() & Qt::LeftButton) jumpTo(event->pos().y());
+}
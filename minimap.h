@@ -0,0 +1,97 @@
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <QWidget>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QPointer>
+#include <QFutureWatcher>
+#include <QTimer>
+
+#include "session.h"
+#include "piecetable.h"
+
+class HexEditorArea;
+class QThreadPool;
+
+// Resumen de un bloque: entropía y proporción de ceros y de texto, escaladas a 0-255
+struct MinimapBlock {
+    quint8 entropy = 0;     // 255 = 8 bits per byte
+    quint8 zeros = 0;
+    quint8 text = 0;
+};
+
+// Per-block summaries plus coarser levels that each merge pairs of the level below
+class MinimapPyramid
+{
+public:
+    static const qint64 BLOCK_SIZE = 1024;
+
+    static MinimapBlock summarize(const uchar *data, qint64 size, const bool textBytes[256]);
+
+    qint64 blockCount() const { return m_levels.isEmpty() ? 0 : m_levels.first().size(); }
+    QVector<MinimapBlock> blocks() const { return m_levels.isEmpty() ? QVector<MinimapBlock>() : m_levels.first(); }
+    // Replaces the blocks from 'firstBlock' on and resizes the map to 'totalBlocks'.
+    void update(qint64 firstBlock, const QVector<MinimapBlock> &blocks, qint64 totalBlocks);
+    // Summary of blocks [firstBlock, endBlock), read from the coarsest level that fits.
+    MinimapBlock summary(qint64 firstBlock, qint64 endBlock) const;
+
+private:
+    QVector<QVector<MinimapBlock>> m_levels;
+};
+
+// Barra vertical junto al editor con el mapa de todo el fichero; un clic salta a esa zona
+class MinimapWidget : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit MinimapWidget(QThreadPool *pool, QWidget *parent = nullptr);
+    ~MinimapWidget() override;
+
+    void setEditor(HexEditorArea *editor);
+    QSize sizeHint() const override;
+
+    // The summaries of 'editor' on disk, tagged with the stamp of the file they were computed from.
+    // Saving fails unless they describe the current buffer; restoring, unless 'stamp' matches.
+    bool saveCache(HexEditorArea *editor, const QString &path, const FileStamp &stamp) const;
+    bool restoreCache(HexEditorArea *editor, const QString &path, const FileStamp &stamp);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private slots:
+    void scheduleUpdate();
+    void startUpdate();
+    void handleUpdateFinished();
+
+private:
+    struct Result {
+        PieceTable data;
+        QByteArray textKey;
+        qint64 firstBlock = 0;
+        qint64 totalBlocks = 0;
+        QVector<MinimapBlock> blocks;
+    };
+    struct State {
+        PieceTable snapshot;    // Buffer the pyramid describes
+        QByteArray textKey;     // Which bytes counted as text
+        MinimapPyramid pyramid;
+    };
+
+    static QByteArray textKeyFor(const HexEditorArea *editor);
+    static Result compute(const PieceTable &previous, const PieceTable &data, const QByteArray &textKey,
+                          bool full, QThreadPool *pool);
+    void jumpTo(int y);
+
+    QThreadPool *m_pool;
+    QPointer<HexEditorArea> m_editor;
+    QHash<HexEditorArea *, State> m_states;
+    HexEditorArea *m_jobEditor = nullptr;
+    QFutureWatcher<Result> m_watcher;
+    QTimer m_updateTimer;
+};
+
+#endif // MINIMAP_H
@@ -0,0 +1,679 @@
+#include "patchengine.h"
+#include "bindiff.h"
+
+#include <QIODevice>
+#include <QFile>
+#include <QFileInfo>
+#include <QByteArray>
+#include <QVector>
+#include <QCoreApplication>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const qint64 IPS_MAX_OFFSET = 0xFFFFFF;
+const qint64 IPS_EOF_OFFSET = 0x454F46;     // "EOF" can't be used as a record offset
+const qint64 IPS_MAX_RECORD = 0xFFFE;
+const qint64 IPS_MIN_RLE = 9;               // Shorter runs are cheaper as literals
+const qint64 FOOTER_SIZE = 12;              // UPS/BPS: source, target and patch CRC-32
+const qint64 BPS_COMPARE_BLOCK = 1 << 22;   // Same-size diff, compared and written 4 MB at a time
+
+enum BpsAction {
+    SourceRead = 0,
+    TargetRead = 1,
+    SourceCopy = 2,
+    TargetCopy = 3
+};
+
+QString tr(const char *text) {
+    return QCoreApplication::translate("PatchEngine", text);
+}
+
+struct Crc32Tables {
+    quint32 t[8][256];
+
+    Crc32Tables() {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            t[0][i] = c;
+        }
+        for (int s = 1; s < 8; ++s) {
+            for (int i = 0; i < 256; ++i) {
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+const Crc32Tables &crcTables() {
+    static const Crc32Tables tables;
+    return tables;
+}
+
+quint32 read32le(const uchar *p) {
+    return (quint32)p[0] | ((quint32)p[1] << 8) | ((quint32)p[2] << 16) | ((quint32)p[3] << 24);
+}
+
+bool readVlq(const uchar *patch, qint64 end, qint64 &pos, quint64 &value) {
+    quint64 data = 0;
+    quint64 shift = 1;
+    for (;;) {
+        if (pos >= end || shift > (Q_UINT64_C(1) << 56)) return false;
+        quint8 x = patch[pos++];
+        data += (x & 0x7F) * shift;
+        if (x & 0x80) break;
+        shift <<= 7;
+        data += shift;
+    }
+    value = data;
+    return true;
+}
+
+// Buffered output that keeps a running CRC of everything written
+class PatchWriter
+{
+public:
+    explicit PatchWriter(QIODevice *device) : m_device(device) {
+        m_buffer.reserve(BufferSize);
+    }
+
+    void put(quint8 byte) {
+        m_buffer.append((char)byte);
+        if (m_buffer.size() >= BufferSize) flush();
+    }
+
+    void write(const uchar *data, qint64 size) {
+        while (size > 0) {
+            int n = (int)std::min(size, (qint64)(BufferSize - m_buffer.size()));
+            m_buffer.append(reinterpret_cast<const char *>(data), n);
+            data += n;
+            size -= n;
+            if (m_buffer.size() >= BufferSize) flush();
+        }
+    }
+
+    void write(const char *text) {
+        write(reinterpret_cast<const uchar *>(text), (qint64)strlen(text));
+    }
+
+    void writeVlq(quint64 data) {
+        for (;;) {
+            quint8 x = data & 0x7F;
+            data >>= 7;
+            if (data == 0) {
+                put(0x80 | x);
+                break;
+            }
+            put(x);
+            data--;
+        }
+    }
+
+    void write32le(quint32 v) {
+        put(v & 0xFF);
+        put((v >> 8) & 0xFF);
+        put((v >> 16) & 0xFF);
+        put((v >> 24) & 0xFF);
+    }
+
+    void write24be(quint32 v) {
+        put((v >> 16) & 0xFF);
+        put((v >> 8) & 0xFF);
+        put(v & 0xFF);
+    }
+
+    void write16be(quint32 v) {
+        put((v >> 8) & 0xFF);
+        put(v & 0xFF);
+    }
+
+    bool flush() {
+        if (m_buffer.isEmpty()) return m_ok;
+        m_crc = PatchEngine::crc32(reinterpret_cast<const uchar *>(m_buffer.constData()), m_buffer.size(), m_crc);
+        if (m_device->write(m_buffer) != m_buffer.size()) {
+            m_ok = false;
+        }
+        m_buffer.clear();
+        return m_ok;
+    }
+
+    quint32 crc() {
+        flush();
+        return m_crc;
+    }
+
+private:
+    static const int BufferSize = 1 << 16;
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    quint32 m_crc = 0;
+    bool m_ok = true;
+};
+
+void writeIpsLiteral(PatchWriter &w, const uchar *target, qint64 start, qint64 end) {
+    if (start == IPS_EOF_OFFSET) {
+        --start;
+    }
+    w.write24be((quint32)start);
+    w.write16be((quint32)(end - start));
+    w.write(target + start, end - start);
+}
+
+void writeIpsRun(PatchWriter &w, const uchar *target, qint64 start, qint64 length) {
+    if (start == IPS_EOF_OFFSET) {
+        writeIpsLiteral(w, target, start, start + 1);
+        ++start;
+        --length;
+    }
+    w.write24be((quint32)start);
+    w.write16be(0);
+    w.write16be((quint32)length);
+    w.put(target[start]);
+}
+
+qint64 runLength(const uchar *target, qint64 start, qint64 end, qint64 limit) {
+    qint64 r = start + 1;
+    while (r < end && r - start < limit && target[r] == target[start]) {
+        ++r;
+    }
+    return r - start;
+}
+
+// Emits target[start, end) as literal and RLE records
+void writeIpsRange(PatchWriter &w, const uchar *target, qint64 start, qint64 end) {
+    while (start < end) {
+        qint64 run = runLength(target, start, end, IPS_MAX_RECORD);
+        if (run >= IPS_MIN_RLE) {
+            writeIpsRun(w, target, start, run);
+            start += run;
+            continue;
+        }
+
+        qint64 literalEnd = start;
+        while (literalEnd < end && literalEnd - start < IPS_MAX_RECORD - 1) {
+            if (runLength(target, literalEnd, end, IPS_MIN_RLE) >= IPS_MIN_RLE) break;
+            ++literalEnd;
+        }
+        writeIpsLiteral(w, target, start, literalEnd);
+        start = literalEnd;
+    }
+}
+
+bool createIps(const uchar *source, qint64 sourceSize, const uchar *target, qint64 targetSize,
+               PatchWriter &w, QString *error) {
+    if (targetSize > IPS_MAX_OFFSET + 1) {
+        if (error) *error = tr("IPS patches can't address files larger than 16 MB. Use UPS or BPS instead.");
+        return false;
+    }
+
+    w.write("PATCH");
+    qint64 common = std::min(sourceSize, targetSize);
+    // A record header costs 5 bytes, so merging closer differences saves space
+    QVector<DiffRange> ranges = BinDiff::compareBlock(source, target, 0, common, 6);
+    for (const DiffRange &r : ranges) {
+        writeIpsRange(w, target, r.aStart, r.aStart + r.aLength);
+    }
+    if (targetSize > sourceSize) {
+        writeIpsRange(w, target, sourceSize, targetSize);
+    }
+    w.write("EOF");
+    if (targetSize < sourceSize) {
+        w.write24be((quint32)targetSize);
+    }
+    return w.flush();
+}
+
+bool createUps(const uchar *source, qint64 sourceSize, const uchar *target, qint64 targetSize,
+               PatchWriter &w) {
+    w.write("UPS1");
+    w.writeVlq(sourceSize);
+    w.writeVlq(targetSize);
+
+    const qint64 common = std::min(sourceSize, targetSize);
+    const qint64 maxSize = std::max(sourceSize, targetSize);
+    auto xorAt = [&](qint64 i) -> quint8 {
+        quint8 a = i < sourceSize ? source[i] : 0;
+        quint8 b = i < targetSize ? target[i] : 0;
+        return a ^ b;
+    };
+
+    qint64 relative = 0;
+    qint64 offset = 0;
+    while (offset < maxSize) {
+        if (offset < common) {
+            qint64 same = BinDiff::firstDifference(source + offset, target + offset, common - offset);
+            relative += same;
+            offset += same;
+            if (same > 0) continue;
+        }
+        if (xorAt(offset) == 0) {
+            ++relative;
+            ++offset;
+            continue;
+        }
+
+        w.writeVlq(relative);
+        relative = 0;
+        for (;;) {
+            quint8 x = xorAt(offset++);
+            w.put(x);
+            if (x == 0) break;
+        }
+    }
+
+    w.write32le(PatchEngine::crc32(source, sourceSize));
+    w.write32le(PatchEngine::crc32(target, targetSize));
+    w.write32le(w.crc());
+    return w.flush();
+}
+
+bool createBps(const uchar *source, qint64 sourceSize, const uchar *target, qint64 targetSize,
+               PatchWriter &w) {
+    w.write("BPS1");
+    w.writeVlq(sourceSize);
+    w.writeVlq(targetSize);
+    w.writeVlq(0); // No metadata
+
+    qint64 sourceRelative = 0;
+    auto copyEqual = [&](qint64 aPos, qint64 bPos, qint64 length) {
+        if (length <= 0) return;
+        if (aPos == bPos) {
+            w.writeVlq(((quint64)(length - 1) << 2) | SourceRead);
+            return;
+        }
+        w.writeVlq(((quint64)(length - 1) << 2) | SourceCopy);
+        qint64 relative = aPos - sourceRelative;
+        w.writeVlq(((quint64)(relative < 0 ? -relative : relative) << 1) | (relative < 0 ? 1 : 0));
+        sourceRelative = aPos + length;
+    };
+
+    // Las diferencias se escriben según llegan; nunca se guardan todas a la vez
+    qint64 aPos = 0;
+    qint64 bPos = 0;
+    auto writeRanges = [&](const QVector<DiffRange> &ranges) {
+        for (const DiffRange &r : ranges) {
+            copyEqual(aPos, bPos, r.bStart - bPos);
+            if (r.bLength > 0) {
+                w.writeVlq(((quint64)(r.bLength - 1) << 2) | TargetRead);
+                w.write(target + r.bStart, r.bLength);
+            }
+            aPos = r.aStart + r.aLength;
+            bPos = r.bStart + r.bLength;
+        }
+    };
+    if (sourceSize == targetSize) {
+        for (qint64 from = 0; from < sourceSize; from += BPS_COMPARE_BLOCK) {
+            writeRanges(BinDiff::compareBlock(source, target, from, std::min(sourceSize, from + BPS_COMPARE_BLOCK), 4));
+        }
+    } else {
+        BinDiff::alignedDiff(source, sourceSize, target, targetSize,
+                             [&writeRanges](const QVector<DiffRange> &batch, qint64) {
+                                 writeRanges(batch);
+                                 return true;
+                             });
+    }
+    copyEqual(aPos, bPos, targetSize - bPos);
+
+    w.write32le(PatchEngine::crc32(source, sourceSize));
+    w.write32le(PatchEngine::crc32(target, targetSize));
+    w.write32le(w.crc());
+    return w.flush();
+}
+
+bool checkFooter(const uchar *patch, qint64 patchSize, const uchar *source, qint64 sourceSize, QString *error) {
+    if (patchSize < FOOTER_SIZE + 4) {
+        if (error) *error = tr("The patch is truncated.");
+        return false;
+    }
+    if (PatchEngine::crc32(patch, patchSize - 4) != read32le(patch + patchSize - 4)) {
+        if (error) *error = tr("The patch is corrupted (patch CRC mismatch).");
+        return false;
+    }
+    if (PatchEngine::crc32(source, sourceSize) != read32le(patch + patchSize - FOOTER_SIZE)) {
+        if (error) *error = tr("The patch was made for a different source file (source CRC mismatch).");
+        return false;
+    }
+    return true;
+}
+
+bool checkTargetCrc(const uchar *patch, qint64 patchSize, const uchar *target, qint64 targetLength, QString *error) {
+    if (PatchEngine::crc32(target, targetLength) != read32le(patch + patchSize - 8)) {
+        if (error) *error = tr("The patched output doesn't match the expected result (target CRC mismatch).");
+        return false;
+    }
+    return true;
+}
+
+bool applyIps(const uchar *patch, qint64 patchSize, const uchar *source, qint64 sourceSize,
+              uchar *target, qint64 targetLength, QString *error) {
+    memcpy(target, source, std::min(sourceSize, targetLength));
+    if (targetLength > sourceSize) {
+        memset(target + sourceSize, 0, targetLength - sourceSize);
+    }
+
+    qint64 pos = 5;
+    while (pos + 3 <= patchSize) {
+        if (memcmp(patch + pos, "EOF", 3) == 0) return true;
+        if (pos + 5 > patchSize) break;
+
+        qint64 offset = ((qint64)patch[pos] << 16) | ((qint64)patch[pos + 1] << 8) | patch[pos + 2];
+        qint64 size = ((qint64)patch[pos + 3] << 8) | patch[pos + 4];
+        pos += 5;
+
+        if (size == 0) {
+            if (pos + 3 > patchSize) break;
+            qint64 length = ((qint64)patch[pos] << 8) | patch[pos + 1];
+            quint8 value = patch[pos + 2];
+            pos += 3;
+            qint64 end = std::min(offset + length, targetLength);
+            if (offset < end) memset(target + offset, value, end - offset);
+        } else {
+            if (pos + size > patchSize) break;
+            qint64 end = std::min(offset + size, targetLength);
+            if (offset < end) memcpy(target + offset, patch + pos, end - offset);
+            pos += size;
+        }
+    }
+
+    if (error) *error = tr("The patch is truncated.");
+    return false;
+}
+
+bool applyUps(const uchar *patch, qint64 patchSize, const uchar *source, qint64 sourceSize,
+              uchar *target, qint64 targetLength, QString *error) {
+    if (!checkFooter(patch, patchSize, source, sourceSize, error)) return false;
+
+    const qint64 end = patchSize - FOOTER_SIZE;
+    qint64 pos = 4;
+    quint64 declaredSource, declaredTarget;
+    if (!readVlq(patch, end, pos, declaredSource) || !readVlq(patch, end, pos, declaredTarget)) {
+        if (error) *error = tr("The patch is truncated.");
+        return false;
+    }
+
+    memcpy(target, source, std::min(sourceSize, targetLength));
+    if (targetLength > sourceSize) {
+        memset(target + sourceSize, 0, targetLength - sourceSize);
+    }
+
+    // Past the shorter file the XOR data runs to the end of the longer one, and no further
+    const qint64 limit = std::max(sourceSize, targetLength);
+    qint64 out = 0;
+    while (pos < end) {
+        quint64 relative;
+        if (!readVlq(patch, end, pos, relative)) break;
+        if (relative > quint64(std::max<qint64>(0, limit - out))) {
+            if (error) *error = tr("The patch writes past the end of the output.");
+            return false;
+        }
+        out += (qint64)relative;
+        for (;;) {
+            if (pos >= end) {
+                if (error) *error = tr("The patch is truncated.");
+                return false;
+            }
+            quint8 x = patch[pos++];
+            if (out < targetLength) target[out] ^= x;
+            ++out;
+            if (x == 0) break;
+        }
+    }
+
+    return checkTargetCrc(patch, patchSize, target, targetLength, error);
+}
+
+bool applyBps(const uchar *patch, qint64 patchSize, const uchar *source, qint64 sourceSize,
+              uchar *target, qint64 targetLength, QString *error) {
+    if (!checkFooter(patch, patchSize, source, sourceSize, error)) return false;
+
+    const qint64 end = patchSize - FOOTER_SIZE;
+    qint64 pos = 4;
+    quint64 declaredSource, declaredTarget, metadataSize;
+    if (!readVlq(patch, end, pos, declaredSource) || !readVlq(patch, end, pos, declaredTarget)
+        || !readVlq(patch, end, pos, metadataSize)) {
+        if (error) *error = tr("The patch is truncated.");
+        return false;
+    }
+    // Los VLQ llegan a 64 bits: sin comprobar, saltar los metadatos podría dejar pos fuera del parche
+    if (metadataSize > quint64(end - pos)) {
+        if (error) *error = tr("The patch is truncated.");
+        return false;
+    }
+    pos += (qint64)metadataSize;
+
+    qint64 out = 0;
+    qint64 sourceRelative = 0;
+    qint64 targetRelative = 0;
+    while (pos < end) {
+        quint64 data;
+        if (!readVlq(patch, end, pos, data)) break;
+        qint64 length = (qint64)(data >> 2) + 1;
+        int action = data & 3;
+
+        if (out + length > targetLength) {
+            if (error) *error = tr("The patch writes past the end of the output.");
+            return false;
+        }
+
+        if (action == SourceRead) {
+            if (out + length > sourceSize) break;
+            memcpy(target + out, source + out, length);
+            out += length;
+        } else if (action == TargetRead) {
+            if (pos + length > end) break;
+            memcpy(target + out, patch + pos, length);
+            pos += length;
+            out += length;
+        } else {
+            quint64 encoded;
+            if (!readVlq(patch, end, pos, encoded)) break;
+            qint64 delta = (qint64)(encoded >> 1);
+            if (encoded & 1) delta = -delta;
+
+            if (action == SourceCopy) {
+                sourceRelative += delta;
+                if (sourceRelative < 0 || sourceRelative + length > sourceSize) break;
+                memcpy(target + out, source + sourceRelative, length);
+                sourceRelative += length;
+                out += length;
+            } else {
+                targetRelative += delta;
+                if (targetRelative < 0 || targetRelative >= out) break;
+                // Byte by byte: the copy may overlap the bytes it is producing
+                for (qint64 i = 0; i < length; ++i) {
+                    target[out++] = target[targetRelative++];
+                }
+            }
+        }
+    }
+
+    if (pos != end || out != targetLength) {
+        if (error) *error = tr("The patch is corrupted.");
+        return false;
+    }
+    return checkTargetCrc(patch, patchSize, target, targetLength, error);
+}
+
+}
+
+namespace PatchEngine {
+
+Format formatForFileName(const QString &fileName) {
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "ips") return IpsFormat;
+    if (suffix == "ups") return UpsFormat;
+    if (suffix == "bps") return BpsFormat;
+    return UnknownFormat;
+}
+
+Format detectFormat(const uchar *patch, qint64 patchSize) {
+    if (patchSize >= 8 && memcmp(patch, "PATCH", 5) == 0) return IpsFormat;
+    if (patchSize >= 4 + FOOTER_SIZE && memcmp(patch, "UPS1", 4) == 0) return UpsFormat;
+    if (patchSize >= 4 + FOOTER_SIZE && memcmp(patch, "BPS1", 4) == 0) return BpsFormat;
+    return UnknownFormat;
+}
+
+quint32 crc32(const uchar *data, qint64 size, quint32 crc) {
+    const Crc32Tables &tables = crcTables();
+    crc = ~crc;
+    while (size >= 8) {
+        quint32 lo = crc ^ read32le(data);
+        quint32 hi = read32le(data + 4);
+        crc = tables.t[7][lo & 0xFF] ^ tables.t[6][(lo >> 8) & 0xFF]
+            ^ tables.t[5][(lo >> 16) & 0xFF] ^ tables.t[4][lo >> 24]
+            ^ tables.t[3][hi & 0xFF] ^ tables.t[2][(hi >> 8) & 0xFF]
+            ^ tables.t[1][(hi >> 16) & 0xFF] ^ tables.t[0][hi >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = tables.t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+bool createPatch(Format format, const uchar *source, qint64 sourceSize,
+                 const uchar *target, qint64 targetSize, QIODevice *out, QString *error) {
+    PatchWriter writer(out);
+    bool ok = false;
+    switch (format) {
+    case IpsFormat:
+        ok = createIps(source, sourceSize, target, targetSize, writer, error);
+        break;
+    case UpsFormat:
+        ok = createUps(source, sourceSize, target, targetSize, writer);
+        break;
+    case BpsFormat:
+        ok = createBps(source, sourceSize, target, targetSize, writer);
+        break;
+    default:
+        if (error) *error = tr("Unknown patch format.");
+        return false;
+    }
+    if (!ok && error && error->isEmpty()) {
+        *error = out->errorString();
+    }
+    return ok;
+}
+
+qint64 targetSize(const uchar *patch, qint64 patchSize, qint64 sourceSize, QString *error) {
+    Format format = detectFormat(patch, patchSize);
+    if (format == IpsFormat) {
+        // Only record headers are read; the payloads are skipped
+        qint64 size = sourceSize;
+        qint64 pos = 5;
+        while (pos + 3 <= patchSize) {
+            if (memcmp(patch + pos, "EOF", 3) == 0) {
+                if (pos + 6 <= patchSize) {
+                    size = ((qint64)patch[pos + 3] << 16) | ((qint64)patch[pos + 4] << 8) | patch[pos + 5];
+                }
+                return size;
+            }
+            if (pos + 5 > patchSize) break;
+            qint64 offset = ((qint64)patch[pos] << 16) | ((qint64)patch[pos + 1] << 8) | patch[pos + 2];
+            qint64 length = ((qint64)patch[pos + 3] << 8) | patch[pos + 4];
+            pos += 5;
+            if (length == 0) {
+                if (pos + 2 > patchSize) break;
+                length = ((qint64)patch[pos] << 8) | patch[pos + 1];
+                pos += 3;
+            } else {
+                pos += length;
+            }
+            size = std::max(size, offset + length);
+        }
+        if (error) *error = tr("The patch is truncated.");
+        return -1;
+    }
+
+    if (format == UpsFormat || format == BpsFormat) {
+        qint64 pos = 4;
+        quint64 declaredSource, declaredTarget;
+        if (!readVlq(patch, patchSize - FOOTER_SIZE, pos, declaredSource)
+            || !readVlq(patch, patchSize - FOOTER_SIZE, pos, declaredTarget)) {
+            if (error) *error = tr("The patch is truncated.");
+            return -1;
+        }
+        if (declaredTarget > quint64(std::numeric_limits<qint64>::max())) {
+            if (error) *error = tr("The patch is corrupted.");
+            return -1;
+        }
+        if ((qint64)declaredSource != sourceSize) {
+            if (error) *error = tr("The patch expects a source of %1 bytes, but this one has %2.")
+                                    .arg(declaredSource).arg(sourceSize);
+            return -1;
+        }
+        return (qint64)declaredTarget;
+    }
+
+    if (error) *error = tr("Unknown patch format.");
+    return -1;
+}
+
+bool applyPatch(const uchar *patch, qint64 patchSize, const uchar *source, qint64 sourceSize,
+                uchar *target, qint64 targetLength, QString *error) {
+    switch (detectFormat(patch, patchSize)) {
+    case IpsFormat:
+        return applyIps(patch, patchSize, source, sourceSize, target, targetLength, error);
+    case UpsFormat:
+        return applyUps(patch, patchSize, source, sourceSize, target, targetLength, error);
+    case BpsFormat:
+        return applyBps(patch, patchSize, source, sourceSize, target, targetLength, error);
+    default:
+        if (error) *error = tr("Unknown patch format.");
+        return false;
+    }
+}
+
+bool applyPatchFile(const QString &patchPath, const QString &sourcePath, const QString &outputPath, QString *error) {
+    if (QFileInfo(sourcePath).canonicalFilePath() == QFileInfo(outputPath).canonicalFilePath()) {
+        if (error) *error = tr("The output file must be different from the source file.");
+        return false;
+    }
+
+    static const uchar empty = 0;
+    QFile patchFile(patchPath);
+    QFile sourceFile(sourcePath);
+    if (!patchFile.open(QIODevice::ReadOnly) || !sourceFile.open(QIODevice::ReadOnly)) {
+        if (error) *error = tr("Could not open the input files.");
+        return false;
+    }
+
+    const uchar *patch = patchFile.size() > 0 ? patchFile.map(0, patchFile.size()) : &empty;
+    const uchar *source = sourceFile.size() > 0 ? sourceFile.map(0, sourceFile.size()) : &empty;
+    if (!patch || !source) {
+        if (error) *error = tr("Could not map the input files into memory.");
+        return false;
+    }
+
+    qint64 size = targetSize(patch, patchFile.size(), sourceFile.size(), error);
+    if (size < 0) return false;
+
+    QFile outputFile(outputPath);
+    if (!outputFile.open(QIODevice::ReadWrite | QIODevice::Truncate) || !outputFile.resize(size)) {
+        if (error) *error = outputFile.errorString();
+        return false;
+    }
+
+    uchar scratch = 0;
+    uchar *target = size > 0 ? outputFile.map(0, size) : &scratch;
+    if (!target) {
+        if (error) *error = tr("Could not map the output file into memory.");
+        return false;
+    }
+
+    bool ok = applyPatch(patch, patchFile.size(), source, sourceFile.size(), target, size, error);
+    if (size > 0) outputFile.unmap(target);
+    outputFile.close();
+    if (!ok) {
+        QFile::remove(outputPath);
+    }
+    return ok;
+}
+
+}
@@ -0,0 +1,41 @@
+#ifndef PATCHENGINE_H
+#define PATCHENGINE_H
+
+#include <QtGlobal>
+#include <QString>
+
+class QIODevice;
+
+// Creación y aplicación de parches IPS, UPS y BPS sobre buffers en memoria o mapeados
+namespace PatchEngine {
+
+enum Format {
+    UnknownFormat,
+    IpsFormat,
+    UpsFormat,
+    BpsFormat
+};
+
+Format formatForFileName(const QString &fileName);
+Format detectFormat(const uchar *patch, qint64 patchSize);
+
+// Standard (zlib) CRC-32, slice-by-8. Pass the previous value to continue a running CRC.
+quint32 crc32(const uchar *data, qint64 size, quint32 crc = 0);
+
+// Writes a patch turning 'source' into 'target'. The output is streamed to 'out'.
+bool createPatch(Format format, const uchar *source, qint64 sourceSize,
+                 const uchar *target, qint64 targetSize, QIODevice *out, QString *error);
+
+// Size of the output produced by applying 'patch' to a source of 'sourceSize' bytes, or -1.
+qint64 targetSize(const uchar *patch, qint64 patchSize, qint64 sourceSize, QString *error);
+
+// Applies 'patch'; 'target' must hold targetSize() bytes and must not overlap 'source'.
+bool applyPatch(const uchar *patch, qint64 patchSize, const uchar *source, qint64 sourceSize,
+                uchar *target, qint64 targetLength, QString *error);
+
+// File to file application over memory-mapped inputs and output (constant memory).
+bool applyPatchFile(const QString &patchPath, const QString &sourcePath, const QString &outputPath, QString *error);
+
+}
+
+#endif // PATCHENGINE_H
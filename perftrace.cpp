@@ -0,0 +1,212 @@
+#include "perftrace.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QThread>
+#include <QFile>
+#include <QByteArray>
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <cstring>
+
+namespace {
+
+const int MAX_EVENTS = 1 << 17;        // Ring buffer: only the most recent events are kept
+const char FRAME_SCOPE[] = "paintEvent";
+
+struct TraceEvent {
+    const char *name;
+    qint64 start;
+    qint64 duration;    // -1 for counter samples
+    qint64 value;       // Bytes for scopes, the sample for counters
+    quint64 thread;
+};
+
+struct ScopeStats {
+    qint64 lastDuration = 0;
+    qint64 lastBytes = 0;
+};
+
+struct TraceState {
+    QElapsedTimer clock;
+    QMutex mutex;
+    QVector<TraceEvent> events;
+    int next = 0;
+    bool wrapped = false;
+    QHash<const char *, ScopeStats> stats;
+    const char *lastScan = nullptr;
+    QMap<QByteArray, qint64> counters;
+    QAtomicInt overlay;
+
+    TraceState() { clock.start(); }
+
+    void append(const TraceEvent &e) {
+        if (events.isEmpty()) {
+            events.resize(MAX_EVENTS);
+        }
+        events[next] = e;
+        if (++next == MAX_EVENTS) {
+            next = 0;
+            wrapped = true;
+        }
+    }
+};
+
+TraceState &state() {
+    static TraceState s;
+    return s;
+}
+
+quint64 currentThread() {
+    return (quint64)(quintptr)QThread::currentThreadId();
+}
+
+QString formatBytes(qint64 bytes) {
+    if (bytes >= 1 << 20) return QString::number(bytes / 1048576.0, 'f', 1) + " MB";
+    if (bytes >= 1 << 10) return QString::number(bytes / 1024.0, 'f', 1) + " KB";
+    return QString::number(bytes) + " B";
+}
+
+void appendJsonString(QByteArray &out, const char *text) {
+    out += '"';
+    for (const char *p = text; *p; ++p) {
+        if (*p == '"' || *p == '\\') out += '\\';
+        out += *p;
+    }
+    out += '"';
+}
+
+}
+
+namespace PerfTrace {
+
+qint64 now() {
+    return state().clock.nsecsElapsed();
+}
+
+void record(const char *name, qint64 start, qint64 duration, qint64 bytes) {
+    TraceState &s = state();
+    TraceEvent e = { name, start, duration, bytes, currentThread() };
+    QMutexLocker locker(&s.mutex);
+    s.append(e);
+    ScopeStats &stats = s.stats[name];
+    stats.lastDuration = duration;
+    stats.lastBytes = bytes;
+    if (bytes > 0 && strcmp(name, FRAME_SCOPE) != 0) {
+        s.lastScan = name;
+    }
+}
+
+void setCounter(const char *name, qint64 value) {
+    TraceState &s = state();
+    TraceEvent e = { name, now(), -1, value, currentThread() };
+    QMutexLocker locker(&s.mutex);
+    s.append(e);
+    s.counters[QByteArray(name)] = value;
+}
+
+void clear() {
+    TraceState &s = state();
+    QMutexLocker locker(&s.mutex);
+    s.next = 0;
+    s.wrapped = false;
+    s.stats.clear();
+    s.lastScan = nullptr;
+    s.counters.clear();
+}
+
+void setOverlayEnabled(bool enabled) {
+    state().overlay.storeRelease(enabled ? 1 : 0);
+}
+
+bool overlayEnabled() {
+    return state().overlay.loadAcquire() != 0;
+}
+
+QStringList overlayLines() {
+    TraceState &s = state();
+    QMutexLocker locker(&s.mutex);
+    QStringList lines;
+
+    for (auto it = s.stats.constBegin(); it != s.stats.constEnd(); ++it) {
+        if (strcmp(it.key(), FRAME_SCOPE) == 0) {
+            lines.append(QCoreApplication::translate("PerfTrace", "Frame: %1 ms")
+                             .arg(it.value().lastDuration / 1e6, 0, 'f', 2));
+            break;
+        }
+    }
+
+    if (s.lastScan) {
+        const ScopeStats &scan = s.stats.value(s.lastScan);
+        double seconds = qMax(scan.lastDuration, (qint64)1) / 1e9;
+        lines.append(QCoreApplication::translate("PerfTrace", "%1: %2/s (%3 in %4 ms)")
+                         .arg(QString::fromLatin1(s.lastScan))
+                         .arg(formatBytes((qint64)(scan.lastBytes / seconds)))
+                         .arg(formatBytes(scan.lastBytes))
+                         .arg(scan.lastDuration / 1e6, 0, 'f', 1));
+    }
+
+    for (auto it = s.counters.constBegin(); it != s.counters.constEnd(); ++it) {
+        lines.append(QString("%1: %2").arg(QString::fromLatin1(it.key())).arg(formatBytes(it.value())));
+    }
+    return lines;
+}
+
+bool exportChromeTrace(const QString &filePath, QString *error) {
+    QVector<TraceEvent> events;
+    {
+        TraceState &s = state();
+        QMutexLocker locker(&s.mutex);
+        if (s.wrapped) {
+            events = s.events.mid(s.next) + s.events.mid(0, s.next);
+        } else {
+            events = s.events.mid(0, s.next);
+        }
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QByteArray out;
+    out.reserve(1 << 16);
+    out += "{\"traceEvents\":[\n";
+    for (int i = 0; i < events.size(); ++i) {
+        const TraceEvent &e = events.at(i);
+        if (i > 0) out += ",\n";
+        out += "{\"name\":";
+        appendJsonString(out, e.name);
+        out += ",\"pid\":1,\"tid\":" + QByteArray::number(e.thread);
+        out += ",\"ts\":" + QByteArray::number(e.start / 1000.0, 'f', 3);
+        if (e.duration < 0) {
+            out += ",\"ph\":\"C\",\"args\":{\"bytes\":" + QByteArray::number(e.value) + "}}";
+        } else {
+            out += ",\"ph\":\"X\",\"dur\":" + QByteArray::number(e.duration / 1000.0, 'f', 3);
+            if (e.value > 0) {
+                out += ",\"args\":{\"bytes\":" + QByteArray::number(e.value) + "}";
+            }
+            out += '}';
+        }
+        if (out.size() > (1 << 16) - 256) {
+            if (file.write(out) != out.size()) {
+                if (error) *error = file.errorString();
+                return false;
+            }
+            out.clear();
+        }
+    }
+    out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    if (file.write(out) != out.size()) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+}
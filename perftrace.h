@@ -0,0 +1,56 @@
+#ifndef PERFTRACE_H
+#define PERFTRACE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+
+// Medición de tiempos por ámbito. Solo se compila con -DHEXANDTABLER_PROFILING=ON;
+// sin esa opción las macros no generan código.
+namespace PerfTrace {
+
+// Nanoseconds since the first call.
+qint64 now();
+
+void record(const char *name, qint64 start, qint64 duration, qint64 bytes);
+void setCounter(const char *name, qint64 value);
+void clear();
+
+void setOverlayEnabled(bool enabled);
+bool overlayEnabled();
+// Frame time, last scan throughput and counters, one line each.
+QStringList overlayLines();
+
+// Writes the recorded events in Chrome trace format (chrome://tracing, Perfetto).
+bool exportChromeTrace(const QString &filePath, QString *error);
+
+class Scope
+{
+public:
+    explicit Scope(const char *name) : m_name(name), m_start(now()) {}
+    ~Scope() { record(m_name, m_start, now() - m_start, m_bytes); }
+
+    // Bytes processed inside the scope, shown as throughput.
+    void setBytes(qint64 bytes) { m_bytes = bytes; }
+
+private:
+    Q_DISABLE_COPY(Scope)
+    const char *m_name;
+    qint64 m_start;
+    qint64 m_bytes = 0;
+};
+
+}
+
+#ifdef HEXANDTABLER_PROFILING
+#define HT_PROFILE_SCOPE(name) PerfTrace::Scope htProfileScope(name)
+#define HT_PROFILE_BYTES(bytes) htProfileScope.setBytes(bytes)
+#define HT_PROFILE_COUNTER(name, value) PerfTrace::setCounter(name, value)
+#else
+// sizeof: the arguments count as used, so nothing warns, but they are never evaluated
+#define HT_PROFILE_SCOPE(name) do { } while (false)
+#define HT_PROFILE_BYTES(bytes) do { (void)sizeof(bytes); } while (false)
+#define HT_PROFILE_COUNTER(name, value) do { (void)sizeof(value); } while (false)
+#endif
+
+#endif // PERFTRACE_H
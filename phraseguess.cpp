@@ -0,0 +1,248 @@
+#include "phraseguess.h"
+#include "perftrace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+// A character of the phrase: its slot among the session's characters and where it appears
+struct PhraseEntry {
+    int slot;
+    QList<int> positions;
+};
+
+// Whether the phrase fits at 'bytes' on top of 'base' (a byte per slot, -1 while unmapped),
+// whose bytes belong to the slots in 'owner'. 'out' gets the combined mapping.
+bool matchAt(const uchar *bytes, const QVector<PhraseEntry> &entries, const short *base, const short *owner,
+             int width, short *out) {
+    memcpy(out, base, width * sizeof(short));
+    for (int e = 0; e < entries.size(); ++e) {
+        const PhraseEntry &entry = entries.at(e);
+        const quint8 byteValue = bytes[entry.positions.first()];
+
+        // Same character, same byte (A-A check)
+        for (int p : entry.positions) {
+            if (bytes[p] != byteValue) return false;
+        }
+        // Character-to-byte and byte-to-character conflicts, with the base and within the phrase
+        if (out[entry.slot] >= 0 && out[entry.slot] != byteValue) return false;
+        if (owner[byteValue] >= 0 && owner[byteValue] != entry.slot) return false;
+        for (int f = 0; f < e; ++f) {
+            if (out[entries.at(f).slot] == byteValue) return false;
+        }
+        out[entry.slot] = byteValue;
+    }
+    return true;
+}
+
+// Candidates with the same mapping extend identically, so only the first one of each is kept
+void removeDuplicates(QByteArray &mappings, QVector<qint64> &offsets, int width, int offsetsPer) {
+    const int count = width > 0 ? int(mappings.size() / width) : 0;
+    if (count < 2) return;
+
+    const char *m = mappings.constData();
+    QVector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [m, width](int x, int y) {
+        return memcmp(m + qint64(x) * width, m + qint64(y) * width, width) < 0;
+    });
+    QVector<bool> keep(count, false);
+    for (int i = 0; i < count; ++i) {
+        keep[order[i]] = i == 0 || memcmp(m + qint64(order[i]) * width, m + qint64(order[i - 1]) * width, width) != 0;
+    }
+
+    char *out = mappings.data();
+    int kept = 0;
+    for (int i = 0; i < count; ++i) {
+        if (!keep[i]) continue;
+        if (kept != i) {
+            memmove(out + qint64(kept) * width, out + qint64(i) * width, width);
+            std::copy(offsets.constBegin() + i * offsetsPer, offsets.constBegin() + (i + 1) * offsetsPer,
+                      offsets.begin() + kept * offsetsPer);
+        }
+        ++kept;
+    }
+    mappings.resize(kept * width);
+    offsets.resize(kept * offsetsPer);
+}
+
+}
+
+PhraseGuessSession::PhraseGuessSession(const PieceTable &buffer, qint64 start, qint64 end)
+    : m_buffer(buffer),
+      m_start(std::max((qint64)0, start)),
+      m_end(std::min(buffer.size() - 1, end)),
+      m_byteCounts(256, 0)
+{
+}
+
+void PhraseGuessSession::loadRange() {
+    // Solo el rango, y en el hilo que hace la primera búsqueda
+    if (!m_data.isNull() || m_end < m_start) return;
+    m_data = m_buffer.read(m_start, m_end - m_start + 1);
+    for (char byte : qAsConst(m_data)) {
+        ++m_byteCounts[uchar(byte)];
+    }
+}
+
+bool PhraseGuessSession::covers(const PieceTable &buffer, qint64 start, qint64 end) const {
+    return buffer.isSameVersion(m_buffer) && start == m_start && end == m_end;
+}
+
+int PhraseGuessSession::candidateCount() const {
+    return m_characters.isEmpty() ? 0 : int(m_mappingBytes.size() / m_characters.size());
+}
+
+QMap<QChar, quint8> PhraseGuessSession::mapping(int candidate) const {
+    QMap<QChar, quint8> result;
+    const int width = m_characters.size();
+    for (int c = 0; c < width; ++c) {
+        result.insert(m_characters.at(c), quint8(m_mappingBytes.at(candidate * width + c)));
+    }
+    return result;
+}
+
+qint64 PhraseGuessSession::offset(int candidate, int phrase) const {
+    return m_offsets.at(candidate * m_phrases.size() + phrase);
+}
+
+QList<QMap<QChar, quint8>> PhraseGuessSession::mappings(int limit) const {
+    const int count = limit < 0 ? candidateCount() : std::min(limit, candidateCount());
+    QList<QMap<QChar, quint8>> result;
+    result.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        result.append(mapping(i));
+    }
+    return result;
+}
+
+const QVector<qint64> &PhraseGuessSession::occurrences(quint8 byte) {
+    auto it = m_occurrenceCache.find(byte);
+    if (it != m_occurrenceCache.end()) return it.value();
+
+    QVector<qint64> positions;
+    positions.reserve(m_byteCounts[byte]);
+    const char *bytes = m_data.constData();
+    const char *p = bytes;
+    const char *end = bytes + m_data.size();
+    while ((p = static_cast<const char *>(memchr(p, byte, end - p))) != nullptr) {
+        positions.append(m_start + (p - bytes));
+        ++p;
+    }
+    return m_occurrenceCache.insert(byte, positions).value();
+}
+
+bool PhraseGuessSession::addPhrase(const KnownPhrase &phrase, const QAtomicInt *cancel) {
+    HT_PROFILE_SCOPE("guessEncoding");
+    const int oldWidth = m_characters.size();
+    const int oldCount = candidateCount();
+    const int oldPhrases = m_phrases.size();
+
+    // The phrase's characters join the list, which stays in order; old slots move to their new place
+    QString characters = m_characters;
+    for (auto it = phrase.pattern.constBegin(); it != phrase.pattern.constEnd(); ++it) {
+        if (!characters.contains(it.key())) characters.append(it.key());
+    }
+    std::sort(characters.begin(), characters.end());
+    const int width = characters.size();
+    QVector<int> newSlot(oldWidth);
+    for (int c = 0; c < oldWidth; ++c) {
+        newSlot[c] = characters.indexOf(m_characters.at(c));
+    }
+    QVector<PhraseEntry> entries;
+    for (auto it = phrase.pattern.constBegin(); it != phrase.pattern.constEnd(); ++it) {
+        entries.append(PhraseEntry{characters.indexOf(it.key()), it.value()});
+    }
+
+    loadRange();
+    // m_data starts at m_start; positions stay absolute
+    const uchar *range = reinterpret_cast<const uchar *>(m_data.constData());
+    QVector<short> base(width), out(width);
+    short owner[256];
+    QByteArray mappings;
+    QVector<qint64> offsets;
+    auto fits = [&](qint64 pos) { return pos >= m_start && pos + phrase.length - 1 <= m_end; };
+    auto cancelled = [cancel]() { return cancel && cancel->loadAcquire(); };
+    auto append = [&](qint64 pos, const qint64 *previous) {
+        for (int c = 0; c < width; ++c) mappings.append(char(out[c]));
+        for (int p = 0; p < oldPhrases; ++p) offsets.append(previous[p]);
+        offsets.append(pos);
+    };
+    // Every place where the phrase fits on its own, one per distinct mapping
+    auto scanRange = [&](QByteArray &found, QVector<qint64> &foundOffsets) {
+        HT_PROFILE_BYTES(m_end - m_start + 1);
+        const QVector<short> none(width, -1);
+        short noOwner[256];
+        std::fill(noOwner, noOwner + 256, -1);
+        QVector<short> own(width);
+        for (qint64 pos = m_start; fits(pos); ++pos) {
+            if ((pos & 0xFFFF) == 0 && cancelled()) return false;
+            if (matchAt(range + (pos - m_start), entries, none.constData(), noOwner, width, own.data())) {
+                for (int c = 0; c < width; ++c) found.append(char(own[c]));
+                foundOffsets.append(pos);
+            }
+        }
+        removeDuplicates(found, foundOffsets, width, 1);
+        return true;
+    };
+
+    const bool valid = !entries.isEmpty() && phrase.length > 0 && m_end - m_start + 1 >= phrase.length;
+    if (valid && oldPhrases == 0) {
+        if (!scanRange(mappings, offsets)) return false;
+    } else if (valid) {
+        QVector<qint64> unanchored;     // Full scan of the phrase on its own, only if some candidate needs it
+        bool scanned = false;
+
+        for (int i = 0; i < oldCount; ++i) {
+            if (cancelled()) return false;
+            std::fill(base.begin(), base.end(), -1);
+            std::fill(owner, owner + 256, -1);
+            for (int c = 0; c < oldWidth; ++c) {
+                const uchar byteValue = uchar(m_mappingBytes.at(i * oldWidth + c));
+                base[newSlot[c]] = byteValue;
+                owner[byteValue] = newSlot[c];
+            }
+            const qint64 *previous = m_offsets.constData() + i * oldPhrases;
+
+            // El carácter ya asignado con el byte menos frecuente decide dónde mirar
+            const PhraseEntry *anchor = nullptr;
+            for (const PhraseEntry &entry : entries) {
+                if (base[entry.slot] < 0) continue;
+                if (!anchor || m_byteCounts[base[entry.slot]] < m_byteCounts[base[anchor->slot]]) {
+                    anchor = &entry;
+                }
+            }
+
+            if (anchor) {
+                const int anchorPos = anchor->positions.first();
+                for (qint64 occurrence : occurrences(quint8(base[anchor->slot]))) {
+                    const qint64 pos = occurrence - anchorPos;
+                    if (fits(pos) && matchAt(range + (pos - m_start), entries, base.constData(), owner, width, out.data())) {
+                        append(pos, previous);
+                    }
+                }
+            } else {
+                // No shared characters: combine with the phrase's own matches
+                if (!scanned) {
+                    QByteArray own;
+                    if (!scanRange(own, unanchored)) return false;
+                    scanned = true;
+                }
+                for (qint64 pos : unanchored) {
+                    if (matchAt(range + (pos - m_start), entries, base.constData(), owner, width, out.data())) {
+                        append(pos, previous);
+                    }
+                }
+            }
+        }
+        removeDuplicates(mappings, offsets, width, oldPhrases + 1);
+    }
+
+    m_phrases.append(phrase.text);
+    m_characters = characters;
+    m_mappingBytes = mappings;
+    m_offsets = offsets;
+    return true;
+}
@@ -0,0 +1,70 @@
+#ifndef PHRASEGUESS_H
+#define PHRASEGUESS_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include <QVector>
+#include <QChar>
+#include <QAtomicInt>
+
+#include "piecetable.h"
+
+// Estructura para manejar frases conocidas
+struct KnownPhrase {
+    QString text;
+    int length = 0;
+    QMap<QChar, QList<int>> pattern;
+};
+
+// Candidatos de "adivinar codificación" que se conservan entre ejecuciones: cada frase nueva
+// solo se comprueba contra los candidatos que ya existen, no contra todo el rango.
+class PhraseGuessSession
+{
+public:
+    // 'buffer' should be a snapshot(): the range is read from it by the first addPhrase()
+    PhraseGuessSession(const PieceTable &buffer, qint64 start, qint64 end);
+
+    // Whether this session was built over this very version of the buffer and range
+    bool covers(const PieceTable &buffer, qint64 start, qint64 end) const;
+
+    qint64 start() const { return m_start; }
+    qint64 end() const { return m_end; }
+    const QStringList &phrases() const { return m_phrases; }
+
+    // Mappings consistent with every phrase added so far; all of them map the same characters
+    const QString &characters() const { return m_characters; }
+    int candidateCount() const;
+    QMap<QChar, quint8> mapping(int candidate) const;
+    // Where the candidate found phrases().at(phrase)
+    qint64 offset(int candidate, int phrase) const;
+    // The first 'limit' candidates, all of them if negative
+    QList<QMap<QChar, quint8>> mappings(int limit = -1) const;
+
+    // The first phrase scans the whole range; later ones only extend the current candidates.
+    // Returns false, leaving the session as it was, when 'cancel' was set.
+    bool addPhrase(const KnownPhrase &phrase, const QAtomicInt *cancel = nullptr);
+
+private:
+    const QVector<qint64> &occurrences(quint8 byte);
+    void loadRange();
+
+    PieceTable m_buffer;
+    QByteArray m_data;  // Bytes [m_start, m_end] only, once loaded
+    qint64 m_start;
+    qint64 m_end;       // Inclusive
+    QStringList m_phrases;
+    QString m_characters;                           // In QChar order, as a QMap would list them
+    // A short first phrase matches almost anywhere, so candidates are kept flat: candidate i maps
+    // m_characters[c] to m_mappingBytes[i * m_characters.size() + c] and found phrase p at
+    // m_offsets[i * m_phrases.size() + p]
+    QByteArray m_mappingBytes;
+    QVector<qint64> m_offsets;
+    QVector<qint64> m_byteCounts;                   // Over the range, to pick the rarest anchor byte
+    QHash<int, QVector<qint64>> m_occurrenceCache;  // Built on demand, per byte value
+};
+
+#endif // PHRASEGUESS_H
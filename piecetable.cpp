@@ -0,0 +1,295 @@
+#include "piecetable.h"
+
+#include <QAtomicInt>
+#include <cstring>
+#include <algorithm>
+
+// Un tramo de uno de los dos buffers; total y count resumen todo su subárbol
+struct PieceTable::Node {
+    NodePtr left;
+    NodePtr right;
+    qint64 offset = 0;
+    qint64 length = 0;
+    qint64 total = 0;
+    int count = 0;
+    quint32 priority = 0;
+    bool added = false;     // Append buffer instead of the original
+};
+
+namespace {
+
+quint32 nextPriority() {
+    // xorshift: only needs to look random to keep the treap balanced
+    static quint32 state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+int newLineage() {
+    static QAtomicInt next(0);
+    return next.fetchAndAddRelaxed(1) + 1;
+}
+
+}
+
+PieceTable::PieceTable()
+    : m_added(new QByteArray),
+      m_lineage(newLineage())
+{
+}
+
+PieceTable::PieceTable(const QByteArray &original)
+    : m_original(original),
+      m_added(new QByteArray),
+      m_lineage(newLineage())
+{
+    if (!original.isEmpty()) {
+        m_root = makeLeaf(false, 0, original.size());
+    }
+}
+
+qint64 PieceTable::size() const {
+    return total(m_root);
+}
+
+int PieceTable::pieceCount() const {
+    return m_root ? m_root->count : 0;
+}
+
+qint64 PieceTable::total(const NodePtr &node) {
+    return node ? node->total : 0;
+}
+
+PieceTable::NodePtr PieceTable::makeNode(const NodePtr &left, const NodePtr &right, const Node &piece) {
+    QSharedPointer<Node> node = QSharedPointer<Node>::create();
+    node->left = left;
+    node->right = right;
+    node->offset = piece.offset;
+    node->length = piece.length;
+    node->priority = piece.priority;
+    node->added = piece.added;
+    node->total = total(left) + piece.length + total(right);
+    node->count = (left ? left->count : 0) + 1 + (right ? right->count : 0);
+    return node;
+}
+
+PieceTable::NodePtr PieceTable::makeLeaf(bool added, qint64 offset, qint64 length) {
+    Node piece;
+    piece.added = added;
+    piece.offset = offset;
+    piece.length = length;
+    piece.priority = nextPriority();
+    return makeNode(NodePtr(), NodePtr(), piece);
+}
+
+PieceTable::Split PieceTable::split(const NodePtr &node, qint64 pos) {
+    Split result;
+    if (!node) return result;
+    const qint64 leftTotal = total(node->left);
+    if (pos <= leftTotal) {
+        Split sub = split(node->left, pos);
+        result.left = sub.left;
+        result.right = makeNode(sub.right, node->right, *node);
+    } else if (pos >= leftTotal + node->length) {
+        Split sub = split(node->right, pos - leftTotal - node->length);
+        result.left = makeNode(node->left, sub.left, *node);
+        result.right = sub.right;
+    } else {
+        // El corte cae dentro de este tramo: queda partido en dos con la misma prioridad
+        const qint64 cut = pos - leftTotal;
+        Node head = *node;
+        head.length = cut;
+        Node tail = *node;
+        tail.offset += cut;
+        tail.length -= cut;
+        result.left = makeNode(node->left, NodePtr(), head);
+        result.right = makeNode(NodePtr(), node->right, tail);
+    }
+    return result;
+}
+
+PieceTable::NodePtr PieceTable::merge(const NodePtr &a, const NodePtr &b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (a->priority > b->priority) {
+        return makeNode(a->left, merge(a->right, b), *a);
+    }
+    return makeNode(merge(a, b->left), b->right, *b);
+}
+
+PieceTable::NodePtr PieceTable::growLast(const NodePtr &node, qint64 extra) {
+    if (node->right) {
+        return makeNode(node->left, growLast(node->right, extra), *node);
+    }
+    Node piece = *node;
+    piece.length += extra;
+    return makeNode(node->left, NodePtr(), piece);
+}
+
+const char *PieceTable::source(const Node &piece) const {
+    return (piece.added ? m_added->constData() : m_original.constData()) + piece.offset;
+}
+
+char PieceTable::at(qint64 pos) const {
+    const Node *node = m_root.data();
+    while (node) {
+        const qint64 leftTotal = total(node->left);
+        if (pos < leftTotal) {
+            node = node->left.data();
+        } else if (pos < leftTotal + node->length) {
+            return source(*node)[pos - leftTotal];
+        } else {
+            pos -= leftTotal + node->length;
+            node = node->right.data();
+        }
+    }
+    return 0;
+}
+
+void PieceTable::copyRange(const NodePtr &node, qint64 from, qint64 to, char *out) const {
+    // [from, to) relativo a este subárbol; solo se baja por las ramas que lo tocan
+    if (!node || from >= to) return;
+    const qint64 leftTotal = total(node->left);
+    const qint64 pieceEnd = leftTotal + node->length;
+    if (from < leftTotal) {
+        copyRange(node->left, from, std::min(to, leftTotal), out);
+    }
+    const qint64 begin = std::max(from, leftTotal);
+    const qint64 end = std::min(to, pieceEnd);
+    if (begin < end) {
+        memcpy(out + (begin - from), source(*node) + (begin - leftTotal), end - begin);
+    }
+    if (to > pieceEnd) {
+        const qint64 skip = std::max(from, pieceEnd);
+        copyRange(node->right, skip - pieceEnd, to - pieceEnd, out + (skip - from));
+    }
+}
+
+void PieceTable::read(qint64 pos, qint64 length, char *out) const {
+    copyRange(m_root, pos, pos + length, out);
+}
+
+QByteArray PieceTable::read(qint64 pos, qint64 length) const {
+    pos = std::max<qint64>(0, std::min(pos, size()));
+    length = std::max<qint64>(0, std::min(length, size() - pos));
+    QByteArray bytes(int(length), Qt::Uninitialized);
+    read(pos, length, bytes.data());
+    return bytes;
+}
+
+QByteArray PieceTable::toByteArray() const {
+    if (m_root && m_root->count == 1 && !m_root->added && m_root->offset == 0 && m_root->length == m_original.size()) {
+        return m_original;
+    }
+    return read(0, size());
+}
+
+PieceTable PieceTable::snapshot() const {
+    // Un QByteArray propio que comparte los datos: el primer append de este lado los separa
+    PieceTable copy(*this);
+    copy.m_added.reset(new QByteArray(*m_added));
+    return copy;
+}
+
+void PieceTable::collectPieces(const NodePtr &node, QVector<const Node *> &out) {
+    if (!node) return;
+    collectPieces(node->left, out);
+    out.append(node.data());
+    collectPieces(node->right, out);
+}
+
+qint64 PieceTable::sharedBytes(const PieceTable &other, bool fromEnd) const {
+    if (m_lineage != other.m_lineage) return 0;
+    if (m_root == other.m_root) return size();
+
+    // Same buffer and same offset in it means same bytes, even where one piece was split or grown
+    QVector<const Node *> a, b;
+    collectPieces(m_root, a);
+    collectPieces(other.m_root, b);
+    if (fromEnd) {
+        std::reverse(a.begin(), a.end());
+        std::reverse(b.begin(), b.end());
+    }
+    qint64 shared = 0;
+    qint64 usedA = 0;   // Bytes of a[i] already matched, from the side being walked
+    qint64 usedB = 0;
+    int i = 0;
+    int j = 0;
+    while (i < a.size() && j < b.size()) {
+        const Node *x = a.at(i);
+        const Node *y = b.at(j);
+        const qint64 atX = fromEnd ? x->offset + x->length - usedA : x->offset + usedA;
+        const qint64 atY = fromEnd ? y->offset + y->length - usedB : y->offset + usedB;
+        if (x->added != y->added || atX != atY) break;
+        const qint64 step = std::min(x->length - usedA, y->length - usedB);
+        shared += step;
+        usedA += step;
+        usedB += step;
+        if (usedA == x->length) { ++i; usedA = 0; }
+        if (usedB == y->length) { ++j; usedB = 0; }
+    }
+    return shared;
+}
+
+void PieceTable::addNodes(const Node *node, QSet<const void *> *seen, qint64 *bytes) {
+    // Un nodo ya contado comparte también todo su subárbol
+    if (!node || seen->contains(node)) return;
+    seen->insert(node);
+    *bytes += sizeof(Node);
+    addNodes(node->left.data(), seen, bytes);
+    addNodes(node->right.data(), seen, bytes);
+}
+
+void PieceTable::addFootprint(QSet<const void *> *seen, qint64 *bytes) const {
+    if (!m_original.isEmpty() && !seen->contains(m_original.constData())) {
+        seen->insert(m_original.constData());
+        *bytes += m_original.size();
+    }
+    if (!m_added->isEmpty() && !seen->contains(m_added->constData())) {
+        seen->insert(m_added->constData());
+        *bytes += m_added->capacity();
+    }
+    addNodes(m_root.data(), seen, bytes);
+}
+
+qint64 PieceTable::firstDifference(const PieceTable &other) const {
+    return sharedBytes(other, false);
+}
+
+qint64 PieceTable::commonSuffix(const PieceTable &other) const {
+    return sharedBytes(other, true);
+}
+
+void PieceTable::insert(qint64 pos, const QByteArray &bytes) {
+    if (bytes.isEmpty()) return;
+    pos = std::max<qint64>(0, std::min(pos, size()));
+    const qint64 addedStart = m_added->size();
+    m_added->append(bytes);
+
+    Split parts = split(m_root, pos);
+    // Escribir seguido alarga el último tramo en lugar de crear uno por tecla
+    const Node *last = parts.left.data();
+    while (last && last->right) last = last->right.data();
+    if (last && last->added && last->offset + last->length == addedStart) {
+        parts.left = growLast(parts.left, bytes.size());
+    } else {
+        parts.left = merge(parts.left, makeLeaf(true, addedStart, bytes.size()));
+    }
+    m_root = merge(parts.left, parts.right);
+}
+
+void PieceTable::remove(qint64 pos, qint64 length) {
+    pos = std::max<qint64>(0, std::min(pos, size()));
+    length = std::min(length, size() - pos);
+    if (length <= 0) return;
+    Split head = split(m_root, pos);
+    Split tail = split(head.right, length);
+    m_root = merge(head.left, tail.right);
+}
+
+void PieceTable::replace(qint64 pos, qint64 length, const QByteArray &bytes) {
+    remove(pos, length);
+    insert(pos, bytes);
+}
@@ -0,0 +1,80 @@
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QVector>
+#include <QSet>
+
+// Buffer editable by pieces: the original bytes plus an append-only buffer of everything typed or
+// pasted. The pieces live in a treap keyed by position, so reading a byte, inserting and removing
+// are O(log n) whatever the file size.
+//
+// Nodes are never modified once built: every edit returns a new root that shares all the untouched
+// subtrees with the previous one. Copying a PieceTable is O(1), which is what makes it cheap to
+// keep one per undo step. Copies share the append buffer too, so use them from one thread only and
+// hand workers a snapshot().
+class PieceTable
+{
+public:
+    PieceTable();
+    explicit PieceTable(const QByteArray &original);
+
+    qint64 size() const;
+    bool isEmpty() const { return size() == 0; }
+    int pieceCount() const;
+
+    char at(qint64 pos) const;
+    // Copies [pos, pos + length) into 'out'; the range must be inside the buffer
+    void read(qint64 pos, qint64 length, char *out) const;
+    QByteArray read(qint64 pos, qint64 length) const;
+    // Whole buffer; free while nothing has been edited since it was built
+    QByteArray toByteArray() const;
+
+    void insert(qint64 pos, const QByteArray &bytes);
+    void remove(qint64 pos, qint64 length);
+    void replace(qint64 pos, qint64 length, const QByteArray &bytes);
+
+    // True when both are the same version (one is an unedited copy of the other)
+    bool isSameVersion(const PieceTable &other) const { return m_root == other.m_root; }
+
+    // Copy with its own handle on the append buffer, safe to read from another thread while this
+    // one keeps being edited. The next edit here copies the append buffer once, never the file.
+    PieceTable snapshot() const;
+    // Judged by the pieces alone, without reading bytes: a position at or before the first byte
+    // that differs from 'other', and a count of trailing bytes known to be equal (it may overlap
+    // the head when one buffer is a prefix of the other). Versions of different buffers give 0.
+    qint64 firstDifference(const PieceTable &other) const;
+    qint64 commonSuffix(const PieceTable &other) const;
+
+    // Adds to 'bytes' the memory of this version not already in 'seen' (buffers and tree nodes),
+    // and marks it seen: run over several versions, it counts what they share once.
+    void addFootprint(QSet<const void *> *seen, qint64 *bytes) const;
+
+private:
+    struct Node;
+    typedef QSharedPointer<const Node> NodePtr;
+    struct Split {
+        NodePtr left;
+        NodePtr right;
+    };
+
+    static NodePtr makeNode(const NodePtr &left, const NodePtr &right, const Node &piece);
+    static NodePtr makeLeaf(bool added, qint64 offset, qint64 length);
+    static qint64 total(const NodePtr &node);
+    static Split split(const NodePtr &node, qint64 pos);
+    static NodePtr merge(const NodePtr &a, const NodePtr &b);
+    static NodePtr growLast(const NodePtr &node, qint64 extra);
+    static void collectPieces(const NodePtr &node, QVector<const Node *> &out);
+    static void addNodes(const Node *node, QSet<const void *> *seen, qint64 *bytes);
+    qint64 sharedBytes(const PieceTable &other, bool fromEnd) const;
+    void copyRange(const NodePtr &node, qint64 from, qint64 to, char *out) const;
+    const char *source(const Node &piece) const;
+
+    QByteArray m_original;
+    QSharedPointer<QByteArray> m_added;
+    NodePtr m_root;
+    int m_lineage;      // Shared by every version grown from the same original
+};
+
+#endif // PIECETABLE_H
@@ -0,0 +1,142 @@
+#include "pointerscan.h"
+
+#include <QThreadPool>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const qint64 CANCEL_CHECK_BYTES = 1 << 20;
+const int MAX_TABLES = 10000;
+
+struct ScanContext {
+    const uchar *data;
+    qint64 size;
+    PointerFormat format;
+    std::vector<quint64> isStart;   // Bitmap built from the sorted index, for O(1) lookups
+    const QVector<qint64> *starts;
+    int minCount;
+    const QAtomicInt *cancel;
+
+    // Target of the pointer stored at 'p', or -1 if it doesn't land on a string start
+    qint64 target(qint64 p) const {
+        if (p < 0 || p + format.width > size) return -1;
+        qint64 t = format.base + PointerScan::readWord(data + p, format.width, format.bigEndian);
+        if (t < 0 || t >= size) return -1;
+        return (isStart[t >> 6] >> (t & 63)) & 1 ? t : -1;
+    }
+};
+
+// Tables whose first pointer lies in [from, to); a run may extend past 'to'
+QVector<PointerTable> scanChunk(const ScanContext *ctx, qint64 from, qint64 to) {
+    QVector<PointerTable> found;
+    const int width = ctx->format.width;
+
+    for (qint64 p = from; p < to; ++p) {
+        if (ctx->cancel && (p & (CANCEL_CHECK_BYTES - 1)) == 0 && ctx->cancel->loadAcquire()) break;
+
+        qint64 t = ctx->target(p);
+        if (t < 0) continue;
+        qint64 previous = ctx->target(p - width);
+        if (previous >= 0 && previous <= t) continue; // Not the first pointer of its run
+
+        PointerTable table;
+        table.offset = p;
+        table.count = 1;
+        table.distinctTargets = 1;
+        table.firstTarget = t;
+        qint64 last = t;
+        for (qint64 q = p + width;; q += width) {
+            qint64 next = ctx->target(q);
+            if (next < last) break;
+            if (next != last) ++table.distinctTargets;
+            last = next;
+            ++table.count;
+        }
+        if (table.distinctTargets < ctx->minCount) continue;
+        table.lastTarget = last;
+
+        // Real tables point at almost every string between their first and last target
+        auto lo = std::lower_bound(ctx->starts->constBegin(), ctx->starts->constEnd(), table.firstTarget);
+        auto hi = std::upper_bound(lo, ctx->starts->constEnd(), table.lastTarget);
+        table.coverage = (double)table.distinctTargets / std::max(1, (int)(hi - lo));
+        found.append(table);
+    }
+    return found;
+}
+
+}
+
+namespace PointerScan {
+
+quint32 readWord(const uchar *p, int width, bool bigEndian) {
+    quint32 v = 0;
+    if (bigEndian) {
+        for (int i = 0; i < width; ++i) v = (v << 8) | p[i];
+    } else {
+        for (int i = width - 1; i >= 0; --i) v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+QVector<qint64> stringStarts(const uchar *data, qint64 size, const QByteArray &terminators) {
+    bool isTerminator[256] = {};
+    for (char c : terminators) {
+        isTerminator[(uchar)c] = true;
+    }
+
+    QVector<qint64> starts;
+    bool afterTerminator = true;
+    for (qint64 i = 0; i < size; ++i) {
+        bool terminator = isTerminator[data[i]];
+        if (afterTerminator && !terminator) {
+            starts.append(i);
+        }
+        afterTerminator = terminator;
+    }
+    return starts;
+}
+
+QVector<PointerTable> findTables(const uchar *data, qint64 size, const PointerFormat &format,
+                                 const QVector<qint64> &starts, int minCount,
+                                 QThreadPool *pool, const QAtomicInt *cancel) {
+    ScanContext ctx;
+    ctx.data = data;
+    ctx.size = size;
+    ctx.format = format;
+    ctx.starts = &starts;
+    ctx.minCount = std::max(2, minCount);
+    ctx.cancel = cancel;
+    ctx.isStart.assign((size_t)(size >> 6) + 1, 0);
+    for (qint64 s : starts) {
+        ctx.isStart[s >> 6] |= Q_UINT64_C(1) << (s & 63);
+    }
+
+    // The first chunk runs here; waiting on the others runs them here too if no thread took them
+    const int chunks = std::max(1, pool->maxThreadCount()) * 4;
+    const qint64 chunkSize = std::max((qint64)CANCEL_CHECK_BYTES, (size + chunks - 1) / chunks);
+    QVector<QFuture<QVector<PointerTable>>> futures;
+    for (qint64 from = chunkSize; from < size; from += chunkSize) {
+        qint64 to = std::min(size, from + chunkSize);
+        futures.append(QtConcurrent::run(pool, scanChunk, (const ScanContext *)&ctx, from, to));
+    }
+    QVector<PointerTable> tables = scanChunk(&ctx, 0, std::min(size, chunkSize));
+    for (QFuture<QVector<PointerTable>> &future : futures) {
+        tables += future.result();
+    }
+
+    std::sort(tables.begin(), tables.end(), [](const PointerTable &a, const PointerTable &b) {
+        double scoreA = a.distinctTargets * a.coverage;
+        double scoreB = b.distinctTargets * b.coverage;
+        if (scoreA != scoreB) return scoreA > scoreB;
+        return a.offset < b.offset;
+    });
+    if (tables.size() > MAX_TABLES) {
+        tables.resize(MAX_TABLES);
+    }
+    return tables;
+}
+
+}
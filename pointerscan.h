@@ -0,0 +1,42 @@
+#ifndef POINTERSCAN_H
+#define POINTERSCAN_H
+
+#include <QtGlobal>
+#include <QVector>
+#include <QByteArray>
+#include <QAtomicInt>
+
+class QThreadPool;
+
+// Cómo se lee un puntero: destino = base + valor
+struct PointerFormat {
+    int width = 2;          // 2, 3 or 4 bytes
+    bool bigEndian = false;
+    qint64 base = 0;
+};
+
+struct PointerTable {
+    qint64 offset = 0;      // Where the first pointer is stored
+    int count = 0;
+    int distinctTargets = 0;
+    qint64 firstTarget = 0;
+    qint64 lastTarget = 0;
+    double coverage = 0;    // Share of the string starts in [firstTarget, lastTarget] that are pointed at
+};
+
+namespace PointerScan {
+
+quint32 readWord(const uchar *p, int width, bool bigEndian);
+
+// Sorted offsets where a string begins: at 0 or right after a terminator, never on one.
+QVector<qint64> stringStarts(const uchar *data, qint64 size, const QByteArray &terminators);
+
+// Runs of at least 'minCount' consecutive pointers with non-decreasing targets that all land
+// on string starts, best candidates first. The buffer is split across 'pool'.
+QVector<PointerTable> findTables(const uchar *data, qint64 size, const PointerFormat &format,
+                                 const QVector<qint64> &starts, int minCount,
+                                 QThreadPool *pool, const QAtomicInt *cancel);
+
+}
+
+#endif // POINTERSCAN_H
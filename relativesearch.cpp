@@ -0,0 +1,214 @@
+#include "relativesearch.h"
+
+#include <QObject>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RELATIVE_SEARCH_SSE2
+#endif
+
+namespace {
+
+const qint64 BACKWARD_BLOCK = 64 * 1024;
+
+template <int Width, bool BigEndian>
+inline quint32 element(const uchar *p) {
+    if (Width == 1) return p[0];
+    return BigEndian ? (quint32(p[0]) << 8 | p[1]) : (quint32(p[1]) << 8 | p[0]);
+}
+
+template <int Width, bool BigEndian, typename Constraint>
+qint64 scanScalarT(const uchar *data, qint64 from, qint64 to, const Constraint *constraints, int count) {
+    const quint32 mask = Width == 1 ? 0xFF : 0xFFFF;
+    for (qint64 pos = from; pos < to; ++pos) {
+        const uchar *p = data + pos;
+        int k = 0;
+        for (; k < count; ++k) {
+            quint32 diff = element<Width, BigEndian>(p + constraints[k].offset)
+                         - element<Width, BigEndian>(p + constraints[k].anchorOffset);
+            if ((diff & mask) != constraints[k].delta) break;
+        }
+        if (k == count) return pos;
+    }
+    return -1;
+}
+
+#ifdef RELATIVE_SEARCH_SSE2
+
+inline __m128i load(const uchar *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+template <bool BigEndian>
+inline __m128i load16(const uchar *p) {
+    __m128i v = load(p);
+    if (BigEndian) v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    return v;
+}
+
+// One bit per candidate start in [p, p + 16)
+template <typename Constraint>
+inline int matchMask8(const uchar *p, const Constraint *constraints, int count) {
+    int mask = 0xFFFF;
+    for (int k = 0; k < count && mask; ++k) {
+        __m128i diff = _mm_sub_epi8(load(p + constraints[k].offset), load(p + constraints[k].anchorOffset));
+        mask &= _mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_set1_epi8((char)constraints[k].delta)));
+    }
+    return mask;
+}
+
+// Each 16-bit lane holds the candidate at an even distance from 'p'; the odd ones need a second pass
+template <bool BigEndian, typename Constraint>
+inline int matchMask16(const uchar *p, const Constraint *constraints, int count) {
+    int even = 0xFFFF;
+    int odd = 0xFFFF;
+    for (int k = 0; k < count && (even | odd); ++k) {
+        const __m128i delta = _mm_set1_epi16((short)constraints[k].delta);
+        const uchar *a = p + constraints[k].offset;
+        const uchar *b = p + constraints[k].anchorOffset;
+        if (even) {
+            __m128i diff = _mm_sub_epi16(load16<BigEndian>(a), load16<BigEndian>(b));
+            even &= _mm_movemask_epi8(_mm_cmpeq_epi16(diff, delta));
+        }
+        if (odd) {
+            __m128i diff = _mm_sub_epi16(load16<BigEndian>(a + 1), load16<BigEndian>(b + 1));
+            odd &= _mm_movemask_epi8(_mm_cmpeq_epi16(diff, delta));
+        }
+    }
+    return (even & 0x5555) | ((odd & 0x5555) << 1);
+}
+
+template <int Width, bool BigEndian, typename Constraint>
+qint64 scanVectorT(const uchar *data, qint64 from, qint64 to, const Constraint *constraints, int count) {
+    qint64 pos = from;
+    // Every load for the last candidate of a block stays inside that candidate's span
+    for (; pos + 16 <= to; pos += 16) {
+        int mask = Width == 1 ? matchMask8(data + pos, constraints, count)
+                              : matchMask16<BigEndian>(data + pos, constraints, count);
+        if (mask) return pos + qCountTrailingZeroBits((quint32)mask);
+    }
+    return scanScalarT<Width, BigEndian>(data, pos, to, constraints, count);
+}
+
+#endif
+
+}
+
+bool RelativeSearch::compile(const QString &text, const RelativeSearchOptions &options, QString *error) {
+    m_constraints.clear();
+    m_anchors.clear();
+    m_span = 0;
+    m_options = options;
+    if (m_options.width != 2) {
+        m_options.width = 1;
+        m_options.bigEndian = false;
+    }
+    if (m_options.stride <= 0) m_options.stride = m_options.width;
+
+    // Cada caja tiene su propia base: la primera letra de esa caja
+    enum LetterClass { Upper, Lower, Caseless, ClassCount };
+    int anchor[ClassCount] = { -1, -1, -1 };
+    const quint32 mask = m_options.width == 1 ? 0xFF : 0xFFFF;
+
+    for (int i = 0; i < text.length(); ++i) {
+        const QChar ch = text.at(i);
+        if (!ch.isLetter()) continue;
+
+        int letterClass = Caseless;
+        if (m_options.separateCaseBases) {
+            if (ch.isUpper()) letterClass = Upper;
+            else if (ch.isLower()) letterClass = Lower;
+        }
+
+        if (anchor[letterClass] < 0) {
+            anchor[letterClass] = i;
+            // Latin letters report the start of their alphabet
+            Anchor base;
+            base.letter = ch;
+            if (ch.unicode() < 128) base.letter = QChar(ch.isUpper() ? 'A' : 'a');
+            base.offset = i * m_options.stride;
+            base.distance = (quint32)(ch.unicode() - base.letter.unicode()) & mask;
+            m_anchors.append(base);
+            continue;
+        }
+        Constraint constraint;
+        constraint.offset = i * m_options.stride;
+        constraint.anchorOffset = anchor[letterClass] * m_options.stride;
+        constraint.delta = (quint32)(ch.unicode() - text.at(anchor[letterClass]).unicode()) & mask;
+        m_constraints.append(constraint);
+    }
+
+    if (m_constraints.isEmpty()) {
+        m_anchors.clear();
+        if (error) {
+            *error = QObject::tr("The text needs at least two letters%1 to compare.")
+                         .arg(m_options.separateCaseBases ? QObject::tr(" of the same case") : QString());
+        }
+        return false;
+    }
+
+    m_span = (qint64)(text.length() - 1) * m_options.stride + m_options.width;
+    return true;
+}
+
+qint64 RelativeSearch::scanScalar(const uchar *data, qint64 from, qint64 to) const {
+    const Constraint *constraints = m_constraints.constData();
+    const int count = m_constraints.size();
+    if (m_options.width == 1) return scanScalarT<1, false>(data, from, to, constraints, count);
+    if (m_options.bigEndian) return scanScalarT<2, true>(data, from, to, constraints, count);
+    return scanScalarT<2, false>(data, from, to, constraints, count);
+}
+
+qint64 RelativeSearch::scanVector(const uchar *data, qint64 from, qint64 to) const {
+#ifdef RELATIVE_SEARCH_SSE2
+    const Constraint *constraints = m_constraints.constData();
+    const int count = m_constraints.size();
+    if (m_options.width == 1) return scanVectorT<1, false>(data, from, to, constraints, count);
+    if (m_options.bigEndian) return scanVectorT<2, true>(data, from, to, constraints, count);
+    return scanVectorT<2, false>(data, from, to, constraints, count);
+#else
+    return scanScalar(data, from, to);
+#endif
+}
+
+qint64 RelativeSearch::findNext(const uchar *data, qint64 size, qint64 from, qint64 to) const {
+    if (!isValid()) return -1;
+    const qint64 lastStart = size - m_span;
+    if (to < 0 || to > lastStart + 1) to = lastStart + 1;
+    from = std::max((qint64)0, from);
+    if (from >= to) return -1;
+    return scanVector(data, from, to);
+}
+
+qint64 RelativeSearch::findPrevious(const uchar *data, qint64 size, qint64 before) const {
+    if (!isValid()) return -1;
+    before = std::min(before, size - m_span + 1);
+
+    // Bloques hacia atrás; dentro de cada uno, la última coincidencia
+    for (qint64 blockEnd = before; blockEnd > 0; blockEnd -= BACKWARD_BLOCK) {
+        qint64 blockStart = std::max((qint64)0, blockEnd - BACKWARD_BLOCK);
+        qint64 found = -1;
+        for (qint64 pos = findNext(data, size, blockStart, blockEnd); pos >= 0;
+             pos = findNext(data, size, pos + 1, blockEnd)) {
+            found = pos;
+        }
+        if (found >= 0) return found;
+    }
+    return -1;
+}
+
+QVector<RelativeBase> RelativeSearch::impliedBases(const uchar *data, qint64 pos) const {
+    QVector<RelativeBase> bases;
+    const quint32 mask = m_options.width == 1 ? 0xFF : 0xFFFF;
+    for (const Anchor &anchor : m_anchors) {
+        const uchar *p = data + pos + anchor.offset;
+        quint32 value = m_options.width == 1 ? element<1, false>(p)
+                      : m_options.bigEndian ? element<2, true>(p) : element<2, false>(p);
+        RelativeBase base;
+        base.letter = anchor.letter;
+        base.value = (value - anchor.distance) & mask;
+        bases.append(base);
+    }
+    return bases;
+}
@@ -0,0 +1,67 @@
+#ifndef RELATIVESEARCH_H
+#define RELATIVESEARCH_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QChar>
+#include <QVector>
+
+struct RelativeSearchOptions {
+    int width = 1;                  // Bytes per character: 1 or 2
+    bool bigEndian = false;         // For 16-bit characters
+    int stride = 0;                 // Bytes from one character to the next, 0 = width
+    bool separateCaseBases = true;  // Upper and lower case letters don't need to be a fixed distance apart
+};
+
+// Value a match implies for a letter, e.g. 'A' = 0x80
+struct RelativeBase {
+    QChar letter;
+    quint32 value = 0;
+};
+
+// Búsqueda relativa: encuentra texto cuya codificación se desconoce, suponiendo solo que
+// las letras de cada caja van seguidas en la tabla (A, B, C... / a, b, c...).
+// Non-letters in the query are wildcards.
+class RelativeSearch
+{
+public:
+    bool compile(const QString &text, const RelativeSearchOptions &options, QString *error = nullptr);
+    bool isValid() const { return !m_constraints.isEmpty(); }
+
+    const RelativeSearchOptions &options() const { return m_options; }
+    // Bytes covered by one match
+    qint64 span() const { return m_span; }
+
+    // First match starting in [from, to), or -1. 'to' = -1 means up to the end.
+    qint64 findNext(const uchar *data, qint64 size, qint64 from, qint64 to = -1) const;
+    // Last match starting before 'before', or -1.
+    qint64 findPrevious(const uchar *data, qint64 size, qint64 before) const;
+
+    // One entry per letter class in the query: 'A' and 'a' for Latin text, otherwise the class's
+    // first letter. 'pos' must be a match.
+    QVector<RelativeBase> impliedBases(const uchar *data, qint64 pos) const;
+
+private:
+    // element(offset) - element(anchorOffset) must equal delta, modulo the element width
+    struct Constraint {
+        int offset = 0;
+        int anchorOffset = 0;
+        quint32 delta = 0;
+    };
+
+    struct Anchor {
+        QChar letter;
+        int offset = 0;
+        quint32 distance = 0;   // letter value = element(offset) - distance
+    };
+
+    qint64 scanScalar(const uchar *data, qint64 from, qint64 to) const;
+    qint64 scanVector(const uchar *data, qint64 from, qint64 to) const;
+
+    RelativeSearchOptions m_options;
+    QVector<Constraint> m_constraints;
+    QVector<Anchor> m_anchors;
+    qint64 m_span = 0;
+};
+
+#endif // RELATIVESEARCH_H
@@ -0,0 +1,206 @@
+#include "searchresults.h"
+#include "hexeditorarea.h"
+
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <QMutexLocker>
+#include <QListWidget>
+#include <QListWidgetItem>
+#include <QLabel>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFont>
+#include <algorithm>
+#include <climits>
+
+const int MAX_LISTED_HITS = 100000;
+const int PREVIEW_BYTES = 16;
+const int HIT_BATCH_INTERVAL_MS = 100;
+
+SearchJob::SearchJob(const Worker &worker, QThreadPool *pool, QObject *parent)
+    : QObject(parent),
+      m_worker(worker),
+      m_pool(pool)
+{
+}
+
+SearchJob::~SearchJob() {
+    cancel();
+    m_future.waitForFinished();
+}
+
+void SearchJob::start() {
+    m_future = QtConcurrent::run(m_pool, [this]() { run(); });
+}
+
+void SearchJob::run() {
+    m_throttle.start();
+    m_worker(this);
+    emit hitsAvailable();
+    emit finished();
+}
+
+void SearchJob::addHit(const SearchHit &hit) {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pending.append(hit);
+    }
+    if (m_throttle.elapsed() > HIT_BATCH_INTERVAL_MS) {
+        m_throttle.restart();
+        emit hitsAvailable();
+    }
+}
+
+void SearchJob::setProgress(qint64 done, qint64 total) {
+    int percent = total > 0 ? (int)(std::min(done, total) * 100 / total) : 100;
+    if (percent != m_lastPercent) {
+        m_lastPercent = percent;
+        emit progressChanged(percent);
+    }
+}
+
+QVector<SearchHit> SearchJob::takeHits() {
+    QMutexLocker locker(&m_mutex);
+    QVector<SearchHit> hits;
+    hits.swap(m_pending);
+    return hits;
+}
+
+SearchResultsDock::SearchResultsDock(QWidget *parent)
+    : QDockWidget(tr("Search Results"), parent)
+{
+    setObjectName("searchResultsDock");
+    setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetClosable);
+
+    QWidget *content = new QWidget(this);
+    m_list = new QListWidget(content);
+    m_list->setUniformItemSizes(true);
+    QFont mono("Monospace");
+    mono.setStyleHint(QFont::Monospace);
+    m_list->setFont(mono);
+
+    m_statusLabel = new QLabel(content);
+    m_stopButton = new QPushButton(tr("Stop"), content);
+    m_stopButton->setEnabled(false);
+
+    QHBoxLayout *statusLayout = new QHBoxLayout;
+    statusLayout->addWidget(m_statusLabel, 1);
+    statusLayout->addWidget(m_stopButton);
+
+    QVBoxLayout *layout = new QVBoxLayout(content);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_list);
+    layout->addLayout(statusLayout);
+    setWidget(content);
+
+    connect(m_list, &QListWidget::itemActivated, this, &SearchResultsDock::handleItemActivated);
+    connect(m_list, &QListWidget::itemClicked, this, &SearchResultsDock::handleItemActivated);
+    m_list->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(m_list, &QListWidget::customContextMenuRequested, this, &SearchResultsDock::handleContextMenu);
+    connect(m_stopButton, &QPushButton::clicked, this, &SearchResultsDock::stopSearch);
+}
+
+SearchResultsDock::~SearchResultsDock() {
+    delete m_job;
+}
+
+void SearchResultsDock::clear() {
+    delete m_job;
+    m_job = nullptr;
+    m_list->clear();
+    m_hitCount = 0;
+    m_percent = 0;
+    m_data = PieceTable();
+    m_editor = nullptr;
+    m_statusLabel->clear();
+    m_stopButton->setEnabled(false);
+}
+
+void SearchResultsDock::startSearch(const QString &title, HexEditorArea *editor, const PieceTable &data, SearchJob *job) {
+    clear();
+    m_title = title;
+    m_editor = editor;
+    m_data = data;
+    m_job = job;
+
+    connect(m_job, &SearchJob::hitsAvailable, this, &SearchResultsDock::handleHitsAvailable);
+    connect(m_job, &SearchJob::progressChanged, this, &SearchResultsDock::handleProgress);
+    connect(m_job, &SearchJob::finished, this, &SearchResultsDock::handleFinished);
+
+    setWindowTitle(tr("Search Results - %1").arg(title));
+    updateStatus(true);
+    show();
+    raise();
+    m_job->start();
+}
+
+void SearchResultsDock::stopSearch() {
+    if (m_job) m_job->cancel();
+}
+
+void SearchResultsDock::handleHitsAvailable() {
+    if (!m_job || sender() != m_job) return;
+
+    const QVector<SearchHit> hits = m_job->takeHits();
+    m_list->setUpdatesEnabled(false);
+    for (const SearchHit &hit : hits) {
+        ++m_hitCount;
+        if (m_list->count() >= MAX_LISTED_HITS) continue;
+
+        qint64 shown = std::min((qint64)PREVIEW_BYTES, std::min(hit.length, m_data.size() - hit.offset));
+        const QByteArray bytes = m_data.read(hit.offset, shown);
+        QString preview;
+        for (qint64 i = 0; i < shown; ++i) {
+            preview += QString("%1 ").arg(uchar(bytes.at(i)), 2, 16, QChar('0')).toUpper();
+        }
+        if (hit.length > shown) preview += "...";
+
+        QString text = QString("%1  %2").arg(hit.offset, 8, 16, QChar('0')).toUpper().arg(preview.trimmed());
+        if (!hit.note.isEmpty()) text += "  " + hit.note;
+
+        QListWidgetItem *item = new QListWidgetItem(text, m_list);
+        item->setData(Qt::UserRole, hit.offset);
+        item->setData(Qt::UserRole + 1, hit.length);
+    }
+    m_list->setUpdatesEnabled(true);
+    updateStatus(true);
+}
+
+void SearchResultsDock::handleProgress(int percent) {
+    if (sender() != m_job) return;
+    m_percent = percent;
+    updateStatus(true);
+}
+
+void SearchResultsDock::handleFinished() {
+    if (sender() != m_job) return;
+    handleHitsAvailable();
+    updateStatus(false);
+}
+
+void SearchResultsDock::updateStatus(bool running) {
+    QString text = tr("%n hit(s)", "", (int)std::min(m_hitCount, (qint64)INT_MAX));
+    if (m_hitCount > m_list->count()) {
+        text += tr(" (first %1 listed)").arg(m_list->count());
+    }
+    if (running) {
+        text += tr(" - searching... %1%").arg(m_percent);
+    } else if (m_job && m_job->isCancelled()) {
+        text += tr(" - stopped");
+    }
+    m_statusLabel->setText(text);
+    m_stopButton->setEnabled(running);
+}
+
+void SearchResultsDock::handleItemActivated(QListWidgetItem *item) {
+    if (!item || !m_editor) return;
+    emit hitActivated(m_editor, item->data(Qt::UserRole).toLongLong(), item->data(Qt::UserRole + 1).toLongLong());
+}
+
+void SearchResultsDock::handleContextMenu(const QPoint &pos) {
+    QListWidgetItem *item = m_list->itemAt(pos);
+    if (!item || !m_editor) return;
+    emit hitContextMenuRequested(m_editor, item->data(Qt::UserRole).toLongLong(), item->data(Qt::UserRole + 1).toLongLong(),
+                                 m_list->viewport()->mapToGlobal(pos));
+}
@@ -0,0 +1,112 @@
+#ifndef SEARCHRESULTS_H
+#define SEARCHRESULTS_H
+
+#include <QDockWidget>
+#include <QObject>
+#include <QByteArray>
+#include <QVector>
+#include <QString>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QFuture>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <functional>
+
+#include "piecetable.h"
+
+class QThreadPool;
+class QListWidget;
+class QListWidgetItem;
+class QLabel;
+class QPushButton;
+class HexEditorArea;
+
+struct SearchHit {
+    qint64 offset = 0;
+    qint64 length = 0;
+    QString note;
+};
+
+// Búsqueda en segundo plano que entrega los resultados por lotes al hilo de la interfaz
+class SearchJob : public QObject
+{
+    Q_OBJECT
+public:
+    // Runs on the pool; reports hits with addHit() and should return once isCancelled().
+    typedef std::function<void(SearchJob *job)> Worker;
+
+    SearchJob(const Worker &worker, QThreadPool *pool, QObject *parent = nullptr);
+    ~SearchJob() override;
+
+    void start();
+    void cancel() { m_cancel.storeRelease(1); }
+
+    // Worker side
+    bool isCancelled() const { return m_cancel.loadAcquire() != 0; }
+    const QAtomicInt *cancelFlag() const { return &m_cancel; }
+    void addHit(const SearchHit &hit);
+    void setProgress(qint64 done, qint64 total);
+
+    // GUI side
+    QVector<SearchHit> takeHits();
+
+signals:
+    void hitsAvailable();
+    void progressChanged(int percent);
+    void finished();
+
+private:
+    void run();
+
+    Worker m_worker;
+    QThreadPool *m_pool;
+    QFuture<void> m_future;
+    QAtomicInt m_cancel;
+    QMutex m_mutex;
+    QVector<SearchHit> m_pending;
+    QElapsedTimer m_throttle;
+    int m_lastPercent = -1;
+};
+
+// Lista de resultados compartida por las búsquedas de "buscar todo"
+class SearchResultsDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit SearchResultsDock(QWidget *parent = nullptr);
+    ~SearchResultsDock() override;
+
+    // Takes ownership of 'job' and starts it. 'data' is a snapshot of the buffer being searched, for previews.
+    void startSearch(const QString &title, HexEditorArea *editor, const PieceTable &data, SearchJob *job);
+    // Cancels the running search, if any, and empties the list.
+    void clear();
+
+signals:
+    void hitActivated(HexEditorArea *editor, qint64 offset, qint64 length);
+    // Right click on a hit; 'globalPos' is where to show a menu
+    void hitContextMenuRequested(HexEditorArea *editor, qint64 offset, qint64 length, const QPoint &globalPos);
+
+private slots:
+    void handleHitsAvailable();
+    void handleProgress(int percent);
+    void handleFinished();
+    void handleItemActivated(QListWidgetItem *item);
+    void stopSearch();
+    void handleContextMenu(const QPoint &pos);
+
+private:
+    void updateStatus(bool running);
+
+    QListWidget *m_list = nullptr;
+    QLabel *m_statusLabel = nullptr;
+    QPushButton *m_stopButton = nullptr;
+    SearchJob *m_job = nullptr;
+    QPointer<HexEditorArea> m_editor;
+    PieceTable m_data;
+    QString m_title;
+    qint64 m_hitCount = 0;
+    int m_percent = 0;
+};
+
+#endif // SEARCHRESULTS_H
@@ -0,0 +1,147 @@
+#include "session.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QObject>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+const int SESSION_VERSION = 1;
+
+FileStamp FileStamp::of(const QString &filePath) {
+    FileStamp stamp;
+    const QFileInfo info(filePath);
+    if (info.exists()) {
+        stamp.size = info.size();
+        stamp.modified = info.lastModified().toMSecsSinceEpoch();
+    }
+    return stamp;
+}
+
+QString Session::defaultPath() {
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/last.htproj";
+}
+
+QString Session::cachePath(const QString &filePath, const QString &kind) {
+    // Un nombre fijo por fichero: la ruta absoluta resumida
+    const QByteArray key = QCryptographicHash::hash(QFileInfo(filePath).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/" + kind + "/" + QString::fromLatin1(key) + ".cache";
+}
+
+bool Session::save(const QString &path, QString *error) const {
+    QJsonArray tableList;
+    for (const SessionTable &table : tables) {
+        QJsonObject entry;
+        entry["name"] = table.name;
+        entry["file"] = table.filePath;
+        entry["map"] = QJsonArray::fromStringList(table.map);
+        entry["terminators"] = QString::fromLatin1(table.terminators.toHex());
+        tableList.append(entry);
+    }
+
+    QJsonArray documentList;
+    for (const SessionDocument &document : documents) {
+        QJsonObject entry;
+        entry["file"] = document.filePath;
+        entry["size"] = double(document.stamp.size);
+        entry["modified"] = double(document.stamp.modified);
+        entry["table"] = document.table;
+        QJsonArray regions;
+        for (const SessionRegion &region : document.regions) {
+            QJsonObject r;
+            r["start"] = double(region.start);
+            r["end"] = double(region.end);
+            r["table"] = region.table;
+            regions.append(r);
+        }
+        entry["regions"] = regions;
+        entry["cursor"] = double(document.cursorPos);
+        entry["selectionStart"] = double(document.selectionStart);
+        entry["selectionEnd"] = double(document.selectionEnd);
+        entry["top"] = double(document.topOffset);
+        if (!document.minimapCache.isEmpty()) entry["minimapCache"] = document.minimapCache;
+        documentList.append(entry);
+    }
+
+    QJsonObject root;
+    root["version"] = SESSION_VERSION;
+    root["tables"] = tableList;
+    root["activeTable"] = activeTable;
+    root["documents"] = documentList;
+    root["currentDocument"] = currentDocument;
+    root["geometry"] = QString::fromLatin1(geometry.toBase64());
+    root["windowState"] = QString::fromLatin1(windowState.toBase64());
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) == -1) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool Session::load(const QString &path, QString *error) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        if (error) *error = parseError.errorString();
+        return false;
+    }
+    const QJsonObject root = document.object();
+    if (root.value("version").toInt() > SESSION_VERSION) {
+        if (error) *error = QObject::tr("Unsupported project version %1").arg(root.value("version").toInt());
+        return false;
+    }
+
+    tables.clear();
+    for (const QJsonValue &value : root.value("tables").toArray()) {
+        const QJsonObject entry = value.toObject();
+        SessionTable table;
+        table.name = entry.value("name").toString();
+        table.filePath = entry.value("file").toString();
+        for (const QJsonValue &mapped : entry.value("map").toArray()) table.map << mapped.toString();
+        table.terminators = QByteArray::fromHex(entry.value("terminators").toString().toLatin1());
+        if (!table.name.isEmpty() && table.map.size() == 256) tables.append(table);
+    }
+    activeTable = root.value("activeTable").toString();
+
+    documents.clear();
+    for (const QJsonValue &value : root.value("documents").toArray()) {
+        const QJsonObject entry = value.toObject();
+        SessionDocument doc;
+        doc.filePath = entry.value("file").toString();
+        doc.stamp.size = qint64(entry.value("size").toDouble(-1));
+        doc.stamp.modified = qint64(entry.value("modified").toDouble());
+        doc.table = entry.value("table").toString();
+        for (const QJsonValue &r : entry.value("regions").toArray()) {
+            const QJsonObject regionEntry = r.toObject();
+            SessionRegion region;
+            region.start = qint64(regionEntry.value("start").toDouble());
+            region.end = qint64(regionEntry.value("end").toDouble());
+            region.table = regionEntry.value("table").toString();
+            doc.regions.append(region);
+        }
+        doc.cursorPos = qint64(entry.value("cursor").toDouble());
+        doc.selectionStart = qint64(entry.value("selectionStart").toDouble(-1));
+        doc.selectionEnd = qint64(entry.value("selectionEnd").toDouble(-1));
+        doc.topOffset = qint64(entry.value("top").toDouble());
+        doc.minimapCache = entry.value("minimapCache").toString();
+        if (!doc.filePath.isEmpty()) documents.append(doc);
+    }
+    currentDocument = root.value("currentDocument").toInt(-1);
+    geometry = QByteArray::fromBase64(root.value("geometry").toString().toLatin1());
+    windowState = QByteArray::fromBase64(root.value("windowState").toString().toLatin1());
+    return true;
+}
@@ -0,0 +1,64 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+
+// Tamaño y fecha de un fichero: si no han cambiado, lo calculado a partir de él sigue valiendo
+struct FileStamp {
+    qint64 size = -1;       // -1 = no such file
+    qint64 modified = 0;    // Milliseconds since the epoch
+
+    static FileStamp of(const QString &filePath);
+    bool isValid() const { return size >= 0; }
+    bool operator==(const FileStamp &other) const { return size == other.size && modified == other.modified; }
+    bool operator!=(const FileStamp &other) const { return !(*this == other); }
+};
+
+// Tables are stored whole, so restoring needs no .tbl file and keeps unsaved edits
+struct SessionTable {
+    QString name;
+    QString filePath;
+    QStringList map;            // 256 entries
+    QByteArray terminators;
+};
+
+struct SessionRegion {
+    qint64 start = 0;
+    qint64 end = 0;
+    QString table;
+};
+
+struct SessionDocument {
+    QString filePath;
+    FileStamp stamp;            // Of the file the state below describes
+    QString table;
+    QVector<SessionRegion> regions;
+    qint64 cursorPos = 0;
+    qint64 selectionStart = -1;
+    qint64 selectionEnd = -1;
+    qint64 topOffset = 0;
+    QString minimapCache;       // Empty when none was written
+};
+
+// Espacio de trabajo: pestañas, tablas y ventana. Las cachés van en ficheros aparte y el proyecto solo las nombra.
+struct Session {
+    QVector<SessionTable> tables;
+    QString activeTable;
+    QVector<SessionDocument> documents;
+    int currentDocument = -1;
+    QByteArray geometry;
+    QByteArray windowState;
+
+    bool save(const QString &path, QString *error = nullptr) const;
+    bool load(const QString &path, QString *error = nullptr);
+
+    // Saved on exit and reopened on the next start
+    static QString defaultPath();
+    // Cache file of 'kind' ("minimap", ...) for 'filePath', under the user's cache directory
+    static QString cachePath(const QString &filePath, const QString &kind);
+};
+
+#endif // SESSION_H
@@ -0,0 +1,360 @@
+#include "structtemplate.h"
+
+#include <QStringList>
+#include <QObject>
+#include <algorithm>
+#include <cstring>
+
+const int MAX_FIELDS = 65536;           // After unrolling nested structs and struct arrays
+const qint64 MAX_ARRAY = 1 << 24;
+const qint64 MAX_STRUCT_SIZE = qint64(1) << 32;
+const int MAX_LISTED_ELEMENTS = 8;
+const int MAX_LISTED_BYTES = 16;
+
+namespace {
+
+using StructTemplate::FieldKind;
+
+struct Primitive {
+    const char *name;
+    FieldKind kind;
+    int size;
+};
+
+const Primitive PRIMITIVES[] = {
+    {"u8", StructTemplate::Unsigned, 1}, {"s8", StructTemplate::Signed, 1}, {"char", StructTemplate::Bytes, 1},
+    {"u16", StructTemplate::Unsigned, 2}, {"s16", StructTemplate::Signed, 2},
+    {"u24", StructTemplate::Unsigned, 3}, {"s24", StructTemplate::Signed, 3},
+    {"u32", StructTemplate::Unsigned, 4}, {"s32", StructTemplate::Signed, 4},
+    {"u64", StructTemplate::Unsigned, 8}, {"s64", StructTemplate::Signed, 8},
+    {"f32", StructTemplate::Float, 4}, {"f64", StructTemplate::Float, 8}
+};
+
+bool findPrimitive(QString name, StructTemplate::Field *field) {
+    field->bigEndian = false;
+    if (name.endsWith("be")) {
+        name.chop(2);
+        field->bigEndian = true;
+    } else if (name.endsWith("le")) {
+        name.chop(2);
+    }
+    for (const Primitive &primitive : PRIMITIVES) {
+        if (name == QLatin1String(primitive.name)) {
+            field->kind = primitive.kind;
+            field->size = primitive.size;
+            return true;
+        }
+    }
+    return false;
+}
+
+struct Token {
+    enum Type { End, Identifier, Number, Symbol };
+    Type type = End;
+    QString text;
+    qint64 number = 0;
+    int line = 1;
+};
+
+bool tokenize(const QString &source, QVector<Token> *tokens, QString *error) {
+    int line = 1;
+    const int n = source.size();
+    for (int i = 0; i < n;) {
+        const QChar c = source.at(i);
+        if (c == '\n') {
+            ++line;
+            ++i;
+        } else if (c.isSpace()) {
+            ++i;
+        } else if (c == '/' && i + 1 < n && source.at(i + 1) == '/') {
+            while (i < n && source.at(i) != '\n') ++i;
+        } else if (c.isLetter() || c == '_') {
+            Token token;
+            token.type = Token::Identifier;
+            token.line = line;
+            const int begin = i;
+            while (i < n && (source.at(i).isLetterOrNumber() || source.at(i) == '_')) ++i;
+            token.text = source.mid(begin, i - begin);
+            tokens->append(token);
+        } else if (c.isDigit()) {
+            Token token;
+            token.type = Token::Number;
+            token.line = line;
+            const int begin = i;
+            while (i < n && source.at(i).isLetterOrNumber()) ++i;
+            token.text = source.mid(begin, i - begin);
+            bool ok = false;
+            token.number = token.text.toLongLong(&ok, 0);
+            if (!ok) {
+                *error = QObject::tr("Line %1: bad number '%2'").arg(line).arg(token.text);
+                return false;
+            }
+            tokens->append(token);
+        } else if (QString("{}[];").contains(c)) {
+            Token token;
+            token.type = Token::Symbol;
+            token.line = line;
+            token.text = c;
+            tokens->append(token);
+            ++i;
+        } else {
+            *error = QObject::tr("Line %1: unexpected '%2'").arg(line).arg(c);
+            return false;
+        }
+    }
+    Token end;
+    end.line = line;
+    tokens->append(end);
+    return true;
+}
+
+// Recursive descent over the token list; each struct is compiled as soon as it is closed
+class Compiler
+{
+public:
+    Compiler(const QVector<Token> &tokens, QVector<StructTemplate::Layout> *layouts, QString *error)
+        : m_tokens(tokens), m_layouts(layouts), m_error(error) {}
+
+    bool run() {
+        while (peek().type != Token::End) {
+            if (!parseStruct()) return false;
+        }
+        return true;
+    }
+
+private:
+    const Token &peek() const { return m_tokens.at(m_pos); }
+    const Token &take() { return m_tokens.at(m_pos < m_tokens.size() - 1 ? m_pos++ : m_pos); }
+
+    bool fail(const QString &message) {
+        *m_error = QObject::tr("Line %1: %2").arg(peek().line).arg(message);
+        return false;
+    }
+
+    bool accept(const char *symbol) {
+        if (peek().type == Token::Symbol && peek().text == QLatin1String(symbol)) {
+            take();
+            return true;
+        }
+        return false;
+    }
+
+    bool expect(const char *symbol) {
+        return accept(symbol) || fail(QObject::tr("expected '%1'").arg(QLatin1String(symbol)));
+    }
+
+    bool identifier(QString *text, const QString &what) {
+        if (peek().type != Token::Identifier) return fail(QObject::tr("expected %1").arg(what));
+        *text = take().text;
+        return true;
+    }
+
+    const StructTemplate::Layout *findStruct(const QString &name) const {
+        for (const StructTemplate::Layout &layout : *m_layouts) {
+            if (layout.name == name) return &layout;
+        }
+        return nullptr;
+    }
+
+    bool parseStruct() {
+        QString keyword;
+        if (!identifier(&keyword, "'struct'")) return false;
+        if (keyword != "struct") return fail(QObject::tr("expected 'struct'"));
+
+        StructTemplate::Layout layout;
+        if (!identifier(&layout.name, QObject::tr("a struct name"))) return false;
+        StructTemplate::Field probe;
+        if (findStruct(layout.name) || findPrimitive(layout.name, &probe)) {
+            return fail(QObject::tr("'%1' is already a type").arg(layout.name));
+        }
+        if (!expect("{")) return false;
+        while (!accept("}")) {
+            if (peek().type == Token::End) return fail(QObject::tr("missing '}'"));
+            if (!parseField(&layout)) return false;
+        }
+        accept(";");
+
+        if (layout.size == 0) return fail(QObject::tr("'%1' is empty").arg(layout.name));
+        for (int i = 0; i < layout.fields.size(); ++i) {
+            layout.fields[i].colorIndex = i;
+        }
+        m_layouts->append(layout);
+        return true;
+    }
+
+    bool parseField(StructTemplate::Layout *layout) {
+        QString type;
+        QString name;
+        if (!identifier(&type, QObject::tr("a type")) || !identifier(&name, QObject::tr("a field name"))) return false;
+        qint64 count = 1;
+        bool array = false;
+        if (accept("[")) {
+            if (peek().type != Token::Number) return fail(QObject::tr("expected an array length"));
+            count = take().number;
+            if (count < 1 || count > MAX_ARRAY) return fail(QObject::tr("bad array length %1").arg(count));
+            array = true;
+            if (!expect("]")) return false;
+        }
+        if (!expect(";")) return false;
+
+        StructTemplate::Field field;
+        if (findPrimitive(type, &field)) {
+            field.name = name;
+            field.offset = layout->size;
+            field.count = int(count);
+            layout->fields.append(field);
+            layout->size += qint64(field.size) * count;
+        } else if (const StructTemplate::Layout *sub = findStruct(type)) {
+            if (layout->fields.size() + sub->fields.size() * count > MAX_FIELDS) {
+                return fail(QObject::tr("'%1' has more than %2 fields").arg(layout->name).arg(MAX_FIELDS));
+            }
+            // Se desenrolla: cada registro del array aporta sus propios campos con desplazamiento absoluto
+            for (qint64 k = 0; k < count; ++k) {
+                const QString prefix = array ? QString("%1[%2].").arg(name).arg(k) : name + '.';
+                const qint64 base = layout->size + sub->size * k;
+                for (StructTemplate::Field subField : sub->fields) {
+                    subField.name = prefix + subField.name;
+                    subField.offset += base;
+                    layout->fields.append(subField);
+                }
+            }
+            layout->size += sub->size * count;
+        } else {
+            return fail(QObject::tr("unknown type '%1'").arg(type));
+        }
+        if (layout->size > MAX_STRUCT_SIZE) return fail(QObject::tr("'%1' is too large").arg(layout->name));
+        return true;
+    }
+
+    const QVector<Token> &m_tokens;
+    QVector<StructTemplate::Layout> *m_layouts;
+    QString *m_error;
+    int m_pos = 0;
+};
+
+}
+
+int StructTemplate::Layout::firstFieldAfter(qint64 offset) const {
+    auto it = std::upper_bound(fields.constBegin(), fields.constEnd(), offset,
+                               [](qint64 value, const Field &field) { return value < field.end(); });
+    return int(it - fields.constBegin());
+}
+
+bool StructTemplate::compile(const QString &source, QVector<Layout> *layouts, QString *error) {
+    QVector<Token> tokens;
+    QVector<Layout> compiled;
+    QString message;
+    if (!tokenize(source, &tokens, &message) || !Compiler(tokens, &compiled, &message).run()) {
+        if (error) *error = message;
+        return false;
+    }
+    *layouts = compiled;
+    return true;
+}
+
+quint64 StructTemplate::readUnsigned(const uchar *data, int size, bool bigEndian) {
+    quint64 value = 0;
+    for (int i = 0; i < size; ++i) {
+        const int shift = 8 * (bigEndian ? size - 1 - i : i);
+        value |= quint64(data[i]) << shift;
+    }
+    return value;
+}
+
+QString StructTemplate::formatValue(FieldKind kind, int size, bool bigEndian, const uchar *data) {
+    const quint64 value = readUnsigned(data, size, bigEndian);
+    switch (kind) {
+    case Unsigned:
+        return QString::number(value);
+    case Signed: {
+        quint64 extended = value;
+        if (size < 8 && (value >> (size * 8 - 1)) & 1) extended |= ~quint64(0) << (size * 8);
+        return QString::number(qint64(extended));
+    }
+    case Float:
+        if (size == 4) {
+            const quint32 bits = quint32(value);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            return QString::number(f, 'g', 9);
+        } else {
+            double d;
+            memcpy(&d, &value, sizeof(d));
+            return QString::number(d, 'g', 17);
+        }
+    case Bytes:
+        break;
+    }
+    QString hex;
+    for (int i = 0; i < size; ++i) {
+        hex += QString("%1").arg(data[i], 2, 16, QChar('0')).toUpper();
+    }
+    return hex;
+}
+
+QString StructTemplate::formatField(const Field &field, const uchar *data) {
+    if (field.kind == Bytes) {
+        const int shown = std::min(field.count, MAX_LISTED_BYTES);
+        QStringList bytes;
+        for (int i = 0; i < shown; ++i) {
+            bytes << QString("%1").arg(data[i], 2, 16, QChar('0')).toUpper();
+        }
+        return bytes.join(' ') + (field.count > shown ? " ..." : "");
+    }
+    if (field.count == 1) return formatValue(field.kind, field.size, field.bigEndian, data);
+
+    const int shown = std::min(field.count, MAX_LISTED_ELEMENTS);
+    QStringList values;
+    for (int i = 0; i < shown; ++i) {
+        values << formatValue(field.kind, field.size, field.bigEndian, data + i * field.size);
+    }
+    if (field.count > shown) values << "...";
+    return "[" + values.join(", ") + "]";
+}
+
+TemplateOverlay::TemplateOverlay() {
+    // Campos vecinos en colores distintos; translúcidos para que se vea la selección por debajo
+    m_palette << QColor(230, 120, 60, 70) << QColor(70, 140, 230, 70) << QColor(120, 200, 80, 70)
+              << QColor(200, 90, 200, 70) << QColor(230, 200, 50, 70) << QColor(60, 200, 200, 70);
+}
+
+void TemplateOverlay::addInstance(const TemplateInstance &instance) {
+    if (instance.layout.size <= 0 || instance.count <= 0) return;
+    m_instances.append(instance);
+}
+
+const TemplateInstance *TemplateOverlay::instanceAt(qint64 offset) const {
+    for (int i = m_instances.size() - 1; i >= 0; --i) {
+        const TemplateInstance &instance = m_instances.at(i);
+        if (offset >= instance.start && offset < instance.end()) return &instance;
+    }
+    return nullptr;
+}
+
+void TemplateOverlay::query(qint64 start, qint64 end, QVector<HexHighlight> &out) const {
+    for (const TemplateInstance &instance : m_instances) {
+        const qint64 from = std::max(start, instance.start);
+        const qint64 to = std::min(end, instance.end());
+        if (from >= to) continue;
+
+        // El registro y el campo del primer byte salen por aritmética y una búsqueda binaria;
+        // a partir de ahí solo se recorren los campos que caen en [from, to)
+        const StructTemplate::Layout &layout = instance.layout;
+        qint64 recordStart = instance.start + (from - instance.start) / layout.size * layout.size;
+        int field = layout.firstFieldAfter(from - recordStart);
+        while (recordStart < to) {
+            for (; field < layout.fields.size(); ++field) {
+                const StructTemplate::Field &f = layout.fields.at(field);
+                if (recordStart + f.offset >= to) break;
+                HexHighlight highlight;
+                highlight.start = recordStart + f.offset;
+                highlight.end = recordStart + f.end();
+                highlight.color = m_palette.at(f.colorIndex % m_palette.size());
+                out.append(highlight);
+            }
+            if (field < layout.fields.size()) break;
+            recordStart += layout.size;
+            field = 0;
+        }
+    }
+}
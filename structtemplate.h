@@ -0,0 +1,88 @@
+#ifndef STRUCTTEMPLATE_H
+#define STRUCTTEMPLATE_H
+
+#include <QString>
+#include <QVector>
+#include <QColor>
+
+#include "hexoverlay.h"
+
+// Plantillas de estructuras al estilo C; se compilan una vez a una tabla plana de campos
+namespace StructTemplate {
+
+enum FieldKind {
+    Unsigned,
+    Signed,
+    Float,
+    Bytes           // char arrays and padding, shown as raw bytes
+};
+
+struct Field {
+    QString name;       // Full path, e.g. "sprites[3].tile"
+    qint64 offset = 0;  // From the start of the record
+    int size = 1;       // Of one element
+    int count = 1;      // Arrays of primitives stay a single field
+    FieldKind kind = Unsigned;
+    bool bigEndian = false;
+    int colorIndex = 0;
+
+    qint64 end() const { return offset + qint64(size) * count; }
+};
+
+// A compiled struct: every field of nested structs and struct arrays unrolled, sorted by offset
+struct Layout {
+    QString name;
+    qint64 size = 0;
+    QVector<Field> fields;
+
+    // Index of the first field ending after 'offset', or fields.size()
+    int firstFieldAfter(qint64 offset) const;
+};
+
+// Compiles every "struct Name { type field; type field[N]; ... }" in 'source'. Types are u8 s8 u16
+// s16 u24 u32 s32 u64 s64 f32 f64 and char, with a "be" suffix for big endian (u16be), plus any
+// struct defined before. "//" starts a comment. On failure 'error' says where and why.
+bool compile(const QString &source, QVector<Layout> *layouts, QString *error);
+
+// Reads an integer of 1-8 bytes
+quint64 readUnsigned(const uchar *data, int size, bool bigEndian);
+// One value of 'kind'; 'data' must hold 'size' bytes
+QString formatValue(FieldKind kind, int size, bool bigEndian, const uchar *data);
+// Bytes formatField() may look at, at most
+const int FORMATTED_BYTES = 64;
+// Every element of 'field' (the first few of long arrays); 'data' points at the field and holds
+// its first FORMATTED_BYTES bytes, or all of them when the field is shorter
+QString formatField(const Field &field, const uchar *data);
+
+}
+
+// Plantillas aplicadas en el documento: 'count' registros seguidos desde 'start'
+struct TemplateInstance {
+    qint64 start = 0;
+    qint64 count = 1;
+    StructTemplate::Layout layout;
+
+    qint64 end() const { return start + layout.size * count; }
+};
+
+// Colors the fields of each record. A query only touches the records and fields in [start, end),
+// so thousands of repeated records cost the same as one per painted line.
+class TemplateOverlay : public HexOverlay
+{
+public:
+    TemplateOverlay();
+
+    void addInstance(const TemplateInstance &instance);
+    void clear() { m_instances.clear(); }
+    bool isEmpty() const { return m_instances.isEmpty(); }
+    // The last applied instance covering 'offset', or nullptr
+    const TemplateInstance *instanceAt(qint64 offset) const;
+
+    void query(qint64 start, qint64 end, QVector<HexHighlight> &out) const override;
+
+private:
+    QVector<TemplateInstance> m_instances;
+    QVector<QColor> m_palette;
+};
+
+#endif // STRUCTTEMPLATE_H
@@ -0,0 +1,398 @@
+#include "textregions.h"
+#include "hexeditorarea.h"
+#include "perftrace.h"
+
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <QListWidget>
+#include <QListWidgetItem>
+#include <QLabel>
+#include <QSpinBox>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFont>
+#include <QtAlgorithms>
+#include <algorithm>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define TEXT_SCAN_SSSE3
+#endif
+
+const qint64 SCAN_BLOCK = 16;
+const qint64 CANCEL_CHECK_BYTES = 1 << 20;
+// Un byte que no es texto cuesta lo que nueve que sí lo son: el tramo se mantiene por encima del 90%
+const int TEXT_SCORE = 1;
+const int OTHER_SCORE = -9;
+const int SCORE_CAP = 72;       // Keeps a long text from carrying the run deep into the garbage after it
+const int SCORE_FLOOR = -18;    // Below this the run is over
+const int DEFAULT_MIN_LENGTH = 16;
+const int SCAN_DELAY_MS = 200;
+const int MAX_LISTED_RUNS = 100000;
+const int PREVIEW_CHARS = 40;
+const qint64 RESCAN_MARGIN = 128;   // How far past a byte scan() looks before deciding anything about it
+
+TextScan::Membership TextScan::membership(const CharTable &table) {
+    Membership members;
+    std::fill(members.bits, members.bits + 32, 0);
+    for (int b = 0; b < 256; ++b) {
+        if (table.map[b] != ".") members.bits[b >> 3] |= 1 << (b & 7);
+    }
+    return members;
+}
+
+QVector<TextRun> TextScan::scan(const uchar *data, qint64 size, const Membership &members, qint64 minLength,
+                                const QAtomicInt *cancel) {
+    HT_PROFILE_SCOPE("textScan");
+    HT_PROFILE_BYTES(size);
+    QVector<TextRun> runs;
+
+    bool isText[256];
+    for (int b = 0; b < 256; ++b) {
+        isText[b] = members.contains(b);
+    }
+
+#ifdef TEXT_SCAN_SSSE3
+    // Mapa de 256 bits como 16 filas (nibble bajo) x 16 bits (nibble alto), partido en dos
+    // mitades de 8 bits para pshufb; la tercera tabla da el bit del nibble alto.
+    alignas(16) quint8 lowRows[16] = {};
+    alignas(16) quint8 highRows[16] = {};
+    alignas(16) quint8 bitOf[16];
+    for (int lo = 0; lo < 16; ++lo) {
+        for (int hi = 0; hi < 16; ++hi) {
+            if (!isText[hi << 4 | lo]) continue;
+            if (hi < 8) lowRows[lo] |= 1 << hi;
+            else highRows[lo] |= 1 << (hi - 8);
+        }
+        bitOf[lo] = 1 << (lo & 7);
+    }
+    const __m128i lowTable = _mm_load_si128(reinterpret_cast<const __m128i *>(lowRows));
+    const __m128i highTable = _mm_load_si128(reinterpret_cast<const __m128i *>(highRows));
+    const __m128i bitTable = _mm_load_si128(reinterpret_cast<const __m128i *>(bitOf));
+    const __m128i rowIndex = _mm_set1_epi8((char)0x8F);     // Bit 7 set makes pshufb return 0
+    const __m128i topBit = _mm_set1_epi8((char)0x80);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+#endif
+
+    // Bit i set when data[pos + i] is text
+    auto textMask = [&](qint64 pos, qint64 count) -> quint32 {
+#ifdef TEXT_SCAN_SSSE3
+        if (count == SCAN_BLOCK) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+            const __m128i rows = _mm_or_si128(_mm_shuffle_epi8(lowTable, _mm_and_si128(v, rowIndex)),
+                                              _mm_shuffle_epi8(highTable, _mm_and_si128(_mm_xor_si128(v, topBit), rowIndex)));
+            const __m128i bit = _mm_shuffle_epi8(bitTable, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+            return (quint32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(rows, bit), bit));
+        }
+#endif
+        quint32 mask = 0;
+        for (qint64 i = 0; i < count; ++i) {
+            mask |= (quint32)isText[data[pos + i]] << i;
+        }
+        return mask;
+    };
+
+    // 64 bytes classified at a time; bits past the end of the data stay clear
+    auto textBits = [&](qint64 base) -> quint64 {
+        quint64 bits = 0;
+        for (qint64 at = base; at < std::min(size, base + 64); at += SCAN_BLOCK) {
+            bits |= (quint64)textMask(at, std::min(SCAN_BLOCK, size - at)) << (at - base);
+        }
+        return bits;
+    };
+
+    // A run may only start where the next few bytes are text, which is what keeps the scan
+    // from crawling byte by byte through binary data where a third of the bytes decode.
+    const int window = (int)std::min((qint64)16, std::max((qint64)4, minLength));
+    const quint64 windowMask = (quint64(1) << window) - 1;
+    const uint windowNeed = window - window / 10;
+
+    bool inRun = false;
+    qint64 runStart = 0;
+    qint64 runEnd = 0;      // Last point where the run still held its 90%
+    int score = 0;
+
+    qint64 nextCancelCheck = CANCEL_CHECK_BYTES;
+    quint64 next = size > 0 ? textBits(0) : 0;
+    for (qint64 base = 0; base < size; base += 64) {
+        if (base >= nextCancelCheck) {
+            if (cancel && cancel->loadAcquire()) return runs;
+            nextCancelCheck = base + CANCEL_CHECK_BYTES;
+        }
+
+        const quint64 bits = next;
+        next = base + 64 < size ? textBits(base + 64) : 0;
+        const int count = (int)std::min((qint64)64, size - base);
+        const quint64 full = count == 64 ? ~quint64(0) : (quint64(1) << count) - 1;
+
+        // Bloques enteros de texto o de nada se resuelven sin mirar byte a byte
+        if (!inRun && bits == 0) continue;
+        if (inRun && bits == full && score >= 0) {
+            score = std::min(SCORE_CAP, score + count * TEXT_SCORE);
+            runEnd = base + count;
+            continue;
+        }
+
+        auto shifted = [&](int k) { return (bits >> k) | (next << (64 - k)); };
+        const quint64 candidates = bits & ((shifted(1) & shifted(2)) | (shifted(1) & shifted(3)) | (shifted(2) & shifted(3)));
+
+        int i = 0;
+        while (i < count) {
+            if (!inRun) {
+                // Cheap first cut: a start needs two of the three bytes after it to be text too
+                quint64 starts = (candidates >> i) << i;
+                while (starts) {
+                    i = qCountTrailingZeroBits(starts);
+                    const quint64 ahead = (bits >> i) | (i > 0 ? next << (64 - i) : 0);
+                    if (qPopulationCount(ahead & windowMask) >= windowNeed) break;
+                    starts &= starts - 1;
+                }
+                if (!starts) break;
+                inRun = true;
+                runStart = base + i;
+                score = 0;
+            }
+            if ((bits >> i) & 1) {
+                score = std::min(SCORE_CAP, score + TEXT_SCORE);
+                if (score >= 0) runEnd = base + i + 1;
+            } else {
+                score += OTHER_SCORE;
+                if (score < SCORE_FLOOR) {
+                    // The run ends at its last good point; scanning goes on after this byte
+                    if (runEnd - runStart >= minLength) runs.append(TextRun{runStart, runEnd});
+                    inRun = false;
+                }
+            }
+            ++i;
+        }
+    }
+    if (inRun && runEnd - runStart >= minLength) runs.append(TextRun{runStart, runEnd});
+    return runs;
+}
+
+void TextRegionOverlay::query(qint64 start, qint64 end, QVector<HexHighlight> &out) const {
+    auto it = std::upper_bound(m_runs.constBegin(), m_runs.constEnd(), start,
+                               [](qint64 value, const TextRun &run) { return value < run.end; });
+    for (; it != m_runs.constEnd() && it->start < end; ++it) {
+        HexHighlight highlight;
+        highlight.start = it->start;
+        highlight.end = it->end;
+        highlight.color = m_color;
+        out.append(highlight);
+    }
+}
+
+TextRegionsDock::TextRegionsDock(QThreadPool *pool, QWidget *parent)
+    : QDockWidget(tr("Text Regions"), parent),
+      m_pool(pool)
+{
+    setObjectName("textRegionsDock");
+    setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetClosable);
+
+    QWidget *content = new QWidget(this);
+    m_minLengthSpinBox = new QSpinBox(content);
+    m_minLengthSpinBox->setRange(4, 4096);
+    m_minLengthSpinBox->setValue(DEFAULT_MIN_LENGTH);
+    m_minLengthSpinBox->setSuffix(tr(" bytes"));
+
+    m_list = new QListWidget(content);
+    m_list->setUniformItemSizes(true);
+    QFont mono("Monospace");
+    mono.setStyleHint(QFont::Monospace);
+    m_list->setFont(mono);
+    m_statusLabel = new QLabel(content);
+
+    QHBoxLayout *optionsLayout = new QHBoxLayout;
+    optionsLayout->addWidget(new QLabel(tr("Minimum length:"), content));
+    optionsLayout->addWidget(m_minLengthSpinBox);
+    optionsLayout->addStretch(1);
+
+    QVBoxLayout *layout = new QVBoxLayout(content);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addLayout(optionsLayout);
+    layout->addWidget(m_list);
+    layout->addWidget(m_statusLabel);
+    setWidget(content);
+
+    m_scanTimer.setSingleShot(true);
+    m_scanTimer.setInterval(SCAN_DELAY_MS);
+    connect(&m_scanTimer, &QTimer::timeout, this, &TextRegionsDock::startScan);
+    connect(&m_watcher, &QFutureWatcher<QVector<TextRun>>::finished, this, &TextRegionsDock::handleScanFinished);
+    connect(m_minLengthSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &TextRegionsDock::scheduleScan);
+    connect(m_list, &QListWidget::itemActivated, this, &TextRegionsDock::handleItemActivated);
+    connect(m_list, &QListWidget::itemClicked, this, &TextRegionsDock::handleItemActivated);
+    connect(this, &QDockWidget::visibilityChanged, this, &TextRegionsDock::handleVisibilityChanged);
+}
+
+TextRegionsDock::~TextRegionsDock() {
+    m_cancel.storeRelease(1);
+    m_watcher.waitForFinished();
+    for (auto it = m_states.begin(); it != m_states.end(); ++it) {
+        it.key()->removeOverlay(it->overlay);
+        delete it->overlay;
+    }
+}
+
+void TextRegionsDock::setEditor(HexEditorArea *editor) {
+    if (m_editor == editor) return;
+    m_editor = editor;
+
+    if (editor && !m_states.contains(editor)) {
+        State state;
+        state.overlay = new TextRegionOverlay(QColor(80, 200, 120, 70));
+        m_states.insert(editor, state);
+        if (isVisible()) editor->addOverlay(state.overlay);
+
+        connect(editor, &HexEditorArea::dataChanged, this, &TextRegionsDock::scheduleScan);
+        connect(editor, &HexEditorArea::dataReplaced, this, &TextRegionsDock::scheduleScan);
+        connect(editor, &HexEditorArea::charTableChanged, this, &TextRegionsDock::scheduleScan);
+        connect(editor, &QObject::destroyed, this, [this, editor]() {
+            delete m_states.value(editor).overlay;
+            m_states.remove(editor);
+            if (m_jobEditor == editor) m_jobEditor = nullptr;
+        });
+    }
+    fillList();
+    scheduleScan();
+}
+
+void TextRegionsDock::scheduleScan() {
+    m_scanTimer.start();
+}
+
+void TextRegionsDock::handleVisibilityChanged(bool visible) {
+    // Oculto no se escanea ni se pinta nada
+    attachOverlays(visible);
+    if (visible) scheduleScan();
+}
+
+void TextRegionsDock::attachOverlays(bool attach) {
+    for (auto it = m_states.constBegin(); it != m_states.constEnd(); ++it) {
+        if (attach) it.key()->addOverlay(it->overlay);
+        else it.key()->removeOverlay(it->overlay);
+    }
+}
+
+QByteArray TextRegionsDock::tableKeyFor(const TextScan::Membership &members) {
+    return QByteArray(reinterpret_cast<const char *>(members.bits), sizeof(members.bits));
+}
+
+void TextRegionsDock::startScan() {
+    if (!m_editor || !isVisible()) return;
+    if (m_watcher.isRunning()) {
+        m_cancel.storeRelease(1);   // handleScanFinished() starts over
+        return;
+    }
+
+    const CharTablePtr table = m_editor->charTable();
+    CharTable fallback;
+    if (!table) fallback.fillDefault();
+    const TextScan::Membership members = TextScan::membership(table ? *table : fallback);
+
+    const State state = m_states.value(m_editor);
+    const Job &scanned = state.scanned;
+    Job job;
+    job.tableKey = tableKeyFor(members);
+    job.minLength = m_minLengthSpinBox->value();
+    if (m_editor->buffer().isSameVersion(scanned.data)
+        && job.tableKey == scanned.tableKey && job.minLength == scanned.minLength) {
+        return;
+    }
+    job.data = m_editor->buffer().snapshot();
+
+    m_jobEditor = m_editor;
+    m_job = job;
+    m_cancel.storeRelease(0);
+    const QAtomicInt *cancel = &m_cancel;
+    const QVector<TextRun> previousRuns = state.overlay ? state.overlay->runs() : QVector<TextRun>();
+    m_watcher.setFuture(QtConcurrent::run(m_pool, [job, scanned, previousRuns, members, cancel]() {
+        return rescan(job, scanned, previousRuns, members, cancel);
+    }));
+    m_statusLabel->setText(tr("Scanning..."));
+}
+
+QVector<TextRun> TextRegionsDock::rescan(const Job &job, const Job &previous, const QVector<TextRun> &previousRuns,
+                                         const TextScan::Membership &members, const QAtomicInt *cancel) {
+    // Con la misma tabla y longitud, lo anterior al cambio no varía: se sigue desde el último tramo
+    // que empieza lo bastante antes, donde scan() estaba fuera de un tramo
+    QVector<TextRun> runs;
+    qint64 restart = 0;
+    if (job.tableKey == previous.tableKey && job.minLength == previous.minLength) {
+        const qint64 from = job.data.firstDifference(previous.data);
+        auto it = std::upper_bound(previousRuns.constBegin(), previousRuns.constEnd(), from - RESCAN_MARGIN,
+                                   [](qint64 value, const TextRun &run) { return value < run.start; });
+        if (it != previousRuns.constBegin()) {
+            --it;
+            restart = it->start;
+            runs = previousRuns.mid(0, int(it - previousRuns.constBegin()));
+        }
+    }
+
+    const QByteArray tail = job.data.read(restart, job.data.size() - restart);
+    const QVector<TextRun> found = TextScan::scan(reinterpret_cast<const uchar *>(tail.constData()), tail.size(),
+                                                  members, job.minLength, cancel);
+    runs.reserve(runs.size() + found.size());
+    for (const TextRun &run : found) {
+        runs.append(TextRun{run.start + restart, run.end + restart});
+    }
+    return runs;
+}
+
+void TextRegionsDock::handleScanFinished() {
+    auto it = m_states.find(m_jobEditor);
+    if (m_cancel.loadAcquire() == 0 && m_jobEditor && it != m_states.end()) {
+        it->overlay->setRuns(m_watcher.result());
+        it->scanned = m_job;
+        m_jobEditor->invalidateView();
+        if (m_jobEditor == m_editor) fillList();
+    }
+    m_jobEditor = nullptr;
+    m_job = Job();
+    startScan();
+}
+
+void TextRegionsDock::fillList() {
+    m_list->clear();
+    auto it = m_states.constFind(m_editor);
+    if (!m_editor || it == m_states.constEnd()) {
+        m_statusLabel->clear();
+        return;
+    }
+
+    const QVector<TextRun> &runs = it->overlay->runs();
+    const PieceTable &data = it->scanned.data;
+    const CharTablePtr table = m_editor->charTable();
+    qint64 textBytes = 0;
+
+    m_list->setUpdatesEnabled(false);
+    for (int i = 0; i < runs.size(); ++i) {
+        const TextRun &run = runs.at(i);
+        textBytes += run.end - run.start;
+        if (i >= MAX_LISTED_RUNS) continue;
+
+        QString preview;
+        const QByteArray head = data.read(run.start, std::min(run.end - run.start, (qint64)PREVIEW_CHARS));
+        for (char byte : head) {
+            preview += table ? table->map[(uchar)byte] : QString(".");
+        }
+        if (run.end - run.start > PREVIEW_CHARS) preview += "...";
+        preview.replace('\n', ' ');
+
+        QString text = QString("%1  %2  ").arg(run.start, 8, 16, QChar('0')).toUpper().arg(run.end - run.start, 6);
+        QListWidgetItem *item = new QListWidgetItem(text + preview, m_list);
+        item->setData(Qt::UserRole, run.start);
+        item->setData(Qt::UserRole + 1, run.end - run.start);
+    }
+    m_list->setUpdatesEnabled(true);
+
+    QString status = tr("%n region(s), %1 bytes", "", runs.size()).arg(textBytes);
+    if (runs.size() > m_list->count()) {
+        status += tr(" (first %1 listed)").arg(m_list->count());
+    }
+    m_statusLabel->setText(status);
+}
+
+void TextRegionsDock::handleItemActivated(QListWidgetItem *item) {
+    if (!item || !m_editor) return;
+    emit runActivated(m_editor, item->data(Qt::UserRole).toLongLong(), item->data(Qt::UserRole + 1).toLongLong());
+}
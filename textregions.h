@@ -0,0 +1,116 @@
+#ifndef TEXTREGIONS_H
+#define TEXTREGIONS_H
+
+#include <QDockWidget>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QPointer>
+#include <QFutureWatcher>
+#include <QAtomicInt>
+#include <QTimer>
+#include <QColor>
+
+#include "chartable.h"
+#include "hexoverlay.h"
+#include "piecetable.h"
+
+class QThreadPool;
+class QListWidget;
+class QListWidgetItem;
+class QLabel;
+class QSpinBox;
+class HexEditorArea;
+
+// Tramo [start, end) que la tabla decodifica casi entero
+struct TextRun {
+    qint64 start = 0;
+    qint64 end = 0;
+};
+
+namespace TextScan {
+
+// Bit b is set when the table maps byte b to something other than "."
+struct Membership {
+    quint8 bits[32];
+    bool contains(quint8 byte) const { return (bits[byte >> 3] >> (byte & 7)) & 1; }
+};
+
+Membership membership(const CharTable &table);
+
+// Runs at least 'minLength' long where >= 90% of the bytes are in 'members'. The runs come
+// out sorted and never overlap. Returns early (with what it has) once 'cancel' is set.
+QVector<TextRun> scan(const uchar *data, qint64 size, const Membership &members, qint64 minLength,
+                      const QAtomicInt *cancel = nullptr);
+
+}
+
+// Runs of one scan, looked up by binary search; paints them behind the bytes
+class TextRegionOverlay : public HexOverlay
+{
+public:
+    explicit TextRegionOverlay(const QColor &color) : m_color(color) {}
+
+    void setRuns(const QVector<TextRun> &runs) { m_runs = runs; }
+    const QVector<TextRun> &runs() const { return m_runs; }
+
+    void query(qint64 start, qint64 end, QVector<HexHighlight> &out) const override;
+
+private:
+    QVector<TextRun> m_runs;
+    QColor m_color;
+};
+
+// Lista de zonas de texto del documento activo; se vuelve a calcular al editar o cambiar la tabla
+class TextRegionsDock : public QDockWidget
+{
+    Q_OBJECT
+public:
+    explicit TextRegionsDock(QThreadPool *pool, QWidget *parent = nullptr);
+    ~TextRegionsDock() override;
+
+    void setEditor(HexEditorArea *editor);
+
+signals:
+    void runActivated(HexEditorArea *editor, qint64 offset, qint64 length);
+
+private slots:
+    void scheduleScan();
+    void startScan();
+    void handleScanFinished();
+    void handleItemActivated(QListWidgetItem *item);
+    void handleVisibilityChanged(bool visible);
+
+private:
+    struct Job {
+        PieceTable data;
+        QByteArray tableKey;
+        qint64 minLength = 0;
+    };
+    struct State {
+        TextRegionOverlay *overlay = nullptr;
+        Job scanned;            // Inputs of the runs the overlay holds
+    };
+
+    static QByteArray tableKeyFor(const TextScan::Membership &members);
+    static QVector<TextRun> rescan(const Job &job, const Job &previous, const QVector<TextRun> &previousRuns,
+                                   const TextScan::Membership &members, const QAtomicInt *cancel);
+    void attachOverlays(bool attach);
+    void fillList();
+
+    QThreadPool *m_pool;
+    QPointer<HexEditorArea> m_editor;
+    QHash<HexEditorArea *, State> m_states;
+
+    QListWidget *m_list = nullptr;
+    QLabel *m_statusLabel = nullptr;
+    QSpinBox *m_minLengthSpinBox = nullptr;
+
+    HexEditorArea *m_jobEditor = nullptr;
+    Job m_job;
+    QAtomicInt m_cancel;
+    QFutureWatcher<QVector<TextRun>> m_watcher;
+    QTimer m_scanTimer;
+};
+
+#endif // TEXTREGIONS_H